@@ -0,0 +1,90 @@
+// Pasarela de los reportes por SMS: lee PDU en hexadecimal (uno por línea),
+// une las partes concatenadas y escribe cada reporte como los parámetros de
+// la petición HTTP del rastreador, precedidos del número que lo envió:
+//
+//   +5215550001111 lat=18.926113&lon=-99.230733&speed=42.5&seq=17&ts=1714558222&oldest=12
+//
+// El servidor de la pasarela agrega el token del número y llama a API_PATH.
+// Las líneas que no son hexadecimales se ignoran, así se puede pasar tal cual
+// la salida de AT+CMGL=4 en modo PDU.
+//
+//   g++ -std=c++11 -I src/findme32 pasarela/pasarela_sms.cpp src/findme32/FormatoSMS.cpp -o pasarela_sms
+//   ./pasarela_sms < pdus.txt
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "FormatoSMS.h"
+
+// Partes recibidas de un mensaje concatenado, por remitente y referencia
+struct Pendiente {
+  uint8_t partes;
+  std::map<uint8_t, std::vector<uint8_t> > recibidas;
+};
+
+static void imprimirReportes(const char* numero, const std::vector<uint8_t>& carga) {
+  ReporteSMS reportes[255];
+  uint32_t masAntigua = 0;
+  int n = desempaquetarReportes(carga.data(), carga.size(), masAntigua, reportes, 255);
+  if (n < 0) {
+    fprintf(stderr, "Carga inválida de %s (%u bytes)\n", numero, (unsigned)carga.size());
+    return;
+  }
+  for (int i = 0; i < n; i++) {
+    const ReporteSMS& r = reportes[i];
+    printf("%s lat=%.6f&lon=%.6f", numero, r.lat / 1e6, r.lon / 1e6);
+    if (r.velocidad != REPORTE_SMS_SIN_VELOCIDAD) {
+      printf("&speed=%.1f", r.velocidad / 10.0);
+    }
+    printf("&seq=%lu", (unsigned long)r.secuencia);
+    if (r.utc != 0) {
+      printf("&ts=%lu", (unsigned long)r.utc);
+    }
+    printf("&oldest=%lu\n", (unsigned long)masAntigua);
+  }
+  fflush(stdout);
+}
+
+int main() {
+  std::map<std::string, Pendiente> pendientes;
+  char linea[1024];
+  uint8_t pdu[512];
+
+  while (fgets(linea, sizeof(linea), stdin) != NULL) {
+    linea[strcspn(linea, "\r\n")] = '\0';
+    size_t n = deHexadecimal(linea, pdu, sizeof(pdu));
+    SMSBinario sms;
+    if (n == 0 || !leerPDU(pdu, n, sms)) {
+      continue;
+    }
+
+    if (!sms.concatenado) {
+      imprimirReportes(sms.numero, std::vector<uint8_t>(sms.datos, sms.datos + sms.largo));
+      continue;
+    }
+
+    char clave[64];
+    snprintf(clave, sizeof(clave), "%s/%u/%u", sms.numero, (unsigned)sms.referencia, (unsigned)sms.partes);
+    Pendiente& p = pendientes[clave];
+    p.partes = sms.partes;
+    p.recibidas[sms.parte].assign(sms.datos, sms.datos + sms.largo);
+    if (p.recibidas.size() < p.partes) {
+      continue;
+    }
+
+    // Completo: las partes en orden, sin importar cómo llegaron
+    std::vector<uint8_t> carga;
+    for (std::map<uint8_t, std::vector<uint8_t> >::iterator it = p.recibidas.begin(); it != p.recibidas.end(); ++it) {
+      carga.insert(carga.end(), it->second.begin(), it->second.end());
+    }
+    imprimirReportes(sms.numero, carga);
+    pendientes.erase(clave);
+  }
+
+  for (std::map<std::string, Pendiente>::iterator it = pendientes.begin(); it != pendientes.end(); ++it) {
+    fprintf(stderr, "Incompleto: %s (%u de %u partes)\n", it->first.c_str(), (unsigned)it->second.recibidas.size(),
+            (unsigned)it->second.partes);
+  }
+  return 0;
+}
@@ -0,0 +1,369 @@
+// Contrato del endpoint de recepción (README, "API Backend"), del lado del
+// servidor: análisis de la petición del rastreador sobre el búfer de la
+// conexión, sin copiar ni reservar memoria, y el estado de confirmación
+// ("ack") de cada dispositivo.
+//
+// Solo depende de la biblioteca de C: lo usan servidor/ingesta.cpp,
+// servidor/carga.cpp y las pruebas nativas.
+#ifndef CONTRATOGPS_H
+#define CONTRATOGPS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define CONTRATO_MAX_FIXES 64     // Principal más el lote
+#define CONTRATO_MAX_EXTRA 8      // Parámetros que el contrato aún no define
+#define CONTRATO_SIN_VELOCIDAD (-1)
+#define CONTRATO_SIN_RUMBO (-1)
+#define CONTRATO_VENTANA 64       // Secuencias por encima de ack que se recuerdan
+
+// Trozo del búfer de entrada: no termina en '\0'
+struct Texto {
+  const char* p;
+  size_t n;
+
+  bool igual(const char* s) const { return strlen(s) == n && memcmp(p, s, n) == 0; }
+};
+
+// Un fix en enteros: grados x 1e6, décimas de km/h y de grado
+struct FixGPS {
+  uint32_t seq;
+  uint32_t ts;        // 0 si el dispositivo aún no tiene hora
+  int32_t lat;
+  int32_t lon;
+  int32_t velocidad;  // CONTRATO_SIN_VELOCIDAD si no viene
+  int32_t rumbo;      // CONTRATO_SIN_RUMBO si no viene (solo el reporte por estima lo envía)
+};
+
+struct PeticionGPS {
+  Texto metodo;
+  Texto ruta;
+  Texto token;
+  FixGPS fixes[CONTRATO_MAX_FIXES];  // [0] es el principal; luego el lote, del más antiguo al más nuevo
+  int nFixes;
+  uint32_t oldest;
+  bool hayOldest;
+  Texto extra[CONTRATO_MAX_EXTRA];   // "clave=valor" tal cual llegaron
+  int nExtra;
+  bool consulta;                     // token, lat, lon y seq presentes y bien formados
+  bool mantener;                     // HTTP/1.1 sin "Connection: close"
+  size_t largo;                      // Bytes de la petición, cabeceras incluidas
+  size_t cuerpo;                     // Content-Length
+};
+
+enum ResultadoAnalisis {
+  ANALISIS_INCOMPLETA,  // Faltan bytes: seguir leyendo
+  ANALISIS_OK,          // Ruta, método y 'consulta' se responden aparte (404, 405, 400)
+  ANALISIS_INVALIDA     // No es HTTP/1.x: responder 400 y cerrar
+};
+
+namespace contrato {
+
+inline bool esDigito(char c) { return c >= '0' && c <= '9'; }
+
+inline char minuscula(char c) { return c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c; }
+
+inline bool igualSinMayusculas(const char* a, const char* b, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    if (minuscula(a[i]) != minuscula(b[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Entero sin signo de 32 bits; false si hay otra cosa o desborda
+inline bool leerNatural(const char* p, size_t n, uint32_t& valor) {
+  if (n == 0 || n > 10) {
+    return false;
+  }
+  uint64_t v = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (!esDigito(p[i])) {
+      return false;
+    }
+    v = v * 10 + (uint32_t)(p[i] - '0');
+  }
+  if (v > 0xFFFFFFFFULL) {
+    return false;
+  }
+  valor = (uint32_t)v;
+  return true;
+}
+
+inline bool leerEntero(const char* p, size_t n, int32_t& valor) {
+  bool negativo = n > 0 && p[0] == '-';
+  uint32_t v = 0;
+  if (!leerNatural(p + negativo, n - negativo, v) || v > 0x7FFFFFFFUL) {
+    return false;
+  }
+  valor = negativo ? -(int32_t)v : (int32_t)v;
+  return true;
+}
+
+// Decimal "-18.9261" como entero x 10^decimales, redondeando las cifras sobrantes
+inline bool leerFijo(const char* p, size_t n, int decimales, int32_t& valor) {
+  size_t i = 0;
+  bool negativo = false;
+  if (i < n && (p[i] == '-' || p[i] == '+')) {
+    negativo = p[i] == '-';
+    i++;
+  }
+  int64_t v = 0;
+  int cifras = 0;
+  int fraccion = -1;  // Cifras tras el punto; -1 sin punto
+  bool redondear = false;
+  for (; i < n; i++) {
+    if (p[i] == '.' && fraccion < 0) {
+      fraccion = 0;
+    } else if (esDigito(p[i])) {
+      if (fraccion < decimales) {
+        v = v * 10 + (p[i] - '0');
+        if (fraccion >= 0) fraccion++;
+        if (++cifras > 12) return false;
+      } else if (fraccion == decimales) {
+        redondear = p[i] >= '5';
+        fraccion++;
+      }
+    } else {
+      return false;
+    }
+  }
+  if (cifras == 0) {
+    return false;
+  }
+  for (int f = fraccion < 0 ? 0 : (fraccion > decimales ? decimales : fraccion); f < decimales; f++) {
+    v *= 10;
+  }
+  v += redondear;
+  if (v > 0x7FFFFFFFLL) {
+    return false;
+  }
+  valor = negativo ? -(int32_t)v : (int32_t)v;
+  return true;
+}
+
+// Lote "dseq,dlat,dlon,dts" separados por '_', relativo al fix principal
+inline bool leerLote(const char* p, size_t n, PeticionGPS& peticion) {
+  const FixGPS& principal = peticion.fixes[0];
+  size_t i = 0;
+  while (i < n) {
+    if (peticion.nFixes >= CONTRATO_MAX_FIXES) {
+      return false;
+    }
+    int32_t campos[4];
+    for (int c = 0; c < 4; c++) {
+      size_t inicio = i;
+      while (i < n && p[i] != ',' && p[i] != '_') i++;
+      if (!leerEntero(p + inicio, i - inicio, campos[c])) {
+        return false;
+      }
+      if (c < 3) {
+        if (i >= n || p[i] != ',') return false;
+        i++;
+      }
+    }
+    if (i < n) {
+      if (p[i] != '_') return false;
+      i++;
+    }
+    FixGPS& f = peticion.fixes[peticion.nFixes++];
+    f.seq = principal.seq - (uint32_t)campos[0];
+    f.lat = principal.lat + campos[1];
+    f.lon = principal.lon + campos[2];
+    f.ts = principal.ts != 0 && campos[3] != 0 ? principal.ts - (uint32_t)campos[3] : 0;
+    f.velocidad = CONTRATO_SIN_VELOCIDAD;
+    f.rumbo = CONTRATO_SIN_RUMBO;
+  }
+  return true;
+}
+
+// Los parámetros de la consulta; el lote se lee al final, cuando ya se conoce el principal
+inline bool leerConsulta(const char* p, size_t n, PeticionGPS& peticion) {
+  bool hayLat = false, hayLon = false, haySeq = false;
+  const char* lote = NULL;
+  size_t largoLote = 0;
+  FixGPS& principal = peticion.fixes[0];
+  size_t i = 0;
+  while (i < n) {
+    size_t inicio = i;
+    while (i < n && p[i] != '&') i++;
+    const char* par = p + inicio;
+    size_t largo = i - inicio;
+    if (i < n) i++;
+    const char* igual = (const char*)memchr(par, '=', largo);
+    if (igual == NULL) {
+      continue;
+    }
+    Texto clave = { par, (size_t)(igual - par) };
+    const char* v = igual + 1;
+    size_t nv = largo - clave.n - 1;
+    bool ok = true;
+    if (clave.igual("lat")) {
+      ok = hayLat = leerFijo(v, nv, 6, principal.lat);
+    } else if (clave.igual("lon")) {
+      ok = hayLon = leerFijo(v, nv, 6, principal.lon);
+    } else if (clave.igual("speed")) {
+      ok = leerFijo(v, nv, 1, principal.velocidad);
+    } else if (clave.igual("course")) {
+      ok = leerFijo(v, nv, 1, principal.rumbo) && principal.rumbo >= 0 && principal.rumbo < 3600;
+    } else if (clave.igual("seq")) {
+      ok = haySeq = leerNatural(v, nv, principal.seq);
+    } else if (clave.igual("ts")) {
+      ok = leerNatural(v, nv, principal.ts);
+    } else if (clave.igual("oldest")) {
+      ok = peticion.hayOldest = leerNatural(v, nv, peticion.oldest);
+    } else if (clave.igual("token")) {
+      peticion.token.p = v;
+      peticion.token.n = nv;
+    } else if (clave.igual("lote")) {
+      lote = v;
+      largoLote = nv;
+    } else if (peticion.nExtra < CONTRATO_MAX_EXTRA) {
+      // Lo que agregue el firmware después se conserva sin interpretarlo
+      peticion.extra[peticion.nExtra].p = par;
+      peticion.extra[peticion.nExtra].n = largo;
+      peticion.nExtra++;
+    }
+    if (!ok) {
+      return false;
+    }
+  }
+  // Sin seq (firmware anterior a los reportes idempotentes) el fix no se puede deduplicar
+  if (!hayLat || !hayLon || !haySeq || peticion.token.n == 0) {
+    return false;
+  }
+  return lote == NULL || leerLote(lote, largoLote, peticion);
+}
+
+}  // namespace contrato
+
+// Analiza la petición al inicio de 'datos'; los Texto apuntan a 'datos'
+inline ResultadoAnalisis analizarPeticion(const char* datos, size_t n, PeticionGPS& peticion) {
+  using namespace contrato;
+  const char* fin = NULL;
+  for (size_t i = 3; i < n; i++) {
+    if (datos[i] == '\n' && datos[i - 1] == '\r' && datos[i - 2] == '\n' && datos[i - 3] == '\r') {
+      fin = datos + i + 1;
+      break;
+    }
+  }
+  if (fin == NULL) {
+    return ANALISIS_INCOMPLETA;
+  }
+
+  peticion.nFixes = 1;
+  peticion.nExtra = 0;
+  peticion.hayOldest = false;
+  peticion.oldest = 0;
+  peticion.token.p = NULL;
+  peticion.token.n = 0;
+  peticion.cuerpo = 0;
+  FixGPS& principal = peticion.fixes[0];
+  principal.ts = 0;
+  principal.velocidad = CONTRATO_SIN_VELOCIDAD;
+  principal.rumbo = CONTRATO_SIN_RUMBO;
+
+  // Línea de petición: MÉTODO SP destino SP HTTP/1.x
+  const char* finLinea = (const char*)memchr(datos, '\r', fin - datos);
+  const char* sp1 = (const char*)memchr(datos, ' ', finLinea - datos);
+  if (sp1 == NULL) {
+    return ANALISIS_INVALIDA;
+  }
+  const char* sp2 = (const char*)memchr(sp1 + 1, ' ', finLinea - sp1 - 1);
+  if (sp2 == NULL || finLinea - sp2 - 1 != 8 || memcmp(sp2 + 1, "HTTP/1.", 7) != 0) {
+    return ANALISIS_INVALIDA;
+  }
+  peticion.metodo.p = datos;
+  peticion.metodo.n = sp1 - datos;
+  peticion.mantener = sp2[8] == '1';
+
+  const char* destino = sp1 + 1;
+  const char* interrogacion = (const char*)memchr(destino, '?', sp2 - destino);
+  peticion.ruta.p = destino;
+  peticion.ruta.n = (interrogacion != NULL ? interrogacion : sp2) - destino;
+
+  // Cabeceras que importan: Connection y Content-Length
+  const char* linea = finLinea + 2;
+  while (linea < fin - 2) {
+    const char* salto = (const char*)memchr(linea, '\r', fin - linea);
+    size_t largo = salto - linea;
+    if (largo > 11 && igualSinMayusculas(linea, "connection:", 11)) {
+      const char* v = linea + 11;
+      while (*v == ' ') v++;
+      if (salto - v >= 5 && igualSinMayusculas(v, "close", 5)) peticion.mantener = false;
+      if (salto - v >= 10 && igualSinMayusculas(v, "keep-alive", 10)) peticion.mantener = true;
+    } else if (largo > 15 && igualSinMayusculas(linea, "content-length:", 15)) {
+      const char* v = linea + 15;
+      while (*v == ' ') v++;
+      uint32_t cuerpo = 0;
+      if (!leerNatural(v, salto - v, cuerpo)) {
+        return ANALISIS_INVALIDA;
+      }
+      peticion.cuerpo = cuerpo;
+    }
+    linea = salto + 2;
+  }
+  peticion.largo = (fin - datos) + peticion.cuerpo;
+  if (peticion.largo > n) {
+    return ANALISIS_INCOMPLETA;
+  }
+
+  peticion.consulta = interrogacion != NULL && leerConsulta(interrogacion + 1, sp2 - interrogacion - 1, peticion);
+  return ANALISIS_OK;
+}
+
+/**
+ * Confirmación de un dispositivo: todas las secuencias hasta 'ack' llegaron, y
+ * de las CONTRATO_VENTANA siguientes se recuerda cuáles ya llegaron. Un
+ * reintento de una secuencia recibida no se vuelve a escribir.
+ */
+struct EstadoConfirmacion {
+  uint32_t ack;
+  uint64_t ventana;  // Bit i: llegó ack + 1 + i
+
+  void reiniciar() {
+    ack = 0;
+    ventana = 0;
+  }
+
+  // true si 'seq' es nueva. Más allá de la ventana se acepta sin recordarla.
+  bool registrar(uint32_t seq) {
+    if (seq <= ack) {
+      return false;
+    }
+    uint32_t d = seq - ack - 1;
+    if (d >= CONTRATO_VENTANA) {
+      return true;
+    }
+    uint64_t bit = 1ULL << d;
+    if (ventana & bit) {
+      return false;
+    }
+    ventana |= bit;
+    avanzar();
+    return true;
+  }
+
+  // El dispositivo ya no tiene nada anterior a 'oldest': cuenta como recibido
+  void aplicarOldest(uint32_t oldest) {
+    if (oldest == 0 || oldest - 1 <= ack) {
+      return;
+    }
+    uint32_t salto = oldest - 1 - ack;
+    ventana = salto >= CONTRATO_VENTANA ? 0 : ventana >> salto;
+    ack = oldest - 1;
+    avanzar();
+  }
+
+private:
+  void avanzar() {
+    while (ventana & 1) {
+      ventana >>= 1;
+      ack++;
+    }
+  }
+};
+
+#endif // CONTRATOGPS_H
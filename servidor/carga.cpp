@@ -0,0 +1,421 @@
+// Generador de carga del endpoint de recepción: simula -n rastreadores que
+// reportan cada -i ms como el firmware (la URL de HTTPClient::construirURL con
+// seq, ts y oldest, y con -l lotes de pendientes), con una conexión TCP nueva
+// por reporte o, con -k, conexiones reutilizadas. Comprueba el ack de cada
+// respuesta y cada segundo imprime reportes/s, latencia y retraso respecto
+// del calendario: si el retraso crece, el servidor no da abasto.
+//
+//   g++ -std=c++11 -O2 -Wall -I servidor servidor/carga.cpp -o carga
+//   ./carga -n 20000 -i 20000 -t 60
+//
+// Opciones: -h dirección IPv4 (127.0.0.1), -p puerto (8080), -n rastreadores
+// (10000), -i ms entre reportes de cada uno (20000), -t segundos (30),
+// -c conexiones simultáneas (1000), -l fixes por reporte (1), -k mantener
+// conexiones, -r ruta (/api/gps/gpstracker).
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include "ContratoGPS.h"
+
+#define LATENCIA_MAX_MS 10000
+#define EVENTOS_MAX 1024
+#define SALIDA_BYTES 1024
+#define ENTRADA_BYTES 512
+#define SIN_RASTREADOR (-1)
+
+struct Rastreador {
+  uint32_t seq;        // Último enviado
+  uint32_t confirmado; // ack recibido
+  int32_t lat;         // Grados x 1e6
+  int32_t lon;
+  long long vence;
+};
+
+enum EstadoRanura { INACTIVA, CONECTANDO, ENVIANDO, RECIBIENDO };
+
+struct Ranura {
+  int fd;
+  EstadoRanura estado;
+  int rastreador;
+  long long inicio;
+  size_t largo;
+  size_t enviados;
+  size_t usados;
+  char salida[SALIDA_BYTES];
+  char entrada[ENTRADA_BYTES];
+};
+
+struct Opciones {
+  const char* host;
+  int puerto;
+  int rastreadores;
+  int intervaloMs;
+  int segundos;
+  int conexiones;
+  int lote;
+  bool mantener;
+  const char* ruta;
+};
+
+static Opciones opc = { "127.0.0.1", 8080, 10000, 20000, 30, 1000, 1, false, "/api/gps/gpstracker" };
+
+static int ep;
+static struct sockaddr_in servidor;
+static Rastreador* rastreadores;
+static Ranura* ranuras;
+static int* ranurasLibres;
+static int nLibres;
+
+static struct {
+  unsigned long long enviados, ok, errores, ackAtrasado, conexiones;
+  unsigned long latencia[LATENCIA_MAX_MS + 1];
+  long long retrasoMax;
+} cuenta, segundo;
+
+static long long ahoraMs() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (long long)t.tv_sec * 1000 + t.tv_nsec / 1000000;
+}
+
+static uint32_t azar(uint32_t& estado) {
+  estado ^= estado << 13;  // xorshift32: reproducible y sin estado global de rand()
+  estado ^= estado >> 17;
+  estado ^= estado << 5;
+  return estado;
+}
+
+static long percentil(const unsigned long* latencia, unsigned long long total, double p) {
+  unsigned long long objetivo = (unsigned long long)(total * p);
+  unsigned long long acumulado = 0;
+  for (int ms = 0; ms <= LATENCIA_MAX_MS; ms++) {
+    acumulado += latencia[ms];
+    if (acumulado > objetivo) {
+      return ms;
+    }
+  }
+  return LATENCIA_MAX_MS;
+}
+
+// La petición del firmware: fix principal y, con -l, los pendientes como lote
+static size_t armarPeticion(int indice, Rastreador& r, char* salida, size_t cap, uint32_t& semilla) {
+  uint32_t ts = 1714558222UL + (uint32_t)(ahoraMs() / 1000);
+  uint32_t paso = opc.intervaloMs / 1000 / opc.lote;  // Segundos entre fixes de un mismo reporte
+  // Recorrido desde el último enviado: lat[0] el más antiguo, lat[lote - 1] el principal
+  int32_t lat[CONTRATO_MAX_FIXES], lon[CONTRATO_MAX_FIXES];
+  for (int i = 0; i < opc.lote; i++) {
+    r.lat += (int32_t)(azar(semilla) % 401) - 200;  // Hasta ~20 m por fix
+    r.lon += (int32_t)(azar(semilla) % 401) - 200;
+    lat[i] = r.lat;
+    lon[i] = r.lon;
+  }
+  uint32_t oldest = r.confirmado + 1;
+  r.seq += opc.lote;
+  uint32_t alat = r.lat < 0 ? -(uint32_t)r.lat : r.lat;
+  uint32_t alon = r.lon < 0 ? -(uint32_t)r.lon : r.lon;
+  int n = snprintf(salida, cap, "GET %s?lat=%s%lu.%06lu&lon=%s%lu.%06lu&token=sim%06d&speed=%lu.%lu&seq=%lu&ts=%lu&oldest=%lu",
+                   opc.ruta, r.lat < 0 ? "-" : "", (unsigned long)(alat / 1000000), (unsigned long)(alat % 1000000),
+                   r.lon < 0 ? "-" : "", (unsigned long)(alon / 1000000), (unsigned long)(alon % 1000000), indice,
+                   (unsigned long)(azar(semilla) % 90), (unsigned long)(azar(semilla) % 10), (unsigned long)r.seq,
+                   (unsigned long)ts, (unsigned long)oldest);
+  // Pendientes del más antiguo al más nuevo: "dseq,dlat,dlon,dts" relativos al principal
+  for (int i = 0; i < opc.lote - 1; i++) {
+    int d = opc.lote - 1 - i;
+    n += snprintf(salida + n, cap - n, "%s%d,%ld,%ld,%lu", i == 0 ? "&lote=" : "_", d, (long)(lat[i] - r.lat),
+                  (long)(lon[i] - r.lon), (unsigned long)(d * paso));
+  }
+  n += snprintf(salida + n, cap - n,
+                " HTTP/1.1\r\nHost: %s\r\nUser-Agent: SIMCOM_MODULE\r\nAccept: */*\r\nContent-Length: 0\r\n"
+                "Connection: %s\r\n\r\n",
+                opc.host, opc.mantener ? "keep-alive" : "close");
+  return n;
+}
+
+static void vigilar(Ranura& s, int operacion, uint32_t eventos) {
+  struct epoll_event e;
+  e.events = eventos;
+  e.data.u32 = (uint32_t)(&s - ranuras);
+  epoll_ctl(ep, operacion, s.fd, &e);
+}
+
+static void cerrar(Ranura& s) {
+  if (s.fd >= 0) {
+    close(s.fd);
+    s.fd = -1;
+  }
+}
+
+static void liberar(Ranura& s, bool exito) {
+  if (!exito) {
+    cuenta.errores++;
+    segundo.errores++;
+    cerrar(s);
+  } else if (!opc.mantener) {
+    cerrar(s);
+  }
+  s.estado = INACTIVA;
+  s.rastreador = SIN_RASTREADOR;
+  ranurasLibres[nLibres++] = (int)(&s - ranuras);
+}
+
+static void enviar(Ranura& s) {
+  while (s.enviados < s.largo) {
+    ssize_t w = send(s.fd, s.salida + s.enviados, s.largo - s.enviados, MSG_NOSIGNAL);
+    if (w < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        vigilar(s, EPOLL_CTL_MOD, EPOLLOUT);
+        return;
+      }
+      liberar(s, false);
+      return;
+    }
+    s.enviados += w;
+  }
+  s.estado = RECIBIENDO;
+  s.usados = 0;
+  vigilar(s, EPOLL_CTL_MOD, EPOLLIN);
+}
+
+static bool conectar(Ranura& s) {
+  s.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (s.fd < 0) {
+    return false;
+  }
+  int uno = 1;
+  setsockopt(s.fd, IPPROTO_TCP, TCP_NODELAY, &uno, sizeof(uno));
+  if (connect(s.fd, (struct sockaddr*)&servidor, sizeof(servidor)) != 0 && errno != EINPROGRESS) {
+    cerrar(s);
+    return false;
+  }
+  cuenta.conexiones++;
+  vigilar(s, EPOLL_CTL_ADD, EPOLLOUT);
+  return true;
+}
+
+static void lanzar(int indice, uint32_t& semilla) {
+  Ranura& s = ranuras[ranurasLibres[--nLibres]];
+  Rastreador& r = rastreadores[indice];
+  s.rastreador = indice;
+  s.inicio = ahoraMs();
+  s.largo = armarPeticion(indice, r, s.salida, sizeof(s.salida), semilla);
+  s.enviados = 0;
+  cuenta.enviados++;
+  segundo.enviados++;
+  if (s.fd >= 0) {
+    s.estado = ENVIANDO;
+    enviar(s);
+  } else if (conectar(s)) {
+    s.estado = CONECTANDO;
+  } else {
+    liberar(s, false);
+  }
+}
+
+// Respuesta completa: código, y el ack del cuerpo {"isActive":...,"ack":N}
+static void recibir(Ranura& s) {
+  bool cerrada = false;  // Con "Connection: close" el cierre llega junto con la respuesta
+  for (;;) {
+    ssize_t r = recv(s.fd, s.entrada + s.usados, sizeof(s.entrada) - 1 - s.usados, 0);
+    if (r > 0) {
+      s.usados += r;
+      if (s.usados == sizeof(s.entrada) - 1) break;
+    } else if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      break;
+    } else if (r < 0 && errno == EINTR) {
+      continue;
+    } else {
+      cerrada = true;
+      break;
+    }
+  }
+  s.entrada[s.usados] = '\0';
+  const char* fin = strstr(s.entrada, "\r\n\r\n");
+  const char* largo = fin != NULL ? strstr(s.entrada, "Content-Length:") : NULL;
+  size_t cuerpo = largo != NULL && largo < fin ? strtoul(largo + 15, NULL, 10) : 0;
+  if (fin == NULL || (size_t)(fin + 4 - s.entrada) + cuerpo > s.usados) {
+    if (cerrada || s.usados == sizeof(s.entrada) - 1) {
+      liberar(s, false);  // Cerrada antes de la respuesta completa
+    }
+    return;
+  }
+
+  long long ms = ahoraMs() - s.inicio;
+  int codigo = atoi(s.entrada + 9);
+  if (codigo != 200) {
+    liberar(s, false);
+    return;
+  }
+  Rastreador& r = rastreadores[s.rastreador];
+  const char* ack = strstr(fin, "\"ack\":");
+  if (ack != NULL) {
+    r.confirmado = strtoul(ack + 6, NULL, 10);
+  }
+  if (r.confirmado != r.seq) {
+    cuenta.ackAtrasado++;
+  }
+  int cubeta = ms > LATENCIA_MAX_MS ? LATENCIA_MAX_MS : (int)ms;
+  cuenta.latencia[cubeta]++;
+  segundo.latencia[cubeta]++;
+  cuenta.ok++;
+  segundo.ok++;
+  if (cerrada || strstr(s.entrada, "Connection: close") != NULL) {
+    cerrar(s);
+  }
+  liberar(s, true);
+}
+
+static void alConectar(Ranura& s) {
+  int error = 0;
+  socklen_t largo = sizeof(error);
+  getsockopt(s.fd, SOL_SOCKET, SO_ERROR, &error, &largo);
+  if (error != 0) {
+    liberar(s, false);
+    return;
+  }
+  s.estado = ENVIANDO;
+  enviar(s);
+}
+
+static void leerOpciones(int argc, char** argv) {
+  int o;
+  while ((o = getopt(argc, argv, "h:p:n:i:t:c:l:kr:")) != -1) {
+    switch (o) {
+      case 'h': opc.host = optarg; break;
+      case 'p': opc.puerto = atoi(optarg); break;
+      case 'n': opc.rastreadores = atoi(optarg); break;
+      case 'i': opc.intervaloMs = atoi(optarg); break;
+      case 't': opc.segundos = atoi(optarg); break;
+      case 'c': opc.conexiones = atoi(optarg); break;
+      case 'l': opc.lote = atoi(optarg); break;
+      case 'k': opc.mantener = true; break;
+      case 'r': opc.ruta = optarg; break;
+      default:
+        fprintf(stderr, "uso: %s [-h ip] [-p puerto] [-n rastreadores] [-i ms] [-t s] [-c conexiones] [-l fixes] "
+                        "[-k] [-r ruta]\n", argv[0]);
+        exit(2);
+    }
+  }
+  if (opc.rastreadores <= 0 || opc.intervaloMs <= 0 || opc.conexiones <= 0 || opc.lote < 1 ||
+      opc.lote > CONTRATO_MAX_FIXES) {
+    fprintf(stderr, "Valores inválidos\n");
+    exit(2);
+  }
+}
+
+static void imprimirSegundo(long long t, long long retraso) {
+  fprintf(stderr, "t=%llds  %llu rep/s  ok %llu  errores %llu  p50 %ld ms  p99 %ld ms  retraso %lld ms\n", t,
+          segundo.enviados, segundo.ok, segundo.errores, percentil(segundo.latencia, segundo.ok, 0.5),
+          percentil(segundo.latencia, segundo.ok, 0.99), retraso);
+  memset(&segundo, 0, sizeof(segundo));
+}
+
+int main(int argc, char** argv) {
+  leerOpciones(argc, argv);
+  memset(&servidor, 0, sizeof(servidor));
+  servidor.sin_family = AF_INET;
+  servidor.sin_port = htons(opc.puerto);
+  if (inet_pton(AF_INET, opc.host, &servidor.sin_addr) != 1) {
+    fprintf(stderr, "Dirección inválida: %s\n", opc.host);
+    return 2;
+  }
+  signal(SIGPIPE, SIG_IGN);
+
+  rastreadores = (Rastreador*)calloc(opc.rastreadores, sizeof(Rastreador));
+  ranuras = (Ranura*)calloc(opc.conexiones, sizeof(Ranura));
+  ranurasLibres = (int*)calloc(opc.conexiones, sizeof(int));
+  if (rastreadores == NULL || ranuras == NULL || ranurasLibres == NULL) {
+    fprintf(stderr, "Sin memoria\n");
+    return 1;
+  }
+  uint32_t semilla = 2463534242u;
+  long long inicio = ahoraMs();
+  for (int i = 0; i < opc.rastreadores; i++) {
+    // Alrededor de Cuernavaca, con los reportes repartidos en el intervalo
+    Rastreador& r = rastreadores[i];
+    r.lat = 18926113 + (int32_t)(azar(semilla) % 200000) - 100000;
+    r.lon = -99230733 + (int32_t)(azar(semilla) % 200000) - 100000;
+    r.vence = inicio + (long long)i * opc.intervaloMs / opc.rastreadores;
+  }
+  for (int i = opc.conexiones - 1; i >= 0; i--) {
+    ranuras[i].fd = -1;
+    ranuras[i].rastreador = SIN_RASTREADOR;
+    ranurasLibres[nLibres++] = i;
+  }
+  ep = epoll_create1(EPOLL_CLOEXEC);
+
+  fprintf(stderr, "%d rastreadores cada %d ms (%.0f rep/s), %d conexiones, %d fixes por reporte%s\n",
+          opc.rastreadores, opc.intervaloMs, opc.rastreadores * 1000.0 / opc.intervaloMs, opc.conexiones, opc.lote,
+          opc.mantener ? ", conexiones mantenidas" : "");
+
+  struct epoll_event eventos[EVENTOS_MAX];
+  int siguiente = 0;
+  long long fin = inicio + opc.segundos * 1000LL;
+  long long proximoResumen = inicio + 1000;
+  long long retraso = 0;
+  for (;;) {
+    long long ahora = ahoraMs();
+    // El calendario avanza en orden: el siguiente siempre es el que vence antes
+    while (ahora < fin && nLibres > 0 && rastreadores[siguiente].vence <= ahora) {
+      Rastreador& r = rastreadores[siguiente];
+      retraso = ahora - r.vence;
+      if (retraso > segundo.retrasoMax) segundo.retrasoMax = retraso;
+      if (retraso > cuenta.retrasoMax) cuenta.retrasoMax = retraso;
+      r.vence += opc.intervaloMs;
+      lanzar(siguiente, semilla);
+      siguiente = (siguiente + 1) % opc.rastreadores;
+    }
+    if (ahora >= fin && nLibres == opc.conexiones) {
+      break;
+    }
+    if (ahora >= proximoResumen) {
+      imprimirSegundo((ahora - inicio) / 1000, segundo.retrasoMax);
+      proximoResumen += 1000;
+    }
+
+    long long espera = rastreadores[siguiente].vence - ahora;
+    if (nLibres == 0 || ahora >= fin || espera > 100) espera = 100;
+    if (espera < 0) espera = 0;
+    int n = epoll_wait(ep, eventos, EVENTOS_MAX, (int)espera);
+    for (int i = 0; i < n; i++) {
+      Ranura& s = ranuras[eventos[i].data.u32];
+      if (s.rastreador == SIN_RASTREADOR) {
+        // Conexión mantenida y ociosa: el servidor la cerró
+        if (s.fd >= 0) {
+          epoll_ctl(ep, EPOLL_CTL_DEL, s.fd, NULL);
+          cerrar(s);
+        }
+        continue;
+      }
+      if (eventos[i].events & (EPOLLERR | EPOLLHUP) && s.estado != RECIBIENDO) {
+        liberar(s, false);
+      } else if (s.estado == CONECTANDO) {
+        alConectar(s);
+      } else if (s.estado == ENVIANDO) {
+        enviar(s);
+      } else if (s.estado == RECIBIENDO) {
+        recibir(s);
+      }
+    }
+    if (ahora >= fin + LATENCIA_MAX_MS) {
+      break;  // Lo que no respondió en este plazo cuenta como perdido
+    }
+  }
+
+  unsigned long long total = cuenta.ok;
+  printf("Reportes: %llu enviados, %llu ok, %llu errores, %llu con ack atrasado, %llu conexiones\n", cuenta.enviados,
+         cuenta.ok, cuenta.errores, cuenta.ackAtrasado, cuenta.conexiones);
+  printf("Rendimiento: %.0f rep/s, %.0f fixes/s\n", cuenta.ok * 1000.0 / (opc.segundos * 1000.0),
+         cuenta.ok * (double)opc.lote / opc.segundos);
+  printf("Latencia: p50 %ld ms, p90 %ld ms, p99 %ld ms; retraso máximo del calendario %lld ms\n",
+         percentil(cuenta.latencia, total, 0.5), percentil(cuenta.latencia, total, 0.9),
+         percentil(cuenta.latencia, total, 0.99), cuenta.retrasoMax);
+  return cuenta.errores == 0 ? 0 : 1;
+}
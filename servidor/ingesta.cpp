@@ -0,0 +1,778 @@
+// Servidor de referencia del endpoint de recepción (README, "API Backend"):
+// deduplica por (token, seq), responde {"isActive":...,"ack":...} y escribe
+// cada fix nuevo en la pista del dispositivo, <directorio>/<token>.log, una
+// línea por fix:
+//
+//   <seq> <ts> <lat> <lon> <velocidad|-> <rumbo|-> [parámetros desconocidos tal cual]
+//
+// GET <ruta de posición>?token=... responde la posición actual del dispositivo:
+// con rumbo en su último reporte (reporte por estima), la que extrapola el
+// firmware con el mismo código (src/findme32/Estima.cpp), como mucho -m s.
+//
+// Un solo hilo con epoll. Toda la memoria se reserva al arrancar: el análisis
+// de una petición trabaja sobre el búfer de la conexión (ContratoGPS.h).
+// Commit en grupo: los fixes de todas las peticiones que llegan durante
+// -t ms se escriben juntos, con un syncfs por tanda, y solo entonces se
+// responde; un ack nunca confirma algo que no está en disco.
+//
+// Solo HTTP: el TLS lo termina el túnel o un proxy delante, como en producción.
+//
+//   g++ -std=c++11 -O2 -Wall -I servidor -I src/findme32 servidor/ingesta.cpp
+//       src/findme32/Estima.cpp src/findme32/GeoUtils.cpp -o ingesta
+//   ./ingesta -p 8080 -d pistas
+//
+// Opciones: -p puerto (8080), -d directorio (pistas), -t ms por tanda (5),
+// -n dispositivos (65536), -c conexiones (8192), -r ruta (/api/gps/gpstracker),
+// -x archivo con los tokens inactivos (uno por línea), -s 0 sin syncfs (solo
+// para medir la CPU), -e ruta de la posición (/api/gps/posicion), -m segundos
+// máximos de extrapolación (900).
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+#include "ContratoGPS.h"
+#include "Estima.h"
+
+#define TOKEN_MAX 64
+#define ENTRADA_BYTES 4096        // URL más larga del firmware (480) con cabeceras de sobra
+#define SALIDA_BYTES 256
+#define ARENA_BYTES (8u << 20)    // Líneas de una tanda
+#define LINEA_MAX 96              // Una línea sin los parámetros desconocidos
+#define EVENTOS_MAX 1024
+#define IOV_MAX_TANDA 1024
+#define ABIERTOS_MAX 4096         // Pistas abiertas a la vez
+#define SIN_INDICE (-1)
+#define ESCUCHA 0xFFFFFFFFu
+
+enum EstadoConexion { LIBRE, LEYENDO, EN_TANDA, CERRADA_EN_TANDA, ESCRIBIENDO };
+
+struct Conexion {
+  int fd;
+  EstadoConexion estado;
+  bool cerrar;              // Tras responder
+  int32_t dispositivo;      // El de la petición en tanda
+  size_t usados;
+  size_t consumidos;        // Bytes de la petición que se está respondiendo
+  size_t largoSalida;
+  size_t enviados;
+  char entrada[ENTRADA_BYTES];
+  char salida[SALIDA_BYTES];
+};
+
+struct Dispositivo {
+  char token[TOKEN_MAX + 1];
+  EstadoConfirmacion estado;
+  EstadoConfirmacion respaldo;  // Al entrar en la tanda: se restaura si la escritura falla
+  bool activo;
+  bool enTanda;
+  bool fallo;
+  int fd;
+  FixGPS base;                  // Fix principal de la secuencia más alta (seq 0: ninguno)
+  FixGPS baseRespaldo;
+  int32_t primero;              // Registros de la tanda, en orden
+  int32_t ultimo;
+};
+
+struct Registro {
+  uint32_t desde;
+  uint32_t largo;
+  int32_t siguiente;
+};
+
+struct Opciones {
+  int puerto;
+  const char* directorio;
+  int tandaMs;
+  int maxDispositivos;
+  int maxConexiones;
+  const char* ruta;
+  const char* inactivos;
+  bool sincronizar;
+  const char* rutaPosicion;
+  int horizonte;
+};
+
+static Opciones opc = { 8080, "pistas", 5, 65536, 8192, "/api/gps/gpstracker", NULL, true, "/api/gps/posicion", 900 };
+
+static int ep = -1;
+static int dirFd = -1;
+static volatile sig_atomic_t terminar = 0;
+
+static Conexion* conexiones;
+static int32_t* conexionesLibres;
+static int nLibres;
+static int32_t* listos;         // Respondidas con otra petición ya en el búfer (anillo)
+static int primeroListo;
+static int nListos;
+
+static Dispositivo* dispositivos;
+static int nDispositivos;
+static int32_t* ranuras;        // Tabla hash abierta: índice en 'dispositivos' o SIN_INDICE
+static uint32_t mascaraRanuras;
+static int abiertos;
+
+static char* arena;
+static uint32_t arenaUsada;
+static Registro* registros;
+static int nRegistros;
+static int maxRegistros;
+static int32_t* sucios;
+static int nSucios;
+static int32_t* esperando;
+static int nEsperando;
+static long long inicioTanda;
+
+static PeticionGPS peticion;
+
+static struct {
+  unsigned long long peticiones, nuevos, duplicados, tandas, errores, rechazadas, msTandas;
+} cuenta;
+
+static long long ahoraMs() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (long long)t.tv_sec * 1000 + t.tv_nsec / 1000000;
+}
+
+static void alTerminar(int) { terminar = 1; }
+
+// ============================
+// DISPOSITIVOS
+// ============================
+static uint32_t dispersar(const char* p, size_t n) {
+  uint32_t h = 2166136261u;  // FNV-1a
+  for (size_t i = 0; i < n; i++) {
+    h = (h ^ (uint8_t)p[i]) * 16777619u;
+  }
+  return h;
+}
+
+// El token es el nombre del archivo: nada que salga del directorio
+static bool tokenValido(const Texto& t) {
+  if (t.n == 0 || t.n > TOKEN_MAX || t.p[0] == '.') {
+    return false;
+  }
+  for (size_t i = 0; i < t.n; i++) {
+    char c = t.p[i];
+    if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || contrato::esDigito(c) || c == '_' || c == '-' || c == '.')) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static Dispositivo* buscarDispositivo(const Texto& token, bool crear) {
+  uint32_t r = dispersar(token.p, token.n) & mascaraRanuras;
+  while (ranuras[r] != SIN_INDICE) {
+    Dispositivo& d = dispositivos[ranuras[r]];
+    if (strlen(d.token) == token.n && memcmp(d.token, token.p, token.n) == 0) {
+      return &d;
+    }
+    r = (r + 1) & mascaraRanuras;
+  }
+  if (!crear || nDispositivos >= opc.maxDispositivos) {
+    return NULL;
+  }
+  Dispositivo& d = dispositivos[nDispositivos];
+  memcpy(d.token, token.p, token.n);
+  d.token[token.n] = '\0';
+  d.estado.reiniciar();
+  d.base.seq = 0;
+  d.activo = true;
+  d.enTanda = false;
+  d.fd = -1;
+  ranuras[r] = nDispositivos++;
+  return &d;
+}
+
+static void cargarInactivos(const char* archivo) {
+  FILE* f = fopen(archivo, "r");
+  if (f == NULL) {
+    perror(archivo);
+    exit(1);
+  }
+  char linea[TOKEN_MAX + 8];
+  int n = 0;
+  while (fgets(linea, sizeof(linea), f) != NULL) {
+    Texto t = { linea, strcspn(linea, "\r\n") };
+    Dispositivo* d = tokenValido(t) ? buscarDispositivo(t, true) : NULL;
+    if (d != NULL) {
+      d->activo = false;
+      n++;
+    }
+  }
+  fclose(f);
+  fprintf(stderr, "%d dispositivos inactivos\n", n);
+}
+
+// ============================
+// TANDA (COMMIT EN GRUPO)
+// ============================
+static int abrirPista(Dispositivo& d) {
+  if (abiertos >= ABIERTOS_MAX) {
+    // Rara vez: se cierran las que no están en esta tanda y se vuelven a abrir al usarlas
+    for (int i = 0; i < nDispositivos; i++) {
+      if (dispositivos[i].fd >= 0 && !dispositivos[i].enTanda) {
+        close(dispositivos[i].fd);
+        dispositivos[i].fd = -1;
+        abiertos--;
+      }
+    }
+  }
+  char nombre[TOKEN_MAX + 8];
+  snprintf(nombre, sizeof(nombre), "%s.log", d.token);
+  d.fd = openat(dirFd, nombre, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+  if (d.fd >= 0) {
+    abiertos++;
+  }
+  return d.fd;
+}
+
+static bool escribirTodo(int fd, struct iovec* iov, int n) {
+  while (n > 0) {
+    ssize_t w = writev(fd, iov, n);
+    if (w < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    while (n > 0 && (size_t)w >= iov->iov_len) {
+      w -= iov->iov_len;
+      iov++;
+      n--;
+    }
+    if (n > 0) {
+      iov->iov_base = (char*)iov->iov_base + w;
+      iov->iov_len -= w;
+    }
+  }
+  return true;
+}
+
+static bool escribirPista(Dispositivo& d) {
+  if (d.primero == SIN_INDICE) {
+    return true;  // Solo duplicados
+  }
+  if (d.fd < 0 && abrirPista(d) < 0) {
+    perror(d.token);
+    return false;
+  }
+  struct iovec iov[IOV_MAX_TANDA];
+  int n = 0;
+  for (int32_t r = d.primero; r != SIN_INDICE; r = registros[r].siguiente) {
+    iov[n].iov_base = arena + registros[r].desde;
+    iov[n].iov_len = registros[r].largo;
+    if (++n == IOV_MAX_TANDA) {
+      if (!escribirTodo(d.fd, iov, n)) return false;
+      n = 0;
+    }
+  }
+  return escribirTodo(d.fd, iov, n);
+}
+
+static void empezarRespuesta(Conexion& c);
+
+static void confirmarTanda() {
+  if (nSucios == 0 && nEsperando == 0) {
+    return;
+  }
+  long long inicio = ahoraMs();
+  bool todos = true;
+  for (int i = 0; i < nSucios; i++) {
+    Dispositivo& d = dispositivos[sucios[i]];
+    d.fallo = !escribirPista(d);
+    if (d.fallo) {
+      todos = false;
+    }
+  }
+  if (opc.sincronizar && arenaUsada > 0 && syncfs(dirFd) != 0) {
+    perror("syncfs");
+    for (int i = 0; i < nSucios; i++) {
+      dispositivos[sucios[i]].fallo = true;
+    }
+    todos = false;
+  }
+  for (int i = 0; i < nSucios; i++) {
+    Dispositivo& d = dispositivos[sucios[i]];
+    if (d.fallo) {
+      d.estado = d.respaldo;  // El dispositivo reintentará: mejor un duplicado que un hueco
+      d.base = d.baseRespaldo;
+    }
+    d.enTanda = false;
+  }
+
+  for (int i = 0; i < nEsperando; i++) {
+    Conexion& c = conexiones[esperando[i]];
+    if (c.estado == CERRADA_EN_TANDA) {
+      c.estado = LIBRE;
+      conexionesLibres[nLibres++] = esperando[i];
+      continue;
+    }
+    if (!todos && dispositivos[c.dispositivo].fallo) {
+      static const char error[] = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+      memcpy(c.salida, error, sizeof(error) - 1);
+      c.largoSalida = sizeof(error) - 1;
+      c.cerrar = true;
+      cuenta.errores++;
+    }
+    empezarRespuesta(c);
+  }
+
+  cuenta.tandas++;
+  cuenta.msTandas += ahoraMs() - inicio;
+  nSucios = 0;
+  nEsperando = 0;
+  nRegistros = 0;
+  arenaUsada = 0;
+}
+
+static void agregarLinea(Dispositivo& d, const FixGPS& f, const Texto* extra, int nExtra) {
+  char* p = arena + arenaUsada;
+  size_t libre = ARENA_BYTES - arenaUsada;
+  uint32_t alat = f.lat < 0 ? -(uint32_t)f.lat : f.lat;
+  uint32_t alon = f.lon < 0 ? -(uint32_t)f.lon : f.lon;
+  int n = snprintf(p, libre, "%lu %lu %s%lu.%06lu %s%lu.%06lu", (unsigned long)f.seq, (unsigned long)f.ts,
+                   f.lat < 0 ? "-" : "", (unsigned long)(alat / 1000000), (unsigned long)(alat % 1000000),
+                   f.lon < 0 ? "-" : "", (unsigned long)(alon / 1000000), (unsigned long)(alon % 1000000));
+  if (f.velocidad == CONTRATO_SIN_VELOCIDAD) {
+    n += snprintf(p + n, libre - n, " -");
+  } else {
+    n += snprintf(p + n, libre - n, " %ld.%ld", (long)(f.velocidad / 10), (long)(f.velocidad % 10));
+  }
+  if (f.rumbo == CONTRATO_SIN_RUMBO) {
+    n += snprintf(p + n, libre - n, " -");
+  } else {
+    n += snprintf(p + n, libre - n, " %ld.%ld", (long)(f.rumbo / 10), (long)(f.rumbo % 10));
+  }
+  for (int i = 0; i < nExtra; i++) {
+    n += snprintf(p + n, libre - n, " %.*s", (int)extra[i].n, extra[i].p);
+  }
+  p[n++] = '\n';
+
+  Registro& r = registros[nRegistros];
+  r.desde = arenaUsada;
+  r.largo = n;
+  r.siguiente = SIN_INDICE;
+  if (d.primero == SIN_INDICE) {
+    d.primero = nRegistros;
+  } else {
+    registros[d.ultimo].siguiente = nRegistros;
+  }
+  d.ultimo = nRegistros++;
+  arenaUsada += n;
+}
+
+// ============================
+// CONEXIONES
+// ============================
+static void vigilar(Conexion& c, uint32_t eventos) {
+  struct epoll_event e;
+  e.events = eventos;
+  e.data.u32 = (uint32_t)(&c - conexiones);
+  epoll_ctl(ep, EPOLL_CTL_MOD, c.fd, &e);
+}
+
+static void cerrarConexion(Conexion& c) {
+  close(c.fd);
+  if (c.estado == EN_TANDA) {
+    c.estado = CERRADA_EN_TANDA;  // Se libera al confirmar la tanda, que aún la nombra
+    return;
+  }
+  c.estado = LIBRE;
+  conexionesLibres[nLibres++] = (int32_t)(&c - conexiones);
+}
+
+static void responder(Conexion& c, int codigo, const char* razon, const char* cuerpo, bool cerrar) {
+  c.cerrar = cerrar || !peticion.mantener;
+  int n = snprintf(c.salida, sizeof(c.salida),
+                   "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nContent-Length: %u\r\nConnection: %s\r\n\r\n%s",
+                   codigo, razon, (unsigned)strlen(cuerpo), c.cerrar ? "close" : "keep-alive", cuerpo);
+  c.largoSalida = n;
+}
+
+static void escribir(Conexion& c) {
+  while (c.enviados < c.largoSalida) {
+    ssize_t w = send(c.fd, c.salida + c.enviados, c.largoSalida - c.enviados, MSG_NOSIGNAL);
+    if (w < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        vigilar(c, EPOLLOUT);
+        return;
+      }
+      cerrarConexion(c);
+      return;
+    }
+    c.enviados += w;
+  }
+  if (c.cerrar) {
+    cerrarConexion(c);
+    return;
+  }
+  memmove(c.entrada, c.entrada + c.consumidos, c.usados - c.consumidos);
+  c.usados -= c.consumidos;
+  c.consumidos = 0;
+  c.estado = LEYENDO;
+  vigilar(c, EPOLLIN | EPOLLRDHUP);
+  if (c.usados > 0) {
+    // La siguiente petición llegó detrás de esta: se analiza desde el ciclo, no
+    // aquí, que puede ser dentro de confirmarTanda() con 'peticion' en uso
+    listos[(primeroListo + nListos++) % opc.maxConexiones] = (int32_t)(&c - conexiones);
+  }
+}
+
+static void empezarRespuesta(Conexion& c) {
+  c.estado = ESCRIBIENDO;
+  c.enviados = 0;
+  escribir(c);
+}
+
+static void registrarReporte(Conexion& c) {
+  Dispositivo* d = buscarDispositivo(peticion.token, true);
+  if (d == NULL) {
+    responder(c, 503, "Service Unavailable", "{\"error\":\"dispositivos\"}", true);
+    cuenta.errores++;
+    empezarRespuesta(c);
+    return;
+  }
+
+  // Que la petición entera quepa en la tanda en curso
+  size_t extra = 0;
+  for (int i = 0; i < peticion.nExtra; i++) {
+    extra += peticion.extra[i].n + 1;
+  }
+  if (arenaUsada + peticion.nFixes * LINEA_MAX + extra > ARENA_BYTES || nRegistros + peticion.nFixes > maxRegistros ||
+      nEsperando >= opc.maxConexiones) {
+    confirmarTanda();
+  }
+  if (nSucios == 0 && nEsperando == 0) {
+    inicioTanda = ahoraMs();
+  }
+
+  int32_t indice = (int32_t)(d - dispositivos);
+  if (!d->enTanda) {
+    d->respaldo = d->estado;
+    d->baseRespaldo = d->base;
+    d->enTanda = true;
+    d->primero = SIN_INDICE;
+    sucios[nSucios++] = indice;
+  }
+  if (peticion.hayOldest) {
+    d->estado.aplicarOldest(peticion.oldest);
+  }
+  // El lote es más antiguo que el principal: va primero en la pista
+  for (int i = 1; i <= peticion.nFixes; i++) {
+    const FixGPS& f = peticion.fixes[i % peticion.nFixes];
+    if (d->estado.registrar(f.seq)) {
+      bool principal = i == peticion.nFixes;
+      agregarLinea(*d, f, principal ? peticion.extra : NULL, principal ? peticion.nExtra : 0);
+      cuenta.nuevos++;
+    } else {
+      cuenta.duplicados++;
+    }
+  }
+
+  // La estima sigue al reporte más nuevo; uno atrasado no la mueve
+  if (peticion.fixes[0].seq > d->base.seq) {
+    d->base = peticion.fixes[0];
+  }
+
+  char cuerpo[64];
+  snprintf(cuerpo, sizeof(cuerpo), "{\"isActive\":%s,\"ack\":%lu}", d->activo ? "true" : "false",
+           (unsigned long)d->estado.ack);
+  responder(c, 200, "OK", cuerpo, false);
+  c.dispositivo = indice;
+  c.estado = EN_TANDA;
+  esperando[nEsperando++] = (int32_t)(&c - conexiones);
+  vigilar(c, 0);  // Sin leer más hasta responder
+  if (opc.tandaMs == 0) {
+    confirmarTanda();
+  }
+}
+
+// Posición actual: la del último reporte, extrapolada si trajo rumbo
+static void responderPosicion(Conexion& c) {
+  Dispositivo* d = tokenValido(peticion.token) ? buscarDispositivo(peticion.token, false) : NULL;
+  if (d == NULL || d->base.seq == 0) {
+    responder(c, 404, "Not Found", "{\"error\":\"token\"}", false);
+    empezarRespuesta(c);
+    return;
+  }
+  const FixGPS& f = d->base;
+  BaseEstima base;
+  base.lat = f.lat / 1e6;
+  base.lon = f.lon / 1e6;
+  base.velocidad = f.velocidad == CONTRATO_SIN_VELOCIDAD ? -1.0f : f.velocidad / 10.0f;
+  base.rumbo = f.rumbo == CONTRATO_SIN_RUMBO ? ESTIMA_SIN_RUMBO : f.rumbo / 10.0f;
+  base.utc = f.ts;
+
+  uint32_t ahora = (uint32_t)time(NULL);
+  long edad = f.ts != 0 && ahora > f.ts ? (long)(ahora - f.ts) : 0;
+  double lat, lon;
+  predecirPosicion(base, edad < opc.horizonte ? edad : opc.horizonte, lat, lon);
+
+  char cuerpo[160];
+  snprintf(cuerpo, sizeof(cuerpo), "{\"lat\":%.6f,\"lon\":%.6f,\"seq\":%lu,\"edad\":%ld,\"estimada\":%s}", lat, lon,
+           (unsigned long)f.seq, edad, base.rumbo >= 0 && edad > 0 ? "true" : "false");
+  responder(c, 200, "OK", cuerpo, false);
+  empezarRespuesta(c);
+}
+
+static void procesarEntrada(Conexion& c) {
+  if (c.estado != LEYENDO || c.usados == 0) {
+    return;
+  }
+  ResultadoAnalisis a = analizarPeticion(c.entrada, c.usados, peticion);
+  if (a == ANALISIS_INCOMPLETA) {
+    if (c.usados == sizeof(c.entrada)) {
+      peticion.mantener = false;
+      responder(c, 431, "Request Header Fields Too Large", "{}", true);
+      empezarRespuesta(c);
+    }
+    return;
+  }
+  cuenta.peticiones++;
+  if (a == ANALISIS_INVALIDA) {
+    peticion.mantener = false;
+    responder(c, 400, "Bad Request", "{}", true);
+    cuenta.errores++;
+    empezarRespuesta(c);
+    return;
+  }
+  c.consumidos = peticion.largo;
+  if (peticion.ruta.igual(opc.rutaPosicion) && peticion.metodo.igual("GET")) {
+    responderPosicion(c);
+    return;
+  }
+  if (!peticion.ruta.igual(opc.ruta)) {
+    responder(c, 404, "Not Found", "{}", false);
+  } else if (!peticion.metodo.igual("GET")) {
+    responder(c, 405, "Method Not Allowed", "{}", false);
+  } else if (!peticion.consulta || !tokenValido(peticion.token)) {
+    responder(c, 400, "Bad Request", "{\"error\":\"consulta\"}", false);
+  } else {
+    registrarReporte(c);
+    return;
+  }
+  cuenta.errores++;
+  empezarRespuesta(c);
+}
+
+static void leer(Conexion& c) {
+  for (;;) {
+    if (c.usados == sizeof(c.entrada)) {
+      break;
+    }
+    ssize_t r = recv(c.fd, c.entrada + c.usados, sizeof(c.entrada) - c.usados, 0);
+    if (r > 0) {
+      c.usados += r;
+    } else if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      break;
+    } else if (r < 0 && errno == EINTR) {
+      continue;
+    } else {
+      cerrarConexion(c);  // Cerrada por el cliente o error
+      return;
+    }
+  }
+  procesarEntrada(c);
+}
+
+static void aceptar(int escucha) {
+  for (;;) {
+    int fd = accept4(escucha, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EINTR) continue;
+      return;  // EAGAIN, o sin descriptores: se reintenta en el siguiente evento
+    }
+    if (nLibres == 0) {
+      close(fd);
+      cuenta.rechazadas++;
+      continue;
+    }
+    int uno = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &uno, sizeof(uno));
+    int32_t i = conexionesLibres[--nLibres];
+    Conexion& c = conexiones[i];
+    c.fd = fd;
+    c.estado = LEYENDO;
+    c.usados = 0;
+    c.consumidos = 0;
+    c.cerrar = false;
+    struct epoll_event e;
+    e.events = EPOLLIN | EPOLLRDHUP;
+    e.data.u32 = (uint32_t)i;
+    epoll_ctl(ep, EPOLL_CTL_ADD, fd, &e);
+  }
+}
+
+// ============================
+// ARRANQUE Y CICLO
+// ============================
+static void leerOpciones(int argc, char** argv) {
+  int o;
+  while ((o = getopt(argc, argv, "p:d:t:n:c:r:x:s:e:m:")) != -1) {
+    switch (o) {
+      case 'p': opc.puerto = atoi(optarg); break;
+      case 'd': opc.directorio = optarg; break;
+      case 't': opc.tandaMs = atoi(optarg); break;
+      case 'n': opc.maxDispositivos = atoi(optarg); break;
+      case 'c': opc.maxConexiones = atoi(optarg); break;
+      case 'r': opc.ruta = optarg; break;
+      case 'x': opc.inactivos = optarg; break;
+      case 's': opc.sincronizar = atoi(optarg) != 0; break;
+      case 'e': opc.rutaPosicion = optarg; break;
+      case 'm': opc.horizonte = atoi(optarg); break;
+      default:
+        fprintf(stderr, "uso: %s [-p puerto] [-d directorio] [-t ms] [-n dispositivos] [-c conexiones] "
+                        "[-r ruta] [-x inactivos] [-s 0|1] [-e ruta] [-m s]\n", argv[0]);
+        exit(2);
+    }
+  }
+  if (opc.maxDispositivos <= 0 || opc.maxConexiones <= 0 || opc.tandaMs < 0 || opc.horizonte < 0) {
+    fprintf(stderr, "Valores inválidos\n");
+    exit(2);
+  }
+}
+
+static void* reservar(size_t n, size_t tam) {
+  void* p = calloc(n, tam);
+  if (p == NULL) {
+    fprintf(stderr, "Sin memoria para %lu x %lu bytes\n", (unsigned long)n, (unsigned long)tam);
+    exit(1);
+  }
+  return p;
+}
+
+static void reservarTodo() {
+  conexiones = (Conexion*)reservar(opc.maxConexiones, sizeof(Conexion));
+  conexionesLibres = (int32_t*)reservar(opc.maxConexiones, sizeof(int32_t));
+  for (int i = opc.maxConexiones - 1; i >= 0; i--) {
+    conexionesLibres[nLibres++] = i;
+  }
+  esperando = (int32_t*)reservar(opc.maxConexiones, sizeof(int32_t));
+  listos = (int32_t*)reservar(opc.maxConexiones, sizeof(int32_t));
+
+  dispositivos = (Dispositivo*)reservar(opc.maxDispositivos, sizeof(Dispositivo));
+  sucios = (int32_t*)reservar(opc.maxDispositivos, sizeof(int32_t));
+  uint32_t tam = 1;
+  while (tam < (uint32_t)opc.maxDispositivos * 2) tam <<= 1;
+  ranuras = (int32_t*)reservar(tam, sizeof(int32_t));
+  memset(ranuras, 0xFF, tam * sizeof(int32_t));  // SIN_INDICE
+  mascaraRanuras = tam - 1;
+
+  arena = (char*)reservar(ARENA_BYTES, 1);
+  maxRegistros = ARENA_BYTES / 32;  // Ninguna línea es más corta
+  registros = (Registro*)reservar(maxRegistros, sizeof(Registro));
+}
+
+static int escuchar(int puerto) {
+  int s = socket(AF_INET6, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (s < 0) {
+    perror("socket");
+    exit(1);
+  }
+  int uno = 1, cero = 0;
+  setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &uno, sizeof(uno));
+  setsockopt(s, IPPROTO_IPV6, IPV6_V6ONLY, &cero, sizeof(cero));
+  struct sockaddr_in6 dir;
+  memset(&dir, 0, sizeof(dir));
+  dir.sin6_family = AF_INET6;
+  dir.sin6_addr = in6addr_any;
+  dir.sin6_port = htons(puerto);
+  if (bind(s, (struct sockaddr*)&dir, sizeof(dir)) != 0 || listen(s, SOMAXCONN) != 0) {
+    perror("bind/listen");
+    exit(1);
+  }
+  return s;
+}
+
+static void imprimirCuenta(long long segundos) {
+  fprintf(stderr, "%llds: %llu peticiones, %llu fixes nuevos, %llu duplicados, %llu errores, %llu rechazadas, "
+          "%llu tandas (%.2f ms por tanda), %d dispositivos\n", segundos, cuenta.peticiones, cuenta.nuevos,
+          cuenta.duplicados, cuenta.errores, cuenta.rechazadas, cuenta.tandas,
+          cuenta.tandas > 0 ? (double)cuenta.msTandas / cuenta.tandas : 0.0, nDispositivos);
+}
+
+int main(int argc, char** argv) {
+  leerOpciones(argc, argv);
+  mkdir(opc.directorio, 0755);
+  dirFd = open(opc.directorio, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dirFd < 0) {
+    perror(opc.directorio);
+    return 1;
+  }
+  reservarTodo();
+  if (opc.inactivos != NULL) {
+    cargarInactivos(opc.inactivos);
+  }
+
+  signal(SIGPIPE, SIG_IGN);
+  signal(SIGINT, alTerminar);
+  signal(SIGTERM, alTerminar);
+
+  int escucha = escuchar(opc.puerto);
+  ep = epoll_create1(EPOLL_CLOEXEC);
+  struct epoll_event e;
+  e.events = EPOLLIN;
+  e.data.u32 = ESCUCHA;
+  epoll_ctl(ep, EPOLL_CTL_ADD, escucha, &e);
+  fprintf(stderr, "Escuchando en el puerto %d, pistas en %s, tandas de %d ms\n", opc.puerto, opc.directorio,
+          opc.tandaMs);
+
+  struct epoll_event eventos[EVENTOS_MAX];
+  long long arranque = ahoraMs();
+  long long ultimoResumen = arranque;
+  while (!terminar) {
+    int espera = nListos > 0 ? 0 : 1000;
+    if (nEsperando > 0 && nListos == 0) {
+      long long resta = inicioTanda + opc.tandaMs - ahoraMs();
+      espera = resta < 0 ? 0 : (int)resta;
+    }
+    int n = epoll_wait(ep, eventos, EVENTOS_MAX, espera);
+    for (int i = 0; i < n; i++) {
+      if (eventos[i].data.u32 == ESCUCHA) {
+        aceptar(escucha);
+        continue;
+      }
+      Conexion& c = conexiones[eventos[i].data.u32];
+      if (c.estado == LIBRE || c.estado == CERRADA_EN_TANDA) {
+        continue;
+      }
+      if (eventos[i].events & (EPOLLERR | EPOLLHUP)) {
+        cerrarConexion(c);
+      } else if (c.estado == ESCRIBIENDO && (eventos[i].events & EPOLLOUT)) {
+        escribir(c);
+      } else if (c.estado == LEYENDO && (eventos[i].events & (EPOLLIN | EPOLLRDHUP))) {
+        leer(c);
+      }
+    }
+    long long ahora = ahoraMs();
+    if (nEsperando > 0 && ahora - inicioTanda >= opc.tandaMs) {
+      confirmarTanda();
+    }
+    for (int pendientes = nListos; pendientes > 0; pendientes--) {
+      Conexion& c = conexiones[listos[primeroListo]];
+      primeroListo = (primeroListo + 1) % opc.maxConexiones;
+      nListos--;
+      procesarEntrada(c);
+    }
+    if (ahora - ultimoResumen >= 10000 && cuenta.peticiones > 0) {
+      imprimirCuenta((ahora - arranque) / 1000);
+      ultimoResumen = ahora;
+    }
+  }
+  confirmarTanda();
+  imprimirCuenta((ahoraMs() - arranque) / 1000);
+  return 0;
+}
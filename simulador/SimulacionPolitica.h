@@ -0,0 +1,125 @@
+// Reproducción de la política de reporte del firmware (src/findme32/
+// PoliticaReporte.h) sobre una traza GNSS grabada: qué reportes habría
+// enviado el rastreador con unos parámetros, cuántos bytes habrían costado y
+// cuánto se habría apartado del recorrido real la posición que da el
+// servidor (la del último reporte o, con rumbo, la extrapolada por estima
+// como en servidor/ingesta.cpp).
+//
+// Sin Arduino ni reservas de memoria: lo usan simulador/politica.cpp y las
+// pruebas nativas.
+#ifndef SIMULACIONPOLITICA_H
+#define SIMULACIONPOLITICA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "Estima.h"
+#include "GeoUtils.h"
+#include "PoliticaReporte.h"
+
+// Una muestra de la traza: lo que leería el firmware en ese instante
+struct MuestraTraza {
+  uint32_t utc;     // Segundos Unix
+  uint16_t utcMs;
+  double lat;
+  double lon;
+  float velocidad;  // km/h, -1 si no se conoce
+  float rumbo;      // Grados desde el norte, -1 si no se conoce
+};
+
+// Bytes de una sesión de reporte como los estima HTTPClient (DATOS_BYTES_*), sin los parámetros de la URL
+struct CostoSesion {
+  uint32_t fijos;      // TCP, TLS y cabeceras de ida y vuelta, cuerpo de la respuesta
+  uint32_t largoBase;  // "https://" API_ENDPOINT API_PATH y "&token=" DEVICE_TOKEN
+};
+
+struct ResultadoSimulacion {
+  uint32_t reportes;
+  uint32_t heartbeats;   // De los reportes, los que salieron por heartbeat
+  uint64_t bytes;
+  double errorMax;       // Metros entre la traza y la posición del servidor
+  double errorSuma;
+  uint32_t muestras;     // Con posición en el servidor (desde el primer reporte)
+  double segundos;       // Duración de las trazas
+
+  double errorMedio() const { return muestras > 0 ? errorSuma / muestras : 0; }
+};
+
+// Parámetros de la URL del reporte ('?lat=...&oldest=...'), como HTTPClient::construirURL()
+inline int largoParametros(const BaseEstima& base, uint32_t secuencia) {
+  char texto[160];
+  int n = snprintf(texto, sizeof(texto), "?lat=%.6f&lon=%.6f", base.lat, base.lon);
+  if (base.velocidad >= 0) {
+    n += snprintf(texto + n, sizeof(texto) - n, "&speed=%.1f", base.velocidad);
+  }
+  if (base.rumbo >= 0) {
+    n += snprintf(texto + n, sizeof(texto) - n, "&course=%.1f", base.rumbo);
+  }
+  n += snprintf(texto + n, sizeof(texto) - n, "&seq=%lu&ts=%lu&oldest=%lu", (unsigned long)secuencia,
+                (unsigned long)base.utc, (unsigned long)secuencia);
+  return n;
+}
+
+/**
+ * Reproduce una traza (muestras en orden, idealmente a 1 Hz) y suma a 'r'.
+ *
+ * El reloj del firmware es el tiempo de la traza: cada muestra es una vuelta
+ * del ciclo, con lectura cuando la política lo pide y heartbeat después. Todo
+ * envío sale de inmediato y llega (factor 1, sin lotes ni enlace malo ni
+ * eventos de viaje). El error se mide en cada muestra contra la posición que
+ * el servidor da en ese instante, extrapolada como mucho 'horizonteS'.
+ */
+inline void simularTraza(const MuestraTraza* muestras, size_t n, const ParametrosPolitica& parametros,
+                         const CostoSesion& costo, double horizonteS, ResultadoSimulacion& r) {
+  if (n == 0) {
+    return;
+  }
+  PoliticaReporte politica(parametros);
+  const uint32_t utc0 = muestras[0].utc;
+  politica.iniciar(0);
+  BaseEstima base;
+  bool conBase = false;
+  uint32_t secuencia = 0;
+
+  for (size_t i = 0; i < n; i++) {
+    const MuestraTraza& m = muestras[i];
+    unsigned long ahora = (unsigned long)(m.utc - utc0) * 1000 + m.utcMs;
+    DecisionReporte d;
+    d.motivo = REPORTE_NINGUNO;
+
+    if (politica.tocaLectura(ahora, false)) {
+      FixPolitica fix = { m.lat, m.lon, m.utc, m.utcMs, m.velocidad, m.rumbo, (uint64_t)ahora + 1 };
+      d = politica.evaluarFix(fix);
+    }
+    if (d.motivo == REPORTE_NINGUNO && politica.evaluarHeartbeat(ahora) == HEARTBEAT_ENVIAR) {
+      d = politica.reporteActual();
+    }
+    if (d.motivo != REPORTE_NINGUNO) {
+      // Como enviarYActualizar(): se reporta el último fix leído
+      const FixPolitica& leido = politica.getActual();
+      base = politica.armarBase(leido.lat, leido.lon, d.velocidad, d.rumbo, leido.utc);
+      politica.fijarReportado(leido.lat, leido.lon, base, leido.monotono);
+      politica.marcarEnvio(ahora);
+      conBase = true;
+      secuencia++;
+      r.reportes++;
+      r.heartbeats += d.motivo == REPORTE_HEARTBEAT ? 1 : 0;
+      r.bytes += costo.fijos + costo.largoBase + largoParametros(base, secuencia);
+    }
+
+    if (conBase) {
+      double edad = (double)(m.utc - base.utc) + m.utcMs / 1000.0;
+      double lat, lon;
+      predecirPosicion(base, edad < horizonteS ? edad : horizonteS, lat, lon);
+      double error = calcularDistancia(m.lat, m.lon, lat, lon);
+      if (error > r.errorMax) {
+        r.errorMax = error;
+      }
+      r.errorSuma += error;
+      r.muestras++;
+    }
+  }
+  r.segundos += (muestras[n - 1].utc - utc0) + (muestras[n - 1].utcMs - (int)muestras[0].utcMs) / 1000.0;
+}
+
+#endif // SIMULACIONPOLITICA_H
@@ -0,0 +1,293 @@
+// Simulador de la política de reporte: reproduce trazas GNSS grabadas con la
+// misma lógica que el ciclo principal del firmware (PoliticaReporte.cpp) para
+// cada combinación de parámetros y escribe, por combinación, los reportes, los
+// bytes estimados y el error máximo y medio de la posición que da el servidor
+// respecto de la traza (SimulacionPolitica.h).
+//
+//   g++ -std=c++11 -O2 -Wall -I simulador -I src/findme32 simulador/politica.cpp
+//       src/findme32/PoliticaReporte.cpp src/findme32/Estima.cpp src/findme32/GeoUtils.cpp -o politica
+//   ./politica -x 150 viajes_reparto/*.txt capturas/*.fmc
+//
+// Trazas, una por archivo, se simula cada una desde el arranque y se suman:
+// - Texto, una muestra por línea: "<ts> <lat> <lon> [velocidad|-] [rumbo|-]",
+//   ts en segundos Unix (admite decimales); '#' comenta el resto de la línea
+// - Capturas de alta frecuencia tal como llegan al endpoint de capturas (FMC1)
+//
+// Opciones (listas separadas por comas; sin ellas, un barrido por omisión):
+// -e modos (0 distancia, 1 estima), -u umbrales en metros (UMBRAL_MOVIMIENTO_METROS
+// o ESTIMA_UMBRAL_METROS según el modo), -l segundos entre lecturas, -h segundos
+// de heartbeat, -i segundos máximos sin reporte por estima, -m segundos
+// máximos de extrapolación del servidor (900), -x error máximo aceptable en
+// metros: al final se indica la combinación más barata que lo cumple.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "config_template.h"
+#include "SimulacionPolitica.h"
+
+#define CAPTURA_MAGIA 0x31434D46UL  // "FMC1" en little-endian, como CapturaGNSS.h
+#define CAPTURA_CABECERA 20
+#define CAPTURA_MUESTRA 16
+#define CAPTURA_SIN_VALOR 0xFFFF
+#define RESPUESTA_BYTES 32          // {"isActive":true,"ack":...}
+
+typedef std::vector<MuestraTraza> Traza;
+
+struct Opciones {
+  std::vector<double> modos;
+  std::vector<double> umbrales;
+  std::vector<double> lecturas;
+  std::vector<double> heartbeats;
+  std::vector<double> intervalosEstima;
+  double horizonte;
+  double errorAceptable;  // 0 = sin selección
+};
+
+static Opciones opc;
+
+static std::vector<double> leerLista(const char* texto) {
+  std::vector<double> valores;
+  const char* p = texto;
+  while (*p != '\0') {
+    char* fin;
+    double v = strtod(p, &fin);
+    if (fin == p || v < 0) {
+      fprintf(stderr, "Lista inválida: %s\n", texto);
+      exit(2);
+    }
+    valores.push_back(v);
+    p = *fin == ',' ? fin + 1 : fin;
+  }
+  return valores;
+}
+
+static uint32_t leerU32(const unsigned char* p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t leerU16(const unsigned char* p) {
+  return p[0] | (p[1] << 8);
+}
+
+// Captura FMC1: el instante de cada muestra sale de la referencia UTC de la cabecera
+static bool leerCaptura(const std::vector<unsigned char>& datos, Traza& traza) {
+  if (datos.size() < CAPTURA_CABECERA || leerU32(&datos[0]) != CAPTURA_MAGIA) {
+    return false;
+  }
+  size_t n = leerU16(&datos[4]);
+  uint32_t utcReferencia = leerU32(&datos[12]);
+  uint32_t msReferencia = leerU32(&datos[16]);
+  if (utcReferencia == 0 || datos.size() < CAPTURA_CABECERA + n * CAPTURA_MUESTRA) {
+    return false;  // Sin hora GNSS no se puede comparar con el servidor
+  }
+  for (size_t i = 0; i < n; i++) {
+    const unsigned char* p = &datos[CAPTURA_CABECERA + i * CAPTURA_MUESTRA];
+    int64_t ms = (int64_t)utcReferencia * 1000 + (int32_t)(leerU32(p) - msReferencia);
+    uint16_t velocidad = leerU16(p + 12);
+    uint16_t rumbo = leerU16(p + 14);
+    MuestraTraza m;
+    m.utc = (uint32_t)(ms / 1000);
+    m.utcMs = (uint16_t)(ms % 1000);
+    m.lat = (int32_t)leerU32(p + 4) / 1e7;
+    m.lon = (int32_t)leerU32(p + 8) / 1e7;
+    m.velocidad = velocidad == CAPTURA_SIN_VALOR ? -1.0f : velocidad / 100.0f;
+    m.rumbo = rumbo == CAPTURA_SIN_VALOR ? -1.0f : rumbo / 100.0f;
+    traza.push_back(m);
+  }
+  return true;
+}
+
+static float leerOpcional(const char* campo) {
+  return campo == NULL || strcmp(campo, "-") == 0 ? -1.0f : (float)atof(campo);
+}
+
+static bool leerTexto(const std::vector<unsigned char>& datos, Traza& traza) {
+  std::string texto(datos.begin(), datos.end());
+  size_t inicio = 0;
+  int numero = 0;
+  while (inicio < texto.size()) {
+    size_t fin = texto.find('\n', inicio);
+    std::string linea = texto.substr(inicio, fin == std::string::npos ? std::string::npos : fin - inicio);
+    inicio = fin == std::string::npos ? texto.size() : fin + 1;
+    numero++;
+    size_t comentario = linea.find('#');
+    if (comentario != std::string::npos) {
+      linea.erase(comentario);
+    }
+    char ts[32], lat[32], lon[32], velocidad[32], rumbo[32];
+    int campos = sscanf(linea.c_str(), "%31s %31s %31s %31s %31s", ts, lat, lon, velocidad, rumbo);
+    if (campos <= 0) {
+      continue;
+    }
+    if (campos < 3) {
+      fprintf(stderr, "Línea %d incompleta\n", numero);
+      return false;
+    }
+    double segundos = atof(ts);
+    MuestraTraza m;
+    m.utc = (uint32_t)segundos;
+    m.utcMs = (uint16_t)((segundos - m.utc) * 1000 + 0.5);
+    if (m.utcMs >= 1000) {
+      m.utc++;
+      m.utcMs = 0;
+    }
+    m.lat = atof(lat);
+    m.lon = atof(lon);
+    m.velocidad = leerOpcional(campos >= 4 ? velocidad : NULL);
+    m.rumbo = leerOpcional(campos >= 5 ? rumbo : NULL);
+    traza.push_back(m);
+  }
+  return true;
+}
+
+static bool antes(const MuestraTraza& a, const MuestraTraza& b) {
+  return a.utc != b.utc ? a.utc < b.utc : a.utcMs < b.utcMs;
+}
+
+static bool mismoInstante(const MuestraTraza& a, const MuestraTraza& b) {
+  return a.utc == b.utc && a.utcMs == b.utcMs;
+}
+
+static bool leerTraza(const char* ruta, Traza& traza) {
+  FILE* f = fopen(ruta, "rb");
+  if (f == NULL) {
+    perror(ruta);
+    return false;
+  }
+  std::vector<unsigned char> datos;
+  unsigned char bloque[4096];
+  size_t n;
+  while ((n = fread(bloque, 1, sizeof(bloque), f)) > 0) {
+    datos.insert(datos.end(), bloque, bloque + n);
+  }
+  fclose(f);
+  bool binaria = datos.size() >= 4 && leerU32(&datos[0]) == CAPTURA_MAGIA;
+  if (!(binaria ? leerCaptura(datos, traza) : leerTexto(datos, traza))) {
+    fprintf(stderr, "%s: traza inválida\n", ruta);
+    return false;
+  }
+  // La política y el error cuentan por la hora de cada muestra
+  std::stable_sort(traza.begin(), traza.end(), antes);
+  traza.erase(std::unique(traza.begin(), traza.end(), mismoInstante), traza.end());
+  return !traza.empty();
+}
+
+static void leerOpciones(int argc, char** argv) {
+  opc.modos = leerLista("0,1");
+  opc.umbrales = leerLista("10,25,50,100");
+  opc.lecturas = leerLista("5,10,20,30,60");
+  opc.heartbeats = leerLista("60,300,900");
+  opc.intervalosEstima.push_back(ESTIMA_INTERVALO_MAX_MS / 1000.0);
+  opc.horizonte = 900;
+  opc.errorAceptable = 0;
+  int o;
+  while ((o = getopt(argc, argv, "e:u:l:h:i:m:x:")) != -1) {
+    switch (o) {
+      case 'e': opc.modos = leerLista(optarg); break;
+      case 'u': opc.umbrales = leerLista(optarg); break;
+      case 'l': opc.lecturas = leerLista(optarg); break;
+      case 'h': opc.heartbeats = leerLista(optarg); break;
+      case 'i': opc.intervalosEstima = leerLista(optarg); break;
+      case 'm': opc.horizonte = atof(optarg); break;
+      case 'x': opc.errorAceptable = atof(optarg); break;
+      default:
+        fprintf(stderr, "uso: %s [-e modos] [-u metros] [-l s] [-h s] [-i s] [-m s] [-x metros] traza...\n",
+                argv[0]);
+        exit(2);
+    }
+  }
+  if (optind >= argc) {
+    fprintf(stderr, "Falta al menos una traza\n");
+    exit(2);
+  }
+}
+
+// Parámetros de la plantilla, con una combinación del barrido encima
+static ParametrosPolitica combinar(bool estima, double umbral, double lectura, double heartbeat, double intervalo) {
+  ParametrosPolitica p = {
+    UMBRAL_MOVIMIENTO_METROS, INTERVALO_LECTURA_GPS, INTERVALO_LECTURA_URGENTE, INTERVALO_HEARTBEAT,
+    estima, ESTIMA_UMBRAL_METROS, ESTIMA_INTERVALO_MAX_MS, ESTIMA_VELOCIDAD_MIN_KMH
+  };
+  if (estima) {
+    p.estimaUmbralMetros = umbral;
+    p.estimaIntervaloMs = (unsigned long)(intervalo * 1000);
+  } else {
+    p.umbralMetros = umbral;
+  }
+  p.lecturaMs = (unsigned long)(lectura * 1000);
+  p.heartbeatMs = (unsigned long)(heartbeat * 1000);
+  return p;
+}
+
+int main(int argc, char** argv) {
+  leerOpciones(argc, argv);
+
+  std::vector<Traza> trazas;
+  size_t totalMuestras = 0;
+  for (int i = optind; i < argc; i++) {
+    trazas.push_back(Traza());
+    if (!leerTraza(argv[i], trazas.back())) {
+      return 1;
+    }
+    totalMuestras += trazas.back().size();
+  }
+
+  CostoSesion costo;
+  costo.fijos = 2 * DATOS_BYTES_TCP + DATOS_BYTES_TLS_SUBIDA + DATOS_BYTES_TLS_BAJADA + DATOS_BYTES_CABECERAS_SUBIDA +
+                DATOS_BYTES_CABECERAS_BAJADA + RESPUESTA_BYTES;
+  costo.largoBase = strlen("https://" API_ENDPOINT API_PATH "&token=" DEVICE_TOKEN);
+
+  double horas = 0;
+  printf("# %u trazas, %u muestras\n", (unsigned)trazas.size(), (unsigned)totalMuestras);
+  printf("modo\tumbral_m\tlectura_s\theartbeat_s\testima_s\treportes\theartbeats\tkb\terror_max_m\terror_medio_m\n");
+
+  bool hayElegido = false;
+  std::string elegido;
+  uint64_t bytesElegido = 0;
+  for (size_t e = 0; e < opc.modos.size(); e++) {
+    bool estima = opc.modos[e] != 0;
+    for (size_t u = 0; u < opc.umbrales.size(); u++) {
+      for (size_t l = 0; l < opc.lecturas.size(); l++) {
+        for (size_t h = 0; h < opc.heartbeats.size(); h++) {
+          // El intervalo de la estima no cambia nada en el modo por distancia
+          size_t intervalos = estima ? opc.intervalosEstima.size() : 1;
+          for (size_t i = 0; i < intervalos; i++) {
+            double intervalo = estima ? opc.intervalosEstima[i] : 0;
+            ParametrosPolitica p = combinar(estima, opc.umbrales[u], opc.lecturas[l], opc.heartbeats[h], intervalo);
+            ResultadoSimulacion r;
+            memset(&r, 0, sizeof(r));
+            for (size_t t = 0; t < trazas.size(); t++) {
+              simularTraza(trazas[t].data(), trazas[t].size(), p, costo, opc.horizonte, r);
+            }
+            horas = r.segundos / 3600.0;
+
+            char fila[256];
+            snprintf(fila, sizeof(fila), "%s\t%.0f\t%.0f\t%.0f\t%s\t%lu\t%lu\t%.1f\t%.1f\t%.1f",
+                     estima ? "estima" : "distancia", opc.umbrales[u], opc.lecturas[l], opc.heartbeats[h],
+                     estima ? std::to_string((long)intervalo).c_str() : "-", (unsigned long)r.reportes,
+                     (unsigned long)r.heartbeats, r.bytes / 1024.0, r.errorMax, r.errorMedio());
+            printf("%s\n", fila);
+            if (opc.errorAceptable > 0 && r.errorMax <= opc.errorAceptable && (!hayElegido || r.bytes < bytesElegido)) {
+              hayElegido = true;
+              bytesElegido = r.bytes;
+              elegido = fila;
+            }
+          }
+        }
+      }
+    }
+  }
+  printf("# %.2f h de trazas\n", horas);
+  if (opc.errorAceptable > 0) {
+    if (hayElegido) {
+      printf("# Más barata con error máximo <= %.0f m:\n# %s\n", opc.errorAceptable, elegido.c_str());
+    } else {
+      printf("# Ninguna combinación con error máximo <= %.0f m\n", opc.errorAceptable);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,345 @@
+#include "ActualizacionOTA.h"
+#include "Bitacora.h"
+#include <esp_ota_ops.h>
+
+ActualizacionOTA::ActualizacionOTA(HTTPClient& httpClient)
+  : http(httpClient), enValidacion(false), inicioValidacion(0), cabeceraLista(false) {
+  objetivo[0] = '\0';
+  rechazada[0] = '\0';
+  anterior[0] = '\0';
+  memset(&cabecera, 0, sizeof(cabecera));
+}
+
+void ActualizacionOTA::begin() {
+  const esp_partition_t* enEjecucion = esp_ota_get_running_partition();
+  LOG_INFO("Firmware %s en la partición %s", FIRMWARE_VERSION, enEjecucion->label);
+
+  char nueva[OTA_LONGITUD_VERSION] = "";
+  uint8_t arranques = 0;
+  preferences.begin("ota", false);
+  preferences.getString("objetivo", objetivo, sizeof(objetivo));
+  preferences.getString("rechazada", rechazada, sizeof(rechazada));
+  preferences.getString("anterior", anterior, sizeof(anterior));
+  preferences.getString("nueva", nueva, sizeof(nueva));
+  enValidacion = preferences.getBool("validando", false);
+  if (enValidacion) {
+    arranques = preferences.getUChar("arranques", 0) + 1;
+    preferences.putUChar("arranques", arranques);
+  }
+  preferences.end();
+
+  if (enValidacion) {
+    inicioValidacion = millis();
+    if (strcmp(enEjecucion->label, anterior) == 0) {
+      // La imagen nueva no llegó a arrancar y el bootloader volvió a esta
+      LOG_ERROR("✗ OTA: la versión %s no arrancó; se mantiene %s", nueva, FIRMWARE_VERSION);
+      strncpy(rechazada, nueva, sizeof(rechazada) - 1);
+      enValidacion = false;
+      preferences.begin("ota", false);
+      preferences.putBool("validando", false);
+      preferences.putString("rechazada", rechazada);
+      preferences.end();
+    } else if (arranques > OTA_ARRANQUES_MAX) {
+      char motivo[48];
+      snprintf(motivo, sizeof(motivo), "se reinició %d veces sin reportar", arranques - 1);
+      revertir(motivo);
+    } else {
+      LOG_AVISO("OTA: imagen a prueba, arranque %u de %d", (unsigned)arranques, OTA_ARRANQUES_MAX);
+    }
+  }
+
+  if (!descargaPendiente()) {
+    return;
+  }
+  if (strcmp(objetivo, FIRMWARE_VERSION) == 0) {
+    descartar("ya está instalada", false);
+    return;
+  }
+  if (!LittleFS.begin(true)) {
+    LOG_ERROR("✗ OTA: no se pudo montar LittleFS");
+    return;
+  }
+  leerCabecera();
+  LOG_INFO("OTA: descarga de la versión %s pendiente desde el byte %lu", objetivo, (unsigned long)descargados());
+}
+
+void ActualizacionOTA::solicitar(const char* version) {
+  if (!OTA_HABILITADA || version == NULL || version[0] == '\0') {
+    return;
+  }
+  // Primero debe confirmarse la imagen a prueba
+  if (enValidacion || strcmp(version, FIRMWARE_VERSION) == 0 || strcmp(version, rechazada) == 0 ||
+      strcmp(version, objetivo) == 0) {
+    return;
+  }
+
+  // Una versión distinta de la que se descargaba invalida lo descargado
+  if (descargaPendiente()) {
+    LOG_AVISO("OTA: se abandona la versión %s", objetivo);
+  }
+  LittleFS.remove(OTA_ARCHIVO);
+  cabeceraLista = false;
+  strncpy(objetivo, version, sizeof(objetivo) - 1);
+  objetivo[sizeof(objetivo) - 1] = '\0';
+  guardarObjetivo();
+  LOG_INFO("OTA: el servidor ofrece la versión %s (actual %s)", objetivo, FIRMWARE_VERSION);
+}
+
+void ActualizacionOTA::guardarObjetivo() {
+  preferences.begin("ota", false);
+  if (descargaPendiente()) {
+    preferences.putString("objetivo", objetivo);
+  } else {
+    preferences.remove("objetivo");
+  }
+  preferences.end();
+}
+
+uint32_t ActualizacionOTA::descargados() const {
+  File f = LittleFS.open(OTA_ARCHIVO, "r");
+  if (!f) {
+    return 0;
+  }
+  uint32_t tamano = f.size();
+  f.close();
+  return tamano;
+}
+
+bool ActualizacionOTA::recibir(const uint8_t* datos, size_t n, void* contexto) {
+  ActualizacionOTA* ota = static_cast<ActualizacionOTA*>(contexto);
+  return ota->archivo.write(datos, n) == n;
+}
+
+bool ActualizacionOTA::descargarBloque() {
+  if (!descargaPendiente()) {
+    return false;
+  }
+
+  uint32_t desde = descargados();
+  uint32_t n = OTA_BLOQUE_BYTES;
+  if (cabeceraLista && cabecera.bytesDelta - desde < n) {
+    n = cabecera.bytesDelta - desde;
+  }
+
+  char ruta[HTTP_LONGITUD_URL / 2];
+  snprintf(ruta, sizeof(ruta), "%s?token=%s&desde=%s&hacia=%s", OTA_API_PATH, DEVICE_TOKEN, FIRMWARE_VERSION,
+           objetivo);
+
+  archivo = LittleFS.open(OTA_ARCHIVO, "a");
+  if (!archivo) {
+    LOG_ERROR("✗ OTA: no se pudo abrir %s", OTA_ARCHIVO);
+    return false;
+  }
+  uint32_t recibidos = http.descargarRango(ruta, desde, n, recibir, this);
+  archivo.close();
+
+  if (recibidos == 0) {
+    int codigo = http.ultimoCodigoHTTP();
+    if (codigo == 404 || codigo == 410) {
+      descartar("el servidor no tiene el delta", false);
+    } else if (codigo == 416) {
+      // Lo descargado no corresponde al delta del servidor: se empieza de nuevo
+      LOG_AVISO("✗ OTA: rango fuera del delta, se reinicia la descarga");
+      LittleFS.remove(OTA_ARCHIVO);
+      cabeceraLista = false;
+    }
+    return false;
+  }
+
+  uint32_t total = desde + recibidos;
+  if (!cabeceraLista && total >= sizeof(CabeceraDelta)) {
+    if (!leerCabecera() || !revisarCabecera()) {
+      descartar("delta inválido", true);
+      return false;
+    }
+  }
+  if (cabeceraLista && total > cabecera.bytesDelta) {
+    descartar("el delta excede su tamaño", true);
+    return false;
+  }
+
+  if (cabeceraLista) {
+    LOG_INFO("OTA: %lu de %lu bytes de la versión %s", (unsigned long)total, (unsigned long)cabecera.bytesDelta, objetivo);
+  } else {
+    LOG_INFO("OTA: %lu bytes de la versión %s", (unsigned long)total, objetivo);
+  }
+  if (cabeceraLista && total == cabecera.bytesDelta) {
+    return instalar();
+  }
+  return true;
+}
+
+bool ActualizacionOTA::leerCabecera() {
+  File f = LittleFS.open(OTA_ARCHIVO, "r");
+  cabeceraLista = f && f.read((uint8_t*)&cabecera, sizeof(cabecera)) == sizeof(cabecera);
+  if (f) {
+    f.close();
+  }
+  return cabeceraLista;
+}
+
+bool ActualizacionOTA::imagenEnEjecucionEs(const uint8_t* sha, uint32_t tamano) {
+  const esp_partition_t* enEjecucion = esp_ota_get_running_partition();
+  if (tamano > enEjecucion->size) {
+    return false;
+  }
+
+  uint8_t trozo[512];
+  uint8_t resumen[32];
+  mbedtls_sha256_context ctx;
+  mbedtls_sha256_init(&ctx);
+  mbedtls_sha256_starts(&ctx, 0);
+  bool leida = true;
+  for (uint32_t desde = 0; desde < tamano && leida; desde += sizeof(trozo)) {
+    size_t n = tamano - desde < sizeof(trozo) ? tamano - desde : sizeof(trozo);
+    leida = esp_partition_read(enEjecucion, desde, trozo, n) == ESP_OK;
+    mbedtls_sha256_update(&ctx, trozo, n);
+  }
+  mbedtls_sha256_finish(&ctx, resumen);
+  mbedtls_sha256_free(&ctx);
+  return leida && memcmp(resumen, sha, sizeof(resumen)) == 0;
+}
+
+bool ActualizacionOTA::revisarCabecera() {
+  const esp_partition_t* siguiente = esp_ota_get_next_update_partition(NULL);
+  const char* motivo = NULL;
+  if (cabecera.magia != DELTA_MAGIA) {
+    motivo = "no es un delta";
+  } else if (cabecera.bytesDelta <= sizeof(CabeceraDelta)) {
+    motivo = "tamaño inválido";
+  } else if (siguiente == NULL || cabecera.tamanoDestino > siguiente->size) {
+    motivo = "la imagen nueva no cabe en la partición";
+  } else if (!AplicadorDelta::verificarFirma(cabecera, OTA_CLAVE_PUBLICA)) {
+    motivo = "firma inválida";
+  } else if (!imagenEnEjecucionEs(cabecera.shaOrigen, cabecera.tamanoOrigen)) {
+    motivo = "calculado contra otra imagen";
+  }
+  if (motivo != NULL) {
+    LOG_ERROR("✗ OTA: delta rechazado, %s", motivo);
+    return false;
+  }
+  return true;
+}
+
+bool ActualizacionOTA::leerOrigen(uint32_t desde, uint8_t* destino, size_t n, void* contexto) {
+  return esp_partition_read(static_cast<Particiones*>(contexto)->origen, desde, destino, n) == ESP_OK;
+}
+
+bool ActualizacionOTA::escribirDestino(uint32_t desde, const uint8_t* datos, size_t n, void* contexto) {
+  return esp_partition_write(static_cast<Particiones*>(contexto)->destino, desde, datos, n) == ESP_OK;
+}
+
+bool ActualizacionOTA::instalar() {
+  if (!leerCabecera() || !revisarCabecera()) {
+    descartar("delta inválido", true);
+    return false;
+  }
+  File f = LittleFS.open(OTA_ARCHIVO, "r");
+  if (!f || f.size() != cabecera.bytesDelta) {
+    if (f) {
+      f.close();
+    }
+    LOG_ERROR("✗ OTA: el delta está incompleto");
+    return false;
+  }
+
+  Particiones p;
+  p.origen = esp_ota_get_running_partition();
+  p.destino = esp_ota_get_next_update_partition(NULL);
+  LOG_INFO("OTA: aplicando el delta sobre la partición %s (%lu bytes)...", p.destino->label,
+           (unsigned long)cabecera.tamanoDestino);
+
+  // Se borra solo lo que ocupará la imagen nueva, en sectores completos
+  uint32_t borrar = (cabecera.tamanoDestino + OTA_SECTOR_BYTES - 1) / OTA_SECTOR_BYTES * OTA_SECTOR_BYTES;
+  if (esp_partition_erase_range(p.destino, 0, borrar) != ESP_OK) {
+    f.close();
+    LOG_ERROR("✗ OTA: no se pudo borrar la partición");
+    return false;
+  }
+
+  AplicadorDelta aplicador(cabecera, leerOrigen, escribirDestino, &p);
+  uint8_t trozo[512];
+  size_t leidos = 0;
+  f.seek(sizeof(CabeceraDelta));
+  while ((leidos = f.read(trozo, sizeof(trozo))) > 0 && aplicador.consumir(trozo, leidos)) {
+  }
+  f.close();
+
+  if (!aplicador.valido()) {
+    descartar(aplicador.error() != NULL ? aplicador.error() : "la imagen no coincide con el hash firmado", true);
+    return false;
+  }
+  if (esp_ota_set_boot_partition(p.destino) != ESP_OK) {
+    descartar("la imagen nueva no es arrancable", true);
+    return false;
+  }
+
+  // A prueba desde el próximo arranque
+  preferences.begin("ota", false);
+  preferences.putBool("validando", true);
+  preferences.putUChar("arranques", 0);
+  preferences.putString("anterior", p.origen->label);
+  preferences.putString("nueva", objetivo);
+  preferences.remove("objetivo");
+  preferences.end();
+  LittleFS.remove(OTA_ARCHIVO);
+
+  LOG_AVISO("✓ OTA: versión %s instalada en %s, reiniciando...", objetivo, p.destino->label);
+  objetivo[0] = '\0';
+  cabeceraLista = false;
+  ESP.restart();
+  return true;
+}
+
+void ActualizacionOTA::descartar(const char* motivo, bool rechazar) {
+  LOG_ERROR("✗ OTA: se descarta la versión %s: %s", objetivo, motivo);
+  LittleFS.remove(OTA_ARCHIVO);
+  cabeceraLista = false;
+  if (rechazar) {
+    strncpy(rechazada, objetivo, sizeof(rechazada) - 1);
+    rechazada[sizeof(rechazada) - 1] = '\0';
+    preferences.begin("ota", false);
+    preferences.putString("rechazada", rechazada);
+    preferences.end();
+  }
+  objetivo[0] = '\0';
+  guardarObjetivo();
+}
+
+void ActualizacionOTA::confirmarArranque() {
+  if (!enValidacion) {
+    return;
+  }
+  enValidacion = false;
+  preferences.begin("ota", false);
+  preferences.putBool("validando", false);
+  preferences.remove("arranques");
+  preferences.end();
+  LOG_INFO("✓ OTA: versión %s confirmada", FIRMWARE_VERSION);
+}
+
+void ActualizacionOTA::atender() {
+  if (enValidacion && millis() - inicioValidacion >= OTA_VALIDACION_MS) {
+    char motivo[48];
+    snprintf(motivo, sizeof(motivo), "no reportó al servidor en %lu min", OTA_VALIDACION_MS / 60000);
+    revertir(motivo);
+  }
+}
+
+void ActualizacionOTA::revertir(const char* motivo) {
+  LOG_ERROR("✗ OTA: la versión %s %s; se vuelve a %s", FIRMWARE_VERSION, motivo, anterior);
+  enValidacion = false;
+  strncpy(rechazada, FIRMWARE_VERSION, sizeof(rechazada) - 1);
+  rechazada[sizeof(rechazada) - 1] = '\0';
+  preferences.begin("ota", false);
+  preferences.putBool("validando", false);
+  preferences.putString("rechazada", rechazada);
+  preferences.end();
+
+  const esp_partition_t* p = esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY, anterior);
+  if (p == NULL || esp_ota_set_boot_partition(p) != ESP_OK) {
+    LOG_ERROR("✗ OTA: no se pudo volver a la imagen anterior");
+    return;
+  }
+  ESP.restart();
+}
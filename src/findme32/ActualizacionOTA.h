@@ -0,0 +1,92 @@
+#ifndef ACTUALIZACIONOTA_H
+#define ACTUALIZACIONOTA_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <LittleFS.h>
+#include <esp_partition.h>
+#include "HTTPClient.h"
+#include "DeltaOTA.h"
+#include "config.h"
+
+// Versión de esta imagen; el entorno de compilación la define con -DFIRMWARE_VERSION=...
+#ifndef FIRMWARE_VERSION
+#define FIRMWARE_VERSION "1.0.0"
+#endif
+
+#define OTA_SECTOR_BYTES 4096  // Unidad de borrado de la flash
+
+/**
+ * Actualización de firmware por deltas firmados.
+ *
+ * Cuando el servidor ofrece una versión ("ota" en la respuesta a un reporte)
+ * se descarga un delta contra la imagen en ejecución por bloques de
+ * OTA_BLOQUE_BYTES con la cabecera Range. Cada bloque se agrega a
+ * OTA_ARCHIVO en LittleFS: el tamaño del archivo es el punto de reanudación,
+ * así que una caída de cobertura o un reinicio solo pierden el bloque en curso.
+ *
+ * Con la cabecera descargada se comprueban la firma y que la imagen en
+ * ejecución es la de origen; con el delta completo se aplica sobre la otra
+ * partición de aplicación, se verifica el hash firmado y se arranca de ella.
+ *
+ * La imagen nueva queda a prueba: si se reinicia OTA_ARRANQUES_MAX veces o
+ * pasa OTA_VALIDACION_MS sin un envío exitoso al servidor, se vuelve a la
+ * anterior y esa versión no se vuelve a aceptar.
+ */
+class ActualizacionOTA {
+public:
+  ActualizacionOTA(HTTPClient& http);
+
+  // Cuenta el arranque de una imagen a prueba y retoma una descarga pendiente
+  void begin();
+  // Versión ofrecida por el servidor (vacía = ninguna)
+  void solicitar(const char* version);
+  bool descargaPendiente() const { return objetivo[0] != '\0'; }
+  // Descarga el siguiente bloque; con el delta completo lo instala y reinicia
+  bool descargarBloque();
+  // Aplica el delta completo de OTA_ARCHIVO y cambia la partición de arranque
+  bool instalar();
+
+  // La imagen a prueba llegó al servidor: queda como definitiva
+  void confirmarArranque();
+  // Vuelve a la imagen anterior si venció el plazo de validación
+  void atender();
+  bool validando() const { return enValidacion; }
+
+  uint32_t descargados() const;
+  uint32_t totalDelta() const { return cabeceraLista ? cabecera.bytesDelta : 0; }
+
+private:
+  // Particiones que usa el aplicador del delta
+  struct Particiones {
+    const esp_partition_t* origen;
+    const esp_partition_t* destino;
+  };
+
+  HTTPClient& http;
+  Preferences preferences;
+
+  char objetivo[OTA_LONGITUD_VERSION];   // Versión en descarga
+  char rechazada[OTA_LONGITUD_VERSION];  // Versión que falló a prueba
+  char anterior[17];                     // Partición a la que se vuelve
+
+  bool enValidacion;
+  unsigned long inicioValidacion;
+
+  CabeceraDelta cabecera;
+  bool cabeceraLista;
+  File archivo;  // Abierto mientras se descarga un bloque
+
+  bool leerCabecera();
+  bool revisarCabecera();
+  bool imagenEnEjecucionEs(const uint8_t* sha, uint32_t tamano);
+  void descartar(const char* motivo, bool rechazar);
+  void revertir(const char* motivo);
+  void guardarObjetivo();
+
+  static bool recibir(const uint8_t* datos, size_t n, void* contexto);
+  static bool leerOrigen(uint32_t desde, uint8_t* destino, size_t n, void* contexto);
+  static bool escribirDestino(uint32_t desde, const uint8_t* datos, size_t n, void* contexto);
+};
+
+#endif // ACTUALIZACIONOTA_H
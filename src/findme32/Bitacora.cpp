@@ -0,0 +1,250 @@
+#include "Bitacora.h"
+#include <stdarg.h>
+
+// El anillo se comparte con la tarea de drenado: las copias van en sección crítica
+#if defined(ARDUINO_ARCH_ESP32)
+static portMUX_TYPE cerrojo = portMUX_INITIALIZER_UNLOCKED;
+#define BLOQUEAR() portENTER_CRITICAL(&cerrojo)
+#define DESBLOQUEAR() portEXIT_CRITICAL(&cerrojo)
+#else
+#define BLOQUEAR()
+#define DESBLOQUEAR()
+#endif
+
+static __NOINIT_ATTR MemoriaBitacora memoriaBitacora;
+Bitacora bitacora(memoriaBitacora);
+
+// Diferencia con signo entre posiciones del anillo, válida aunque den la vuelta
+static int32_t distancia(uint32_t desde, uint32_t hasta) {
+  return (int32_t)(hasta - desde);
+}
+
+Bitacora::Bitacora(MemoriaBitacora& m)
+  : memoria(m), iniciada(false), diferido(false), guardarPendiente(false), flashOcupada(false) {
+  // La memoria no se toca: puede traer la sesión anterior
+}
+
+void Bitacora::vaciar() {
+  memoria.magia = BITACORA_MAGIA;
+  memoria.inicio = 0;
+  memoria.escritura = 0;
+  memoria.drenado = 0;
+  memoria.guardado = 0;
+  memoria.descartadas = 0;
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+static void tareaDrenado(void* parametro) {
+  Bitacora* b = static_cast<Bitacora*>(parametro);
+  for (;;) {
+    b->atender();
+    vTaskDelay(pdMS_TO_TICKS(BITACORA_DRENADO_MS));
+  }
+}
+#endif
+
+void Bitacora::begin() {
+  // Tras un corte de alimentación la RAM trae basura: se descarta entera
+  uint32_t ocupados = memoria.escritura - memoria.inicio;
+  if (memoria.magia != BITACORA_MAGIA || ocupados > BITACORA_RAM_BYTES ||
+      distancia(memoria.inicio, memoria.drenado) < 0 || distancia(memoria.drenado, memoria.escritura) < 0 ||
+      distancia(memoria.inicio, memoria.guardado) < 0 || distancia(memoria.guardado, memoria.escritura) < 0) {
+    vaciar();
+  }
+  // Lo que la sesión anterior no llegó a mostrar ya no saldrá por Serial
+  memoria.drenado = memoria.escritura;
+  iniciada = true;
+
+  LittleFS.begin(true);
+  guardar();
+
+#if defined(ARDUINO_ARCH_ESP32)
+  // Por debajo de loop(): el USB puede bloquear sin demorar el rastreo
+  if (xTaskCreate(tareaDrenado, "bitacora", 4096, this, tskIDLE_PRIORITY, NULL) == pdPASS) {
+    diferido = true;
+  }
+#endif
+}
+
+void Bitacora::liberar(size_t n) {
+  // Se pisan líneas completas desde la más antigua
+  while (memoria.escritura + n - memoria.inicio > BITACORA_RAM_BYTES) {
+    while (memoria.inicio != memoria.escritura && memoria.datos[memoria.inicio++ % BITACORA_RAM_BYTES] != '\n') {
+    }
+    if (distancia(memoria.drenado, memoria.inicio) > 0) {
+      memoria.drenado = memoria.inicio;
+      memoria.descartadas++;
+    }
+    if (distancia(memoria.guardado, memoria.inicio) > 0) {
+      memoria.guardado = memoria.inicio;
+    }
+  }
+}
+
+void Bitacora::registrar(uint8_t nivel, const char* formato, ...) {
+  static const char letras[] = "-EAID";
+  char linea[BITACORA_LINEA_MAX];
+  int n = snprintf(linea, sizeof(linea), "%8lu %c ", millis(), letras[nivel <= BITACORA_DEPURACION ? nivel : 0]);
+  va_list args;
+  va_start(args, formato);
+  int m = vsnprintf(linea + n, sizeof(linea) - n - 1, formato, args);
+  va_end(args);
+  size_t largo = n + (m < 0 ? 0 : (size_t)m < sizeof(linea) - n - 1 ? (size_t)m : sizeof(linea) - n - 2);
+  linea[largo++] = '\n';
+
+  // Antes de begin() la RAM aún no es del anillo
+  if (!iniciada) {
+#if BITACORA_SERIE
+    Serial.write((const uint8_t*)linea, largo);
+#endif
+    return;
+  }
+
+  BLOQUEAR();
+  liberar(largo);
+  size_t posicion = memoria.escritura % BITACORA_RAM_BYTES;
+  size_t primera = BITACORA_RAM_BYTES - posicion < largo ? BITACORA_RAM_BYTES - posicion : largo;
+  memcpy(memoria.datos + posicion, linea, primera);
+  memcpy(memoria.datos, linea + primera, largo - primera);
+  memoria.escritura += largo;
+  if (nivel <= BITACORA_GUARDAR_NIVEL) {
+    guardarPendiente = true;
+  }
+  DESBLOQUEAR();
+
+  if (!diferido) {
+    atender();
+  }
+}
+
+size_t Bitacora::copiarLinea(uint32_t desde, char* destino, size_t capacidad) const {
+  size_t n = 0;
+  while (n < capacidad && desde + n != memoria.escritura) {
+    char c = memoria.datos[(desde + n) % BITACORA_RAM_BYTES];
+    destino[n++] = c;
+    if (c == '\n') {
+      break;
+    }
+  }
+  return n;
+}
+
+int Bitacora::drenar() {
+  int lineas = 0;
+  char linea[BITACORA_LINEA_MAX];
+  for (;;) {
+    BLOQUEAR();
+    size_t n = copiarLinea(memoria.drenado, linea, sizeof(linea));
+    memoria.drenado += n;
+    DESBLOQUEAR();
+    if (n == 0) {
+      break;
+    }
+#if BITACORA_SERIE
+    Serial.write((const uint8_t*)linea, n);
+#endif
+    lineas++;
+  }
+  return lineas;
+}
+
+bool Bitacora::reservarFlash() {
+  BLOQUEAR();
+  bool libre = !flashOcupada;
+  flashOcupada = true;
+  DESBLOQUEAR();
+  return libre;
+}
+
+void Bitacora::escribirFlash() {
+  guardarPendiente = false;
+  File f = LittleFS.open(BITACORA_ARCHIVO, "a");
+  if (!f) {
+    return;
+  }
+  char linea[BITACORA_LINEA_MAX];
+  for (;;) {
+    BLOQUEAR();
+    size_t n = copiarLinea(memoria.guardado, linea, sizeof(linea));
+    memoria.guardado += n;
+    DESBLOQUEAR();
+    if (n == 0) {
+      break;
+    }
+    f.write((const uint8_t*)linea, n);
+  }
+  size_t tamano = f.size();
+  f.close();
+
+  // Al llenarse la mitad, el actual pasa a ser el anterior
+  if (tamano >= BITACORA_FLASH_BYTES / 2) {
+    LittleFS.remove(BITACORA_ARCHIVO_ANTERIOR);
+    LittleFS.rename(BITACORA_ARCHIVO, BITACORA_ARCHIVO_ANTERIOR);
+  }
+}
+
+void Bitacora::guardar() {
+  if (!reservarFlash()) {
+    return;  // Otra tarea está guardando o subiendo la historia
+  }
+  escribirFlash();
+  flashOcupada = false;
+}
+
+void Bitacora::atender() {
+  drenar();
+  if (guardarPendiente) {
+    guardar();
+  }
+}
+
+bool Bitacora::prepararEnvio() {
+  if (!reservarFlash()) {
+    return false;
+  }
+  escribirFlash();
+  return true;
+}
+
+size_t Bitacora::bytesGuardados() {
+  size_t total = 0;
+  const char* archivos[] = { BITACORA_ARCHIVO_ANTERIOR, BITACORA_ARCHIVO };
+  for (size_t i = 0; i < 2; i++) {
+    File f = LittleFS.open(archivos[i], "r");
+    if (f) {
+      total += f.size();
+      f.close();
+    }
+  }
+  return total;
+}
+
+size_t Bitacora::leerGuardada(size_t desde, uint8_t* destino, size_t n) {
+  // El anterior primero: la historia sale en orden
+  size_t leidos = 0;
+  const char* archivos[] = { BITACORA_ARCHIVO_ANTERIOR, BITACORA_ARCHIVO };
+  for (size_t i = 0; i < 2 && leidos < n; i++) {
+    File f = LittleFS.open(archivos[i], "r");
+    if (!f) {
+      continue;
+    }
+    size_t tamano = f.size();
+    if (desde >= tamano) {
+      desde -= tamano;
+    } else {
+      f.seek(desde);
+      leidos += f.read(destino + leidos, n - leidos);
+      desde = 0;
+    }
+    f.close();
+  }
+  return leidos;
+}
+
+void Bitacora::terminarEnvio(bool recibida) {
+  if (recibida) {
+    LittleFS.remove(BITACORA_ARCHIVO_ANTERIOR);
+    LittleFS.remove(BITACORA_ARCHIVO);
+  }
+  flashOcupada = false;
+}
@@ -0,0 +1,126 @@
+#ifndef BITACORA_H
+#define BITACORA_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "config.h"
+
+// Niveles: BITACORA_NIVEL (config.h) es el más detallado que se compila
+#define BITACORA_NADA 0
+#define BITACORA_ERROR 1
+#define BITACORA_AVISO 2
+#define BITACORA_INFO 3
+#define BITACORA_DEPURACION 4
+
+// RAM que el arranque no borra: el anillo sobrevive a reinicios por software y del watchdog
+#if defined(ARDUINO_ARCH_ESP32)
+#include <esp_attr.h>
+#endif
+#ifndef __NOINIT_ATTR
+#define __NOINIT_ATTR
+#endif
+
+#define BITACORA_MAGIA 0x31474F4CUL          // "LOG1"
+#define BITACORA_ARCHIVO "/bitacora.log"
+#define BITACORA_ARCHIVO_ANTERIOR "/bitacora.ant"
+
+/**
+ * Anillo de líneas terminadas en '\n'. Las posiciones crecen sin volver a
+ * cero; el índice en 'datos' es la posición módulo BITACORA_RAM_BYTES.
+ */
+struct MemoriaBitacora {
+  uint32_t magia;
+  uint32_t inicio;      // Primera línea completa que sigue en el anillo
+  uint32_t escritura;   // Donde empieza la próxima línea
+  uint32_t drenado;     // Hasta dónde salió por Serial
+  uint32_t guardado;    // Hasta dónde está en la flash
+  uint32_t descartadas; // Líneas pisadas antes de salir por Serial
+  char datos[BITACORA_RAM_BYTES];
+};
+
+/**
+ * Bitácora por niveles con salida diferida.
+ *
+ * LOG_ERROR/LOG_AVISO/LOG_INFO/LOG_DEPURACION formatean con printf en la pila
+ * y copian la línea a un anillo en RAM, sin heap y sin esperar al USB. Lo que
+ * se difiere es la salida, no el formato: muchos argumentos son el c_str() de
+ * un String temporal o un búfer local que ya no existe cuando corre la tarea
+ * de drenado, así que guardar el formato con los argumentos crudos no sería
+ * seguro. vsnprintf() en la pila cuesta microsegundos; la espera al USB, que
+ * es lo que estiraba las esperas AT, queda fuera de la llamada. Los
+ * niveles por encima de BITACORA_NIVEL no se compilan: sus argumentos ni se
+ * evalúan. En el ESP32 una tarea de baja prioridad vacía el anillo por Serial
+ * (si BITACORA_SERIE); sin ella, cada línea sale al registrarse.
+ *
+ * El anillo vive en RAM no inicializada: tras un reinicio que no corta la
+ * alimentación (watchdog, pánico, ESP.restart) begin() pasa a la flash lo que
+ * la sesión anterior no guardó. La flash conserva los últimos
+ * BITACORA_FLASH_BYTES en dos archivos que se alternan; el servidor los pide
+ * con "log":true.
+ */
+class Bitacora {
+public:
+  explicit Bitacora(MemoriaBitacora& memoria);
+
+  // Rescata la sesión anterior a la flash y arranca la tarea de drenado
+  void begin();
+  void registrar(uint8_t nivel, const char* formato, ...) __attribute__((format(printf, 3, 4)));
+
+  // Saca por Serial las líneas pendientes; devuelve cuántas
+  int drenar();
+  // Agrega a la flash lo que aún no está guardado
+  void guardar();
+  // Trabajo de la tarea de drenado: Serial y, tras un error, la flash
+  void atender();
+
+  // Subida de la historia en flash: guarda lo pendiente y la congela hasta terminarEnvio()
+  bool prepararEnvio();
+  size_t bytesGuardados();
+  size_t leerGuardada(size_t desde, uint8_t* destino, size_t n);
+  void terminarEnvio(bool recibida);
+
+  uint32_t descartadas() const { return memoria.descartadas; }
+  // Solo pruebas: las líneas quedan en el anillo hasta drenar()
+  void diferirDrenado() { diferido = true; }
+
+private:
+  MemoriaBitacora& memoria;
+  bool iniciada;
+  bool diferido;                 // Hay quien llame a atender(): registrar() no escribe por Serial
+  volatile bool guardarPendiente;
+  volatile bool flashOcupada;    // Un guardado o una subida en curso
+
+  void vaciar();
+  bool reservarFlash();
+  void escribirFlash();
+  void liberar(size_t n);
+  size_t copiarLinea(uint32_t desde, char* destino, size_t capacidad) const;
+};
+
+extern Bitacora bitacora;
+
+#if BITACORA_NIVEL >= BITACORA_ERROR
+#define LOG_ERROR(...) bitacora.registrar(BITACORA_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) do {} while (0)
+#endif
+
+#if BITACORA_NIVEL >= BITACORA_AVISO
+#define LOG_AVISO(...) bitacora.registrar(BITACORA_AVISO, __VA_ARGS__)
+#else
+#define LOG_AVISO(...) do {} while (0)
+#endif
+
+#if BITACORA_NIVEL >= BITACORA_INFO
+#define LOG_INFO(...) bitacora.registrar(BITACORA_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) do {} while (0)
+#endif
+
+#if BITACORA_NIVEL >= BITACORA_DEPURACION
+#define LOG_DEPURACION(...) bitacora.registrar(BITACORA_DEPURACION, __VA_ARGS__)
+#else
+#define LOG_DEPURACION(...) do {} while (0)
+#endif
+
+#endif // BITACORA_H
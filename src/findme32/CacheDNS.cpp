@@ -0,0 +1,164 @@
+#include "CacheDNS.h"
+#include "Bitacora.h"
+
+CacheDNS::CacheDNS(CanalAT& canalAT, const char* nombre, bool porDireccion)
+  : canal(canalAT), host(nombre), conectarPorIP(porDireccion), habilitada(false), total(0), actual(0),
+    vigente(false), resuelto(0), huboIntento(false), ultimoIntento(0), datosFuncionan(true) {}
+
+bool CacheDNS::esDireccionIP(const char* nombre) {
+  if (strchr(nombre, ':') != NULL) {
+    return true;  // IPv6
+  }
+  for (const char* p = nombre; *p != '\0'; p++) {
+    if ((*p < '0' || *p > '9') && *p != '.') {
+      return false;
+    }
+  }
+  return nombre[0] != '\0';
+}
+
+void CacheDNS::begin() {
+  habilitada = conectarPorIP && !esDireccionIP(host);
+  if (!habilitada) {
+    return;
+  }
+
+  char guardado[256] = "";  // Nombre DNS más largo: 253
+  preferences.begin("dns", true);
+  preferences.getString("host", guardado, sizeof(guardado));
+  if (strcmp(guardado, host) == 0) {
+    size_t leidos = preferences.getBytes("ips", ips, sizeof(ips));
+    total = (int)(leidos / DNS_LONGITUD_IP);
+  }
+  preferences.end();
+
+  for (int i = 0; i < total; i++) {
+    ips[i][DNS_LONGITUD_IP - 1] = '\0';
+  }
+  if (total > 0) {
+    LOG_INFO("Caché DNS: %s -> %s (guardada, se resolverá de nuevo)", host, ips[0]);
+  }
+}
+
+const char* CacheDNS::servidor() const {
+  return porIP() ? ips[actual] : host;
+}
+
+bool CacheDNS::porIP() const {
+  return habilitada && actual < total;
+}
+
+int CacheDNS::parsearCDNSGIP(const char* respuesta, char destino[][DNS_LONGITUD_IP], int max) {
+  // +CDNSGIP: 1,"<nombre>","<ip1>"[,"<ip2>"]  /  +CDNSGIP: 0,<error>
+  const char* p = strstr(respuesta, "+CDNSGIP:");
+  if (p == NULL) {
+    return 0;
+  }
+  p += 9;
+  while (*p == ' ') p++;
+  if (*p != '1') {
+    return 0;
+  }
+  // Saltar el nombre: las direcciones son los campos entrecomillados que siguen
+  p = strchr(p, '"');
+  if (p == NULL || (p = strchr(p + 1, '"')) == NULL) {
+    return 0;
+  }
+  p++;
+  int n = 0;
+  while (n < max && (p = strchr(p, '"')) != NULL) {
+    const char* fin = strchr(p + 1, '"');
+    if (fin == NULL) {
+      break;
+    }
+    size_t largo = fin - p - 1;
+    const char* salto = strchr(p, '\n');
+    if (salto != NULL && salto < fin) {
+      break;  // Otra línea
+    }
+    if (largo > 0 && largo < DNS_LONGITUD_IP) {
+      memcpy(destino[n], p + 1, largo);
+      destino[n][largo] = '\0';
+      if (esDireccionIP(destino[n])) {
+        n++;
+      }
+    }
+    p = fin + 1;
+  }
+  return n;
+}
+
+void CacheDNS::guardar() {
+  preferences.begin("dns", false);
+  preferences.putString("host", host);
+  preferences.putBytes("ips", ips, total * DNS_LONGITUD_IP);
+  preferences.end();
+}
+
+bool CacheDNS::atender() {
+  if (!habilitada || !datosFuncionan || !canal.libre()) {
+    return false;
+  }
+  unsigned long ahora = millis();
+  if (vigente && ahora - resuelto < DNS_TTL_MS) {
+    return false;
+  }
+  if (huboIntento && ahora - ultimoIntento < DNS_REINTENTO_MS) {
+    return false;
+  }
+  huboIntento = true;
+  ultimoIntento = ahora;
+
+  char nuevas[DNS_DIRECCIONES][DNS_LONGITUD_IP];
+  int n = 0;
+  if (canal.ejecutar(AT_CDNSGIP, host) == AT_OK) {
+    n = parsearCDNSGIP(canal.respuesta().c_str(), nuevas, DNS_DIRECCIONES);
+  }
+  if (n == 0) {
+    LOG_AVISO("✗ No se pudo resolver %s: se conecta por %s", host, servidor());
+    return false;
+  }
+
+  bool cambio = n != total || actual != 0;
+  for (int i = 0; i < n && !cambio; i++) {
+    cambio = strcmp(nuevas[i], ips[i]) != 0;
+  }
+  memcpy(ips, nuevas, sizeof(nuevas));
+  total = n;
+  actual = 0;
+  vigente = true;
+  resuelto = millis();
+  if (cambio) {
+    guardar();  // La NVS solo se escribe si cambió la respuesta
+  }
+  LOG_INFO("✓ %s -> %s (%d direcciones, vigente %lu min)", host, ips[0], n, DNS_TTL_MS / 60000);
+  return true;
+}
+
+void CacheDNS::registrarConexion(ResultadoEnvio resultado, bool porDireccion) {
+  switch (resultado) {
+    case ENVIO_OK:
+    case ENVIO_ERROR_SERVIDOR:
+      datosFuncionan = true;
+      break;
+    case ENVIO_SIN_REGISTRO:
+    case ENVIO_SIN_PDP:
+      datosFuncionan = false;  // Sin datos tampoco hay DNS
+      break;
+    case ENVIO_ERROR_CONFIG:
+      break;
+    default:
+      // Conexión fallida: si fue por IP, la siguiente dirección o el nombre
+      if (porDireccion && porIP()) {
+        LOG_AVISO("✗ Sin conexión con %s (%s)", ips[actual], HTTPClient::nombreResultado(resultado));
+        actual++;
+        if (actual >= total) {
+          LOG_AVISO("Direcciones agotadas: se conecta por nombre y se resolverá de nuevo");
+          vigente = false;
+          huboIntento = false;
+        }
+      }
+      datosFuncionan = true;
+      break;
+  }
+}
@@ -0,0 +1,69 @@
+#ifndef CACHEDNS_H
+#define CACHEDNS_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "config.h"
+#include "CanalAT.h"
+#include "HTTPClient.h"
+
+#define DNS_LONGITUD_IP 40  // IPv6 en texto
+
+/**
+ * Direcciones de API_ENDPOINT resueltas con AT+CDNSGIP.
+ *
+ * Sin caché, cada AT+HTTPACTION resuelve el nombre dentro del módem y un
+ * fallo de esa consulta es el error 703. Con las direcciones en RAM y NVS
+ * ("dns") el HTTPClient conecta por IP y manda el nombre en la cabecera Host,
+ * y la resolución se hace en atender(), fuera del envío de los reportes.
+ *
+ * El módem toma el SNI del host de la URL: por IP, el handshake no lleva el
+ * nombre. Por eso es opcional (DNS_CONECTAR_POR_IP) y apagado de fábrica.
+ *
+ * AT+CDNSGIP no informa el TTL: una resolución vale DNS_TTL_MS. Tras un
+ * reinicio las direcciones guardadas se usan pero cuentan como vencidas.
+ * Si la conexión por IP falla se pasa a la siguiente dirección y, agotadas,
+ * al nombre hasta la próxima resolución.
+ */
+class CacheDNS {
+public:
+  // 'conectarPorIP' false: ni resuelve ni cambia la URL (el módem resuelve el nombre en cada sesión)
+  CacheDNS(CanalAT& canal, const char* host, bool conectarPorIP = DNS_CONECTAR_POR_IP);
+
+  void begin();
+
+  // Resuelve de nuevo si la entrada venció y los datos funcionan; true si resolvió
+  bool atender();
+
+  // Host para la URL: la dirección vigente o el nombre
+  const char* servidor() const;
+  bool porIP() const;
+  int direcciones() const { return total; }
+
+  // Resultado de la última sesión HTTP; 'porDireccion' si fue a servidor() por IP
+  void registrarConexion(ResultadoEnvio resultado, bool porDireccion);
+
+  static int parsearCDNSGIP(const char* respuesta, char destino[][DNS_LONGITUD_IP], int max);
+  static bool esDireccionIP(const char* host);
+
+private:
+  CanalAT& canal;
+  const char* host;
+  Preferences preferences;
+  bool conectarPorIP;
+  bool habilitada;
+
+  char ips[DNS_DIRECCIONES][DNS_LONGITUD_IP];
+  int total;
+  int actual;  // La que se usa; las anteriores ya fallaron
+
+  bool vigente;
+  unsigned long resuelto;
+  bool huboIntento;
+  unsigned long ultimoIntento;
+  bool datosFuncionan;
+
+  void guardar();
+};
+
+#endif // CACHEDNS_H
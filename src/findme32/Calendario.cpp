@@ -0,0 +1,25 @@
+#include "Calendario.h"
+
+// Algoritmos de días civiles con el año empezando en marzo: el 29 de febrero
+// queda al final y no necesita casos especiales
+
+long diasDesdeEpoca(int anio, int mes, int dia) {
+  long a = anio - (mes <= 2 ? 1 : 0);
+  long era = (a >= 0 ? a : a - 399) / 400;
+  long anioDeEra = a - era * 400;
+  long diaDelAnio = (153 * (mes > 2 ? mes - 3 : mes + 9) + 2) / 5 + dia - 1;
+  long diaDeEra = anioDeEra * 365 + anioDeEra / 4 - anioDeEra / 100 + diaDelAnio;
+  return era * 146097 + diaDeEra - 719468;
+}
+
+void fechaDesdeDias(long dias, int& anio, int& mes, int& dia) {
+  dias += 719468;
+  long era = (dias >= 0 ? dias : dias - 146096) / 146097;
+  long diaDeEra = dias - era * 146097;
+  long anioDeEra = (diaDeEra - diaDeEra / 1460 + diaDeEra / 36524 - diaDeEra / 146096) / 365;
+  long diaDelAnio = diaDeEra - (365 * anioDeEra + anioDeEra / 4 - anioDeEra / 100);
+  long mesMarzo = (5 * diaDelAnio + 2) / 153;
+  dia = (int)(diaDelAnio - (153 * mesMarzo + 2) / 5 + 1);
+  mes = (int)(mesMarzo < 10 ? mesMarzo + 3 : mesMarzo - 9);
+  anio = (int)(anioDeEra + era * 400 + (mes <= 2 ? 1 : 0));
+}
@@ -0,0 +1,21 @@
+#ifndef CALENDARIO_H
+#define CALENDARIO_H
+
+// ============================
+// UTILIDADES DE CALENDARIO (UTC)
+// ============================
+
+/**
+ * Días desde 1970-01-01 para una fecha del calendario gregoriano
+ * @param anio Año completo (p.ej. 2024)
+ * @param mes 1-12
+ * @param dia 1-31
+ */
+long diasDesdeEpoca(int anio, int mes, int dia);
+
+/**
+ * Fecha gregoriana de un número de días desde 1970-01-01
+ */
+void fechaDesdeDias(long dias, int& anio, int& mes, int& dia);
+
+#endif // CALENDARIO_H
@@ -0,0 +1,409 @@
+#include "CanalAT.h"
+#include "Bitacora.h"
+
+// Tiempo máximo que un comando bloqueante espera a que otra transacción libere el canal
+#define CANAL_TIMEOUT_ESPERA_LIBRE 90000UL
+// Reenvíos tras un timeout, solo para comandos marcados como reintentables
+#define CANAL_REINTENTOS_TIMEOUT 1
+
+// Prefijos que el módem puede emitir en cualquier momento
+static const char* const PREFIJOS_URC[] = {
+  "+CMTI:",
+  "+HTTPACTION:",
+  "+AGPS:",
+  "+HTTP_NONET_EVENT",
+  "+HTTP_PEER_CLOSED",
+  "+CGEV:",
+  "+CPIN:",
+  "+CREG:",
+  "+CEREG:",
+  "+CGREG:",
+  "RDY",
+  "SMS DONE",
+  "PB DONE",
+  "*ATREADY"
+};
+static const int TOTAL_PREFIJOS_URC = sizeof(PREFIJOS_URC) / sizeof(PREFIJOS_URC[0]);
+
+CanalAT::CanalAT(HardwareSerial& serial)
+  : gsm(serial), transaccionActiva(false), estado(AT_OK), lineaFin(NULL), esperaPrompt(false),
+    limite(0), lineaLen(0), binarioDestino(NULL), binarioCapacidad(0), binarioPendientes(0),
+    binarioRecibidos(0), urcCount(0), manejadoresCount(0), tareaFondo(NULL), enTareaFondo(false),
+    latido(NULL), grabador(NULL) {
+  prefijoRespuesta[0] = '\0';
+  comandoActual[0] = '\0';
+  resp.reserve(256);
+}
+
+bool CanalAT::esResultadoFinal(const char* l) {
+  return strcmp(l, "OK") == 0 ||
+         strcmp(l, "ERROR") == 0 ||
+         strncmp(l, "+CME ERROR", 10) == 0 ||
+         strncmp(l, "+CMS ERROR", 10) == 0;
+}
+
+bool CanalAT::esURC(const char* l) const {
+  for (int i = 0; i < TOTAL_PREFIJOS_URC; i++) {
+    if (strncmp(l, PREFIJOS_URC[i], strlen(PREFIJOS_URC[i])) == 0) return true;
+  }
+  for (int i = 0; i < manejadoresCount; i++) {
+    if (strncmp(l, manejadores[i].prefijo, strlen(manejadores[i].prefijo)) == 0) return true;
+  }
+  return false;
+}
+
+void CanalAT::guardarURC(const char* l) {
+  if (urcCount == CANAL_MAX_URC_PENDIENTES) {
+    // Descartar el más antiguo
+    for (int i = 1; i < urcCount; i++) {
+      memcpy(urcPendientes[i - 1], urcPendientes[i], CANAL_LONGITUD_URC);
+    }
+    urcCount--;
+  }
+  strncpy(urcPendientes[urcCount], l, CANAL_LONGITUD_URC - 1);
+  urcPendientes[urcCount][CANAL_LONGITUD_URC - 1] = '\0';
+  urcCount++;
+}
+
+bool CanalAT::tomarURC(const char* prefijo, String& destino) {
+  size_t n = strlen(prefijo);
+  for (int i = 0; i < urcCount; i++) {
+    if (strncmp(urcPendientes[i], prefijo, n) == 0) {
+      destino = urcPendientes[i];
+      for (int j = i + 1; j < urcCount; j++) {
+        memcpy(urcPendientes[j - 1], urcPendientes[j], CANAL_LONGITUD_URC);
+      }
+      urcCount--;
+      return true;
+    }
+  }
+  return false;
+}
+
+void CanalAT::procesarLinea() {
+  while (lineaLen > 0 && (linea[lineaLen - 1] == '\r' || linea[lineaLen - 1] == '\n')) {
+    lineaLen--;
+  }
+  linea[lineaLen] = '\0';
+  lineaLen = 0;
+
+  if (linea[0] == '\0') {
+    return;
+  }
+
+  bool delComando = transaccionActiva && prefijoRespuesta[0] != '\0' &&
+                    strncmp(linea, prefijoRespuesta, strlen(prefijoRespuesta)) == 0;
+
+  if (!delComando && esURC(linea)) {
+    bool atendido = false;
+    for (int i = 0; i < manejadoresCount; i++) {
+      if (strncmp(linea, manejadores[i].prefijo, strlen(manejadores[i].prefijo)) == 0) {
+        manejadores[i].funcion(linea, manejadores[i].contexto);
+        atendido = true;
+      }
+    }
+    if (!atendido) {
+      guardarURC(linea);
+    }
+    return;
+  }
+
+  if (!transaccionActiva || (estado != AT_EN_CURSO && estado != AT_PROMPT)) {
+    return;  // Línea huérfana (eco tardío, restos de un timeout)
+  }
+
+  if (delComando && binarioDestino != NULL) {
+    long n = atol(linea + strlen(prefijoRespuesta));
+    binarioPendientes = n > 0 ? (size_t)n : 0;
+  }
+
+  resp += linea;
+  resp += "\r\n";
+
+  if (lineaFin != NULL && strncmp(linea, lineaFin, strlen(lineaFin)) == 0) {
+    estado = AT_OK;
+  } else if (esResultadoFinal(linea)) {
+    if (strcmp(linea, "OK") != 0) {
+      estado = AT_ERROR;
+    } else if (lineaFin == NULL) {
+      estado = AT_OK;
+    }
+  }
+}
+
+void CanalAT::leerEntrada() {
+  while (gsm.available()) {
+    char c = (char)gsm.read();
+    if (grabador != NULL) {
+      grabador->recibido(c);
+    }
+
+    if (binarioPendientes > 0) {
+      if (binarioRecibidos < binarioCapacidad) {
+        binarioDestino[binarioRecibidos++] = (uint8_t)c;
+      }
+      binarioPendientes--;
+      continue;
+    }
+
+    if (c == '\n') {
+      procesarLinea();
+      continue;
+    }
+
+    linea[lineaLen++] = c;
+
+    if (transaccionActiva && esperaPrompt && estado == AT_EN_CURSO && linea[0] == '>') {
+      estado = AT_PROMPT;
+      lineaLen = 0;
+      continue;
+    }
+
+    if (lineaLen >= (int)sizeof(linea) - 1) {
+      // Línea demasiado larga (cuerpo HTTP): se agrega a la respuesta sin separador
+      linea[lineaLen] = '\0';
+      if (transaccionActiva) {
+        resp += linea;
+      }
+      lineaLen = 0;
+    }
+  }
+}
+
+bool CanalAT::formatear(IdComandoAT id, va_list args) {
+  int n = vsnprintf(comandoActual, sizeof(comandoActual), COMANDOS_AT[id].texto, args);
+  if (n < 0 || n >= (int)sizeof(comandoActual)) {
+    LOG_ERROR("✗ Comando AT demasiado largo, no enviado: %s", COMANDOS_AT[id].texto);
+    return false;
+  }
+  return true;
+}
+
+void CanalAT::enviarComando(const ComandoAT& c, uint8_t* destino, size_t capacidad) {
+  // Despachar lo que haya llegado antes (URCs) para no mezclarlo con la respuesta
+  leerEntrada();
+
+  // Prefijo de las líneas de respuesta propias: "AT+CGACT?" -> "+CGACT:"
+  prefijoRespuesta[0] = '\0';
+  if (strncmp(comandoActual, "AT+", 3) == 0) {
+    int i = 0;
+    prefijoRespuesta[i++] = '+';
+    for (const char* p = comandoActual + 3; *p != '\0' && i < (int)sizeof(prefijoRespuesta) - 2; p++) {
+      if (*p == '=' || *p == '?') break;
+      prefijoRespuesta[i++] = *p;
+    }
+    prefijoRespuesta[i++] = ':';
+    prefijoRespuesta[i] = '\0';
+  }
+
+  resp = "";
+  binarioDestino = destino;
+  binarioCapacidad = destino != NULL ? capacidad : 0;
+  binarioPendientes = 0;
+  binarioRecibidos = 0;
+  lineaFin = c.fin;
+  esperaPrompt = c.final == FINAL_PROMPT;
+  estado = AT_EN_CURSO;
+  transaccionActiva = true;
+  limite = millis() + c.timeoutMs;
+
+  gsm.println(comandoActual);
+  if (grabador != NULL) {
+    grabador->enviado(comandoActual);
+    grabador->enviado("\r\n");
+  }
+}
+
+bool CanalAT::iniciar(IdComandoAT id, ...) {
+  if (transaccionActiva) {
+    return false;
+  }
+
+  va_list args;
+  va_start(args, id);
+  bool formateado = formatear(id, args);
+  va_end(args);
+  if (!formateado) {
+    return false;
+  }
+
+  enviarComando(COMANDOS_AT[id]);
+  return true;
+}
+
+ResultadoAT CanalAT::sondear() {
+  latir();
+  leerEntrada();
+  if ((estado == AT_EN_CURSO || estado == AT_PROMPT) && (long)(millis() - limite) >= 0) {
+    estado = AT_TIMEOUT;
+  }
+  return estado;
+}
+
+void CanalAT::enviarDatos(const char* datos, uint8_t terminador, unsigned long timeout_ms) {
+  gsm.print(datos);
+  if (terminador != 0) {
+    gsm.write(terminador);
+  }
+  if (grabador != NULL) {
+    grabador->enviado(datos);
+    if (terminador != 0) {
+      grabador->enviado(terminador);
+    }
+  }
+  esperaPrompt = false;
+  estado = AT_EN_CURSO;
+  limite = millis() + timeout_ms;
+}
+
+void CanalAT::enviarBytes(const uint8_t* datos, size_t n, unsigned long timeout_ms) {
+  gsm.write(datos, n);
+  if (grabador != NULL) {
+    for (size_t i = 0; i < n; i++) {
+      grabador->enviado(datos[i]);
+    }
+  }
+  lineaFin = NULL;
+  estado = AT_EN_CURSO;
+  limite = millis() + timeout_ms;
+}
+
+void CanalAT::finalizar() {
+  transaccionActiva = false;
+  lineaFin = NULL;
+  esperaPrompt = false;
+  // Un cuerpo cortado por timeout no se come las líneas de la transacción siguiente
+  binarioDestino = NULL;
+  binarioPendientes = 0;
+}
+
+void CanalAT::ejecutarTareaFondo() {
+  if (tareaFondo == NULL || enTareaFondo) {
+    return;
+  }
+  enTareaFondo = true;
+  tareaFondo();
+  enTareaFondo = false;
+}
+
+void CanalAT::latir() {
+  if (latido != NULL) {
+    latido();
+  }
+}
+
+ResultadoAT CanalAT::ejecutar(IdComandoAT id, ...) {
+  va_list args;
+  va_start(args, id);
+  ResultadoAT r = ejecutarLista(id, args, NULL, 0);
+  va_end(args);
+  return r;
+}
+
+ResultadoAT CanalAT::ejecutarBinario(uint8_t* destino, size_t capacidad, IdComandoAT id, ...) {
+  va_list args;
+  va_start(args, id);
+  ResultadoAT r = ejecutarLista(id, args, destino, capacidad);
+  va_end(args);
+  return r;
+}
+
+ResultadoAT CanalAT::ejecutarLista(IdComandoAT id, va_list args, uint8_t* destino, size_t capacidad) {
+  const ComandoAT& c = COMANDOS_AT[id];
+
+  // Si otra transacción (p.ej. un SMS en curso) tiene el canal, dejar que avance
+  unsigned long inicioEspera = millis();
+  while (transaccionActiva) {
+    if (millis() - inicioEspera >= CANAL_TIMEOUT_ESPERA_LIBRE) {
+      LOG_ERROR("✗ Canal AT ocupado. Comando no enviado: %s", c.texto);
+      resp = "ERROR";
+      return AT_ERROR;
+    }
+    latir();
+    ejecutarTareaFondo();
+    leerEntrada();
+    delay(5);
+  }
+
+  if (!formatear(id, args)) {
+    resp = "ERROR";
+    return AT_ERROR;
+  }
+
+  ResultadoAT r = AT_TIMEOUT;
+  for (int intento = 0; intento <= CANAL_REINTENTOS_TIMEOUT; intento++) {
+    if (intento > 0) {
+      if (!c.reintentable) break;
+      LOG_AVISO("Timeout, reintentando: %s", comandoActual);
+    }
+
+    enviarComando(c, destino, capacidad);
+    r = sondear();
+    while (r == AT_EN_CURSO || r == AT_PROMPT) {
+      delay(5);
+      r = sondear();
+    }
+    finalizar();
+
+    if (r != AT_TIMEOUT) break;
+  }
+  return r;
+}
+
+bool CanalAT::esperarURC(IdComandoAT id, String& destino, const char* const* abortos) {
+  return esperarURC(COMANDOS_AT[id].urc, COMANDOS_AT[id].timeoutUrcMs, destino, abortos);
+}
+
+bool CanalAT::esperarURC(const char* prefijo, unsigned long timeout_ms, String& destino, const char* const* abortos) {
+  unsigned long inicio = millis();
+
+  while (millis() - inicio < timeout_ms) {
+    if (!transaccionActiva) {
+      leerEntrada();
+    }
+
+    if (tomarURC(prefijo, destino)) {
+      return true;
+    }
+    if (abortos != NULL) {
+      for (int i = 0; abortos[i] != NULL; i++) {
+        if (tomarURC(abortos[i], destino)) {
+          return false;
+        }
+      }
+    }
+
+    latir();
+    ejecutarTareaFondo();
+    delay(10);
+  }
+
+  destino = "";
+  return false;
+}
+
+void CanalAT::pausa(unsigned long ms) {
+  unsigned long inicio = millis();
+  while (millis() - inicio < ms) {
+    atender();
+    latir();
+    ejecutarTareaFondo();
+    delay(10);
+  }
+}
+
+void CanalAT::registrarURC(const char* prefijo, ManejadorURC manejador, void* contexto) {
+  if (manejadoresCount >= CANAL_MAX_MANEJADORES) {
+    return;
+  }
+  manejadores[manejadoresCount].prefijo = prefijo;
+  manejadores[manejadoresCount].funcion = manejador;
+  manejadores[manejadoresCount].contexto = contexto;
+  manejadoresCount++;
+}
+
+void CanalAT::atender() {
+  if (!transaccionActiva) {
+    leerEntrada();
+  }
+}
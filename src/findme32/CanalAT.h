@@ -0,0 +1,136 @@
+#ifndef CANALAT_H
+#define CANALAT_H
+
+#include <Arduino.h>
+#include <stdarg.h>
+#include "GrabadorUART.h"
+#include "ComandosAT.h"
+
+#define CANAL_MAX_URC_PENDIENTES 4
+#define CANAL_MAX_MANEJADORES 6
+#define CANAL_LONGITUD_URC 96
+
+/**
+ * Resultado de una transacción AT
+ */
+enum ResultadoAT {
+  AT_EN_CURSO,
+  AT_PROMPT,   // El módem espera datos ('>')
+  AT_OK,
+  AT_ERROR,
+  AT_TIMEOUT
+};
+
+typedef void (*ManejadorURC)(const char* linea, void* contexto);
+typedef void (*TareaFondo)();
+
+/**
+ * Árbitro del canal AT compartido por el rastreador y el control SMS.
+ *
+ * Solo puede haber una transacción en curso. Las respuestas se separan por
+ * líneas: las que empiezan con un prefijo de URC conocido (+CMTI, +HTTPACTION,
+ * +CGEV...) y no pertenecen al comando en curso se despachan a sus manejadores
+ * y se guardan para esperarURC(), en lugar de mezclarse con la respuesta.
+ *
+ * Mientras se espera un URC largo (p.ej. +HTTPACTION) o el canal está ocupado,
+ * se ejecuta la tarea de fondo, lo que permite intercalar SMS con una sesión
+ * HTTP sin bloquear ninguna de las dos funciones.
+ *
+ * Toda espera (respuesta, URC, canal ocupado, pausa) llama al latido: una
+ * vuelta del ciclo puede encadenar varias sesiones largas, y cada espera ya
+ * está acotada por su propio timeout.
+ */
+class CanalAT {
+public:
+  CanalAT(HardwareSerial& serial);
+
+  HardwareSerial& getSerial() { return gsm; }
+
+  // API no bloqueante (transacciones de varios pasos, p.ej. AT+CMGS).
+  // Los argumentos completan la plantilla del descriptor (ComandosAT.h).
+  bool iniciar(IdComandoAT id, ...);
+  ResultadoAT sondear();
+  void enviarDatos(const char* datos, uint8_t terminador, unsigned long timeout_ms);
+  // Datos binarios tras la línea 'fin' (p.ej. "DOWNLOAD" de AT+HTTPDATA); la transacción termina con OK
+  void enviarBytes(const uint8_t* datos, size_t n, unsigned long timeout_ms);
+  const String& respuesta() const { return resp; }
+  // Bytes copiados por el último ejecutarBinario()
+  size_t binariosRecibidos() const { return binarioRecibidos; }
+  void finalizar();
+  bool libre() const { return !transaccionActiva; }
+
+  // API bloqueante: espera el canal, envía y espera el final del descriptor.
+  // La respuesta queda en respuesta() hasta la siguiente transacción.
+  ResultadoAT ejecutar(IdComandoAT id, ...);
+  // Como ejecutar(), con un cuerpo binario anunciado por su línea de respuesta
+  // ("+HTTPREAD: n"): los n bytes siguientes se copian a 'destino' sin partirlos
+  // en líneas. Solo en esta transacción: un AT+CMGS en curso mientras espera el
+  // canal no lo activa con su "+CMGS: <ref>".
+  ResultadoAT ejecutarBinario(uint8_t* destino, size_t capacidad, IdComandoAT id, ...);
+  bool esperarURC(const char* prefijo, unsigned long timeout_ms, String& linea, const char* const* abortos = NULL);
+  bool esperarURC(IdComandoAT id, String& linea, const char* const* abortos = NULL);
+  void pausa(unsigned long ms);
+
+  // URCs y tareas de fondo
+  void registrarURC(const char* prefijo, ManejadorURC manejador, void* contexto);
+  void setTareaFondo(TareaFondo tarea) { tareaFondo = tarea; }
+  // Se llama en cada vuelta de espera, también dentro de la tarea de fondo (p.ej. el watchdog)
+  void setLatido(TareaFondo funcion) { latido = funcion; }
+  void atender();
+
+  // Transcripción del UART para reproducirla en test/ (NULL = sin grabar)
+  void setGrabador(GrabadorUART* g) { grabador = g; }
+
+private:
+  struct Manejador {
+    const char* prefijo;
+    ManejadorURC funcion;
+    void* contexto;
+  };
+
+  HardwareSerial& gsm;
+
+  char comandoActual[AT_LONGITUD_COMANDO];
+
+  bool transaccionActiva;
+  ResultadoAT estado;
+  String resp;
+  char prefijoRespuesta[16];
+  const char* lineaFin;
+  bool esperaPrompt;
+  unsigned long limite;
+
+  char linea[CANAL_LONGITUD_URC * 2];
+  int lineaLen;
+
+  uint8_t* binarioDestino;
+  size_t binarioCapacidad;
+  size_t binarioPendientes;
+  size_t binarioRecibidos;
+
+  char urcPendientes[CANAL_MAX_URC_PENDIENTES][CANAL_LONGITUD_URC];
+  int urcCount;
+
+  Manejador manejadores[CANAL_MAX_MANEJADORES];
+  int manejadoresCount;
+
+  TareaFondo tareaFondo;
+  bool enTareaFondo;
+  TareaFondo latido;
+
+  GrabadorUART* grabador;
+
+  bool formatear(IdComandoAT id, va_list args);
+  void enviarComando(const ComandoAT& c, uint8_t* destino = NULL, size_t capacidad = 0);
+  ResultadoAT ejecutarLista(IdComandoAT id, va_list args, uint8_t* destino, size_t capacidad);
+  void leerEntrada();
+  void procesarLinea();
+  bool esURC(const char* l) const;
+  void guardarURC(const char* l);
+  bool tomarURC(const char* prefijo, String& destino);
+  void ejecutarTareaFondo();
+  void latir();
+  static bool esResultadoFinal(const char* l);
+};
+
+#endif // CANALAT_H
@@ -0,0 +1,203 @@
+#include "CapturaGNSS.h"
+#include "Bitacora.h"
+#include <LittleFS.h>
+#include <math.h>
+
+CapturaGNSS::CapturaGNSS(CanalAT& canalAT, RelojGNSS& relojGNSS)
+  : canal(canalAT), reloj(relojGNSS), inicio(0), cantidad(0), urcActivo(false), ultimoFallo(0),
+    motivoPendiente(CAPTURA_NINGUNO), msDisparo(0), hayAnterior(false), congelada(false), pinAnterior(HIGH) {
+  memset(&cabecera, 0, sizeof(cabecera));
+  memset(&anterior, 0, sizeof(anterior));
+}
+
+const char* CapturaGNSS::nombreMotivo(MotivoCaptura motivo) {
+  switch (motivo) {
+    case CAPTURA_VELOCIDAD: return "velocidad";
+    case CAPTURA_PIN:       return "pin";
+    case CAPTURA_SERVIDOR:  return "servidor";
+    default:                return "ninguno";
+  }
+}
+
+void CapturaGNSS::begin() {
+  if (!CAPTURA_HABILITADA) {
+    return;
+  }
+  canal.registrarURC("+CGNSSINFO:", manejarURC, this);
+
+#if CAPTURA_PIN_DISPARO >= 0
+  pinMode(CAPTURA_PIN_DISPARO, INPUT_PULLUP);
+  pinAnterior = digitalRead(CAPTURA_PIN_DISPARO);
+#endif
+
+  if (!LittleFS.begin(true)) {
+    LOG_ERROR("✗ Captura: no se pudo montar LittleFS");
+    return;
+  }
+
+  // Una captura congelada antes del reinicio sigue pendiente de subir
+  File f = LittleFS.open(CAPTURA_ARCHIVO, "r");
+  if (!f) {
+    return;
+  }
+  bool valida = f.read((uint8_t*)&cabecera, sizeof(cabecera)) == sizeof(cabecera) &&
+                cabecera.magia == CAPTURA_MAGIA && cabecera.version == CAPTURA_VERSION &&
+                f.size() == bytesCongelados();
+  f.close();
+  if (valida) {
+    congelada = true;
+    LOG_INFO("Captura pendiente de subir: %u muestras (%s)", (unsigned)cabecera.muestras,
+             nombreMotivo((MotivoCaptura)cabecera.motivo));
+  } else {
+    LittleFS.remove(CAPTURA_ARCHIVO);
+    memset(&cabecera, 0, sizeof(cabecera));
+  }
+}
+
+void CapturaGNSS::reiniciar() {
+  urcActivo = false;
+  ultimoFallo = 0;
+}
+
+void CapturaGNSS::manejarURC(const char* linea, void* contexto) {
+  static_cast<CapturaGNSS*>(contexto)->ingerir(linea);
+}
+
+void CapturaGNSS::ingerir(const char* linea) {
+  GpsData fix;
+  fix.valida = false;
+  if (GPSModule::parsearCGNSSINFO(linea, fix)) {
+    fix.monotono = reloj.ahora();
+    reloj.sincronizar(fix);
+    agregar(fix);
+  }
+}
+
+void CapturaGNSS::aMuestra(const GpsData& fix, MuestraGNSS& destino) {
+  destino.ms = (uint32_t)fix.monotono;
+  destino.lat = (int32_t)lround(fix.lat * 1e7);
+  destino.lon = (int32_t)lround(fix.lon * 1e7);
+  destino.velocidad = fix.velocidad >= 0 && fix.velocidad < 655.0f ? (uint16_t)lroundf(fix.velocidad * 100) : 0xFFFF;
+  destino.rumbo = fix.rumbo >= 0 && fix.rumbo < 360.0f ? (uint16_t)lroundf(fix.rumbo * 100) : 0xFFFF;
+}
+
+void CapturaGNSS::agregar(const GpsData& fix) {
+  if (cantidad < CAPTURA_MUESTRAS) {
+    aMuestra(fix, anillo[(inicio + cantidad) % CAPTURA_MUESTRAS]);
+    cantidad++;
+  } else {
+    aMuestra(fix, anillo[inicio]);
+    inicio = (inicio + 1) % CAPTURA_MUESTRAS;
+  }
+
+  if (fix.velocidad < 0) {
+    return;
+  }
+
+  // El tiempo GNSS no depende de cuándo se leyó el URC; si falta, el de llegada
+  double dt = hayAnterior ? RelojGNSS::segundosEntre(anterior, fix) : 0;
+  // Tras un hueco (GNSS apagado, sin fix) no se compara
+  if (dt > 0 && dt <= 3.0 * CAPTURA_PERIODO_S && fabs(fix.velocidad - anterior.velocidad) / dt >= CAPTURA_DELTA_KMH_S) {
+    disparar(CAPTURA_VELOCIDAD);
+  }
+  hayAnterior = true;
+  anterior = fix;
+}
+
+void CapturaGNSS::disparar(MotivoCaptura motivo) {
+  if (disparada()) {
+    return;
+  }
+  if (congelada) {
+    LOG_AVISO("Captura: disparo por %s ignorado, la anterior aún no se sube", nombreMotivo(motivo));
+    return;
+  }
+  motivoPendiente = motivo;
+  msDisparo = reloj.ahora();
+  LOG_AVISO("Captura disparada (%s): se congela en %lu s", nombreMotivo(motivo),
+            (unsigned long)(CAPTURA_POST_DISPARO_MS / 1000));
+}
+
+void CapturaGNSS::atender(bool gnssActivo) {
+  if (!CAPTURA_HABILITADA) {
+    return;
+  }
+
+  // URC periódico solo con el GNSS encendido; tras un fallo se espera antes de reintentar
+  if (gnssActivo != urcActivo && (ultimoFallo == 0 || millis() - ultimoFallo >= CAPTURA_REINTENTO_MS)) {
+    if (canal.ejecutar(AT_CGNSSINFO_AUTO, gnssActivo ? CAPTURA_PERIODO_S : 0) == AT_OK) {
+      urcActivo = gnssActivo;
+      ultimoFallo = 0;
+      if (gnssActivo) {
+        LOG_INFO("Captura: +CGNSSINFO cada %d s", CAPTURA_PERIODO_S);
+      } else {
+        LOG_INFO("Captura: URC +CGNSSINFO desactivado");
+      }
+    } else {
+      ultimoFallo = millis();
+    }
+    hayAnterior = false;
+  }
+
+#if CAPTURA_PIN_DISPARO >= 0
+  int nivel = digitalRead(CAPTURA_PIN_DISPARO);
+  if (pinAnterior == HIGH && nivel == LOW) {
+    disparar(CAPTURA_PIN);
+  }
+  pinAnterior = nivel;
+#endif
+
+  if (disparada() && reloj.ahora() - msDisparo >= CAPTURA_POST_DISPARO_MS) {
+    congelar();
+  }
+}
+
+void CapturaGNSS::congelar() {
+  MotivoCaptura motivo = motivoPendiente;
+  motivoPendiente = CAPTURA_NINGUNO;
+
+  File f = LittleFS.open(CAPTURA_ARCHIVO, "w");
+  if (!f) {
+    LOG_ERROR("✗ Captura: no se pudo crear %s", CAPTURA_ARCHIVO);
+    return;
+  }
+
+  cabecera.magia = CAPTURA_MAGIA;
+  cabecera.muestras = (uint16_t)cantidad;
+  cabecera.version = CAPTURA_VERSION;
+  cabecera.motivo = (uint8_t)motivo;
+  cabecera.msDisparo = (uint32_t)msDisparo;
+  cabecera.utcReferencia = reloj.ahoraUTC();
+  cabecera.msReferencia = cabecera.utcReferencia != 0 ? (uint32_t)reloj.monotonoDe(cabecera.utcReferencia * 1000ULL) : 0;
+
+  // El anillo en dos tramos: de 'inicio' al final del arreglo y del principio a 'inicio'
+  int primero = cantidad < CAPTURA_MUESTRAS - inicio ? cantidad : CAPTURA_MUESTRAS - inicio;
+  size_t escritos = f.write((const uint8_t*)&cabecera, sizeof(cabecera));
+  escritos += f.write((const uint8_t*)&anillo[inicio], primero * sizeof(MuestraGNSS));
+  escritos += f.write((const uint8_t*)&anillo[0], (cantidad - primero) * sizeof(MuestraGNSS));
+  f.close();
+
+  if (escritos != bytesCongelados()) {
+    LOG_ERROR("✗ Captura: flash llena, se descarta");
+    LittleFS.remove(CAPTURA_ARCHIVO);
+    return;
+  }
+  congelada = true;
+  LOG_INFO("Captura congelada en flash: %d muestras, %lu bytes", cantidad, (unsigned long)escritos);
+}
+
+size_t CapturaGNSS::leerCongelada(size_t desde, uint8_t* destino, size_t n) const {
+  File f = LittleFS.open(CAPTURA_ARCHIVO, "r");
+  if (!f) {
+    return 0;
+  }
+  size_t leidos = f.seek(desde) ? f.read(destino, n) : 0;
+  f.close();
+  return leidos;
+}
+
+void CapturaGNSS::descartarCongelada() {
+  LittleFS.remove(CAPTURA_ARCHIVO);
+  congelada = false;
+  memset(&cabecera, 0, sizeof(cabecera));
+}
@@ -0,0 +1,120 @@
+#ifndef CAPTURAGNSS_H
+#define CAPTURAGNSS_H
+
+#include <Arduino.h>
+#include "CanalAT.h"
+#include "GPSModule.h"
+#include "RelojGNSS.h"
+#include "config.h"
+
+#define CAPTURA_MAGIA 0x31434D46UL  // "FMC1" en little-endian
+#define CAPTURA_VERSION 1
+
+/**
+ * Qué congeló la captura
+ */
+enum MotivoCaptura {
+  CAPTURA_NINGUNO,
+  CAPTURA_VELOCIDAD,  // Cambio brusco de velocidad entre fixes consecutivos
+  CAPTURA_PIN,        // CAPTURA_PIN_DISPARO pasó a nivel bajo
+  CAPTURA_SERVIDOR    // "capture":true en la respuesta del servidor
+};
+
+/**
+ * Un fix en punto fijo: 16 bytes en RAM y en el archivo (little-endian)
+ */
+struct MuestraGNSS {
+  uint32_t ms;         // Reloj monótono al recibir el fix (32 bits bajos)
+  int32_t lat;         // Grados x 1e7
+  int32_t lon;         // Grados x 1e7
+  uint16_t velocidad;  // km/h x 100; 0xFFFF si no se conoce
+  uint16_t rumbo;      // Grados x 100; 0xFFFF si no se conoce
+};
+
+/**
+ * Cabecera del archivo congelado. Le siguen 'muestras' MuestraGNSS, de la
+ * más antigua a la más nueva.
+ */
+struct CabeceraCaptura {
+  uint32_t magia;          // CAPTURA_MAGIA
+  uint16_t muestras;
+  uint8_t version;
+  uint8_t motivo;          // MotivoCaptura
+  uint32_t msDisparo;      // Reloj monótono del disparo, como MuestraGNSS::ms
+  uint32_t utcReferencia;  // Un segundo UTC exacto según RelojGNSS (0 si no hay hora)...
+  uint32_t msReferencia;   // ...y su instante monótono: utc = utcReferencia + (ms - msReferencia) / 1000.0
+};
+
+static_assert(sizeof(MuestraGNSS) == 16, "MuestraGNSS debe ocupar 16 bytes");
+static_assert(sizeof(CabeceraCaptura) == 20, "CabeceraCaptura debe ocupar 20 bytes");
+static_assert(CAPTURA_MUESTRAS > 0 && CAPTURA_MUESTRAS <= 65535, "CAPTURA_MUESTRAS no cabe en la cabecera");
+
+/**
+ * Captura de alta frecuencia para reconstruir incidentes.
+ *
+ * Mientras el GNSS está encendido, el módem emite +CGNSSINFO cada
+ * CAPTURA_PERIODO_S; el manejador de URC lo convierte en una MuestraGNSS y
+ * lo guarda en un anillo en RAM con los últimos CAPTURA_MUESTRAS fixes, sin
+ * usar el heap. Un disparo (cambio de velocidad, pin o servidor) sigue
+ * grabando CAPTURA_POST_DISPARO_MS y congela el anillo en flash
+ * (CAPTURA_ARCHIVO), donde sobrevive a un reinicio hasta que se sube.
+ *
+ * Solo se guarda una captura congelada: los disparos posteriores se ignoran
+ * hasta que el servidor confirma la subida.
+ */
+class CapturaGNSS {
+public:
+  CapturaGNSS(CanalAT& canal, RelojGNSS& reloj);
+
+  void begin();
+  // Mantiene el URC activo mientras el GNSS está encendido, revisa el pin y congela tras el disparo
+  void atender(bool gnssActivo);
+  // Tras ciclar el módem se pierde la configuración del URC
+  void reiniciar();
+
+  // Línea +CGNSSINFO (URC); público para las pruebas
+  void ingerir(const char* linea);
+  void agregar(const GpsData& fix);
+  void disparar(MotivoCaptura motivo);
+  bool disparada() const { return motivoPendiente != CAPTURA_NINGUNO; }
+
+  int muestras() const { return cantidad; }
+  const MuestraGNSS& muestra(int indice) const { return anillo[(inicio + indice) % CAPTURA_MUESTRAS]; }  // 0 = más antigua
+
+  // Captura congelada en flash, pendiente de subir
+  bool hayCongelada() const { return congelada; }
+  const CabeceraCaptura& getCabecera() const { return cabecera; }
+  size_t bytesCongelados() const { return sizeof(CabeceraCaptura) + cabecera.muestras * sizeof(MuestraGNSS); }
+  size_t leerCongelada(size_t desde, uint8_t* destino, size_t n) const;
+  void descartarCongelada();
+
+  static const char* nombreMotivo(MotivoCaptura motivo);
+  static void aMuestra(const GpsData& fix, MuestraGNSS& destino);
+
+private:
+  CanalAT& canal;
+  RelojGNSS& reloj;
+
+  MuestraGNSS anillo[CAPTURA_MUESTRAS];
+  int inicio;
+  int cantidad;
+
+  bool urcActivo;
+  unsigned long ultimoFallo;
+
+  MotivoCaptura motivoPendiente;
+  uint64_t msDisparo;  // Reloj monótono
+
+  // Fix anterior con velocidad, para el disparo por cambio brusco
+  bool hayAnterior;
+  GpsData anterior;
+
+  bool congelada;
+  CabeceraCaptura cabecera;
+  int pinAnterior;
+
+  static void manejarURC(const char* linea, void* contexto);
+  void congelar();
+};
+
+#endif // CAPTURAGNSS_H
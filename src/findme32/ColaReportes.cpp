@@ -0,0 +1,67 @@
+#include "ColaReportes.h"
+#include "Bitacora.h"
+
+ColaReportes::ColaReportes()
+  : cantidad(0), siguiente(1) {}
+
+void ColaReportes::begin() {
+  preferences.begin("reportes", true);
+  siguiente = preferences.getUInt("secuencia", 0) + 1;
+  preferences.end();
+  LOG_INFO("Reportes: siguiente secuencia %lu", (unsigned long)siguiente);
+}
+
+Reporte ColaReportes::agregar(double lat, double lon, float velocidad, uint32_t utc, float rumbo) {
+  // El heartbeat puede volver a enviar un fix que ya está en cola: conserva su secuencia
+  if (cantidad > 0) {
+    const Reporte& ultimo = masReciente();
+    if (ultimo.utc == utc && ultimo.lat == lat && ultimo.lon == lon) {
+      return ultimo;
+    }
+  }
+
+  if (cantidad == REPORTES_COLA_CAPACIDAD) {
+    LOG_AVISO("Cola de reportes llena. Se descarta la secuencia %lu", (unsigned long)cola[0].secuencia);
+    quitar(0);
+  }
+
+  Reporte r = { siguiente, lat, lon, velocidad, rumbo, utc, millis() };
+  cola[cantidad++] = r;
+  siguiente++;
+
+  // Una escritura por fix: la NVS reparte el desgaste entre sus páginas
+  preferences.begin("reportes", false);
+  preferences.putUInt("secuencia", r.secuencia);
+  preferences.end();
+
+  return r;
+}
+
+void ColaReportes::confirmarEnvio(int anteriores, uint32_t ack) {
+  if (cantidad == 0) {
+    return;
+  }
+  uint32_t enviado = masReciente().secuencia;
+  uint32_t ultimoDelLote = anteriores > 0 ? cola[anteriores - 1].secuencia : 0;
+
+  int i = 0;
+  while (i < cantidad) {
+    uint32_t s = cola[i].secuencia;
+    if (s == enviado || s <= ultimoDelLote || s <= ack) {
+      quitar(i);
+    } else {
+      i++;
+    }
+  }
+
+  if (cantidad > 0) {
+    LOG_INFO("Reportes pendientes: %d (desde la secuencia %lu)", cantidad, (unsigned long)cola[0].secuencia);
+  }
+}
+
+void ColaReportes::quitar(int indice) {
+  for (int i = indice; i < cantidad - 1; i++) {
+    cola[i] = cola[i + 1];
+  }
+  cantidad--;
+}
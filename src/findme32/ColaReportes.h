@@ -0,0 +1,65 @@
+#ifndef COLAREPORTES_H
+#define COLAREPORTES_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "config.h"
+
+/**
+ * Un fix pendiente de confirmar por el servidor
+ */
+struct Reporte {
+  uint32_t secuencia;  // Monótona por dispositivo, sobrevive a reinicios
+  double lat;
+  double lon;
+  float velocidad;     // km/h, negativa si no se conoce
+  float rumbo;         // Grados desde el norte, negativo si no se envía
+  uint32_t utc;        // Instante GNSS del fix (segundos Unix), 0 si no se conoce
+  unsigned long encolado;  // millis() al entrar en la cola
+};
+
+/**
+ * Cola de reportes salientes con número de secuencia.
+ *
+ * Cada fix nuevo recibe el siguiente número de secuencia, que se guarda en NVS
+ * para no repetirse tras un reinicio. El servidor descarta duplicados por
+ * (token, secuencia) y responde con "ack": la secuencia más alta hasta la que
+ * recibió todo. Así reenviar un reporte que quizá sí llegó es seguro, y solo se
+ * reenvían los huecos.
+ *
+ * La cola vive en RAM ordenada por secuencia: un reinicio pierde los pendientes,
+ * y el parámetro "oldest" de cada reporte le indica al servidor que no esperará
+ * secuencias anteriores.
+ *
+ * Cada petición lleva el fix más nuevo y, como lote, los pendientes más
+ * antiguos que quepan en la URL: una sola sesión TLS para todo el atraso.
+ */
+class ColaReportes {
+public:
+  ColaReportes();
+
+  void begin();
+
+  // Asigna secuencia a un fix nuevo; si es el mismo fix que el último encolado, lo devuelve
+  Reporte agregar(double lat, double lon, float velocidad, uint32_t utc, float rumbo = -1.0f);
+
+  // Tras un envío exitoso: quita el más nuevo, los 'anteriores' más antiguos
+  // que viajaron en el lote y todo lo confirmado por 'ack' (0 = sin ack)
+  void confirmarEnvio(int anteriores, uint32_t ack);
+
+  int pendientes() const { return cantidad; }
+  const Reporte& en(int indice) const { return cola[indice]; }  // 0 = más antiguo
+  const Reporte& masAntiguo() const { return cola[0]; }
+  const Reporte& masReciente() const { return cola[cantidad - 1]; }
+  uint32_t ultimaSecuencia() const { return siguiente - 1; }
+
+private:
+  Preferences preferences;
+  Reporte cola[REPORTES_COLA_CAPACIDAD];
+  int cantidad;
+  uint32_t siguiente;
+
+  void quitar(int indice);
+};
+
+#endif // COLAREPORTES_H
@@ -0,0 +1,339 @@
+#include "ColaSMS.h"
+#include "Bitacora.h"
+
+static_assert(SMS_LONGITUD_MAXIMA + 1 >= SMS_BINARIO_MAX, "El búfer de texto debe admitir un SMS binario");
+
+// PDU del SMS binario en curso, en hexadecimal como lo espera AT+CMGS
+static char pduHex[2 * SMS_PDU_MAX + 1];
+
+ColaSMS::ColaSMS(CanalAT& canalAT)
+  : canal(canalAT), cantidad(0), actual(-1), estado(LIBRE), referenciaConcatenado(0) {
+  memset(registros, 0, sizeof(registros));
+}
+
+uint32_t ColaSMS::hashNumero(const char* numero) {
+  // FNV-1a sobre los dígitos; ignora '+' y espacios para agrupar formatos equivalentes
+  uint32_t h = 2166136261UL;
+  for (const char* p = numero; *p; p++) {
+    if (*p < '0' || *p > '9') continue;
+    h ^= (uint8_t)*p;
+    h *= 16777619UL;
+  }
+  return h ? h : 1;
+}
+
+int ColaSMS::buscarRegistro(uint32_t hash) const {
+  for (int i = 0; i < SMS_COLA_CAPACIDAD; i++) {
+    if (registros[i].hash == hash) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Solo consulta: la cuota se gasta en contarEnvio(), cuando el mensaje ya está en la cola
+bool ColaSMS::permitidoPorNumero(const char* numero, PrioridadSMS prioridad) {
+  int i = buscarRegistro(hashNumero(numero));
+  if (i < 0 || millis() - registros[i].inicioVentana >= SMS_VENTANA_POR_NUMERO_MS) {
+    return true;
+  }
+  int limite = (prioridad == SMS_PRIORIDAD_ALTA) ? SMS_MAX_POR_NUMERO : SMS_MAX_POR_NUMERO_BAJA;
+  return registros[i].enviados < limite;
+}
+
+void ColaSMS::contarEnvio(const char* numero) {
+  uint32_t h = hashNumero(numero);
+  unsigned long ahora = millis();
+  int i = buscarRegistro(h);
+  if (i < 0) {
+    // Reemplaza el registro libre o el de la ventana más antigua
+    i = 0;
+    for (int j = 1; j < SMS_COLA_CAPACIDAD && registros[i].hash != 0; j++) {
+      if (registros[j].hash == 0 || registros[j].inicioVentana < registros[i].inicioVentana) {
+        i = j;
+      }
+    }
+    registros[i].hash = h;
+    registros[i].inicioVentana = ahora;
+    registros[i].enviados = 0;
+  } else if (ahora - registros[i].inicioVentana >= SMS_VENTANA_POR_NUMERO_MS) {
+    registros[i].inicioVentana = ahora;
+    registros[i].enviados = 0;
+  }
+  registros[i].enviados++;
+}
+
+bool ColaSMS::encolar(const String& numero, const String& texto, PrioridadSMS prioridad) {
+  if (prioridad == SMS_PRIORIDAD_BAJA && cantidad >= SMS_UMBRAL_CARGA) {
+    LOG_AVISO("Cola SMS con carga alta. Respuesta de baja prioridad descartada (%s)", numero.c_str());
+    return false;
+  }
+
+  if (!permitidoPorNumero(numero.c_str(), prioridad)) {
+    LOG_AVISO("Límite de respuestas alcanzado para %s. SMS descartado.", numero.c_str());
+    return false;
+  }
+
+  if (cantidad >= SMS_COLA_CAPACIDAD) {
+    // Cola llena: solo un mensaje de alta prioridad puede desplazar a uno de baja
+    int victima = -1;
+    if (prioridad == SMS_PRIORIDAD_ALTA) {
+      for (int i = cantidad - 1; i >= 0; i--) {
+        if (i != actual && cola[i].prioridad == SMS_PRIORIDAD_BAJA) {
+          victima = i;
+          break;
+        }
+      }
+    }
+    if (victima == -1) {
+      LOG_AVISO("Cola SMS llena. SMS a %s descartado.", numero.c_str());
+      return false;
+    }
+    LOG_AVISO("Cola SMS llena. Descartando respuesta de baja prioridad a %s", cola[victima].numero);
+    if (cola[victima].aviso != NULL) {
+      cola[victima].aviso(false, cola[victima].contexto);
+    }
+    quitar(victima);
+  }
+
+  MensajeSaliente& m = cola[cantidad];
+  strncpy(m.numero, numero.c_str(), sizeof(m.numero) - 1);
+  m.numero[sizeof(m.numero) - 1] = '\0';
+  strncpy(m.texto, texto.c_str(), sizeof(m.texto) - 1);
+  m.texto[sizeof(m.texto) - 1] = '\0';
+  m.binario = 0;
+  m.cabecera = false;
+  m.prioridad = prioridad;
+  m.intentos = 0;
+  m.siguienteIntento = millis();
+  m.aviso = NULL;
+  m.contexto = NULL;
+  cantidad++;
+  contarEnvio(numero.c_str());
+
+  LOG_INFO("SMS a %s en cola (%d pendientes)", numero.c_str(), cantidad);
+  return true;
+}
+
+int ColaSMS::partesBinario(size_t n) {
+  if (n <= SMS_BINARIO_MAX) {
+    return 1;
+  }
+  const size_t porParte = SMS_BINARIO_MAX - SMS_UDH_CONCATENADO;
+  return (int)((n + porParte - 1) / porParte);
+}
+
+int ColaSMS::encolarBinario(const char* numero, const uint8_t* datos, size_t n, AvisoEnvioSMS aviso, void* contexto) {
+  int partes = partesBinario(n);
+  // Todas las partes o ninguna, y sin quitarle lugar a las respuestas
+  if (n == 0 || partes > 255 || cantidad + partes > SMS_UMBRAL_CARGA) {
+    LOG_AVISO("Cola SMS sin lugar para %d partes binarias a %s", partes, numero);
+    return 0;
+  }
+  uint8_t prueba[SMS_PDU_MAX];
+  if (strlen(numero) >= sizeof(cola[0].numero) || armarPDUEnvio(numero, datos, 0, false, prueba) == 0) {
+    LOG_ERROR("✗ Número inválido para SMS binario: %s", numero);
+    return 0;
+  }
+
+  referenciaConcatenado++;
+  size_t porParte = partes == 1 ? n : SMS_BINARIO_MAX - SMS_UDH_CONCATENADO;
+  for (int p = 0; p < partes; p++) {
+    MensajeSaliente& m = cola[cantidad++];
+    strcpy(m.numero, numero);
+    uint8_t* ud = (uint8_t*)m.texto;
+    size_t k = 0;
+    if (partes > 1) {
+      // UDH: concatenado con referencia de 8 bits
+      ud[k++] = SMS_UDH_CONCATENADO - 1;
+      ud[k++] = 0x00;
+      ud[k++] = 3;
+      ud[k++] = referenciaConcatenado;
+      ud[k++] = (uint8_t)partes;
+      ud[k++] = (uint8_t)(p + 1);
+    }
+    size_t inicio = p * porParte;
+    size_t largo = n - inicio < porParte ? n - inicio : porParte;
+    memcpy(ud + k, datos + inicio, largo);
+    m.binario = (uint8_t)(k + largo);
+    m.cabecera = partes > 1;
+    m.prioridad = SMS_PRIORIDAD_BAJA;
+    m.intentos = 0;
+    m.siguienteIntento = millis();
+    m.aviso = aviso;
+    m.contexto = contexto;
+  }
+
+  LOG_INFO("SMS binario a %s en cola: %u bytes en %d partes", numero, (unsigned)n, partes);
+  return partes;
+}
+
+void ColaSMS::quitar(int indice) {
+  for (int i = indice; i < cantidad - 1; i++) {
+    cola[i] = cola[i + 1];
+  }
+  cantidad--;
+
+  if (actual == indice) {
+    actual = -1;
+  } else if (actual > indice) {
+    actual--;
+  }
+}
+
+int ColaSMS::seleccionarSiguiente(unsigned long ahora) const {
+  int elegido = -1;
+  for (int i = 0; i < cantidad; i++) {
+    if ((long)(ahora - cola[i].siguienteIntento) < 0) continue;
+    if (elegido == -1 || cola[i].prioridad > cola[elegido].prioridad) {
+      elegido = i;
+    }
+  }
+  return elegido;
+}
+
+void ColaSMS::iniciarEnvio(int indice) {
+  if (cola[indice].binario > 0) {
+    if (!canal.iniciar(AT_CMGF_PDU)) {
+      return;
+    }
+    LOG_INFO("Enviando SMS binario a %s (%d bytes)", cola[indice].numero, (int)cola[indice].binario);
+    actual = indice;
+    estado = CAMBIANDO_A_PDU;
+    return;
+  }
+
+  if (!canal.iniciar(AT_CMGS, cola[indice].numero)) {
+    return;  // Canal ocupado: se intentará en la siguiente llamada
+  }
+
+  LOG_INFO("Enviando SMS a %s", cola[indice].numero);
+
+  actual = indice;
+  estado = ESPERANDO_PROMPT;
+}
+
+// Referencia de +CMGS: <ref> en la respuesta; -1 si no vino
+static inline long referenciaCMGS(const char* respuesta) {
+  const char* cmgs = strstr(respuesta, "+CMGS:");
+  return cmgs != NULL ? strtol(cmgs + 6, NULL, 10) : -1;
+}
+
+// Con el módem ya en modo PDU: AT+CMGS con el largo del PDU sin el octeto del SMSC
+void ColaSMS::prepararPDU() {
+  const MensajeSaliente& m = cola[actual];
+  uint8_t pdu[SMS_PDU_MAX];
+  size_t largo = armarPDUEnvio(m.numero, (const uint8_t*)m.texto, m.binario, m.cabecera, pdu);
+  aHexadecimal(pdu, largo, pduHex);
+  if (canal.iniciar(AT_CMGS_PDU, (int)largo - 1)) {
+    estado = ESPERANDO_PROMPT;
+  } else {
+    finalizarEnvio(false);
+  }
+}
+
+void ColaSMS::finalizarEnvio(bool exito) {
+  MensajeSaliente& m = cola[actual];
+  bool binario = m.binario > 0;
+
+  if (exito) {
+    LOG_INFO("✓ SMS enviado a %s (ref %ld)", m.numero, referenciaCMGS(canal.respuesta().c_str()));
+    if (m.aviso != NULL) {
+      m.aviso(true, m.contexto);
+    }
+    quitar(actual);
+  } else {
+    m.intentos++;
+    if (m.intentos >= SMS_MAX_INTENTOS) {
+      LOG_ERROR("✗ SMS a %s descartado tras %d intentos", m.numero, (int)m.intentos);
+      if (m.aviso != NULL) {
+        m.aviso(false, m.contexto);
+      }
+      quitar(actual);
+    } else {
+      unsigned long espera = SMS_BACKOFF_BASE_MS << (m.intentos - 1);
+      m.siguienteIntento = millis() + espera;
+      LOG_AVISO("Reintentando SMS a %s en %lu s", m.numero, espera / 1000);
+    }
+  }
+
+  canal.finalizar();
+  actual = -1;
+  estado = binario ? VOLVER_A_TEXTO : LIBRE;
+}
+
+void ColaSMS::procesar() {
+  unsigned long ahora = millis();
+
+  switch (estado) {
+    case LIBRE: {
+      int siguiente = seleccionarSiguiente(ahora);
+      if (siguiente != -1 && canal.libre()) {
+        iniciarEnvio(siguiente);
+      }
+      break;
+    }
+
+    case CAMBIANDO_A_PDU: {
+      ResultadoAT r = canal.sondear();
+      if (r == AT_OK) {
+        canal.finalizar();
+        prepararPDU();
+      } else if (r == AT_ERROR || r == AT_TIMEOUT) {
+        LOG_AVISO("✗ El módem no pasó a modo PDU");
+        finalizarEnvio(false);
+      }
+      break;
+    }
+
+    case ESPERANDO_PROMPT: {
+      ResultadoAT r = canal.sondear();
+      if (r == AT_PROMPT) {
+        const char* datos = cola[actual].binario > 0 ? pduHex : cola[actual].texto;
+        canal.enviarDatos(datos, 26, SMS_TIMEOUT_CMGS_MS);  // Ctrl+Z
+        estado = ESPERANDO_RESULTADO;
+      } else if (r == AT_ERROR) {
+        LOG_AVISO("✗ AT+CMGS rechazado: %s", canal.respuesta().c_str());
+        finalizarEnvio(false);
+      } else if (r == AT_TIMEOUT) {
+        LOG_AVISO("✗ Timeout esperando '>' del módem");
+        canal.getSerial().write(27);  // ESC cancela la captura del texto
+        finalizarEnvio(false);
+      }
+      break;
+    }
+
+    case ESPERANDO_RESULTADO: {
+      ResultadoAT r = canal.sondear();
+      if (r == AT_OK) {
+        finalizarEnvio(true);
+      } else if (r == AT_ERROR) {
+        LOG_AVISO("✗ Error de envío SMS: %s", canal.respuesta().c_str());
+        finalizarEnvio(false);
+      } else if (r == AT_TIMEOUT) {
+        LOG_AVISO("✗ Timeout esperando +CMGS");
+        finalizarEnvio(false);
+      }
+      break;
+    }
+
+    case VOLVER_A_TEXTO:
+      if (canal.iniciar(AT_CMGF)) {
+        estado = VOLVIENDO_A_TEXTO;
+      }
+      break;
+
+    case VOLVIENDO_A_TEXTO: {
+      ResultadoAT r = canal.sondear();
+      if (r == AT_OK) {
+        canal.finalizar();
+        estado = LIBRE;
+      } else if (r == AT_ERROR || r == AT_TIMEOUT) {
+        LOG_AVISO("✗ El módem no volvió a modo texto. Reintentando...");
+        canal.finalizar();
+        estado = VOLVER_A_TEXTO;
+      }
+      break;
+    }
+  }
+}
@@ -0,0 +1,97 @@
+#ifndef COLASMS_H
+#define COLASMS_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "CanalAT.h"
+#include "FormatoSMS.h"
+
+/**
+ * Prioridad de un SMS saliente
+ */
+enum PrioridadSMS {
+  SMS_PRIORIDAD_BAJA = 0,  // Respuestas a remitentes no autorizados
+  SMS_PRIORIDAD_ALTA = 1   // Respuestas a comandos autorizados
+};
+
+// Resultado de una parte de un SMS binario: enviada o descartada
+typedef void (*AvisoEnvioSMS)(bool enviado, void* contexto);
+
+/**
+ * Cola de SMS salientes no bloqueante.
+ *
+ * Cada envío avanza como máquina de estados en procesar(): AT+CMGS, espera
+ * del prompt '>', texto + Ctrl+Z y espera de +CMGS/+CMS ERROR. Los fallos se
+ * reintentan con backoff exponencial. Mientras ocupada() sea true la cola
+ * tiene una transacción abierta en el CanalAT.
+ *
+ * Los SMS binarios viajan en modo PDU con datos de 8 bits y, si no caben en
+ * uno, en partes concatenadas (UDH). El módem pasa a AT+CMGF=0 solo durante
+ * cada envío y vuelve a modo texto al terminar; entre tanto ocupada() sigue
+ * siendo true para que nadie lea la bandeja en modo PDU.
+ */
+class ColaSMS {
+public:
+  ColaSMS(CanalAT& canal);
+
+  bool encolar(const String& numero, const String& texto, PrioridadSMS prioridad = SMS_PRIORIDAD_ALTA);
+  // Baja prioridad y sin límite por número: quien los encola limita su ritmo.
+  // 'aviso' se llama una vez por parte. Devuelve las partes encoladas (0 = sin lugar).
+  int encolarBinario(const char* numero, const uint8_t* datos, size_t n, AvisoEnvioSMS aviso, void* contexto);
+  void procesar();
+
+  static int partesBinario(size_t n);
+
+  bool ocupada() const { return estado != LIBRE; }
+  int pendientes() const { return cantidad; }
+
+private:
+  enum Estado {
+    LIBRE,
+    CAMBIANDO_A_PDU,
+    ESPERANDO_PROMPT,
+    ESPERANDO_RESULTADO,
+    VOLVER_A_TEXTO,     // Falta AT+CMGF=1 (canal ocupado o falló el anterior)
+    VOLVIENDO_A_TEXTO
+  };
+
+  struct MensajeSaliente {
+    char numero[20];
+    char texto[SMS_LONGITUD_MAXIMA + 1];  // O los datos de usuario de un SMS binario
+    uint8_t binario;                      // Octetos en 'texto' de un SMS binario; 0 = texto
+    bool cabecera;                        // Los datos empiezan con una UDH
+    uint8_t prioridad;
+    uint8_t intentos;
+    unsigned long siguienteIntento;
+    AvisoEnvioSMS aviso;
+    void* contexto;
+  };
+
+  struct RegistroNumero {
+    uint32_t hash;
+    uint8_t enviados;
+    unsigned long inicioVentana;
+  };
+
+  CanalAT& canal;
+  MensajeSaliente cola[SMS_COLA_CAPACIDAD];
+  int cantidad;
+  int actual;  // Índice del mensaje en curso, -1 si no hay
+
+  RegistroNumero registros[SMS_COLA_CAPACIDAD];
+
+  Estado estado;
+  uint8_t referenciaConcatenado;
+
+  int seleccionarSiguiente(unsigned long ahora) const;
+  void iniciarEnvio(int indice);
+  void prepararPDU();
+  void finalizarEnvio(bool exito);
+  void quitar(int indice);
+  int buscarRegistro(uint32_t hash) const;
+  bool permitidoPorNumero(const char* numero, PrioridadSMS prioridad);
+  void contarEnvio(const char* numero);
+  static uint32_t hashNumero(const char* numero);
+};
+
+#endif // COLASMS_H
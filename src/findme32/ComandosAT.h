@@ -0,0 +1,213 @@
+#ifndef COMANDOSAT_H
+#define COMANDOSAT_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Búfer donde CanalAT formatea cada comando (el más largo es AT+HTTPPARA="URL" con un lote)
+#define AT_LONGITUD_COMANDO 512
+// Ningún comando de la tabla puede bloquear el canal más que esto
+#define AT_TIMEOUT_MAXIMO 30000UL
+
+/**
+ * Identificador de cada comando AT que usa el firmware.
+ * El orden debe coincidir con COMANDOS_AT (se verifica al compilar).
+ */
+enum IdComandoAT {
+  // Módem y red
+  AT_PRUEBA,
+  AT_CREG,
+  AT_CSQ,
+  AT_CPSI,
+  AT_CIMI,
+  AT_COPS_NUMERICO,
+  AT_COPS_CONSULTA,
+  AT_CCLK,
+  AT_CCLK_FIJAR,
+  AT_CTZU,
+  AT_CLTS,
+  AT_GUARDAR_PERFIL,
+  AT_CFUN_REINICIO,
+  AT_CFUN_MINIMA,
+  AT_CFUN_COMPLETA,
+  AT_CGACT_CONSULTA,
+  AT_CGDCONT_CONSULTA,
+  AT_CGDCONT,
+  AT_CGACT_ACTIVAR,
+  AT_CGACT_DESACTIVAR,
+  AT_CGPADDR,
+  AT_CDNSGIP,
+  // HTTP(S)
+  AT_HTTPTERM,
+  AT_HTTPINIT,
+  AT_HTTPPARA_CID,
+  AT_HTTPPARA_URL,
+  AT_HTTPPARA_HOST,
+  AT_HTTPSSL,
+  AT_CSSL_VERSION,
+  AT_CSSL_AUTENTICACION,
+  AT_CSSL_CA,
+  AT_CSSL_HORA,
+  AT_CSSL_SNI,
+  AT_CCERTLIST,
+  AT_CCERTDOWN,
+  AT_HTTPACTION_GET,
+  AT_HTTPPARA_CONTENT,
+  AT_HTTPDATA,
+  AT_HTTPACTION_POST,
+  AT_HTTPREAD,
+  AT_HTTPPARA_RANGO,
+  AT_HTTPREAD_DESDE,
+  // GNSS
+  AT_GNSS_ENCENDER,
+  AT_GNSS_APAGAR,
+  AT_CGNSSINFO,
+  AT_CGNSSINFO_AUTO,
+  AT_CAGPS,
+  AT_GNSS_CALIENTE,
+  AT_GNSS_TIBIO,
+  AT_GNSS_FRIO,
+  // SMS
+  AT_CMGF,
+  AT_CNMI,
+  AT_CMGL_NO_LEIDOS,
+  AT_CMGD,
+  AT_CMGS,
+  AT_CMGF_PDU,
+  AT_CMGS_PDU,
+  TOTAL_COMANDOS_AT
+};
+
+/**
+ * Cómo termina la respuesta de un comando
+ */
+enum FinalAT {
+  FINAL_OK,      // OK / ERROR / +CME ERROR
+  FINAL_LINEA,   // Una línea propia ('fin'), p.ej. el "+HTTPREAD: 0" tras el cuerpo
+  FINAL_PROMPT   // El módem pide datos con '>' (AT+CMGS, AT+CCERTDOWN)
+};
+
+/**
+ * Descriptor de un comando AT.
+ *
+ * 'texto' es el comando literal o una plantilla printf; CanalAT lo formatea
+ * en su búfer estático sin usar el heap. 'reintentable' indica que repetirlo
+ * tras un timeout no tiene efectos secundarios (consultas y configuración).
+ * Los comandos cuyo resultado real llega después como URC lo declaran en
+ * 'urc', con su propio timeout.
+ */
+struct ComandoAT {
+  IdComandoAT id;
+  const char* texto;
+  FinalAT final;
+  const char* fin;
+  unsigned long timeoutMs;
+  bool reintentable;
+  const char* urc;
+  unsigned long timeoutUrcMs;
+};
+
+// Timeouts: tiempo máximo de respuesta del manual AT de la serie A76XX,
+// acotado a AT_TIMEOUT_MAXIMO cuando el firmware ya reintenta por su cuenta
+// (AT+CGACT). Los comandos locales responden en milisegundos.
+constexpr ComandoAT COMANDOS_AT[] = {
+  { AT_PRUEBA,             "AT",                               FINAL_OK,     NULL,           1000,  true,  NULL,           0 },
+  { AT_CREG,               "AT+CREG?",                         FINAL_OK,     NULL,           1000,  true,  NULL,           0 },
+  { AT_CSQ,                "AT+CSQ",                           FINAL_OK,     NULL,           1000,  true,  NULL,           0 },
+  { AT_CPSI,               "AT+CPSI?",                         FINAL_OK,     NULL,           1000,  true,  NULL,           0 },  // Celda servidora
+  { AT_CIMI,               "AT+CIMI",                          FINAL_OK,     NULL,           1000,  true,  NULL,           0 },  // IMSI de la SIM
+  { AT_COPS_NUMERICO,      "AT+COPS=3,2",                      FINAL_OK,     NULL,           1000,  true,  NULL,           0 },  // Operador como MCC+MNC
+  { AT_COPS_CONSULTA,      "AT+COPS?",                         FINAL_OK,     NULL,           3000,  true,  NULL,           0 },
+  { AT_CCLK,               "AT+CCLK?",                         FINAL_OK,     NULL,           1000,  true,  NULL,           0 },
+  { AT_CCLK_FIJAR,         "AT+CCLK=\"%s\"",                   FINAL_OK,     NULL,           1000,  true,  NULL,           0 },  // "aa/MM/dd,hh:mm:ss+zz"
+  { AT_CTZU,               "AT+CTZU=1",                        FINAL_OK,     NULL,           1000,  true,  NULL,           0 },
+  { AT_CLTS,               "AT+CLTS=1",                        FINAL_OK,     NULL,           1000,  true,  NULL,           0 },
+  { AT_GUARDAR_PERFIL,     "AT&W",                             FINAL_OK,     NULL,           1000,  true,  NULL,           0 },
+  { AT_CFUN_REINICIO,      "AT+CFUN=1,1",                      FINAL_OK,     NULL,           9000,  false, NULL,           0 },
+  { AT_CFUN_MINIMA,        "AT+CFUN=0",                        FINAL_OK,     NULL,           9000,  true,  NULL,           0 },  // Radio apagado
+  { AT_CFUN_COMPLETA,      "AT+CFUN=1",                        FINAL_OK,     NULL,           9000,  true,  NULL,           0 },
+  { AT_CGACT_CONSULTA,     "AT+CGACT?",                        FINAL_OK,     NULL,           2000,  true,  NULL,           0 },
+  { AT_CGDCONT_CONSULTA,   "AT+CGDCONT?",                      FINAL_OK,     NULL,           1000,  true,  NULL,           0 },
+  { AT_CGDCONT,            "AT+CGDCONT=1,\"IP\",\"%s\"",       FINAL_OK,     NULL,           1000,  true,  NULL,           0 },
+  { AT_CGACT_ACTIVAR,      "AT+CGACT=1,1",                     FINAL_OK,     NULL,           15000, false, NULL,           0 },
+  { AT_CGACT_DESACTIVAR,   "AT+CGACT=0,1",                     FINAL_OK,     NULL,           15000, true,  NULL,           0 },
+  { AT_CGPADDR,            "AT+CGPADDR=1",                     FINAL_OK,     NULL,           1000,  true,  NULL,           0 },
+  { AT_CDNSGIP,            "AT+CDNSGIP=\"%s\"",                FINAL_OK,     NULL,           20000, true,  NULL,           0 },  // Resolver un nombre
+
+  { AT_HTTPTERM,           "AT+HTTPTERM",                      FINAL_OK,     NULL,           1000,  true,  NULL,           0 },
+  { AT_HTTPINIT,           "AT+HTTPINIT",                      FINAL_OK,     NULL,           2000,  false, NULL,           0 },
+  { AT_HTTPPARA_CID,       "AT+HTTPPARA=\"CID\",1",            FINAL_OK,     NULL,           1000,  true,  NULL,           0 },
+  { AT_HTTPPARA_URL,       "AT+HTTPPARA=\"URL\",\"%s\"",       FINAL_OK,     NULL,           1000,  true,  NULL,           0 },
+  { AT_HTTPPARA_HOST,      "AT+HTTPPARA=\"USERDATA\",\"Host: %s\"", FINAL_OK,  NULL,           1000,  true,  NULL,           0 },  // URL por IP
+  { AT_HTTPSSL,            "AT+HTTPSSL=1",                     FINAL_OK,     NULL,           1000,  true,  NULL,           0 },
+  { AT_CSSL_VERSION,       "AT+CSSLCFG=\"sslversion\",0,3",    FINAL_OK,     NULL,           1000,  true,  NULL,           0 },  // TLS 1.2
+  { AT_CSSL_AUTENTICACION, "AT+CSSLCFG=\"authmode\",0,%d",     FINAL_OK,     NULL,           1000,  true,  NULL,           0 },  // 0 = sin verificar, 1 = servidor
+  { AT_CSSL_CA,            "AT+CSSLCFG=\"cacert\",0,\"%s\"",   FINAL_OK,     NULL,           1000,  true,  NULL,           0 },
+  { AT_CSSL_HORA,          "AT+CSSLCFG=\"ignorelocaltime\",0,%d", FINAL_OK,   NULL,           1000,  true,  NULL,           0 },
+  { AT_CSSL_SNI,           "AT+CSSLCFG=\"enableSNI\",0,1",     FINAL_OK,     NULL,           1000,  true,  NULL,           0 },
+  { AT_CCERTLIST,          "AT+CCERTLIST",                     FINAL_OK,     NULL,           1000,  true,  NULL,           0 },  // Certificados en el módem
+  { AT_CCERTDOWN,          "AT+CCERTDOWN=\"%s\",%d",           FINAL_PROMPT, NULL,           5000,  false, NULL,           0 },  // Nombre, bytes del PEM
+  { AT_HTTPACTION_GET,     "AT+HTTPACTION=0",                  FINAL_OK,     NULL,           1000,  false, "+HTTPACTION:", HTTP_TIMEOUT },
+  { AT_HTTPPARA_CONTENT,   "AT+HTTPPARA=\"CONTENT\",\"application/octet-stream\"", FINAL_OK, NULL, 1000, true, NULL, 0 },
+  { AT_HTTPDATA,           "AT+HTTPDATA=%d,%d",                FINAL_LINEA,  "DOWNLOAD",     5000,  false, NULL,           0 },  // Luego el cuerpo en binario
+  { AT_HTTPACTION_POST,    "AT+HTTPACTION=1",                  FINAL_OK,     NULL,           1000,  false, "+HTTPACTION:", HTTP_TIMEOUT },
+  { AT_HTTPREAD,           "AT+HTTPREAD=0,%d",                 FINAL_LINEA,  "+HTTPREAD: 0", 5000,  true,  NULL,           0 },
+  { AT_HTTPPARA_RANGO,     "AT+HTTPPARA=\"USERDATA\",\"Range: bytes=%lu-%lu\"", FINAL_OK, NULL, 1000, true, NULL, 0 },
+  { AT_HTTPREAD_DESDE,     "AT+HTTPREAD=%lu,%d",               FINAL_LINEA,  "+HTTPREAD: 0", 5000,  true,  NULL,           0 },  // Cuerpo binario
+
+  { AT_GNSS_ENCENDER,      "AT+CGNSSPWR=1",                    FINAL_OK,     NULL,           3000,  true,  NULL,           0 },
+  { AT_GNSS_APAGAR,        "AT+CGNSSPWR=0",                    FINAL_OK,     NULL,           3000,  true,  NULL,           0 },
+  { AT_CGNSSINFO,          "AT+CGNSSINFO",                     FINAL_OK,     NULL,           1000,  true,  NULL,           0 },
+  { AT_CGNSSINFO_AUTO,     "AT+CGNSSINFO=%d",                  FINAL_OK,     NULL,           1000,  true,  NULL,           0 },  // URC cada N s (0 = no)
+  { AT_CAGPS,              "AT+CAGPS",                         FINAL_OK,     NULL,           3000,  false, "+AGPS:",       AGPS_TIMEOUT_MS },
+  { AT_GNSS_CALIENTE,      "AT+CGPSHOT",                       FINAL_OK,     NULL,           1000,  false, NULL,           0 },
+  { AT_GNSS_TIBIO,         "AT+CGPSWARM",                      FINAL_OK,     NULL,           1000,  false, NULL,           0 },
+  { AT_GNSS_FRIO,          "AT+CGPSCOLD",                      FINAL_OK,     NULL,           1000,  false, NULL,           0 },
+
+  { AT_CMGF,               "AT+CMGF=1",                        FINAL_OK,     NULL,           1000,  true,  NULL,           0 },
+  { AT_CNMI,               "AT+CNMI=2,1,0,0,0",                FINAL_OK,     NULL,           1000,  true,  NULL,           0 },  // Avisar con +CMTI
+  { AT_CMGL_NO_LEIDOS,     "AT+CMGL=\"REC UNREAD\"",           FINAL_OK,     NULL,           5000,  false, NULL,           0 },  // Los marca como leídos
+  { AT_CMGD,               "AT+CMGD=%d",                       FINAL_OK,     NULL,           5000,  true,  NULL,           0 },
+  { AT_CMGS,               "AT+CMGS=\"%s\"",                   FINAL_PROMPT, NULL,           SMS_TIMEOUT_PROMPT_MS, false, NULL, 0 },
+  { AT_CMGF_PDU,           "AT+CMGF=0",                        FINAL_OK,     NULL,           1000,  true,  NULL,           0 },  // Solo durante un SMS binario
+  { AT_CMGS_PDU,           "AT+CMGS=%d",                       FINAL_PROMPT, NULL,           SMS_TIMEOUT_PROMPT_MS, false, NULL, 0 },  // Octetos del PDU sin el SMSC
+};
+
+// ============================
+// VERIFICACIÓN EN COMPILACIÓN
+// ============================
+namespace verificacionAT {
+
+constexpr size_t longitud(const char* s) {
+  return *s == '\0' ? 0 : 1 + longitud(s + 1);
+}
+
+constexpr bool empiezaCon(const char* s, const char* prefijo) {
+  return *prefijo == '\0' || (*s == *prefijo && empiezaCon(s + 1, prefijo + 1));
+}
+
+constexpr bool descriptorValido(const ComandoAT& c, int indice) {
+  return c.id == indice &&
+         empiezaCon(c.texto, "AT") &&
+         longitud(c.texto) < AT_LONGITUD_COMANDO &&
+         c.timeoutMs > 0 && c.timeoutMs <= AT_TIMEOUT_MAXIMO &&
+         (c.final == FINAL_LINEA) == (c.fin != NULL) &&
+         (c.urc == NULL) == (c.timeoutUrcMs == 0) &&
+         (c.urc == NULL || c.urc[0] == '+') &&
+         // Repetir un comando con efecto posterior (URC, prompt) duplicaría la operación
+         !(c.reintentable && (c.urc != NULL || c.final == FINAL_PROMPT));
+}
+
+constexpr bool tablaValida(int indice) {
+  return indice == TOTAL_COMANDOS_AT ||
+         (descriptorValido(COMANDOS_AT[indice], indice) && tablaValida(indice + 1));
+}
+
+}  // namespace verificacionAT
+
+static_assert(sizeof(COMANDOS_AT) / sizeof(COMANDOS_AT[0]) == TOTAL_COMANDOS_AT,
+              "COMANDOS_AT debe tener un descriptor por cada IdComandoAT");
+static_assert(verificacionAT::tablaValida(0),
+              "Descriptor AT inválido: orden, texto, timeout, fin o URC incoherentes");
+
+#endif // COMANDOSAT_H
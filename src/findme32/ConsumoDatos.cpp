@@ -0,0 +1,165 @@
+#include "ConsumoDatos.h"
+#include "Bitacora.h"
+#include "Calendario.h"
+
+ConsumoDatos::ConsumoDatos(RelojGNSS& relojGNSS)
+  : sinGuardar(0), reloj(relojGNSS), presionInformada(PRESION_NORMAL) {
+  memset(&periodo, 0, sizeof(periodo));
+}
+
+const char* ConsumoDatos::nombrePresion(PresionDatos p) {
+  switch (p) {
+    case PRESION_NORMAL:   return "normal";
+    case PRESION_MODERADA: return "moderada";
+    case PRESION_ALTA:     return "alta";
+    case PRESION_AGOTADA:  return "presupuesto agotado";
+    default:               return "?";
+  }
+}
+
+uint32_t ConsumoDatos::inicioPeriodo(uint32_t utc) {
+  int anio, mes, dia;
+  fechaDesdeDias(utc / 86400UL, anio, mes, dia);
+  if (dia < DATOS_DIA_CORTE) {
+    // Todavía en el periodo que empezó el mes anterior
+    if (--mes == 0) {
+      mes = 12;
+      anio--;
+    }
+  }
+  return (uint32_t)diasDesdeEpoca(anio, mes, DATOS_DIA_CORTE) * 86400UL;
+}
+
+uint32_t ConsumoDatos::finPeriodo(uint32_t inicio) {
+  int anio, mes, dia;
+  fechaDesdeDias(inicio / 86400UL, anio, mes, dia);
+  if (++mes == 13) {
+    mes = 1;
+    anio++;
+  }
+  return (uint32_t)diasDesdeEpoca(anio, mes, DATOS_DIA_CORTE) * 86400UL;
+}
+
+void ConsumoDatos::begin() {
+  preferences.begin("datos", true);
+  size_t leidos = preferences.getBytes("periodo", &periodo, sizeof(periodo));
+  preferences.end();
+  if (leidos != sizeof(periodo)) {
+    memset(&periodo, 0, sizeof(periodo));  // Primer arranque o formato anterior
+  }
+  imprimirResumen();
+  presionInformada = presion();
+}
+
+void ConsumoDatos::guardar() {
+  preferences.begin("datos", false);
+  preferences.putBytes("periodo", &periodo, sizeof(periodo));
+  preferences.end();
+  sinGuardar = 0;
+}
+
+void ConsumoDatos::actualizarHora() {
+  uint32_t utc = reloj.ahoraUTC();
+  if (utc == 0) {
+    return;
+  }
+
+  uint32_t inicio = inicioPeriodo(utc);
+  if (periodo.inicio == 0) {
+    // Lo contado sin fecha pertenece al periodo actual
+    periodo.inicio = inicio;
+    guardar();
+  } else if (inicio > periodo.inicio) {
+    LOG_INFO("Datos: nuevo periodo de facturación");
+    imprimirResumen();
+    uint32_t anterior = totalBytes();
+    memset(&periodo, 0, sizeof(periodo));
+    periodo.inicio = inicio;
+    periodo.totalAnterior = anterior;
+    guardar();
+  }
+  informarPresion();
+}
+
+void ConsumoDatos::registrar(OperacionDatos operacion, const ConsumoSesion& consumo) {
+  if (consumo.subida == 0 && consumo.bajada == 0) {
+    return;  // La operación no llegó a la red
+  }
+  periodo.subida[operacion] += consumo.subida;
+  periodo.bajada[operacion] += consumo.bajada;
+  periodo.sesiones++;
+
+  sinGuardar += consumo.subida + consumo.bajada;
+  if (sinGuardar >= DATOS_GUARDAR_CADA_BYTES) {
+    guardar();
+  }
+  informarPresion();
+}
+
+unsigned long ConsumoDatos::kilobytes(OperacionDatos operacion) const {
+  return (unsigned long)((periodo.subida[operacion] + periodo.bajada[operacion]) / 1024);
+}
+
+uint32_t ConsumoDatos::totalBytes() const {
+  uint32_t total = 0;
+  for (int i = 0; i < TOTAL_OPERACIONES_DATOS; i++) {
+    total += periodo.subida[i] + periodo.bajada[i];
+  }
+  return total;
+}
+
+PresionDatos ConsumoDatos::presion() const {
+  if (DATOS_PRESUPUESTO_MENSUAL_KB == 0) {
+    return PRESION_NORMAL;
+  }
+
+  double presupuesto = DATOS_PRESUPUESTO_MENSUAL_KB * 1024.0;
+  double usado = totalBytes();
+  if (usado >= presupuesto) {
+    return PRESION_AGOTADA;
+  }
+
+  // Fracción transcurrida del periodo; sin fecha, solo el presupuesto completo
+  double fraccion = 1.0;
+  uint32_t ahora = reloj.ahoraUTC();
+  if (ahora != 0 && periodo.inicio != 0 && ahora >= periodo.inicio) {
+    uint32_t fin = finPeriodo(periodo.inicio);
+    fraccion = (double)(ahora - periodo.inicio) / (fin - periodo.inicio) + DATOS_HOLGURA_PCT / 100.0;
+    if (fraccion > 1.0) fraccion = 1.0;
+  }
+
+  double permitido = presupuesto * fraccion;
+  if (usado >= permitido) {
+    return PRESION_ALTA;
+  }
+  if (usado >= permitido * DATOS_MODERADO_PCT / 100.0) {
+    return PRESION_MODERADA;
+  }
+  return PRESION_NORMAL;
+}
+
+int ConsumoDatos::factorIntervalo() const {
+  switch (presion()) {
+    case PRESION_MODERADA: return 2;
+    case PRESION_ALTA:     return 4;
+    case PRESION_AGOTADA:  return 12;  // Heartbeat cada hora
+    default:               return 1;
+  }
+}
+
+void ConsumoDatos::informarPresion() {
+  PresionDatos p = presion();
+  if (p == presionInformada) {
+    return;
+  }
+  presionInformada = p;
+  LOG_AVISO("Datos: presión %s (%lu de %lu KB). Intervalos x%d", nombrePresion(p), (unsigned long)(totalBytes() / 1024),
+            (unsigned long)DATOS_PRESUPUESTO_MENSUAL_KB, factorIntervalo());
+  guardar();
+}
+
+void ConsumoDatos::imprimirResumen() const {
+  LOG_INFO("Datos del periodo: %lu KB en %lu sesiones (reportes %lu KB, AGPS %lu KB, capturas %lu KB, OTA %lu KB)",
+           (unsigned long)(totalBytes() / 1024), (unsigned long)periodo.sesiones, kilobytes(DATOS_REPORTE),
+           kilobytes(DATOS_AGPS), kilobytes(DATOS_CAPTURA), kilobytes(DATOS_OTA));
+}
@@ -0,0 +1,101 @@
+#ifndef CONSUMODATOS_H
+#define CONSUMODATOS_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "config.h"
+#include "RelojGNSS.h"
+
+static_assert(DATOS_DIA_CORTE >= 1 && DATOS_DIA_CORTE <= 28, "DATOS_DIA_CORTE debe existir en todos los meses");
+
+/**
+ * Operaciones que consumen datos celulares
+ */
+enum OperacionDatos {
+  DATOS_REPORTE,  // Sesión HTTPS al servidor
+  DATOS_AGPS,     // Descarga de asistencia AT+CAGPS
+  DATOS_CAPTURA,  // Subida de una captura de alta frecuencia o de la bitácora
+  DATOS_OTA,      // Descarga de un delta de firmware
+  TOTAL_OPERACIONES_DATOS
+};
+
+/**
+ * Presión sobre el presupuesto mensual, de menor a mayor
+ */
+enum PresionDatos {
+  PRESION_NORMAL,
+  PRESION_MODERADA,  // Cerca del consumo prorrateado: se agrupan reportes
+  PRESION_ALTA,      // Por encima del prorrateo: intervalos más largos, sin AGPS
+  PRESION_AGOTADA    // Presupuesto del periodo consumido
+};
+
+/**
+ * Bytes estimados de una operación
+ */
+struct ConsumoSesion {
+  uint32_t subida;
+  uint32_t bajada;
+};
+
+/**
+ * Contadores del periodo de facturación, persistidos en NVS ("datos")
+ */
+struct PeriodoDatos {
+  uint32_t inicio;                              // Segundos Unix; 0 mientras no se conozca la fecha
+  uint32_t subida[TOTAL_OPERACIONES_DATOS];
+  uint32_t bajada[TOTAL_OPERACIONES_DATOS];
+  uint32_t sesiones;
+  uint32_t totalAnterior;                       // Bytes del periodo anterior
+};
+
+/**
+ * Contabilidad del consumo de datos celulares.
+ *
+ * Cada operación registra sus bytes estimados (el A7670 no expone un contador
+ * por sesión). Los contadores del periodo se guardan en NVS cada
+ * DATOS_GUARDAR_CADA_BYTES y al cambiar de periodo, que se detecta con la
+ * fecha del GNSS.
+ *
+ * La presión compara lo consumido con el presupuesto prorrateado al momento
+ * del periodo (más DATOS_HOLGURA_PCT). Sin fecha conocida solo cuenta el
+ * presupuesto completo. El ciclo principal usa la presión para alargar los
+ * intervalos de reporte y agrupar fixes en lotes.
+ */
+class ConsumoDatos {
+public:
+  ConsumoDatos(RelojGNSS& reloj);
+
+  void begin();
+  void registrar(OperacionDatos operacion, const ConsumoSesion& consumo);
+  // Tras sincronizar el reloj: detecta el cambio de periodo
+  void actualizarHora();
+
+  PresionDatos presion() const;
+  // Multiplicador de los intervalos de reporte y del umbral de movimiento
+  int factorIntervalo() const;
+  bool agruparReportes() const { return presion() >= PRESION_MODERADA; }
+  bool permiteAsistencia() const { return presion() < PRESION_ALTA; }
+  bool permiteActualizacion() const { return presion() < PRESION_ALTA; }
+
+  uint32_t totalBytes() const;
+  const PeriodoDatos& getPeriodo() const { return periodo; }
+
+  static const char* nombrePresion(PresionDatos p);
+  // Inicio del periodo de facturación que contiene 'utc', y del siguiente
+  static uint32_t inicioPeriodo(uint32_t utc);
+  static uint32_t finPeriodo(uint32_t inicio);
+
+private:
+  Preferences preferences;
+  PeriodoDatos periodo;
+  uint32_t sinGuardar;
+  RelojGNSS& reloj;
+  PresionDatos presionInformada;
+
+  void guardar();
+  void informarPresion();
+  void imprimirResumen() const;
+  unsigned long kilobytes(OperacionDatos operacion) const;
+};
+
+#endif // CONSUMODATOS_H
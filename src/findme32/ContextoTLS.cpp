@@ -0,0 +1,143 @@
+#include "ContextoTLS.h"
+#include "Bitacora.h"
+#include <mbedtls/sha256.h>
+
+static_assert(sizeof(TLS_CA_PEM) > 1 || TLS_SIN_VERIFICAR,
+              "Configurar TLS_CA_PEM, o TLS_SIN_VERIFICAR 1 para aceptar cualquier certificado");
+
+ContextoTLS::ContextoTLS(CanalAT& canalAT, const char* certificado, const char* nombre)
+  : canal(canalAT), pem(certificado), archivo(nombre), configurado(false), relojConFecha(false),
+    certificadoListo(false), vecesConfigurado(0), sesiones(0), msTotal(0), bytesTotal(0) {}
+
+void ContextoTLS::invalidar() {
+  configurado = false;
+  relojConFecha = false;  // Sin batería de respaldo el módem vuelve a 1980
+}
+
+void ContextoTLS::setRelojValido(bool valido) {
+  bool antes = ignoraHora();
+  relojConFecha = valido;
+  if (verificaServidor() && ignoraHora() != antes) {
+    configurado = false;  // Cambia "ignorelocaltime": se reconfigura en la próxima sesión
+    LOG_INFO("TLS: vigencia del certificado %s", ignoraHora() ? "sin validar (reloj sin fecha)" : "validada");
+  }
+}
+
+bool ContextoTLS::certificadoListado(const char* respuesta, const char* nombre) {
+  // +CCERTLIST: "<archivo>", una línea por certificado
+  size_t largo = strlen(nombre);
+  const char* p = respuesta;
+  while ((p = strstr(p, "+CCERTLIST:")) != NULL) {
+    p += 11;
+    while (*p == ' ') p++;
+    if (*p == '"' && strncmp(p + 1, nombre, largo) == 0 && p[1 + largo] == '"') {
+      return true;
+    }
+  }
+  return false;
+}
+
+static ResultadoAT esperarFinal(CanalAT& canal) {
+  ResultadoAT r = canal.sondear();
+  while (r == AT_EN_CURSO) {
+    delay(5);
+    r = canal.sondear();
+  }
+  return r;
+}
+
+bool ContextoTLS::subirCertificado() {
+  int largo = (int)strlen(pem);
+  bool subido = false;
+  if (canal.iniciar(AT_CCERTDOWN, archivo, largo)) {
+    if (esperarFinal(canal) == AT_PROMPT) {
+      canal.enviarDatos(pem, 0, TLS_TIEMPO_CARGA_MS);
+      subido = esperarFinal(canal) == AT_OK;
+    }
+    canal.finalizar();
+  }
+  return subido;
+}
+
+bool ContextoTLS::asegurarCertificado() {
+  if (certificadoListo) {
+    return true;
+  }
+
+  uint8_t resumen[TLS_RESUMEN_BYTES];
+  mbedtls_sha256_context ctx;
+  mbedtls_sha256_init(&ctx);
+  mbedtls_sha256_starts(&ctx, 0);
+  mbedtls_sha256_update(&ctx, (const uint8_t*)pem, strlen(pem));
+  mbedtls_sha256_finish(&ctx, resumen);
+  mbedtls_sha256_free(&ctx);
+
+  uint8_t guardado[TLS_RESUMEN_BYTES];
+  preferences.begin("tls", true);
+  bool coincide = preferences.getBytes("ca", guardado, sizeof(guardado)) == sizeof(guardado) &&
+                  memcmp(guardado, resumen, sizeof(resumen)) == 0;
+  preferences.end();
+
+  // El mismo PEM ya se subió: solo confirmar que el módem lo conserva (pudo cambiarse el módulo)
+  if (coincide && canal.ejecutar(AT_CCERTLIST) == AT_OK &&
+      certificadoListado(canal.respuesta().c_str(), archivo)) {
+    certificadoListo = true;
+    return true;
+  }
+
+  LOG_INFO("Subiendo el certificado del servidor al módem (%s, %lu bytes)...", archivo,
+           (unsigned long)strlen(pem));
+  if (!subirCertificado()) {
+    LOG_ERROR("✗ El módem no aceptó el certificado: sin sesión HTTPS hasta subirlo");
+    return false;
+  }
+  preferences.begin("tls", false);
+  preferences.putBytes("ca", resumen, sizeof(resumen));
+  preferences.end();
+  LOG_INFO("✓ Certificado guardado en el módem");
+  certificadoListo = true;
+  configurado = false;  // El contexto debe apuntar al archivo nuevo
+  return true;
+}
+
+bool ContextoTLS::preparar() {
+  if (!verificaServidor()) {
+    if (!configurado) {
+      LOG_AVISO("TLS sin verificación del servidor: configurar TLS_CA_PEM");
+    }
+  } else if (!asegurarCertificado()) {
+    return false;  // Nunca una sesión sin verificar si se pidió verificación
+  }
+  if (configurado) {
+    return true;
+  }
+
+  // Persiste en el módem hasta que se reinicie: no hace falta repetirlo por sesión
+  bool ok = canal.ejecutar(AT_CSSL_VERSION) == AT_OK;
+  if (verificaServidor()) {
+    ok = canal.ejecutar(AT_CSSL_CA, archivo) == AT_OK && ok;
+    ok = canal.ejecutar(AT_CSSL_HORA, ignoraHora() ? 1 : 0) == AT_OK && ok;
+  }
+  ok = canal.ejecutar(AT_CSSL_AUTENTICACION, verificaServidor() ? 1 : 0) == AT_OK && ok;
+  ok = canal.ejecutar(AT_CSSL_SNI) == AT_OK && ok;
+  vecesConfigurado++;
+
+  if (!ok && verificaServidor()) {
+    LOG_ERROR("✗ No se pudo activar la verificación del servidor");
+    return false;  // Se reintenta en la próxima sesión
+  }
+  configurado = true;
+  LOG_DEPURACION("Contexto SSL configurado (%s)", verificaServidor() ? "servidor verificado" : "sin verificar");
+  return true;
+}
+
+void ContextoTLS::registrarSesion(unsigned long ms, const ConsumoSesion& bytes) {
+  sesiones++;
+  msTotal += ms;
+  bytesTotal += bytes.subida + bytes.bajada;
+  if (sesiones % TLS_MEDICION_SESIONES == 0) {
+    LOG_INFO("TLS %s: %lu ms medidos y ~%lu bytes estimados por reporte (%d sesiones, contexto configurado %d veces)",
+             verificaServidor() ? "verificado" : "sin verificar", msPorSesion(),
+             (unsigned long)bytesEstimadosPorSesion(), sesiones, vecesConfigurado);
+  }
+}
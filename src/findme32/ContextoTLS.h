@@ -0,0 +1,74 @@
+#ifndef CONTEXTOTLS_H
+#define CONTEXTOTLS_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "config.h"
+#include "CanalAT.h"
+#include "ConsumoDatos.h"
+
+#define TLS_TIEMPO_CARGA_MS 10000UL  // Para que el módem guarde el PEM tras recibirlo
+#define TLS_RESUMEN_BYTES 32         // SHA-256 del PEM subido
+
+/**
+ * Contexto SSL 0 del módem, el que usan las sesiones HTTPS.
+ *
+ * Con TLS_CA_PEM configurado el certificado se sube una sola vez al sistema
+ * de archivos del módem: su SHA-256 queda en NVS ("tls") y en cada arranque
+ * basta con ver que el archivo sigue en AT+CCERTLIST. El contexto se configura
+ * con verificación del servidor (authmode 1) una vez por encendido del módem
+ * y no en cada sesión; invalidar() lo repite tras un reinicio del módulo.
+ *
+ * La vigencia del certificado se valida con el reloj del módem, que sin NITZ
+ * arranca en 1980: hasta setRelojValido(true) el contexto la ignora
+ * ("ignorelocaltime" 1) y después se reconfigura para validarla.
+ *
+ * El AT+CSSLCFG del A7670 no ofrece reanudación de sesión ni tickets: cada
+ * sesión sigue siendo un handshake completo. Lo que se ahorra por reporte son
+ * los comandos de configuración: registrarSesion() mide los ms; los bytes son
+ * la estimación de HTTPClient (DATOS_BYTES_*), no una medición.
+ */
+class ContextoTLS {
+public:
+  ContextoTLS(CanalAT& canal, const char* pem = TLS_CA_PEM, const char* archivo = TLS_CA_ARCHIVO);
+
+  // Deja el contexto listo para una sesión; false si el certificado no se pudo subir
+  bool preparar();
+  // El módem se reinició: la configuración del contexto (y quizá su reloj) se perdió
+  void invalidar();
+  bool verificaServidor() const { return pem[0] != '\0'; }
+
+  // El reloj del módem tiene fecha (NITZ o fijada con la hora GNSS)
+  void setRelojValido(bool valido);
+  bool relojValido() const { return relojConFecha; }
+  // "ignorelocaltime" del contexto: sin fecha no se puede validar la vigencia
+  bool ignoraHora() const { return TLS_IGNORAR_HORA || !relojConFecha; }
+
+  // Reporte completado: duración medida de la sesión HTTPS y bytes estimados
+  void registrarSesion(unsigned long ms, const ConsumoSesion& bytes);
+  unsigned long msPorSesion() const { return sesiones > 0 ? msTotal / sesiones : 0; }
+  uint32_t bytesEstimadosPorSesion() const { return sesiones > 0 ? bytesTotal / sesiones : 0; }
+  int configuraciones() const { return vecesConfigurado; }
+
+  // El archivo aparece en la respuesta de AT+CCERTLIST
+  static bool certificadoListado(const char* respuesta, const char* archivo);
+
+private:
+  CanalAT& canal;
+  const char* pem;
+  const char* archivo;
+  Preferences preferences;
+  bool configurado;
+  bool relojConFecha;
+  bool certificadoListo;  // Comprobado en este arranque
+  int vecesConfigurado;
+
+  int sesiones;
+  unsigned long msTotal;
+  uint32_t bytesTotal;
+
+  bool asegurarCertificado();
+  bool subirCertificado();
+};
+
+#endif // CONTEXTOTLS_H
@@ -0,0 +1,169 @@
+#include "ControlSMS.h"
+#include "Bitacora.h"
+#include "config.h"
+
+ControlSMS::ControlSMS(CanalAT& canalAT, ColaSMS& colaSMS, ListaAutorizados& listaAutorizados, ControlSalidas& controlSalidas)
+  : canal(canalAT), cola(colaSMS), lista(listaAutorizados), salidas(controlSalidas), proveedorUbicacion(NULL),
+    mensajesPendientes(true), ultimaRevision(0) {}
+
+void ControlSMS::alRecibirCMTI(const char* linea, void* contexto) {
+  ControlSMS* self = (ControlSMS*)contexto;
+  LOG_INFO("Nuevo SMS: %s", linea);
+  self->mensajesPendientes = true;
+}
+
+void ControlSMS::configurarModem() {
+  LOG_INFO("Configurando SMS en modo texto...");
+  canal.ejecutar(AT_CMGF);
+  canal.ejecutar(AT_CNMI);  // Avisar con +CMTI al recibir un SMS
+}
+
+void ControlSMS::begin() {
+  configurarModem();
+  canal.registrarURC("+CMTI:", alRecibirCMTI, this);
+
+  lista.begin();
+  if (lista.total() == 0) {
+    static const char* const iniciales[] = NUMEROS_AUTORIZADOS_INICIALES;
+    LOG_AVISO("Lista de autorizados vacía. Sembrando desde config.h...");
+    for (size_t i = 0; i < sizeof(iniciales) / sizeof(iniciales[0]); i++) {
+      if (!lista.agregar(iniciales[i], ROL_ADMIN)) {
+        LOG_ERROR("✗ Número inválido en config.h: %s", iniciales[i]);
+      }
+    }
+  }
+
+  mensajesPendientes = true;  // Procesar lo que llegó mientras estaba apagado
+}
+
+void ControlSMS::atender() {
+  cola.procesar();
+
+  // Entre las partes de un SMS binario el módem puede seguir en modo PDU
+  if (!canal.libre() || cola.ocupada()) {
+    return;
+  }
+
+  if (mensajesPendientes || millis() - ultimaRevision >= INTERVALO_REVISION_SMS) {
+    revisarMensajes();
+  }
+}
+
+void ControlSMS::revisarMensajes() {
+  mensajesPendientes = false;
+  ultimaRevision = millis();
+
+  // Copia: cada AT+CMGD reemplaza la respuesta del canal
+  canal.ejecutar(AT_CMGL_NO_LEIDOS);
+  String respuesta = canal.respuesta();
+
+  int inicioMensaje = respuesta.indexOf("+CMGL: ");
+  while (inicioMensaje != -1) {
+    int finCabecera = respuesta.indexOf('\n', inicioMensaje);
+    if (finCabecera == -1) break;
+    String cabecera = respuesta.substring(inicioMensaje, finCabecera);
+
+    int primerComa = cabecera.indexOf(',');
+    int indiceMensaje = cabecera.substring(7, primerComa).toInt();
+
+    int comilla1 = cabecera.indexOf('"', primerComa);
+    int comilla2 = cabecera.indexOf('"', comilla1 + 1);
+    int comilla3 = cabecera.indexOf('"', comilla2 + 1);
+    int comilla4 = cabecera.indexOf('"', comilla3 + 1);
+    String remitente = cabecera.substring(comilla3 + 1, comilla4);
+
+    // El cuerpo termina en la siguiente cabecera o en el OK final
+    int siguiente = respuesta.indexOf("+CMGL: ", finCabecera);
+    int finCuerpo = (siguiente != -1) ? siguiente : respuesta.lastIndexOf("OK");
+    if (finCuerpo < finCabecera) finCuerpo = respuesta.length();
+    String cuerpo = respuesta.substring(finCabecera + 1, finCuerpo);
+    cuerpo.trim();
+
+    LOG_INFO("SMS de %s: '%s'", remitente.c_str(), cuerpo.c_str());
+    procesarMensaje(remitente, cuerpo);
+
+    // AT+CMGL ya lo marcó como leído: se borra aunque no sea válido
+    canal.ejecutar(AT_CMGD, indiceMensaje);
+
+    inicioMensaje = siguiente;
+  }
+}
+
+void ControlSMS::procesarMensaje(const String& remitente, const String& cuerpo) {
+  RolNumero rol = lista.rol(remitente.c_str());
+
+  if (rol == ROL_NINGUNO) {
+    LOG_AVISO("Número NO autorizado. Ignorando mensaje.");
+    cola.encolar(remitente, "No estás autorizado para usar este dispositivo.", SMS_PRIORIDAD_BAJA);
+    return;
+  }
+
+  bool esApagar = cuerpo.equalsIgnoreCase("Apagar");
+  bool esPrender = cuerpo.equalsIgnoreCase("Prender");
+
+  if (rol >= ROL_ADMIN && procesarComandoAdmin(remitente, cuerpo)) {
+    LOG_INFO("COMANDO: Administración de lista blanca.");
+  } else if ((esApagar || esPrender) && rol < ROL_CONTROL) {
+    LOG_AVISO("COMANDO: Rol sin permiso de control.");
+    cola.encolar(remitente, "Tu número solo puede usar Localizar.");
+  } else if (esApagar) {
+    LOG_INFO("COMANDO: Encendiendo relevador...");
+    salidas.aplicarDesdeSMS(true);
+    cola.encolar(remitente, "Apagado");
+  } else if (esPrender) {
+    LOG_INFO("COMANDO: Apagando relevador...");
+    salidas.aplicarDesdeSMS(false);
+    cola.encolar(remitente, "Encendido");
+  } else if (cuerpo.equalsIgnoreCase("Localizar")) {
+    LOG_INFO("COMANDO: Obteniendo ubicación GPS...");
+    String ubicacion = proveedorUbicacion ? proveedorUbicacion(remitente) : String("No se pudo obtener ubicacion GPS.");
+    cola.encolar(remitente, ubicacion);
+  } else {
+    LOG_INFO("COMANDO: No reconocido.");
+    cola.encolar(remitente, "Comando no reconocido.");
+  }
+}
+
+bool ControlSMS::procesarComandoAdmin(const String& remitente, const String& cuerpo) {
+  String comando = cuerpo;
+  String argumentos = "";
+  int espacio = cuerpo.indexOf(' ');
+  if (espacio != -1) {
+    comando = cuerpo.substring(0, espacio);
+    argumentos = cuerpo.substring(espacio + 1);
+    argumentos.trim();
+  }
+
+  bool esAlta = comando.equalsIgnoreCase("Alta");
+  bool esBaja = comando.equalsIgnoreCase("Baja");
+  if (!esAlta && !esBaja) {
+    return false;
+  }
+
+  String numero = argumentos;
+  RolNumero rol = ROL_CONTROL;
+  int separador = argumentos.lastIndexOf(' ');
+  if (esAlta && separador != -1) {
+    RolNumero rolIndicado = ListaAutorizados::parsearRol(argumentos.substring(separador + 1));
+    if (rolIndicado != ROL_NINGUNO) {
+      rol = rolIndicado;
+      numero = argumentos.substring(0, separador);
+      numero.trim();
+    }
+  }
+
+  if (esAlta) {
+    if (lista.agregar(numero.c_str(), rol)) {
+      cola.encolar(remitente, "Alta: " + numero + " (" + ListaAutorizados::nombreRol(rol) + ")");
+    } else {
+      cola.encolar(remitente, "No se pudo dar de alta " + numero);
+    }
+  } else {
+    if (lista.eliminar(numero.c_str())) {
+      cola.encolar(remitente, "Baja: " + numero);
+    } else {
+      cola.encolar(remitente, "Número no encontrado: " + numero);
+    }
+  }
+  return true;
+}
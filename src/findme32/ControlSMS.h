@@ -0,0 +1,47 @@
+#ifndef CONTROLSMS_H
+#define CONTROLSMS_H
+
+#include <Arduino.h>
+#include "CanalAT.h"
+#include "ColaSMS.h"
+#include "ListaAutorizados.h"
+#include "ControlSalidas.h"
+
+typedef String (*ProveedorUbicacion)(const String& remitente);
+
+/**
+ * Control remoto por SMS: recepción de comandos, autorización por rol y
+ * respuestas a través de la cola de salida.
+ *
+ * Los SMS nuevos se detectan por el URC +CMTI (AT+CNMI=2,1) y, como respaldo,
+ * con una revisión periódica de AT+CMGL. atender() nunca bloquea esperando el
+ * canal: si hay otra transacción en curso, la revisión se pospone.
+ */
+class ControlSMS {
+public:
+  ControlSMS(CanalAT& canal, ColaSMS& cola, ListaAutorizados& lista, ControlSalidas& salidas);
+
+  void begin();
+  void atender();
+  // Modo texto y aviso +CMTI; se repite tras reiniciar el módem
+  void configurarModem();
+  void setProveedorUbicacion(ProveedorUbicacion proveedor) { proveedorUbicacion = proveedor; }
+
+private:
+  CanalAT& canal;
+  ColaSMS& cola;
+  ListaAutorizados& lista;
+  ControlSalidas& salidas;
+  ProveedorUbicacion proveedorUbicacion;
+
+  bool mensajesPendientes;
+  unsigned long ultimaRevision;
+
+  void revisarMensajes();
+  void procesarMensaje(const String& remitente, const String& cuerpo);
+  bool procesarComandoAdmin(const String& remitente, const String& cuerpo);
+
+  static void alRecibirCMTI(const char* linea, void* contexto);
+};
+
+#endif // CONTROLSMS_H
@@ -0,0 +1,47 @@
+#include "ControlSalidas.h"
+#include "Bitacora.h"
+
+ControlSalidas::ControlSalidas(int pinActivo_, int pinInactivo_)
+  : pinActivo(pinActivo_), pinInactivo(pinInactivo_), activo(false), servidorConocido(false), ultimoServidor(false) {}
+
+void ControlSalidas::begin() {
+  pinMode(pinActivo, OUTPUT);
+  pinMode(pinInactivo, OUTPUT);
+
+  preferences.begin("relay-state", false);
+  activo = preferences.getBool("on", false);
+  servidorConocido = preferences.isKey("srv");
+  ultimoServidor = preferences.getBool("srv", false);
+
+  digitalWrite(pinActivo, activo ? HIGH : LOW);
+  digitalWrite(pinInactivo, activo ? LOW : HIGH);
+  LOG_INFO("Pines de control inicializados (%d, %d). Estado restaurado: %s", pinActivo, pinInactivo,
+           activo ? "ACTIVO" : "INACTIVO");
+}
+
+void ControlSalidas::aplicar(bool nuevoEstado, const char* origen) {
+  if (nuevoEstado != activo) {
+    activo = nuevoEstado;
+    preferences.putBool("on", activo);
+  }
+
+  digitalWrite(pinActivo, activo ? HIGH : LOW);
+  digitalWrite(pinInactivo, activo ? LOW : HIGH);
+  LOG_INFO("[%s] PIN %d %s, PIN %d %s", origen, pinActivo, activo ? "encendido" : "apagado", pinInactivo,
+           activo ? "apagado" : "encendido");
+}
+
+void ControlSalidas::aplicarDesdeSMS(bool nuevoEstado) {
+  aplicar(nuevoEstado, "SMS");
+}
+
+void ControlSalidas::aplicarDesdeServidor(bool isActive) {
+  if (servidorConocido && isActive == ultimoServidor) {
+    return;  // Sin cambios en el servidor: respetar el último comando SMS
+  }
+
+  servidorConocido = true;
+  ultimoServidor = isActive;
+  preferences.putBool("srv", isActive);
+  aplicar(isActive, "Servidor");
+}
@@ -0,0 +1,35 @@
+#ifndef CONTROLSALIDAS_H
+#define CONTROLSALIDAS_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+/**
+ * Estado único de los pines de control (relevador), compartido por el
+ * rastreador (isActive del servidor) y los comandos SMS (Apagar/Prender).
+ *
+ * El estado se persiste en NVS y se restaura al arrancar. El servidor solo
+ * modifica las salidas cuando su valor de isActive cambia respecto al último
+ * recibido, de modo que un reporte periódico no revierte un comando SMS.
+ */
+class ControlSalidas {
+public:
+  ControlSalidas(int pinActivo, int pinInactivo);
+
+  void begin();
+  void aplicarDesdeSMS(bool activo);
+  void aplicarDesdeServidor(bool isActive);
+  bool estaActivo() const { return activo; }
+
+private:
+  Preferences preferences;
+  int pinActivo;
+  int pinInactivo;
+  bool activo;
+  bool servidorConocido;
+  bool ultimoServidor;
+
+  void aplicar(bool nuevoEstado, const char* origen);
+};
+
+#endif // CONTROLSALIDAS_H
@@ -0,0 +1,140 @@
+#include "DeltaOTA.h"
+#include <mbedtls/pk.h>
+
+static uint32_t leerU32(const uint8_t* p) {
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+AplicadorDelta::AplicadorDelta(const CabeceraDelta& c, LectorOrigen lectorOrigen, EscritorDestino escritorDestino,
+                               void* ctx)
+  : cabecera(c), lector(lectorOrigen), escritor(escritorDestino), contexto(ctx), estado(ESPERANDO_OPERACION),
+    operacion(0), argumentosLeidos(0), restantes(0), salida(0), motivo(NULL) {
+  memset(hash, 0, sizeof(hash));
+  mbedtls_sha256_init(&sha);
+  mbedtls_sha256_starts(&sha, 0);
+}
+
+AplicadorDelta::~AplicadorDelta() {
+  mbedtls_sha256_free(&sha);
+}
+
+bool AplicadorDelta::fallar(const char* razon) {
+  estado = FALLIDO;
+  motivo = razon;
+  return false;
+}
+
+bool AplicadorDelta::escribir(const uint8_t* datos, size_t n) {
+  if (salida + n > cabecera.tamanoDestino) {
+    return fallar("la imagen nueva excede su tamaño");
+  }
+  if (!escritor(salida, datos, n, contexto)) {
+    return fallar("error al escribir la partición");
+  }
+  mbedtls_sha256_update(&sha, datos, n);
+  salida += n;
+  return true;
+}
+
+bool AplicadorDelta::ejecutarOperacion() {
+  if (operacion == DELTA_INSERTAR) {
+    restantes = leerU32(argumentos);
+    estado = restantes > 0 ? INSERTANDO : ESPERANDO_OPERACION;
+    return true;
+  }
+
+  // Copia desde la imagen en ejecución
+  uint32_t desde = leerU32(argumentos);
+  uint32_t n = leerU32(argumentos + 4);
+  if (desde > cabecera.tamanoOrigen || n > cabecera.tamanoOrigen - desde) {
+    return fallar("copia fuera de la imagen en ejecución");
+  }
+  uint8_t trozo[DELTA_TROZO_COPIA];
+  while (n > 0) {
+    size_t parte = n < sizeof(trozo) ? n : sizeof(trozo);
+    if (!lector(desde, trozo, parte, contexto)) {
+      return fallar("error al leer la imagen en ejecución");
+    }
+    if (!escribir(trozo, parte)) {
+      return false;
+    }
+    desde += parte;
+    n -= parte;
+  }
+  estado = ESPERANDO_OPERACION;
+  return true;
+}
+
+bool AplicadorDelta::consumir(const uint8_t* datos, size_t n) {
+  size_t i = 0;
+  while (i < n) {
+    switch (estado) {
+      case ESPERANDO_OPERACION:
+        operacion = datos[i++];
+        argumentosLeidos = 0;
+        if (operacion == DELTA_FIN) {
+          mbedtls_sha256_finish(&sha, hash);
+          estado = TERMINADO;
+        } else if (operacion == DELTA_COPIAR || operacion == DELTA_INSERTAR) {
+          estado = LEYENDO_ARGUMENTOS;
+        } else {
+          return fallar("operación desconocida");
+        }
+        break;
+
+      case LEYENDO_ARGUMENTOS:
+        argumentos[argumentosLeidos++] = datos[i++];
+        if (argumentosLeidos == largoArgumentos() && !ejecutarOperacion()) {
+          return false;
+        }
+        break;
+
+      case INSERTANDO: {
+        size_t parte = n - i < restantes ? n - i : restantes;
+        if (!escribir(datos + i, parte)) {
+          return false;
+        }
+        i += parte;
+        restantes -= parte;
+        if (restantes == 0) {
+          estado = ESPERANDO_OPERACION;
+        }
+        break;
+      }
+
+      case TERMINADO:
+        return fallar("datos después del fin");
+
+      case FALLIDO:
+        return false;
+    }
+  }
+  return true;
+}
+
+bool AplicadorDelta::valido() const {
+  return estado == TERMINADO && salida == cabecera.tamanoDestino &&
+         memcmp(hash, cabecera.shaDestino, sizeof(hash)) == 0;
+}
+
+bool AplicadorDelta::verificarFirma(const CabeceraDelta& c, const char* clavePem) {
+  if (c.firmaLargo == 0 || c.firmaLargo > DELTA_FIRMA_MAX) {
+    return false;
+  }
+
+  uint8_t resumen[32];
+  mbedtls_sha256_context ctx;
+  mbedtls_sha256_init(&ctx);
+  mbedtls_sha256_starts(&ctx, 0);
+  mbedtls_sha256_update(&ctx, (const uint8_t*)&c, DELTA_BYTES_FIRMADOS);
+  mbedtls_sha256_finish(&ctx, resumen);
+  mbedtls_sha256_free(&ctx);
+
+  // El parser de PEM exige el terminador dentro de la longitud
+  mbedtls_pk_context clave;
+  mbedtls_pk_init(&clave);
+  bool valida = mbedtls_pk_parse_public_key(&clave, (const unsigned char*)clavePem, strlen(clavePem) + 1) == 0 &&
+                mbedtls_pk_verify(&clave, MBEDTLS_MD_SHA256, resumen, sizeof(resumen), c.firma, c.firmaLargo) == 0;
+  mbedtls_pk_free(&clave);
+  return valida;
+}
@@ -0,0 +1,93 @@
+#ifndef DELTAOTA_H
+#define DELTAOTA_H
+
+#include <Arduino.h>
+#include <stddef.h>
+#include <mbedtls/sha256.h>
+
+#define DELTA_MAGIA 0x31444D46UL  // "FMD1" en little-endian
+#define DELTA_FIRMA_MAX 72        // ECDSA P-256 en DER
+#define DELTA_TROZO_COPIA 256     // Bytes de la imagen en ejecución leídos por paso
+
+/**
+ * Cabecera del delta (little-endian). La firma cubre los bytes anteriores a
+ * 'firmaLargo': tamaños y hashes de ambas imágenes. Como el hash de la imagen
+ * resultante está firmado, basta con comprobarlo al terminar de aplicar.
+ */
+struct CabeceraDelta {
+  uint32_t magia;                   // DELTA_MAGIA
+  uint32_t bytesDelta;              // Archivo completo, con esta cabecera
+  uint32_t tamanoOrigen;            // Imagen en ejecución contra la que se calculó
+  uint32_t tamanoDestino;
+  uint8_t shaOrigen[32];
+  uint8_t shaDestino[32];
+  uint8_t firmaLargo;
+  uint8_t reservado[3];
+  uint8_t firma[DELTA_FIRMA_MAX];   // Del SHA-256 de los primeros DELTA_BYTES_FIRMADOS
+};
+
+#define DELTA_BYTES_FIRMADOS offsetof(CabeceraDelta, firmaLargo)
+
+static_assert(sizeof(CabeceraDelta) == 156, "CabeceraDelta debe ocupar 156 bytes");
+static_assert(DELTA_BYTES_FIRMADOS == 80, "La firma cubre tamaños y hashes");
+
+/**
+ * Operaciones que siguen a la cabecera, hasta DELTA_FIN:
+ *   'C' u32 desde, u32 n   copiar n bytes de la imagen en ejecución
+ *   'I' u32 n, n bytes     insertar bytes nuevos
+ *   'F'                    fin
+ */
+enum OperacionDelta {
+  DELTA_COPIAR = 'C',
+  DELTA_INSERTAR = 'I',
+  DELTA_FIN = 'F'
+};
+
+typedef bool (*LectorOrigen)(uint32_t desde, uint8_t* destino, size_t n, void* contexto);
+typedef bool (*EscritorDestino)(uint32_t desde, const uint8_t* datos, size_t n, void* contexto);
+
+/**
+ * Aplica las operaciones de un delta a medida que llegan, en trozos de
+ * cualquier tamaño, sin guardar el delta ni la imagen en RAM. Lee la imagen
+ * en ejecución con 'lector', escribe la nueva con 'escritor' y calcula su
+ * SHA-256 al paso.
+ */
+class AplicadorDelta {
+public:
+  AplicadorDelta(const CabeceraDelta& cabecera, LectorOrigen lector, EscritorDestino escritor, void* contexto);
+  ~AplicadorDelta();
+
+  bool consumir(const uint8_t* datos, size_t n);
+  // 'F' recibido, tamaño exacto y hash igual al firmado
+  bool valido() const;
+  uint32_t escritos() const { return salida; }
+  const char* error() const { return motivo; }
+
+  // Firma ECDSA de la cabecera con la clave pública en PEM
+  static bool verificarFirma(const CabeceraDelta& cabecera, const char* clavePem);
+
+private:
+  enum Estado { ESPERANDO_OPERACION, LEYENDO_ARGUMENTOS, INSERTANDO, TERMINADO, FALLIDO };
+
+  const CabeceraDelta& cabecera;
+  LectorOrigen lector;
+  EscritorDestino escritor;
+  void* contexto;
+
+  Estado estado;
+  uint8_t operacion;
+  uint8_t argumentos[8];
+  int argumentosLeidos;
+  uint32_t restantes;
+  uint32_t salida;
+  mbedtls_sha256_context sha;
+  uint8_t hash[32];
+  const char* motivo;
+
+  int largoArgumentos() const { return operacion == DELTA_COPIAR ? 8 : 4; }
+  bool ejecutarOperacion();
+  bool escribir(const uint8_t* datos, size_t n);
+  bool fallar(const char* razon);
+};
+
+#endif // DELTAOTA_H
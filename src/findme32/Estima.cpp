@@ -0,0 +1,67 @@
+#include "Estima.h"
+#include "GeoUtils.h"
+#include <math.h>
+
+#define RADIO_TIERRA_METROS 6371000.0  // El mismo de calcularDistancia()
+
+static double aRadianes(double grados) {
+  return grados * M_PI / 180.0;
+}
+
+static float aDecimas(float valor) {
+  return lroundf(valor * 10) / 10.0f;
+}
+
+void predecirPosicion(const BaseEstima& base, double segundos, double& lat, double& lon) {
+  lat = base.lat;
+  lon = base.lon;
+  if (base.rumbo < 0 || base.velocidad <= 0 || segundos <= 0) {
+    return;
+  }
+  double metros = base.velocidad / 3.6 * segundos;
+  double rumbo = aRadianes(base.rumbo);
+  lat += metros * cos(rumbo) / RADIO_TIERRA_METROS * 180.0 / M_PI;
+  lon += metros * sin(rumbo) / (RADIO_TIERRA_METROS * cos(aRadianes(base.lat))) * 180.0 / M_PI;
+}
+
+ReporteEstima::ReporteEstima(double umbralMetros, double intervaloMaximo, float velocidadMinima)
+  : umbralMetros(umbralMetros), intervaloMaximo(intervaloMaximo), velocidadMinima(velocidadMinima),
+    conBase(false), desvio(0) {
+  base.lat = 0;
+  base.lon = 0;
+  base.velocidad = -1.0f;
+  base.rumbo = ESTIMA_SIN_RUMBO;
+  base.utc = 0;
+}
+
+BaseEstima ReporteEstima::armarBase(double lat, double lon, float velocidad, float rumbo, uint32_t utc) const {
+  BaseEstima b;
+  b.lat = lround(lat * 1e6) / 1e6;
+  b.lon = lround(lon * 1e6) / 1e6;
+  b.velocidad = velocidad < 0 ? -1.0f : aDecimas(velocidad);
+  b.rumbo = ESTIMA_SIN_RUMBO;
+  if (rumbo >= 0 && b.velocidad >= velocidadMinima) {
+    b.rumbo = aDecimas(fmodf(rumbo, 360.0f));
+    if (b.rumbo >= 360.0f) {
+      b.rumbo = 0;
+    }
+  }
+  b.utc = utc;
+  return b;
+}
+
+void ReporteEstima::fijarBase(const BaseEstima& nueva) {
+  base = nueva;
+  conBase = true;
+}
+
+bool ReporteEstima::debeReportar(double lat, double lon, double segundos, int factor) {
+  if (!conBase) {
+    desvio = 0;
+    return true;
+  }
+  double latPrevista, lonPrevista;
+  predecirPosicion(base, segundos, latPrevista, lonPrevista);
+  desvio = calcularDistancia(latPrevista, lonPrevista, lat, lon);
+  return desvio > umbralMetros * factor || segundos >= intervaloMaximo * factor;
+}
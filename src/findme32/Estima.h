@@ -0,0 +1,68 @@
+#ifndef ESTIMA_H
+#define ESTIMA_H
+
+#include <stdint.h>
+
+// ============================
+// NAVEGACIÓN POR ESTIMA
+// ============================
+// Sin dependencias de Arduino: el rastreador decide con este código cuándo
+// reportar y el servidor de referencia (servidor/ingesta.cpp) lo usa para
+// dar la posición entre reportes. Los dos extrapolan desde los mismos números.
+
+#define ESTIMA_SIN_RUMBO (-1.0f)
+
+/**
+ * Lo que el servidor sabe del último reporte, tal como viajó en la URL:
+ * coordenadas en millonésimas de grado, velocidad y rumbo en décimas.
+ */
+struct BaseEstima {
+  double lat;
+  double lon;
+  float velocidad;  // km/h, negativa si no se conoce
+  float rumbo;      // Grados desde el norte; ESTIMA_SIN_RUMBO: la posición no se extrapola
+  uint32_t utc;     // ts del reporte, 0 si no se conoce
+};
+
+/**
+ * Posición prevista 'segundos' después de la base: movimiento rectilíneo a
+ * velocidad constante sobre el plano tangente. Sin rumbo, la de la base.
+ */
+void predecirPosicion(const BaseEstima& base, double segundos, double& lat, double& lon);
+
+/**
+ * Regla de reporte por estima del rastreador.
+ *
+ * Tras cada reporte, dispositivo y servidor extrapolan desde su posición,
+ * velocidad y rumbo. Solo se vuelve a reportar cuando el fix leído se aparta
+ * de la posición prevista más de 'umbralMetros' o cuando pasaron
+ * 'intervaloMaximo' segundos desde la base: en línea recta a velocidad
+ * constante la predicción acierta y no hace falta enviar nada. Detenido (sin
+ * rumbo) equivale a la regla por distancia al último punto enviado.
+ */
+class ReporteEstima {
+public:
+  ReporteEstima(double umbralMetros, double intervaloMaximo, float velocidadMinima);
+
+  // Redondea como HTTPClient y descarta el rumbo por debajo de la velocidad mínima
+  BaseEstima armarBase(double lat, double lon, float velocidad, float rumbo, uint32_t utc) const;
+
+  // El reporte salió o quedó en cola: desde aquí extrapola el servidor
+  void fijarBase(const BaseEstima& nueva);
+  bool hayBase() const { return conBase; }
+  const BaseEstima& getBase() const { return base; }
+
+  // ¿Reportar el fix leído 'segundos' después de la base? 'factor' agranda umbral e intervalo
+  bool debeReportar(double lat, double lon, double segundos, int factor = 1);
+  double ultimoDesvio() const { return desvio; }  // Metros, de la última consulta
+
+private:
+  double umbralMetros;
+  double intervaloMaximo;
+  float velocidadMinima;
+  BaseEstima base;
+  bool conBase;
+  double desvio;
+};
+
+#endif // ESTIMA_H
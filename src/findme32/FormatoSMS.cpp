@@ -0,0 +1,232 @@
+#include "FormatoSMS.h"
+#include <string.h>
+
+static const char HEX_DIGITOS[] = "0123456789ABCDEF";
+
+size_t armarPDUEnvio(const char* numero, const uint8_t* datos, size_t n, bool cabecera, uint8_t* pdu) {
+  bool internacional = numero[0] == '+';
+  const char* digitos = internacional ? numero + 1 : numero;
+  size_t cantidadDigitos = strlen(digitos);
+  if (cantidadDigitos == 0 || cantidadDigitos > SMS_NUMERO_MAX || n > SMS_BINARIO_MAX) {
+    return 0;
+  }
+
+  size_t i = 0;
+  pdu[i++] = 0x00;                          // Centro de mensajes de la SIM
+  pdu[i++] = cabecera ? 0x51 : 0x11;        // SMS-SUBMIT, validez relativa, UDHI
+  pdu[i++] = 0x00;                          // Referencia: la asigna el módem
+  pdu[i++] = (uint8_t)cantidadDigitos;
+  pdu[i++] = internacional ? 0x91 : 0x81;
+  // Semi-octetos invertidos, con 'F' de relleno si la cantidad es impar
+  for (size_t d = 0; d < cantidadDigitos; d += 2) {
+    if (digitos[d] < '0' || digitos[d] > '9') {
+      return 0;
+    }
+    uint8_t bajo = digitos[d] - '0';
+    uint8_t alto = 0x0F;
+    if (d + 1 < cantidadDigitos) {
+      if (digitos[d + 1] < '0' || digitos[d + 1] > '9') {
+        return 0;
+      }
+      alto = digitos[d + 1] - '0';
+    }
+    pdu[i++] = (alto << 4) | bajo;
+  }
+  pdu[i++] = 0x00;                          // PID
+  pdu[i++] = 0x04;                          // DCS: datos de 8 bits
+  pdu[i++] = SMS_VALIDEZ_RELATIVA;
+  pdu[i++] = (uint8_t)n;
+  memcpy(pdu + i, datos, n);
+  return i + n;
+}
+
+// Número en semi-octetos; false si es alfanumérico o no cabe
+static bool leerNumero(const uint8_t* p, size_t digitos, uint8_t tipo, char* destino) {
+  if ((tipo & 0x70) == 0x50 || digitos > SMS_NUMERO_MAX) {
+    return false;
+  }
+  size_t j = 0;
+  if ((tipo & 0x70) == 0x10) {
+    destino[j++] = '+';
+  }
+  for (size_t d = 0; d < digitos; d++) {
+    uint8_t v = (d % 2 == 0) ? (p[d / 2] & 0x0F) : (p[d / 2] >> 4);
+    if (v > 9) {
+      return false;
+    }
+    destino[j++] = '0' + v;
+  }
+  destino[j] = '\0';
+  return true;
+}
+
+static bool esOchoBits(uint8_t dcs) {
+  if ((dcs & 0xC0) == 0x00) {
+    return (dcs & 0x0C) == 0x04;  // Grupo general
+  }
+  return (dcs & 0xF0) == 0xF0 && (dcs & 0x04) != 0;  // Clase de mensaje
+}
+
+bool leerPDU(const uint8_t* pdu, size_t n, SMSBinario& sms) {
+  memset(&sms, 0, sizeof(sms));
+  size_t i = 0;
+  if (n < 1 || (size_t)pdu[0] + 1 >= n) {
+    return false;
+  }
+  i += 1 + pdu[0];                          // Centro de mensajes
+
+  uint8_t primero = pdu[i++];
+  uint8_t tipo = primero & 0x03;
+  if (tipo != 0x00 && tipo != 0x01) {
+    return false;                           // Ni DELIVER ni SUBMIT
+  }
+  if (tipo == 0x01) {
+    i++;                                    // Referencia del mensaje
+  }
+
+  if (i + 2 > n) {
+    return false;
+  }
+  size_t digitos = pdu[i];
+  uint8_t tipoNumero = pdu[i + 1];
+  i += 2;
+  if (i + (digitos + 1) / 2 > n || !leerNumero(pdu + i, digitos, tipoNumero, sms.numero)) {
+    return false;
+  }
+  i += (digitos + 1) / 2;
+
+  if (i + 2 > n) {
+    return false;
+  }
+  i++;                                      // PID
+  uint8_t dcs = pdu[i++];
+  if (tipo == 0x00) {
+    i += 7;                                 // Sello de tiempo del centro de mensajes
+  } else {
+    uint8_t validez = (primero >> 3) & 0x03;
+    i += validez == 0x02 ? 1 : validez == 0x00 ? 0 : 7;
+  }
+  if (i + 1 > n || !esOchoBits(dcs)) {
+    return false;
+  }
+  size_t largo = pdu[i++];
+  if (i + largo > n) {
+    return false;
+  }
+  const uint8_t* datos = pdu + i;
+
+  if (primero & 0x40) {
+    size_t largoCabecera = (size_t)datos[0] + 1;
+    if (largo == 0 || largoCabecera > largo) {
+      return false;
+    }
+    // Elementos de información: solo importa la concatenación
+    for (size_t e = 1; e + 2 <= largoCabecera;) {
+      uint8_t iei = datos[e];
+      uint8_t lei = datos[e + 1];
+      const uint8_t* v = datos + e + 2;
+      if (e + 2 + lei > largoCabecera) {
+        return false;
+      }
+      if (iei == 0x00 && lei == 3) {
+        sms.concatenado = true;
+        sms.referencia = v[0];
+        sms.partes = v[1];
+        sms.parte = v[2];
+      } else if (iei == 0x08 && lei == 4) {
+        sms.concatenado = true;
+        sms.referencia = ((uint16_t)v[0] << 8) | v[1];
+        sms.partes = v[2];
+        sms.parte = v[3];
+      }
+      e += 2 + lei;
+    }
+    if (sms.concatenado && (sms.parte == 0 || sms.parte > sms.partes)) {
+      return false;
+    }
+    datos += largoCabecera;
+    largo -= largoCabecera;
+  }
+
+  sms.datos = datos;
+  sms.largo = largo;
+  return true;
+}
+
+size_t aHexadecimal(const uint8_t* datos, size_t n, char* destino) {
+  for (size_t i = 0; i < n; i++) {
+    destino[2 * i] = HEX_DIGITOS[datos[i] >> 4];
+    destino[2 * i + 1] = HEX_DIGITOS[datos[i] & 0x0F];
+  }
+  destino[2 * n] = '\0';
+  return 2 * n;
+}
+
+static int valorHex(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+size_t deHexadecimal(const char* texto, uint8_t* destino, size_t capacidad) {
+  size_t n = 0;
+  for (; texto[0] != '\0'; texto += 2) {
+    int alto = valorHex(texto[0]);
+    int bajo = alto < 0 ? -1 : valorHex(texto[1]);
+    if (bajo < 0 || n == capacidad) {
+      return 0;
+    }
+    destino[n++] = (uint8_t)((alto << 4) | bajo);
+  }
+  return n;
+}
+
+static void escribir32(uint8_t* p, uint32_t v) {
+  p[0] = v >> 24;
+  p[1] = v >> 16;
+  p[2] = v >> 8;
+  p[3] = v;
+}
+
+static uint32_t leer32(const uint8_t* p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+size_t empaquetarReportes(uint32_t masAntigua, const ReporteSMS* reportes, int n, uint8_t* destino) {
+  destino[0] = REPORTE_SMS_VERSION;
+  destino[1] = (uint8_t)n;
+  escribir32(destino + 2, masAntigua);
+  uint8_t* p = destino + REPORTE_SMS_CABECERA;
+  for (int i = 0; i < n; i++) {
+    escribir32(p, reportes[i].secuencia);
+    escribir32(p + 4, reportes[i].utc);
+    escribir32(p + 8, (uint32_t)reportes[i].lat);
+    escribir32(p + 12, (uint32_t)reportes[i].lon);
+    p[16] = reportes[i].velocidad >> 8;
+    p[17] = reportes[i].velocidad;
+    p += REPORTE_SMS_BYTES;
+  }
+  return p - destino;
+}
+
+int desempaquetarReportes(const uint8_t* datos, size_t n, uint32_t& masAntigua, ReporteSMS* destino, int max) {
+  if (n < REPORTE_SMS_CABECERA || datos[0] != REPORTE_SMS_VERSION) {
+    return -1;
+  }
+  int cantidad = datos[1];
+  if (n != REPORTE_SMS_CABECERA + (size_t)cantidad * REPORTE_SMS_BYTES || cantidad > max) {
+    return -1;
+  }
+  masAntigua = leer32(datos + 2);
+  const uint8_t* p = datos + REPORTE_SMS_CABECERA;
+  for (int i = 0; i < cantidad; i++) {
+    destino[i].secuencia = leer32(p);
+    destino[i].utc = leer32(p + 4);
+    destino[i].lat = (int32_t)leer32(p + 8);
+    destino[i].lon = (int32_t)leer32(p + 12);
+    destino[i].velocidad = ((uint16_t)p[16] << 8) | p[17];
+    p += REPORTE_SMS_BYTES;
+  }
+  return cantidad;
+}
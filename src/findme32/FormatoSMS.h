@@ -0,0 +1,82 @@
+#ifndef FORMATOSMS_H
+#define FORMATOSMS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================
+// SMS BINARIOS (MODO PDU)
+// ============================
+// Sin dependencias de Arduino: el rastreador arma los PDU y la pasarela
+// (pasarela/) los lee con este mismo código.
+
+#define SMS_BINARIO_MAX 140        // Octetos de datos de usuario de un SMS de 8 bits
+#define SMS_UDH_CONCATENADO 6      // UDHL + IEI 0x00 (referencia de 8 bits, total, parte)
+#define SMS_NUMERO_MAX 20          // Dígitos del destino
+// SMSC + primer octeto + MR + destino + PID + DCS + VP + UDL + datos
+#define SMS_PDU_MAX (1 + 2 + 2 + (SMS_NUMERO_MAX + 1) / 2 + 4 + SMS_BINARIO_MAX)
+#define SMS_VALIDEZ_RELATIVA 0xA7  // 24 h: un reporte más viejo ya no le sirve a nadie
+
+/**
+ * Arma un SMS-SUBMIT de 8 bits con el centro de mensajes de la SIM.
+ * @param numero Destino, con '+' si es internacional
+ * @param datos Datos de usuario, incluida la cabecera UDH si 'cabecera'
+ * @param pdu Al menos SMS_PDU_MAX octetos
+ * @return Octetos escritos (0 si el número no es válido). AT+CMGS recibe
+ *         este largo menos 1: el octeto del centro de mensajes no cuenta.
+ */
+size_t armarPDUEnvio(const char* numero, const uint8_t* datos, size_t n, bool cabecera, uint8_t* pdu);
+
+/**
+ * SMS de 8 bits leído de un PDU
+ */
+struct SMSBinario {
+  char numero[SMS_NUMERO_MAX + 2];  // Remitente (DELIVER) o destino (SUBMIT)
+  bool concatenado;
+  uint16_t referencia;              // Igual en todas las partes de un mensaje
+  uint8_t partes;
+  uint8_t parte;                    // 1..partes
+  const uint8_t* datos;             // Sin la cabecera UDH; apunta dentro del PDU
+  size_t largo;
+};
+
+/**
+ * Lee un SMS-DELIVER (lo que recibe la pasarela) o un SMS-SUBMIT (lo que
+ * envió el rastreador, p.ej. desde una transcripción). Solo acepta datos de
+ * 8 bits. Devuelve false si el PDU está truncado o no es binario.
+ */
+bool leerPDU(const uint8_t* pdu, size_t n, SMSBinario& sms);
+
+// Conversión para AT+CMGS / AT+CMGL en modo PDU
+size_t aHexadecimal(const uint8_t* datos, size_t n, char* destino);  // Termina en '\0'
+size_t deHexadecimal(const char* texto, uint8_t* destino, size_t capacidad);  // 0 si no es hex válido
+
+// ============================
+// REPORTES EN SMS
+// ============================
+// Carga, de un SMS o de la unión de sus partes, big-endian:
+//   versión (1) | cantidad (1) | oldest (4) | cantidad x reporte (18)
+// Reporte: secuencia (4) | utc (4) | lat (4) | lon (4) | velocidad (2)
+
+#define REPORTE_SMS_VERSION 1
+#define REPORTE_SMS_CABECERA 6
+#define REPORTE_SMS_BYTES 18
+#define REPORTE_SMS_SIN_VELOCIDAD 0xFFFF
+
+struct ReporteSMS {
+  uint32_t secuencia;
+  uint32_t utc;        // 0 si no se conoce
+  int32_t lat;         // Millonésimas de grado
+  int32_t lon;
+  uint16_t velocidad;  // km/h x 10; REPORTE_SMS_SIN_VELOCIDAD si no se conoce
+};
+
+size_t empaquetarReportes(uint32_t masAntigua, const ReporteSMS* reportes, int n, uint8_t* destino);
+
+/**
+ * @param masAntigua "oldest": el rastreador no reenviará secuencias anteriores
+ * @return Reportes leídos, -1 si la carga no es válida
+ */
+int desempaquetarReportes(const uint8_t* datos, size_t n, uint32_t& masAntigua, ReporteSMS* destino, int max);
+
+#endif // FORMATOSMS_H
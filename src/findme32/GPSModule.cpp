@@ -1,128 +1,271 @@
 #include "GPSModule.h"
+#include "Bitacora.h"
 #include "config.h"
+#include "Calendario.h"
+#include "RelojGNSS.h"
 
-GPSModule::GPSModule(HardwareSerial& serial) : gsm(serial) {}
+GPSModule::GPSModule(CanalAT& canalAT, RelojGNSS& relojGNSS)
+  : canal(canalAT), reloj(relojGNSS), asistenciaDescargada(false), instanteAsistencia(0), ultimoIntentoAsistencia(0),
+    midiendoTTFF(false), primerFixDelArranque(true), inicioBusqueda(0), ttffMs(0) {}
 
 bool GPSModule::inicializar() {
-  Serial.println(">> Inicializando GPS...");
-  gsm.println("AT+CGNSSPWR=1");
-  delay(1000);
-  
-  String respuesta = esperarRespuesta();
-  Serial.println(">> Respuesta encendido GPS: " + respuesta);
-  
-  if (respuesta.indexOf("OK") != -1) {
-    Serial.println(">> ✓ GPS encendido correctamente");
-    return true;
-  } else {
-    Serial.println(">> Reintentando encendido GPS...");
-    gsm.println("AT+CGNSSPWR=1");
-    delay(1000);
-    respuesta = esperarRespuesta();
-    Serial.println(">> Respuesta reintento: " + respuesta);
-    return (respuesta.indexOf("OK") != -1);
+  LOG_INFO("Inicializando GPS...");
+  ResultadoAT r = canal.ejecutar(AT_GNSS_ENCENDER);
+  LOG_DEPURACION("Respuesta encendido GPS: %s", canal.respuesta().c_str());
+  
+  if (r != AT_OK) {
+    LOG_AVISO("Reintentando encendido GPS...");
+    canal.pausa(1000);
+    r = canal.ejecutar(AT_GNSS_ENCENDER);
+    LOG_DEPURACION("Respuesta reintento: %s", canal.respuesta().c_str());
+    if (r != AT_OK) {
+      return false;
+    }
   }
+  
+  LOG_INFO("✓ GPS encendido correctamente");
+  iniciarMedicionTTFF();
+  return true;
+}
+
+void GPSModule::iniciarMedicionTTFF() {
+  midiendoTTFF = true;
+  inicioBusqueda = millis();
+}
+
+bool GPSModule::asistenciaVigente() const {
+  return asistenciaDescargada && millis() - instanteAsistencia < AGPS_VALIDEZ_MS;
 }
 
-String GPSModule::esperarRespuesta() {
-  String respuesta = "";
-  unsigned long timeout = millis() + 3000;
+bool GPSModule::debeRefrescarAsistencia() const {
+  if (!AGPS_HABILITADO || asistenciaVigente()) {
+    return false;
+  }
+  // Tras un intento fallido, esperar antes de volver a gastar datos
+  return ultimoIntentoAsistencia == 0 || millis() - ultimoIntentoAsistencia >= AGPS_REINTENTO_MS;
+}
+
+bool GPSModule::descargarAsistencia() {
+  LOG_INFO("Descargando asistencia AGPS...");
+  ultimoIntentoAsistencia = millis();
   
-  while (millis() < timeout) {
-    while (gsm.available()) {
-      respuesta += (char)gsm.read();
-    }
-    if (respuesta.indexOf("OK") != -1 || respuesta.indexOf("ERROR") != -1) {
-      break;
-    }
-    delay(50);
+  if (canal.ejecutar(AT_CAGPS) == AT_ERROR) {
+    LOG_AVISO("✗ AT+CAGPS rechazado: %s", canal.respuesta().c_str());
+    return false;
   }
   
-  return respuesta;
+  // El resultado llega como URC: "+AGPS: success." o "+AGPS: fail..."
+  String resultado;
+  if (!canal.esperarURC(AT_CAGPS, resultado)) {
+    LOG_AVISO("✗ Timeout esperando resultado AGPS");
+    return false;
+  }
+  
+  if (resultado.indexOf("success") == -1) {
+    LOG_AVISO("✗ Descarga AGPS fallida: %s", resultado.c_str());
+    return false;
+  }
+  
+  asistenciaDescargada = true;
+  instanteAsistencia = millis();
+  LOG_INFO("✓ Asistencia AGPS inyectada (%.1f s)", (millis() - ultimoIntentoAsistencia) / 1000.0);
+  return true;
+}
+
+void GPSModule::registrarTTFF() {
+  midiendoTTFF = false;
+  ttffMs = millis() - inicioBusqueda;
+  bool conAsistencia = asistenciaVigente();
+  
+  LOG_INFO("TTFF: %.1f s (%s, AGPS %s)", ttffMs / 1000.0, primerFixDelArranque ? "arranque" : "reencendido",
+           conAsistencia ? "sí" : "no");
+  
+  // Persistir el TTFF del primer fix de cada arranque para comparar entre reinicios
+  if (primerFixDelArranque) {
+    primerFixDelArranque = false;
+    preferences.begin("gnss", false);
+    uint32_t arranques = preferences.getUInt("arranques", 0) + 1;
+    preferences.putUInt("arranques", arranques);
+    preferences.putUInt("ttff", (uint32_t)ttffMs);
+    preferences.putBool("ttff_agps", conAsistencia);
+    preferences.end();
+  }
+}
+
+bool GPSModule::apagar() {
+  LOG_INFO("Apagando GPS...");
+  return canal.ejecutar(AT_GNSS_APAGAR) == AT_OK;
+}
+
+bool GPSModule::reiniciar(TipoReinicioGNSS tipo) {
+  IdComandoAT cmd = tipo == REINICIO_CALIENTE ? AT_GNSS_CALIENTE :
+                    tipo == REINICIO_TIBIO    ? AT_GNSS_TIBIO : AT_GNSS_FRIO;
+  LOG_INFO("Reinicio GNSS: %s", COMANDOS_AT[cmd].texto);
+  if (canal.ejecutar(cmd) != AT_OK) {
+    LOG_AVISO("✗ Reinicio GNSS rechazado: %s", canal.respuesta().c_str());
+    return false;
+  }
+  iniciarMedicionTTFF();
+  return true;
+}
+
+// Primer carácter no blanco del campo [inicio, fin)
+static const char* saltarBlancos(const char* inicio, const char* fin) {
+  while (inicio < fin && (*inicio == ' ' || *inicio == '\t')) inicio++;
+  return inicio;
+}
+
+// Dígitos decimales fijos, sin depender del terminador del campo
+static int leerDigitos(const char* p, int n) {
+  int valor = 0;
+  for (int i = 0; i < n; i++) {
+    if (p[i] < '0' || p[i] > '9') return -1;
+    valor = valor * 10 + (p[i] - '0');
+  }
+  return valor;
+}
+
+uint32_t GPSModule::segundosUnix(const char* fecha, const char* hora) {
+  int dia = leerDigitos(fecha, 2);
+  int mes = leerDigitos(fecha + 2, 2);
+  int anio = leerDigitos(fecha + 4, 2);
+  int h = leerDigitos(hora, 2);
+  int m = leerDigitos(hora + 2, 2);
+  int s = leerDigitos(hora + 4, 2);
+  if (dia < 1 || dia > 31 || mes < 1 || mes > 12 || anio < 0 || h < 0 || h > 23 || m < 0 || m > 59 || s < 0 || s > 60) {
+    return 0;
+  }
+
+  long dias = diasDesdeEpoca(2000 + anio, mes, dia);
+  return (uint32_t)dias * 86400UL + h * 3600UL + m * 60UL + s;
+}
+
+uint16_t GPSModule::milisegundos(const char* hora) {
+  if (hora[6] != '.') {
+    return 0;
+  }
+  // Hasta tres decimales; "00" son centésimas
+  uint16_t ms = 0;
+  int escala = 100;
+  for (const char* p = hora + 7; *p >= '0' && *p <= '9' && escala > 0; p++) {
+    ms += (*p - '0') * escala;
+    escala /= 10;
+  }
+  return ms;
 }
 
 bool GPSModule::parsearCGNSSINFO(const String& respuesta, GpsData& data) {
-  if (respuesta.indexOf("+CGNSSINFO:") == -1) {
+  return parsearCGNSSINFO(respuesta.c_str(), data);
+}
+
+bool GPSModule::parsearCGNSSINFO(const char* respuesta, GpsData& data) {
+  // Se recorre la respuesta en su lugar: sin substring() ni copias en el heap
+  const char* linea = strstr(respuesta, "+CGNSSINFO:");
+  if (linea == NULL) {
     return false;
   }
+  linea += 11;
+  const char* finLinea = linea + strcspn(linea, "\r\n");
   
-  int inicio = respuesta.indexOf("+CGNSSINFO:");
-  int finLinea = respuesta.indexOf('\n', inicio);
-  if (finLinea == -1) finLinea = respuesta.length();
-  
-  String linea = respuesta.substring(inicio + 12, finLinea);
-  linea.trim();
-  
-  // Parsear campos separados por comas
-  int campos[20];
+  // Inicio de cada campo separado por comas; campos[n] es el fin del último + 1
+  const char* campos[21];
   int campoCount = 0;
-  campos[campoCount++] = -1;
+  campos[campoCount++] = linea;
   
-  for (int i = 0; i < linea.length() && campoCount < 20; i++) {
-    if (linea.charAt(i) == ',') {
-      campos[campoCount++] = i;
+  for (const char* p = linea; p < finLinea && campoCount < 20; p++) {
+    if (*p == ',') {
+      campos[campoCount++] = p + 1;
     }
   }
+  campos[campoCount] = finLinea + 1;
   
   if (campoCount < 9) {
     return false;
   }
   
-  // Extraer coordenadas
-  String lat = linea.substring(campos[5] + 1, campos[6]);
-  String latDir = linea.substring(campos[6] + 1, campos[7]);
-  String lon = linea.substring(campos[7] + 1, campos[8]);
-  String lonDir = linea.substring(campos[8] + 1, campos[9]);
+  // Satélites en uso: campos 1-4, presentes aun antes del fix
+  data.satelites = 0;
+  for (int i = 1; i <= 4; i++) {
+    data.satelites += atoi(campos[i]);
+  }
   
-  lat.trim();
-  latDir.trim();
-  lon.trim();
-  lonDir.trim();
+  // Extraer coordenadas (campos 5-8: lat, N/S, lon, E/W)
+  const char* lat = saltarBlancos(campos[5], campos[6] - 1);
+  const char* latDir = saltarBlancos(campos[6], campos[7] - 1);
+  const char* lon = saltarBlancos(campos[7], campos[8] - 1);
+  const char* lonDir = saltarBlancos(campos[8], campos[9] - 1);
   
-  if (lat.length() == 0 || lon.length() == 0) {
+  if (lat == campos[6] - 1 || lon == campos[8] - 1) {
     return false;
   }
   
-  float latNum = lat.toFloat();
-  float lonNum = lon.toFloat();
+  double latNum = atof(lat);
+  double lonNum = atof(lon);
   
   if (latNum == 0.0 || lonNum == 0.0) {
     return false;
   }
   
   // Aplicar dirección
-  if (latDir == "S") latNum = -latNum;
-  if (lonDir == "W") lonNum = -lonNum;
+  if (*latDir == 'S') latNum = -latNum;
+  if (*lonDir == 'W') lonNum = -lonNum;
   
   data.lat = latNum;
   data.lon = lonNum;
   data.valida = true;
   
+  // Campos 9-10: fecha y hora UTC del fix
+  data.utc = 0;
+  data.utcMs = 0;
+  if (campoCount >= 11) {
+    const char* hora = saltarBlancos(campos[10], campos[11] - 1);
+    data.utc = segundosUnix(saltarBlancos(campos[9], campos[10] - 1), hora);
+    if (data.utc != 0) {
+      data.utcMs = milisegundos(hora);
+    }
+  }
+  
+  // Campos 12-13: velocidad sobre el suelo (nudos) y rumbo
+  data.velocidad = -1.0f;
+  data.rumbo = -1.0f;
+  if (campoCount >= 14) {
+    const char* velocidad = saltarBlancos(campos[12], campos[13] - 1);
+    const char* rumbo = saltarBlancos(campos[13], campos[14] - 1);
+    if (velocidad < campos[13] - 1) {
+      data.velocidad = atof(velocidad) * 1.852f;
+    }
+    if (rumbo < campos[14] - 1) {
+      data.rumbo = atof(rumbo);
+    }
+  }
+  
   return true;
 }
 
 GpsData GPSModule::obtenerCoordenadas(int maxIntentos) {
-  Serial.println(">> Obteniendo coordenadas GPS...");
-  GpsData data = {0.0, 0.0, false};
+  LOG_DEPURACION("Obteniendo coordenadas GPS...");
+  GpsData data = {0.0, 0.0, false, 0, 0, 0, -1.0f, -1.0f, 0};
 
   for (int intento = 1; intento <= maxIntentos; intento++) {
-    gsm.println("AT+CGNSSINFO");
-    delay(2000);
-    
-    String respuesta = esperarRespuesta();
-    Serial.println(">> Respuesta GPS: " + respuesta);
+    canal.ejecutar(AT_CGNSSINFO);
+    LOG_DEPURACION("Respuesta GPS: %s", canal.respuesta().c_str());
     
-    if (parsearCGNSSINFO(respuesta, data)) {
-      Serial.println(">> ✓ Coordenadas obtenidas: " + String(data.lat, 6) + "," + String(data.lon, 6));
+    if (parsearCGNSSINFO(canal.respuesta(), data)) {
+      data.monotono = reloj.ahora();
+      reloj.sincronizar(data);
+      if (midiendoTTFF) {
+        registrarTTFF();
+      }
+      LOG_INFO("✓ Coordenadas obtenidas: %.6f,%.6f", data.lat, data.lon);
       return data;
     }
     
     if (intento < maxIntentos) {
-      Serial.println(">> No se obtuvo ubicación válida. Reintentando...");
-      delay(GPS_DELAY_INTENTO);
+      LOG_DEPURACION("No se obtuvo ubicación válida. Reintentando...");
+      canal.pausa(GPS_DELAY_INTENTO);
     }
   }
   
-  Serial.println(">> No se pudo obtener ubicación GPS en esta lectura.");
+  LOG_INFO("No se pudo obtener ubicación GPS en esta lectura.");
   return data;
 }
@@ -2,6 +2,10 @@
 #define GPSMODULE_H
 
 #include <Arduino.h>
+#include <Preferences.h>
+#include "CanalAT.h"
+
+class RelojGNSS;
 
 /**
  * Estructura para datos GPS
@@ -10,23 +14,67 @@ struct GpsData {
   double lat;
   double lon;
   bool valida;
+  int satelites;  // Satélites en uso (GPS+GLONASS+GALILEO+BEIDOU), también sin fix
+  uint32_t utc;   // Instante del fix según el GNSS (segundos Unix), 0 si no se conoce
+  uint16_t utcMs;   // Milisegundos de 'utc'
+  float velocidad;  // km/h según el GNSS, -1 si no se conoce
+  float rumbo;      // Grados desde el norte, -1 si no se conoce
+  uint64_t monotono;  // RelojGNSS::ahora() al leer el fix, 0 si no se conoce
+};
+
+/**
+ * Tipos de reinicio del receptor GNSS
+ */
+enum TipoReinicioGNSS {
+  REINICIO_CALIENTE,  // Conserva efemérides y almanaque (AT+CGPSHOT)
+  REINICIO_TIBIO,     // Descarta efemérides (AT+CGPSWARM)
+  REINICIO_FRIO       // Descarta todo (AT+CGPSCOLD)
 };
 
 /**
  * Clase para manejo del módulo GPS
+ * Incluye asistencia AGPS (AT+CAGPS) y medición del tiempo al primer fix (TTFF).
+ * Cada fix leído lleva su instante monótono y ancla el reloj con su hora GNSS.
  */
 class GPSModule {
 public:
-  GPSModule(HardwareSerial& serial);
+  GPSModule(CanalAT& canal, RelojGNSS& reloj);
   
   bool inicializar();
+  bool apagar();
+  bool reiniciar(TipoReinicioGNSS tipo);
   GpsData obtenerCoordenadas(int maxIntentos = 10);
   
+  // Asistencia AGPS: requiere contexto PDP activo
+  bool descargarAsistencia();
+  bool asistenciaVigente() const;
+  bool debeRefrescarAsistencia() const;
+  unsigned long ultimoTTFF() const { return ttffMs; }
+  
+  // Público y estático para las pruebas de reproducción en test/
+  static bool parsearCGNSSINFO(const String& respuesta, GpsData& data);
+  static bool parsearCGNSSINFO(const char* respuesta, GpsData& data);
+  // Fecha ddmmyy y hora hhmmss[.ss] de +CGNSSINFO a segundos Unix; 0 si no son válidas
+  static uint32_t segundosUnix(const char* fecha, const char* hora);
+  // Fracción de segundo de hhmmss.ss en milisegundos
+  static uint16_t milisegundos(const char* hora);
+  
 private:
-  HardwareSerial& gsm;
+  CanalAT& canal;
+  RelojGNSS& reloj;
+  Preferences preferences;
+  
+  bool asistenciaDescargada;
+  unsigned long instanteAsistencia;
+  unsigned long ultimoIntentoAsistencia;
+  
+  bool midiendoTTFF;
+  bool primerFixDelArranque;
+  unsigned long inicioBusqueda;
+  unsigned long ttffMs;
   
-  String esperarRespuesta();
-  bool parsearCGNSSINFO(const String& respuesta, GpsData& data);
+  void registrarTTFF();
+  void iniciarMedicionTTFF();
 };
 
 #endif // GPSMODULE_H
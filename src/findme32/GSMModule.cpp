@@ -1,14 +1,44 @@
 #include "GSMModule.h"
+#include "Bitacora.h"
 #include "config.h"
+#include <time.h>
 
-GSMModule::GSMModule(HardwareSerial& serial, int pwrPin_, int rxPin_, int txPin_, unsigned long baudRate_)
-  : gsm(serial), pwrPin(pwrPin_), rxPin(rxPin_), txPin(txPin_), baudRate(baudRate_) {}
+/**
+ * APN por operador (MCC + MNC). Con MNC de 2 dígitos basta poner 5.
+ */
+struct APNOperador {
+  const char* operador;
+  const char* apn;
+};
+
+static const APNOperador APN_OPERADORES[] = {
+  { "334020", "internet.itelcel.com" },      // Telcel
+  { "334030", "internet.movistar.com.mx" },  // Movistar
+  { "334050", "internet.att.com.mx" },       // AT&T (Iusacell)
+  { "334070", "internet.att.com.mx" },       // AT&T (Unefon)
+  { "334090", "internet.att.com.mx" },       // AT&T (Nextel)
+};
+
+static_assert(sizeof(APN_FORZADO) <= APN_LONGITUD_MAX + 1 && sizeof(APN_PREDETERMINADO) <= APN_LONGITUD_MAX + 1,
+              "APN demasiado largo");
+
+GSMModule::GSMModule(CanalAT& canalAT, int pwrPin_, int rxPin_, int txPin_, unsigned long baudRate_)
+  : canal(canalAT), pwrPin(pwrPin_), rxPin(rxPin_), txPin(txPin_), baudRate(baudRate_), senalMedida(false),
+    operadorLeido(false), totalCandidatos(1), candidato(0) {
+  memset(&senal, 0, sizeof(senal));
+  senal.csq = 99;
+  operador[0] = '\0';
+  operadorGuardado[0] = '\0';
+  apnGuardado[0] = '\0';
+  perfilModem[0] = '\0';
+  strcpy(candidatos[0], APN_FORZADO[0] != '\0' ? APN_FORZADO : APN_PREDETERMINADO);
+}
 
 void GSMModule::begin() {
   encenderModulo();
-  gsm.begin(baudRate, SERIAL_8N1, rxPin, txPin);
+  canal.getSerial().begin(baudRate, SERIAL_8N1, rxPin, txPin);
   
-  Serial.println(">> Esperando que el módulo GSM esté listo...");
+  LOG_INFO("Esperando que el módulo GSM esté listo...");
   delay(10000);
   
   verificarComunicacion();
@@ -25,65 +55,175 @@ void GSMModule::encenderModulo() {
 
 bool GSMModule::verificarComunicacion() {
   for (int i = 0; i < 3; i++) {
-    gsm.println("AT");
-    delay(1000);
-    String resp = esperarRespuesta();
-    if (resp.indexOf("OK") != -1) {
-      Serial.println(">> Módulo GSM respondiendo");
+    if (canal.ejecutar(AT_PRUEBA) == AT_OK) {
+      LOG_INFO("Módulo GSM respondiendo");
       return true;
     }
-    delay(2000);
+    canal.pausa(2000);
   }
   return false;
 }
 
-String GSMModule::esperarRespuesta(unsigned long timeout_ms) {
-  String respuesta = "";
-  unsigned long timeout = millis() + timeout_ms;
-  
-  while (millis() < timeout) {
-    while (gsm.available()) {
-      respuesta += (char)gsm.read();
-    }
-    if (respuesta.indexOf("OK") != -1 || respuesta.indexOf("ERROR") != -1) {
-      break;
-    }
-    delay(100);
-  }
-  
-  return respuesta;
-}
-
 bool GSMModule::esperarRegistroRed(int maxIntentos) {
-  Serial.println(">> Verificando registro en la red...");
+  LOG_DEPURACION("Verificando registro en la red...");
   
   for (int intento = 1; intento <= maxIntentos; intento++) {
-    gsm.println("AT+CREG?");
-    delay(1000);
-    String regResp = esperarRespuesta();
-    Serial.println(">> CREG: " + regResp);
+    canal.ejecutar(AT_CREG);
+    const String& regResp = canal.respuesta();
+    LOG_DEPURACION("CREG: %s", regResp.c_str());
     
     if (regResp.indexOf(",1") != -1 || regResp.indexOf(",5") != -1) {
-      Serial.println(">> ✓ Módulo registrado en la red");
+      LOG_INFO("✓ Módulo registrado en la red");
       return true;
     }
     
-    Serial.print(">> Esperando registro en la red... Intento ");
-    Serial.print(intento);
-    Serial.print(" de ");
-    Serial.println(maxIntentos);
-    delay(2000);
+    LOG_INFO("Esperando registro en la red... Intento %d de %d", intento, maxIntentos);
+    canal.pausa(2000);
   }
   
-  Serial.println(">> ✗ ADVERTENCIA: No se pudo registrar en la red");
+  LOG_AVISO("✗ No se pudo registrar en la red");
   return false;
 }
 
+bool GSMModule::estaRegistrado() {
+  canal.ejecutar(AT_CREG);
+  const char* r = canal.respuesta().c_str();
+  return strstr(r, ",1") != NULL || strstr(r, ",5") != NULL;
+}
+
 void GSMModule::verificarCalidadSenal() {
-  gsm.println("AT+CSQ");
-  delay(500);
-  String csq = esperarRespuesta();
-  Serial.println(">> Calidad de señal: " + csq);
+  senalMedida = false;
+  medirSenal();
+  if (senal.lte) {
+    LOG_INFO("Calidad de señal: CSQ %d, LTE RSRP %d dBm, RSRQ %d dB, SINR %d dB (%s)", senal.csq, senal.rsrp,
+             senal.rsrq, senal.sinr, nombreEnlace(senal.nivel));
+  } else {
+    LOG_INFO("Calidad de señal: CSQ %d (%s)", senal.csq, nombreEnlace(senal.nivel));
+  }
+}
+
+const CalidadSenal& GSMModule::medirSenal() {
+  if (senalMedida && millis() - senal.instante < SENAL_VALIDEZ_MS) {
+    return senal;
+  }
+
+  NivelEnlace anterior = senal.nivel;
+  memset(&senal, 0, sizeof(senal));
+  senal.csq = 99;
+  if (canal.ejecutar(AT_CSQ) == AT_OK) {
+    parsearCSQ(canal.respuesta().c_str(), senal);
+  }
+  if (canal.ejecutar(AT_CPSI) == AT_OK) {
+    parsearCPSI(canal.respuesta().c_str(), senal);
+  }
+  senal.nivel = clasificarEnlace(senal);
+  senal.instante = millis();
+  senalMedida = true;
+
+  if (senal.nivel != anterior) {
+    if (senal.lte) {
+      LOG_INFO("Enlace %s (CSQ %d, RSRP %d dBm, SINR %d dB)", nombreEnlace(senal.nivel), senal.csq, senal.rsrp,
+               senal.sinr);
+    } else {
+      LOG_INFO("Enlace %s (CSQ %d)", nombreEnlace(senal.nivel), senal.csq);
+    }
+  }
+  return senal;
+}
+
+bool GSMModule::parsearCSQ(const char* respuesta, CalidadSenal& destino) {
+  // +CSQ: <rssi>,<ber>
+  const char* p = strstr(respuesta, "+CSQ:");
+  if (p == NULL) {
+    return false;
+  }
+  char* fin;
+  long csq = strtol(p + 5, &fin, 10);
+  if (fin == p + 5 || csq < 0 || (csq > 31 && csq != 99)) {
+    return false;
+  }
+  destino.csq = (int)csq;
+  destino.rssi = csq == 99 ? 0 : -113 + 2 * (int)csq;
+  return true;
+}
+
+bool GSMModule::parsearCPSI(const char* respuesta, CalidadSenal& destino) {
+  // +CPSI: LTE,Online,<MCC>-<MNC>,<TAC>,<SCellID>,<PCellID>,<banda>,<earfcn>,<dlbw>,<ulbw>,<RSRQ>,<RSRP>,<RSSI>,<RSSNR>
+  const char* p = strstr(respuesta, "+CPSI:");
+  if (p == NULL) {
+    return false;
+  }
+  p += 6;
+  while (*p == ' ') p++;
+  if (strncmp(p, "NO SERVICE", 10) == 0) {
+    destino.sinServicio = true;
+    return true;
+  }
+  if (strncmp(p, "LTE", 3) != 0) {
+    return true;  // GSM/WCDMA: solo cuenta el CSQ
+  }
+
+  long valores[4];
+  int campo = 0;
+  for (const char* c = p; *c != '\0' && *c != '\r' && *c != '\n'; c++) {
+    if (*c != ',') {
+      continue;
+    }
+    campo++;
+    if (campo >= 10 && campo <= 13) {
+      char* fin;
+      valores[campo - 10] = strtol(c + 1, &fin, 10);
+      if (fin == c + 1) {
+        return false;
+      }
+    }
+  }
+  if (campo < 13) {
+    return false;
+  }
+
+  // Según la versión del firmware RSRQ y RSRP vienen en décimas
+  long rsrq = valores[0];
+  long rsrp = valores[1];
+  if (rsrq < -30) rsrq /= 10;
+  if (rsrp < -200) rsrp /= 10;
+  destino.lte = true;
+  destino.rsrq = (int)rsrq;
+  destino.rsrp = (int)rsrp;
+  destino.sinr = (int)valores[3];
+  return true;
+}
+
+NivelEnlace GSMModule::clasificarEnlace(const CalidadSenal& s) {
+  if (s.sinServicio) {
+    return ENLACE_SIN_SERVICIO;
+  }
+  if (s.lte) {
+    if (s.rsrp < SENAL_RSRP_MALO || s.sinr < SENAL_SINR_MALO) {
+      return ENLACE_MALO;
+    }
+    if (s.rsrp >= SENAL_RSRP_BUENO && s.sinr >= SENAL_SINR_BUENO) {
+      return ENLACE_BUENO;
+    }
+    return ENLACE_REGULAR;
+  }
+  if (s.csq == 99) {
+    return ENLACE_DESCONOCIDO;
+  }
+  if (s.csq < SENAL_CSQ_MALO) {
+    return ENLACE_MALO;
+  }
+  return s.csq >= SENAL_CSQ_BUENO ? ENLACE_BUENO : ENLACE_REGULAR;
+}
+
+const char* GSMModule::nombreEnlace(NivelEnlace n) {
+  switch (n) {
+    case ENLACE_SIN_SERVICIO: return "sin servicio";
+    case ENLACE_MALO:         return "malo";
+    case ENLACE_REGULAR:      return "regular";
+    case ENLACE_BUENO:        return "bueno";
+    default:                  return "desconocido";
+  }
 }
 
 bool GSMModule::necesitaSincronizarReloj(const String& reloj) {
@@ -93,150 +233,326 @@ bool GSMModule::necesitaSincronizarReloj(const String& reloj) {
           reloj.indexOf("00/") != -1);
 }
 
+bool GSMModule::relojConFecha() {
+  return canal.ejecutar(AT_CCLK) == AT_OK && !necesitaSincronizarReloj(canal.respuesta());
+}
+
+bool GSMModule::fijarReloj(uint32_t utc) {
+  time_t segundos = (time_t)utc;
+  struct tm t;
+  gmtime_r(&segundos, &t);
+  char fecha[24];
+  snprintf(fecha, sizeof(fecha), "%02u/%02u/%02u,%02u:%02u:%02u+00", (unsigned)(t.tm_year % 100) % 100,
+           (unsigned)(t.tm_mon + 1) % 100, (unsigned)t.tm_mday % 100, (unsigned)t.tm_hour % 100,
+           (unsigned)t.tm_min % 100, (unsigned)t.tm_sec % 100);
+  return canal.ejecutar(AT_CCLK_FIJAR, fecha) == AT_OK;
+}
+
 bool GSMModule::verificarYSincronizarReloj() {
-  Serial.println(">> Verificando fecha/hora del módulo...");
-  gsm.println("AT+CCLK?");
-  delay(500);
-  String reloj = esperarRespuesta();
-  Serial.println(">> Fecha/Hora: " + reloj);
+  LOG_DEPURACION("Verificando fecha/hora del módulo...");
+  canal.ejecutar(AT_CCLK);
+  String reloj = canal.respuesta();
+  LOG_DEPURACION("Fecha/Hora: %s", reloj.c_str());
   
   if (!necesitaSincronizarReloj(reloj)) {
-    Serial.println(">> ✓ Reloj con fecha válida");
+    LOG_INFO("✓ Reloj con fecha válida");
     return true;
   }
   
-  Serial.println(">> Sincronizando fecha/hora con la red (requiere reinicio)...");
+  LOG_AVISO("Sincronizando fecha/hora con la red (requiere reinicio)...");
   
-  gsm.println("AT+CTZU=1");
-  delay(500);
-  esperarRespuesta();
+  canal.ejecutar(AT_CTZU);
+  canal.ejecutar(AT_CLTS);
   
-  gsm.println("AT+CLTS=1");
-  delay(500);
-  esperarRespuesta();
+  LOG_INFO("Guardando configuración (AT&W) y reiniciando (AT+CFUN=1,1)...");
   
-  Serial.println(">> Guardando configuración (AT&W) y reiniciando (AT+CFUN=1,1)...");
+  canal.ejecutar(AT_GUARDAR_PERFIL);
+  canal.ejecutar(AT_CFUN_REINICIO);
   
-  gsm.println("AT&W");
-  delay(1000);
-  esperarRespuesta();
-  
-  gsm.println("AT+CFUN=1,1");
-  
-  Serial.println(">> Módulo reiniciando. Esperando 25 segundos...");
+  LOG_INFO("Módulo reiniciando. Esperando 25 segundos...");
   delay(25000);
   
   // Volver a verificar registro
-  Serial.println(">> Verificando registro en la red (Post-Reinicio)...");
+  LOG_INFO("Verificando registro en la red (Post-Reinicio)...");
   bool registrado = esperarRegistroRed(NETWORK_REGISTER_TIMEOUT);
   
   // Verificar la hora otra vez
-  gsm.println("AT+CCLK?");
-  delay(500);
-  reloj = esperarRespuesta();
-  Serial.println(">> Nueva Fecha/Hora (Post-Reinicio): " + reloj);
+  canal.ejecutar(AT_CCLK);
+  reloj = canal.respuesta();
+  LOG_INFO("Nueva Fecha/Hora (Post-Reinicio): %s", reloj.c_str());
   
   if (necesitaSincronizarReloj(reloj)) {
-    Serial.println(">> ✗ ADVERTENCIA: El reloj sigue incorrecto. SSL fallará.");
+    LOG_ERROR("✗ ADVERTENCIA: El reloj sigue incorrecto. SSL fallará.");
     return false;
   } else {
-    Serial.println(">> ✓ Reloj sincronizado correctamente.");
+    LOG_INFO("✓ Reloj sincronizado correctamente.");
     return true;
   }
 }
 
 bool GSMModule::estaContextoPDPActivo() {
-  gsm.println("AT+CGACT?");
-  delay(1000);
-  String cgactCheck = esperarRespuesta();
-  return (cgactCheck.indexOf("+CGACT: 1,1") != -1);
+  canal.ejecutar(AT_CGACT_CONSULTA);
+  return strstr(canal.respuesta().c_str(), "+CGACT: 1,1") != NULL;
+}
+
+bool GSMModule::desactivarContextoPDP() {
+  LOG_INFO("Desactivando contexto PDP...");
+  return canal.ejecutar(AT_CGACT_DESACTIVAR) == AT_OK;
+}
+
+bool GSMModule::parsearIMSI(const char* respuesta, char* destino) {
+  // La IMSI es una línea de 6 a 15 dígitos sin prefijo: MCC (3) + MNC (2 o 3) + abonado
+  const char* linea = respuesta;
+  while (*linea != '\0') {
+    size_t digitos = 0;
+    while (linea[digitos] >= '0' && linea[digitos] <= '9') {
+      digitos++;
+    }
+    char fin = linea[digitos];
+    if (digitos >= OPERADOR_LONGITUD && digitos <= 15 && (fin == '\r' || fin == '\n' || fin == '\0')) {
+      // Con MNC de 2 dígitos el sexto es del abonado: solo hace la clave de la caché más estricta
+      memcpy(destino, linea, OPERADOR_LONGITUD);
+      destino[OPERADOR_LONGITUD] = '\0';
+      return true;
+    }
+    const char* siguiente = strchr(linea, '\n');
+    if (siguiente == NULL) {
+      break;
+    }
+    linea = siguiente + 1;
+  }
+  return false;
+}
+
+bool GSMModule::parsearCOPS(const char* respuesta, char* destino) {
+  // +COPS: <modo>,2,"<MCC><MNC>",<tecnología>
+  const char* p = strstr(respuesta, "+COPS:");
+  if (p == NULL || (p = strchr(p, '"')) == NULL) {
+    return false;
+  }
+  p++;
+  size_t digitos = 0;
+  while (p[digitos] >= '0' && p[digitos] <= '9') {
+    digitos++;
+  }
+  if (p[digitos] != '"' || digitos < 5 || digitos > OPERADOR_LONGITUD) {
+    return false;  // Formato alfanumérico
+  }
+  memcpy(destino, p, digitos);
+  destino[digitos] = '\0';
+  return true;
+}
+
+bool GSMModule::parsearCGDCONT(const char* respuesta, char* apn, size_t capacidad) {
+  // +CGDCONT: 1,"IP","<apn>","0.0.0.0",0,0 (una línea por contexto)
+  const char* p = strstr(respuesta, "+CGDCONT: 1,");
+  if (p == NULL) {
+    return false;
+  }
+  p = strchr(p + 12, ',');  // Tras el tipo de PDP
+  if (p == NULL || p[1] != '"') {
+    return false;
+  }
+  p += 2;
+  const char* fin = strchr(p, '"');
+  if (fin == NULL || (size_t)(fin - p) >= capacidad) {
+    return false;
+  }
+  memcpy(apn, p, fin - p);
+  apn[fin - p] = '\0';
+  return true;
+}
+
+const char* GSMModule::apnDeOperador(const char* operadorSIM) {
+  for (size_t i = 0; i < sizeof(APN_OPERADORES) / sizeof(APN_OPERADORES[0]); i++) {
+    const char* prefijo = APN_OPERADORES[i].operador;
+    if (strncmp(operadorSIM, prefijo, strlen(prefijo)) == 0) {
+      return APN_OPERADORES[i].apn;
+    }
+  }
+  return NULL;
+}
+
+void GSMModule::agregarCandidato(const char* apn) {
+  if (apn == NULL || apn[0] == '\0' || totalCandidatos == APN_CANDIDATOS) {
+    return;
+  }
+  for (int i = 0; i < totalCandidatos; i++) {
+    if (strcmp(candidatos[i], apn) == 0) {
+      return;
+    }
+  }
+  strncpy(candidatos[totalCandidatos], apn, APN_LONGITUD_MAX);
+  candidatos[totalCandidatos][APN_LONGITUD_MAX] = '\0';
+  totalCandidatos++;
+}
+
+void GSMModule::detectarOperador() {
+  operadorLeido = true;
+  operador[0] = '\0';
+  if (canal.ejecutar(AT_CIMI) != AT_OK || !parsearIMSI(canal.respuesta().c_str(), operador)) {
+    // Sin IMSI (SIM lenta en responder): el operador de la red en la que está registrado
+    canal.ejecutar(AT_COPS_NUMERICO);
+    if (canal.ejecutar(AT_COPS_CONSULTA) != AT_OK || !parsearCOPS(canal.respuesta().c_str(), operador)) {
+      operador[0] = '\0';
+    }
+  }
+
+  preferences.begin("apn", true);
+  preferences.getString("operador", operadorGuardado, sizeof(operadorGuardado));
+  preferences.getString("apn", apnGuardado, sizeof(apnGuardado));
+  preferences.end();
+
+  totalCandidatos = 0;
+  candidato = 0;
+  if (APN_FORZADO[0] != '\0') {
+    agregarCandidato(APN_FORZADO);
+  } else {
+    if (strcmp(operadorGuardado, operador) == 0) {
+      agregarCandidato(apnGuardado);
+    }
+    agregarCandidato(apnDeOperador(operador));
+    agregarCandidato(APN_PREDETERMINADO);
+  }
+
+  LOG_INFO("Operador %s: APN %s%s", operador[0] != '\0' ? operador : "desconocido", candidatos[0],
+           strcmp(candidatos[0], apnGuardado) == 0 ? " (guardado)" : "");
+}
+
+bool GSMModule::perfilCoincide(const char* apn) {
+  if (strcmp(perfilModem, apn) == 0) {
+    return true;
+  }
+  if (canal.ejecutar(AT_CGDCONT_CONSULTA) != AT_OK ||
+      !parsearCGDCONT(canal.respuesta().c_str(), perfilModem, sizeof(perfilModem))) {
+    perfilModem[0] = '\0';
+    return false;
+  }
+  return strcmp(perfilModem, apn) == 0;
+}
+
+void GSMModule::siguienteAPN() {
+  if (totalCandidatos < 2) {
+    return;
+  }
+  const char* fallido = candidatos[candidato];
+  candidato = (candidato + 1) % totalCandidatos;
+  LOG_AVISO("✗ Sin datos con el APN %s: el próximo intento usará %s", fallido, candidatos[candidato]);
+}
+
+void GSMModule::recordarAPN() {
+  const char* apn = candidatos[candidato];
+  if (strcmp(apnGuardado, apn) == 0 && strcmp(operadorGuardado, operador) == 0) {
+    return;  // Sin escrituras en NVS en cada reconexión
+  }
+  strcpy(apnGuardado, apn);
+  strcpy(operadorGuardado, operador);
+  preferences.begin("apn", false);
+  preferences.putString("operador", operadorGuardado);
+  preferences.putString("apn", apnGuardado);
+  preferences.end();
+  LOG_INFO("✓ APN %s guardado para el operador %s", apnGuardado, operador[0] != '\0' ? operador : "desconocido");
 }
 
 bool GSMModule::verificarConexionGPRS() {
-  Serial.println(">> Verificando conexión GPRS...");
+  LOG_DEPURACION("Verificando conexión GPRS...");
   
   verificarCalidadSenal();
   
-  gsm.println("AT+CREG?");
-  delay(1000);
-  String regResp = esperarRespuesta();
-  Serial.println(">> Estado de registro: " + regResp);
+  canal.ejecutar(AT_CREG);
+  LOG_DEPURACION("Estado de registro: %s", canal.respuesta().c_str());
   
-  gsm.println("AT+CGACT?");
-  delay(1000);
-  String cgactCheck = esperarRespuesta();
-  Serial.println(">> Estado actual PDP: " + cgactCheck);
+  canal.ejecutar(AT_CGACT_CONSULTA);
+  LOG_DEPURACION("Estado actual PDP: %s", canal.respuesta().c_str());
   
-  if (cgactCheck.indexOf("+CGACT: 1,1") != -1) {
-    Serial.println(">> ✓ Contexto PDP ya está activo");
+  if (canal.respuesta().indexOf("+CGACT: 1,1") != -1) {
+    LOG_DEPURACION("✓ Contexto PDP ya está activo");
     return true;
   }
   
-  Serial.println(">> Configurando APN Telcel...");
-  gsm.print("AT+CGDCONT=1,\"IP\",\"");
-  gsm.print(APN_TELCEL);
-  gsm.println("\"");
-  delay(1000);
-  String cgdcontResp = esperarRespuesta();
-  Serial.println(">> Configuración APN: " + cgdcontResp);
+  if (!operadorLeido) {
+    detectarOperador();
+  }
+  const char* apn = candidatos[candidato];
+  if (perfilCoincide(apn)) {
+    LOG_DEPURACION("Contexto 1 ya configurado con %s", apn);
+  } else {
+    LOG_INFO("Configurando APN %s...", apn);
+    if (canal.ejecutar(AT_CGDCONT, apn) == AT_OK) {
+      strcpy(perfilModem, apn);
+    } else {
+      perfilModem[0] = '\0';
+    }
+    LOG_DEPURACION("Configuración APN: %s", canal.respuesta().c_str());
+  }
   
-  Serial.println(">> Activando contexto PDP...");
-  gsm.println("AT+CGACT=1,1");
-  delay(5000);
-  String actResp = esperarRespuesta();
+  LOG_INFO("Activando contexto PDP...");
+  ResultadoAT activacion = canal.ejecutar(AT_CGACT_ACTIVAR);
   
-  Serial.println(">> Respuesta activación: " + actResp);
+  LOG_DEPURACION("Respuesta activación: %s", canal.respuesta().c_str());
   
-  if (actResp.indexOf("ERROR") != -1) {
-    Serial.println(">> Error en activación, verificando estado...");
-    gsm.println("AT+CGACT?");
-    delay(1000);
-    String stateResp = esperarRespuesta();
+  if (activacion != AT_OK) {
+    LOG_AVISO("Error en activación, verificando estado...");
+    canal.ejecutar(AT_CGACT_CONSULTA);
     
-    if (stateResp.indexOf("+CGACT: 1,1") != -1) {
-      Serial.println(">> Contexto PDP ya estaba activo");
+    if (canal.respuesta().indexOf("+CGACT: 1,1") != -1) {
+      LOG_INFO("Contexto PDP ya estaba activo");
     } else {
-      Serial.println(">> ✗ Error: No se pudo activar contexto PDP");
+      LOG_ERROR("✗ Error: No se pudo activar contexto PDP");
+      siguienteAPN();
       return false;
     }
   }
   
-  delay(2000);
-  gsm.println("AT+CGPADDR=1");
-  delay(1000);
-  String ipResp = esperarRespuesta();
-  Serial.println(">> Dirección IP asignada: " + ipResp);
+  canal.pausa(2000);
+  canal.ejecutar(AT_CGPADDR);
+  const String& ipResp = canal.respuesta();
+  LOG_INFO("Dirección IP asignada: %s", ipResp.c_str());
   
   if (ipResp.indexOf("ERROR") != -1 || ipResp.indexOf("0.0.0.0") != -1) {
-    Serial.println(">> ✗ Error: No se obtuvo dirección IP válida");
+    LOG_ERROR("✗ Error: No se obtuvo dirección IP válida");
+    siguienteAPN();
     return false;
   }
   
-  Serial.println(">> ✓ GPRS conectado y listo");
+  recordarAPN();
+  LOG_INFO("✓ GPRS conectado y listo");
   return true;
 }
 
 void GSMModule::reiniciarModulo() {
-  Serial.println(">> Reiniciando módulo A7670SA completamente...");
+  LOG_AVISO("Reiniciando módulo A7670SA completamente...");
   
   // Apagar módulo con pulso en PWR_PIN
   digitalWrite(pwrPin, HIGH);
   delay(3000);  // Mantener presionado 3 segundos para apagado
   digitalWrite(pwrPin, LOW);
   
-  Serial.println(">> Módulo apagado. Esperando 5 segundos...");
+  LOG_INFO("Módulo apagado. Esperando 5 segundos...");
   delay(5000);
   
   // Encender módulo nuevamente
   encenderModulo();
+  perfilModem[0] = '\0';  // Volver a leer el contexto 1
   
-  Serial.println(">> Esperando que el módulo se inicialice...");
+  LOG_INFO("Esperando que el módulo se inicialice...");
   delay(10000);
   
   // Verificar comunicación
   if (verificarComunicacion()) {
-    Serial.println(">> ✓ Módulo reiniciado correctamente");
+    LOG_INFO("✓ Módulo reiniciado correctamente");
   } else {
-    Serial.println(">> ✗ Advertencia: Módulo no responde después del reinicio");
+    LOG_ERROR("✗ Advertencia: Módulo no responde después del reinicio");
+  }
+}
+
+bool GSMModule::ciclarRadio() {
+  LOG_AVISO("Ciclando radio (AT+CFUN=0 / AT+CFUN=1)...");
+  canal.ejecutar(AT_CFUN_MINIMA);
+  canal.pausa(RED_PAUSA_RADIO_MS);
+  if (canal.ejecutar(AT_CFUN_COMPLETA) != AT_OK) {
+    LOG_ERROR("✗ El módulo no reactivó el radio");
+    return false;
   }
+  return esperarRegistroRed(NETWORK_REGISTER_TIMEOUT);
 }
@@ -2,43 +2,120 @@
 #define GSMMODULE_H
 
 #include <Arduino.h>
+#include <Preferences.h>
+#include "CanalAT.h"
+
+#define APN_LONGITUD_MAX 63
+#define OPERADOR_LONGITUD 6   // MCC + MNC de 3 dígitos
+#define APN_CANDIDATOS 3      // Guardado, tabla, predeterminado
+
+/**
+ * Calidad del enlace para decidir si vale la pena abrir una sesión
+ */
+enum NivelEnlace {
+  ENLACE_DESCONOCIDO,  // Sin medición válida: no se retiene nada
+  ENLACE_SIN_SERVICIO,
+  ENLACE_MALO,         // Alta probabilidad de 714/715 o timeout
+  ENLACE_REGULAR,
+  ENLACE_BUENO
+};
+
+/**
+ * Última medición de señal (AT+CSQ y, en LTE, AT+CPSI?)
+ */
+struct CalidadSenal {
+  int csq;             // 0-31, 99 = desconocido
+  int rssi;            // dBm derivado del CSQ (0 si se desconoce)
+  bool lte;            // Celda servidora LTE: rsrp/rsrq/sinr válidos
+  int rsrp;            // dBm
+  int rsrq;            // dB
+  int sinr;            // dB
+  bool sinServicio;     // AT+CPSI? respondió NO SERVICE
+  NivelEnlace nivel;
+  unsigned long instante;  // millis() de la medición
+};
 
 /**
  * Clase para manejo del módulo GSM/GPRS
  * Gestiona: inicialización, registro en red, GPRS, sincronización de reloj
+ * Todos los comandos pasan por el CanalAT compartido.
+ *
+ * El APN sale del operador de la SIM, leído una vez por arranque la primera
+ * vez que hay que activar el contexto: primero el último que funcionó con
+ * ese operador (NVS "apn"), luego el de la tabla, luego APN_PREDETERMINADO.
+ * Si el contexto 1 del módem ya tiene ese APN no se reescribe: solo se
+ * activa.
  */
 class GSMModule {
 public:
-  GSMModule(HardwareSerial& serial, int pwrPin, int rxPin, int txPin, unsigned long baudRate);
+  GSMModule(CanalAT& canal, int pwrPin, int rxPin, int txPin, unsigned long baudRate);
   
   // Inicialización
   void begin();
   bool esperarRegistroRed(int maxIntentos = 30);
+  bool estaRegistrado();
   
   // GPRS
   bool verificarConexionGPRS();
   bool estaContextoPDPActivo();
+  bool desactivarContextoPDP();
+  const char* getOperador() const { return operador; }  // "" si no se pudo leer
+  const char* getAPN() const { return candidatos[candidato]; }
+  static bool parsearIMSI(const char* respuesta, char* operador);
+  static bool parsearCOPS(const char* respuesta, char* operador);
+  static bool parsearCGDCONT(const char* respuesta, char* apn, size_t capacidad);
+  static const char* apnDeOperador(const char* operador);  // NULL si no está en la tabla
   
   // Sincronización de hora
   bool verificarYSincronizarReloj();
+  // AT+CCLK? con una fecha válida (NITZ o fijada)
+  bool relojConFecha();
+  // Fija el reloj del módem en UTC (p.ej. con la hora GNSS)
+  bool fijarReloj(uint32_t utc);
   
-  // Utilidades
-  String esperarRespuesta(unsigned long timeout_ms = 5000);
+  // Señal: medirSenal() reutiliza la medición durante SENAL_VALIDEZ_MS
   void verificarCalidadSenal();
+  const CalidadSenal& medirSenal();
+  const CalidadSenal& getSenal() const { return senal; }
+  static bool parsearCSQ(const char* respuesta, CalidadSenal& destino);
+  static bool parsearCPSI(const char* respuesta, CalidadSenal& destino);
+  static NivelEnlace clasificarEnlace(const CalidadSenal& s);
+  static const char* nombreEnlace(NivelEnlace n);
+  
+  // Utilidades
   void reiniciarModulo();
+  bool ciclarRadio();
   
-  HardwareSerial& getSerial() { return gsm; }
+  HardwareSerial& getSerial() { return canal.getSerial(); }
+  CanalAT& getCanal() { return canal; }
 
 private:
-  HardwareSerial& gsm;
+  CanalAT& canal;
   int pwrPin;
   int rxPin;
   int txPin;
   unsigned long baudRate;
+  CalidadSenal senal;
+  bool senalMedida;
+  Preferences preferences;
+
+  bool operadorLeido;
+  char operador[OPERADOR_LONGITUD + 1];
+  char operadorGuardado[OPERADOR_LONGITUD + 1];
+  char apnGuardado[APN_LONGITUD_MAX + 1];
+  char candidatos[APN_CANDIDATOS][APN_LONGITUD_MAX + 1];
+  int totalCandidatos;
+  int candidato;
+  char perfilModem[APN_LONGITUD_MAX + 1];  // APN confirmado en el contexto 1 ("" = sin confirmar)
   
   void encenderModulo();
   bool verificarComunicacion();
   bool necesitaSincronizarReloj(const String& reloj);
+  void detectarOperador();
+  void agregarCandidato(const char* apn);
+  bool perfilCoincide(const char* apn);
+  void siguienteAPN();
+  void recordarAPN();
 };
 
 #endif // GSMMODULE_H
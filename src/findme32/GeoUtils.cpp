@@ -19,3 +19,37 @@ double calcularDistancia(double lat1, double lon1, double lat2, double lon2) {
   
   return EARTH_RADIUS_METERS * c;
 }
+
+static const char ALFABETO_POLILINEA[] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+int32_t aUnidadesPolilinea(double grados) {
+  return (int32_t)lround(grados * 1e5);
+}
+
+// Zigzag: el signo pasa al bit menos significativo
+static uint32_t zigzag(int32_t valor) {
+  return valor < 0 ? ~((uint32_t)valor << 1) : (uint32_t)valor << 1;
+}
+
+size_t largoPolilinea(int32_t valor) {
+  uint32_t v = zigzag(valor);
+  size_t n = 1;
+  while (v >= 0x20) {
+    v >>= 5;
+    n++;
+  }
+  return n;
+}
+
+size_t codificarPolilinea(int32_t valor, char* destino) {
+  uint32_t v = zigzag(valor);
+  size_t n = 0;
+  // Grupos de 5 bits del menos significativo; el bit 0x20 indica que sigue otro
+  while (v >= 0x20) {
+    destino[n++] = ALFABETO_POLILINEA[0x20 | (v & 0x1F)];
+    v >>= 5;
+  }
+  destino[n++] = ALFABETO_POLILINEA[v];
+  return n;
+}
@@ -1,6 +1,9 @@
 #ifndef GEOUTILS_H
 #define GEOUTILS_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 // ============================
 // UTILIDADES GEOGRÁFICAS
 // ============================
@@ -15,4 +18,30 @@
  */
 double calcularDistancia(double lat1, double lon1, double lat2, double lon2);
 
+// ============================
+// POLILÍNEA CODIFICADA
+// ============================
+// Formato de Google (1e-5 grados, diferencias en zigzag de 5 bits por carácter)
+// con el alfabeto base64url en vez de los caracteres 63..126: va en una URL
+// sin escapar y cada carácter ocupa un solo septeto GSM en el SMS.
+
+/**
+ * Convierte grados decimales a unidades de la polilínea (1e-5 grados)
+ */
+int32_t aUnidadesPolilinea(double grados);
+
+/**
+ * Caracteres que ocupa un valor codificado
+ * @param valor Coordenada absoluta o diferencia con el vértice anterior
+ */
+size_t largoPolilinea(int32_t valor);
+
+/**
+ * Escribe un valor codificado, sin '\0'
+ * @param valor Coordenada absoluta o diferencia con el vértice anterior
+ * @param destino Al menos largoPolilinea(valor) caracteres
+ * @return Caracteres escritos
+ */
+size_t codificarPolilinea(int32_t valor, char* destino);
+
 #endif // GEOUTILS_H
@@ -0,0 +1,76 @@
+#include "GrabadorUART.h"
+
+GrabadorUART::GrabadorUART(Print& out)
+  : salida(out), pendienteLen(0), direccionPendiente(0), ultimoRegistro(0) {}
+
+void GrabadorUART::volcar() {
+  if (pendienteLen == 0) {
+    return;
+  }
+
+  // Un espacio final se perdería al editar el archivo: escribirlo escapado
+  if (pendiente[pendienteLen - 1] == ' ') {
+    memcpy(&pendiente[pendienteLen - 1], "\\x20", 4);
+    pendienteLen += 3;
+  }
+
+  unsigned long ahora = millis();
+  char cabecera[16];
+  snprintf(cabecera, sizeof(cabecera), "#T%c%lu ", direccionPendiente, ahora - ultimoRegistro);
+  ultimoRegistro = ahora;
+
+  salida.print(cabecera);
+  salida.write((const uint8_t*)pendiente, pendienteLen);
+  salida.print("\r\n");
+  pendienteLen = 0;
+}
+
+void GrabadorUART::agregar(char direccion, uint8_t c) {
+  if (direccion != direccionPendiente || pendienteLen > GRABADOR_LONGITUD_REGISTRO - 8) {
+    volcar();
+  }
+  direccionPendiente = direccion;
+
+  if (c == '\r') {
+    pendiente[pendienteLen++] = '\\';
+    pendiente[pendienteLen++] = 'r';
+  } else if (c == '\n') {
+    pendiente[pendienteLen++] = '\\';
+    pendiente[pendienteLen++] = 'n';
+  } else if (c == '\\') {
+    pendiente[pendienteLen++] = '\\';
+    pendiente[pendienteLen++] = '\\';
+  } else if (c < 0x20 || c >= 0x7F) {
+    static const char HEX_DIGITOS[] = "0123456789ABCDEF";
+    pendiente[pendienteLen++] = '\\';
+    pendiente[pendienteLen++] = 'x';
+    pendiente[pendienteLen++] = HEX_DIGITOS[c >> 4];
+    pendiente[pendienteLen++] = HEX_DIGITOS[c & 0x0F];
+  } else {
+    pendiente[pendienteLen++] = (char)c;
+  }
+}
+
+void GrabadorUART::enviado(const char* datos) {
+  while (*datos) {
+    char c = *datos++;
+    agregar('>', (uint8_t)c);
+    if (c == '\n') {
+      volcar();
+    }
+  }
+}
+
+void GrabadorUART::enviado(uint8_t byte) {
+  agregar('>', byte);
+  if (byte == 26 || byte == 27) {
+    volcar();  // Ctrl+Z / ESC cierran el cuerpo de un SMS
+  }
+}
+
+void GrabadorUART::recibido(char c) {
+  agregar('<', (uint8_t)c);
+  if (c == '\n' || (pendienteLen == 1 && c == '>')) {
+    volcar();
+  }
+}
@@ -0,0 +1,42 @@
+#ifndef GRABADORUART_H
+#define GRABADORUART_H
+
+#include <Arduino.h>
+
+#define GRABADOR_LONGITUD_REGISTRO 128
+
+/**
+ * Grabador de la transcripción del UART del módem.
+ *
+ * Emite por el puerto de depuración un registro por línea, fácil de filtrar
+ * del monitor serie con grep '^#T':
+ *
+ *   #T<dir><delta_ms> <datos escapados>
+ *
+ * dir es '>' (ESP32 -> módem) o '<' (módem -> ESP32) y delta_ms el tiempo
+ * desde el registro anterior. En los datos, \r, \n, '\' y los bytes no
+ * imprimibles se escriben como \r, \n, \\ y \xHH. Los datos recibidos se
+ * agrupan hasta fin de línea, así el prompt '>' de AT+CMGS queda en su
+ * propio registro. test/ reproduce estas transcripciones con los módulos
+ * reales (ver test/README).
+ */
+class GrabadorUART {
+public:
+  GrabadorUART(Print& salida);
+
+  void enviado(const char* datos);
+  void enviado(uint8_t byte);
+  void recibido(char c);
+  void volcar();
+
+private:
+  Print& salida;
+  char pendiente[GRABADOR_LONGITUD_REGISTRO];
+  int pendienteLen;
+  char direccionPendiente;
+  unsigned long ultimoRegistro;
+
+  void agregar(char direccion, uint8_t c);
+};
+
+#endif // GRABADORUART_H
@@ -1,256 +1,581 @@
 #include "HTTPClient.h"
 #include "config.h"
+#include "CacheDNS.h"
+#include "RegistroViajes.h"
+#include <math.h>
 
-HTTPClient::HTTPClient(GSMModule& gsmModule) : gsm(gsmModule) {}
+HTTPClient::HTTPClient(GSMModule& gsmModule, ControlSalidas& controlSalidas)
+  : gsm(gsmModule), canal(gsmModule.getCanal()), salidas(controlSalidas), resultado(ENVIO_OK), ack(0), enLote(0),
+    enViaje(0), capturaPedida(false), bitacoraPedida(false), rolPedido(ROL_NINGUNO), codigoHTTP(0), dns(NULL),
+    viajes(NULL), urlPorIP(false), tls(canal) {
+  url[0] = '\0';
+  otaPedida[0] = '\0';
+  altaPedida[0] = '\0';
+  bajaPedida[0] = '\0';
+  consumo.subida = 0;
+  consumo.bajada = 0;
+  respuestaURC.reserve(CANAL_LONGITUD_URC);
+}
 
-String HTTPClient::esperarRespuesta(unsigned long timeout_ms) {
-  String respuesta = "";
-  unsigned long timeout = millis() + timeout_ms;
-  HardwareSerial& gsmSerial = gsm.getSerial();
-  
-  while (millis() < timeout) {
-    while (gsmSerial.available()) {
-      respuesta += (char)gsmSerial.read();
-    }
-    if (respuesta.indexOf("OK") != -1 || respuesta.indexOf("ERROR") != -1) {
-      break;
-    }
-    delay(100);
+const char* HTTPClient::nombreResultado(ResultadoEnvio r) {
+  switch (r) {
+    case ENVIO_OK:             return "ok";
+    case ENVIO_SIN_REGISTRO:   return "sin registro";
+    case ENVIO_SIN_PDP:        return "sin PDP";
+    case ENVIO_DNS:            return "DNS (703)";
+    case ENVIO_TLS:            return "TLS (715)";
+    case ENVIO_TIMEOUT_HTTP:   return "timeout HTTP (714)";
+    case ENVIO_ERROR_MODEM:    return "error del módem";
+    case ENVIO_ERROR_SERVIDOR: return "error del servidor";
+    case ENVIO_ERROR_CONFIG:   return "configuración";
+    default:                   return "?";
   }
-  
-  return respuesta;
 }
 
 bool HTTPClient::inicializarHTTP() {
-  Serial.println(">> Inicializando HTTPS...");
-  HardwareSerial& gsmSerial = gsm.getSerial();
-  
-  gsmSerial.println("AT+HTTPTERM");
-  delay(500);
+  LOG_DEPURACION("Inicializando HTTPS...");
   
-  gsmSerial.println("AT+HTTPINIT");
-  delay(1000);
-  String resp = esperarRespuesta();
+  canal.ejecutar(AT_HTTPTERM);
   
-  if (resp.indexOf("OK") == -1) {
-    Serial.println(">> Error al inicializar HTTP");
+  // Certificado y contexto SSL: solo la primera vez tras encender el módem
+  if (!tls.preparar()) {
     return false;
   }
   
-  gsmSerial.println("AT+HTTPPARA=\"CID\",1");
-  delay(500);
-  esperarRespuesta();
+  if (canal.ejecutar(AT_HTTPINIT) != AT_OK) {
+    LOG_ERROR("✗ Error al inicializar HTTP");
+    return false;
+  }
   
-  Serial.println(">> Habilitando SSL/TLS...");
-  gsmSerial.println("AT+HTTPSSL=1");
-  delay(500);
-  esperarRespuesta();
+  canal.ejecutar(AT_HTTPPARA_CID);
   
-  Serial.println(">> Configurando validación SSL...");
-  gsmSerial.println("AT+CSSLCFG=\"sslversion\",0,3"); // TLS 1.2
-  delay(500);
-  esperarRespuesta();
+  canal.ejecutar(AT_HTTPSSL);
   
-  gsmSerial.println("AT+CSSLCFG=\"authmode\",0,0");
-  delay(500);
-  esperarRespuesta();
+  return true;
+}
 
-  Serial.println(">> Habilitando SNI (Server Name Indication)...");
-  gsmSerial.println("AT+CSSLCFG=\"enableSNI\",0,1");
-  delay(500);
-  esperarRespuesta();
+const char* HTTPClient::servidor() {
+  urlPorIP = dns != NULL && dns->porIP();
+  return urlPorIP ? dns->servidor() : API_ENDPOINT;
+}
+
+void HTTPClient::fijarURL() {
+  canal.ejecutar(AT_HTTPPARA_URL, url);
+  if (urlPorIP) {
+    canal.ejecutar(AT_HTTPPARA_HOST, API_ENDPOINT);
+  }
+}
+
+bool HTTPClient::construirURL(const ColaReportes& cola, int maxLote) {
+  const Reporte& reporte = cola.masReciente();
+  uint32_t masAntiguo = cola.masAntiguo().secuencia;
+
+  int n = snprintf(url, sizeof(url), "https://%s%s?lat=%.6f&lon=%.6f&token=%s",
+                   servidor(), API_PATH, reporte.lat, reporte.lon, DEVICE_TOKEN);
   
+  // Agregar velocidad si está disponible (speed >= 0)
+  if (reporte.velocidad >= 0.0 && n >= 0 && n < (int)sizeof(url)) {
+    n += snprintf(url + n, sizeof(url) - n, "&speed=%.1f", reporte.velocidad);
+  }
+  // Rumbo solo con el reporte por estima: el servidor extrapola desde este fix
+  if (reporte.rumbo >= 0.0 && n >= 0 && n < (int)sizeof(url)) {
+    n += snprintf(url + n, sizeof(url) - n, "&course=%.1f", reporte.rumbo);
+  }
+  
+  // Secuencia para que el servidor descarte duplicados, e instante GNSS del fix
+  if (n >= 0 && n < (int)sizeof(url)) {
+    n += snprintf(url + n, sizeof(url) - n, "&seq=%lu", (unsigned long)reporte.secuencia);
+  }
+  if (reporte.utc != 0 && n >= 0 && n < (int)sizeof(url)) {
+    n += snprintf(url + n, sizeof(url) - n, "&ts=%lu", (unsigned long)reporte.utc);
+  }
+  if (n >= 0 && n < (int)sizeof(url)) {
+    n += snprintf(url + n, sizeof(url) - n, "&oldest=%lu", (unsigned long)masAntiguo);
+  }
+  
+  if (n < 0 || n >= (int)sizeof(url)) {
+    LOG_ERROR("✗ URL demasiado larga para HTTP_LONGITUD_URL");
+    resultado = ENVIO_ERROR_CONFIG;
+    return false;
+  }
+  
+  // Eventos de viaje pendientes, del más antiguo al más nuevo: tienen prioridad sobre el lote
+  enViaje = 0;
+  for (int i = 0; viajes != NULL && i < viajes->eventosPendientes(); i++) {
+    char evento[VIAJES_LARGO_EVENTO];
+    RegistroViajes::formatearEvento(viajes->evento(i), evento, sizeof(evento));
+    int m = snprintf(url + n, sizeof(url) - n, "%s%s", enViaje == 0 ? "&viaje=" : "_", evento);
+    if (m < 0 || n + m >= (int)sizeof(url)) {
+      url[n] = '\0';  // Los que no caben van en el próximo reporte
+      break;
+    }
+    n += m;
+    enViaje++;
+  }
+
+  // Lote: pendientes del más antiguo al más nuevo, relativos al fix principal.
+  // Cada uno "dseq,dlat,dlon,dts" (grados x1e6, segundos), separados por '_'
+  enLote = 0;
+  for (int i = 0; i < cola.pendientes() - 1 && enLote < maxLote; i++) {
+    const Reporte& r = cola.en(i);
+    long dlat = lround((r.lat - reporte.lat) * 1e6);
+    long dlon = lround((r.lon - reporte.lon) * 1e6);
+    long dts = (r.utc != 0 && reporte.utc != 0) ? (long)(reporte.utc - r.utc) : 0;
+    int m = snprintf(url + n, sizeof(url) - n, "%s%lu,%ld,%ld,%ld", enLote == 0 ? "&lote=" : "_",
+                     (unsigned long)(reporte.secuencia - r.secuencia), dlat, dlon, dts);
+    if (m < 0 || n + m >= (int)sizeof(url)) {
+      url[n] = '\0';  // No cabe: este y los siguientes esperan al próximo envío
+      break;
+    }
+    n += m;
+    enLote++;
+  }
   return true;
 }
 
-bool HTTPClient::parsearRespuestaHTTP(const String& respuesta, bool& isActive) {
-  int httpActionPos = respuesta.indexOf("+HTTPACTION:");
-  if (httpActionPos == -1) {
+void HTTPClient::estimarConsumo(int statusCode, int dataLen) {
+  // Sin código el handshake no terminó: se cuenta el intento de conexión
+  uint32_t solicitud = DATOS_BYTES_CABECERAS_SUBIDA + strlen(url);
+  switch (statusCode) {
+    case 0:
+    case 714:
+      consumo.subida = DATOS_BYTES_TCP + DATOS_BYTES_TLS_SUBIDA + solicitud;
+      consumo.bajada = DATOS_BYTES_TCP + DATOS_BYTES_TLS_BAJADA;
+      break;
+    case 703:
+      consumo.subida = DATOS_BYTES_TCP / 4;  // Solo la consulta DNS
+      consumo.bajada = DATOS_BYTES_TCP / 4;
+      break;
+    case 715:
+      consumo.subida = DATOS_BYTES_TCP + DATOS_BYTES_TLS_SUBIDA;
+      consumo.bajada = DATOS_BYTES_TCP + DATOS_BYTES_TLS_BAJADA;
+      break;
+    default:
+      consumo.subida = DATOS_BYTES_TCP + DATOS_BYTES_TLS_SUBIDA + solicitud;
+      consumo.bajada = DATOS_BYTES_TCP + DATOS_BYTES_TLS_BAJADA + DATOS_BYTES_CABECERAS_BAJADA + dataLen;
+      break;
+  }
+}
+
+// Valor entre comillas de 'clave' (con su '"' de apertura) en 'destino'; false si falta o no cabe
+static bool copiarTexto(const char* contenido, const char* clave, char* destino, size_t n) {
+  const char* pos = strstr(contenido, clave);
+  if (pos == NULL) {
+    return false;
+  }
+  pos += strlen(clave);
+  size_t largo = strcspn(pos, "\"");
+  if (pos[largo] != '"' || largo == 0 || largo >= n) {
+    return false;
+  }
+  memcpy(destino, pos, largo);
+  destino[largo] = '\0';
+  return true;
+}
+
+bool HTTPClient::parsearRespuestaHTTP(const String& respuesta, bool& isActive, bool& estadoRecibido) {
+  const char* httpLine = strstr(respuesta.c_str(), "+HTTPACTION:");
+  if (httpLine == NULL) {
     if (respuesta.indexOf("ERROR") != -1) {
-      Serial.println(">> ✗ Error en comando AT");
+      LOG_ERROR("✗ Error en comando AT");
+      resultado = ENVIO_ERROR_MODEM;
     } else {
-      Serial.println(">> ✗ Timeout o respuesta no reconocida");
+      LOG_AVISO("✗ Timeout o respuesta no reconocida");
+      resultado = ENVIO_TIMEOUT_HTTP;
+      estimarConsumo(0, 0);
     }
     return false;
   }
   
-  String httpLine = respuesta.substring(httpActionPos);
-  int lineEnd = httpLine.indexOf('\r');
-  if (lineEnd != -1) {
-    httpLine = httpLine.substring(0, lineEnd);
-  }
-
-  int firstComma = httpLine.indexOf(',');
-  int secondComma = httpLine.indexOf(',', firstComma + 1);
-
-  if (firstComma == -1 || secondComma == -1) {
-    Serial.println(">> ✗ Error al parsear la respuesta +HTTPACTION");
+  // +HTTPACTION: <método>,<código>,<longitud>
+  int metodo = 0;
+  int statusCode = 0;
+  int dataLen = 0;
+  if (sscanf(httpLine, "+HTTPACTION: %d , %d , %d", &metodo, &statusCode, &dataLen) != 3) {
+    LOG_ERROR("✗ Error al parsear la respuesta +HTTPACTION");
+    resultado = ENVIO_ERROR_MODEM;
     return false;
   }
-  
-  String statusCodeStr = httpLine.substring(firstComma + 1, secondComma);
-  statusCodeStr.trim();
-  int statusCode = statusCodeStr.toInt();
-
-  String dataLenStr = httpLine.substring(secondComma + 1);
-  dataLenStr.trim();
-  int dataLen = dataLenStr.toInt();
+  codigoHTTP = statusCode;
+  estimarConsumo(statusCode, dataLen);
 
   if (statusCode == 200 || statusCode == 201 || statusCode == 204) {
-    Serial.println(">> ✓ Ubicación enviada exitosamente (" + statusCodeStr + ")");
+    LOG_INFO("✓ Ubicación enviada exitosamente (%d)", statusCode);
 
     if (dataLen > 0) {
-      Serial.println(">> Respuesta del servidor (" + String(dataLen) + " bytes):");
-      HardwareSerial& gsmSerial = gsm.getSerial();
-      delay(500);
+      // Leer respuesta usando AT+HTTPREAD=<start>,<length>; el cuerpo termina con "+HTTPREAD: 0"
+      canal.ejecutar(AT_HTTPREAD, dataLen);
+      const char* contenido = canal.respuesta().c_str();
+      LOG_DEPURACION("Respuesta del servidor (%d bytes): %s", dataLen, contenido);
+      
+      // "ack": secuencia hasta la que el servidor recibió todo
+      const char* ackPos = strstr(contenido, "\"ack\":");
+      if (ackPos != NULL) {
+        ack = strtoul(ackPos + 6, NULL, 10);
+        LOG_INFO("Servidor confirma hasta la secuencia %lu", (unsigned long)ack);
+      }
+      
+      // "capture":true pide congelar y subir la captura de alta frecuencia
+      const char* capturaPos = strstr(contenido, "\"capture\":");
+      if (capturaPos != NULL) {
+        capturaPos += 10;
+        while (*capturaPos == ' ') capturaPos++;
+        capturaPedida = strncmp(capturaPos, "true", 4) == 0;
+      }
+      
+      // "log":true pide subir la bitácora guardada en flash
+      const char* bitacoraPos = strstr(contenido, "\"log\":");
+      if (bitacoraPos != NULL) {
+        bitacoraPos += 6;
+        while (*bitacoraPos == ' ') bitacoraPos++;
+        bitacoraPedida = strncmp(bitacoraPos, "true", 4) == 0;
+      }
       
-      // Leer respuesta usando AT+HTTPREAD=<start>,<length>
-      gsmSerial.print("AT+HTTPREAD=0,");
-      gsmSerial.println(dataLen);
-      delay(2000);
+      // "ota":"x.y.z" ofrece una actualización; ActualizacionOTA decide si la descarga
+      copiarTexto(contenido, "\"ota\":\"", otaPedida, sizeof(otaPedida));
       
-      String contenido = "";
-      unsigned long readTimeout = millis() + 5000;
-      while (millis() < readTimeout && gsmSerial.available()) {
-        contenido += (char)gsmSerial.read();
+      // "allow":"+52...","role":"control" y "revoke":"+52..." cambian la lista blanca
+      if (copiarTexto(contenido, "\"allow\":\"", altaPedida, sizeof(altaPedida))) {
+        char rol[12];
+        rolPedido = ROL_CONTROL;
+        if (copiarTexto(contenido, "\"role\":\"", rol, sizeof(rol))) {
+          rolPedido = ListaAutorizados::parsearRol(String(rol));
+        }
+        if (rolPedido == ROL_NINGUNO) {
+          LOG_AVISO("✗ Rol desconocido para %s. Alta ignorada.", altaPedida);
+          altaPedida[0] = '\0';
+        }
       }
-      Serial.println(contenido);
+      copiarTexto(contenido, "\"revoke\":\"", bajaPedida, sizeof(bajaPedida));
       
       // Extraer el valor de isActive del JSON
-      int isActivePos = contenido.indexOf("\"isActive\":");
-      if (isActivePos != -1) {
-        int truePos = contenido.indexOf("true", isActivePos);
-        int falsePos = contenido.indexOf("false", isActivePos);
+      const char* isActivePos = strstr(contenido, "\"isActive\":");
+      if (isActivePos != NULL) {
+        const char* truePos = strstr(isActivePos, "true");
+        const char* falsePos = strstr(isActivePos, "false");
         
-        if (truePos != -1 && (falsePos == -1 || truePos < falsePos)) {
+        if (truePos != NULL && (falsePos == NULL || truePos < falsePos)) {
           isActive = true;
-          Serial.println(">> Estado del dispositivo: ACTIVO");
-        } else if (falsePos != -1) {
+          estadoRecibido = true;
+          LOG_INFO("Estado del dispositivo: ACTIVO");
+        } else if (falsePos != NULL) {
           isActive = false;
-          Serial.println(">> Estado del dispositivo: INACTIVO");
+          estadoRecibido = true;
+          LOG_INFO("Estado del dispositivo: INACTIVO");
         }
       }
     } else {
-      Serial.println(">> Respuesta del servidor (sin contenido)");
+      LOG_DEPURACION("Respuesta del servidor (sin contenido)");
     }
     
     return true;
   } else {
-    Serial.println(">> ✗ Error HTTP " + statusCodeStr);
-    if (statusCode == 715) {
-      Serial.println(">> ERROR 715: Timeout SSL/TLS o certificado inválido");
-    } else if (statusCode == 703) {
-      Serial.println(">> ERROR 703: Error de DNS");
-    } else if (statusCode == 714) {
-      Serial.println(">> ERROR 714: Timeout HTTP");
-    }
+    clasificarError(statusCode);
     return false;
   }
 }
 
-bool HTTPClient::enviarUbicacion(double lat, double lon, double speed) {
-  HardwareSerial& gsmSerial = gsm.getSerial();
-  
-  Serial.println(">> Enviando ubicación al servidor...");
-  
-  // Verificar contexto PDP
-  Serial.println(">> Verificando contexto PDP...");
+void HTTPClient::clasificarError(int statusCode) {
+  if (statusCode == 715) {
+    LOG_AVISO("✗ ERROR 715: Timeout SSL/TLS o certificado inválido");
+    resultado = ENVIO_TLS;
+  } else if (statusCode == 703) {
+    LOG_AVISO("✗ ERROR 703: Error de DNS");
+    resultado = ENVIO_DNS;
+  } else if (statusCode == 714) {
+    LOG_AVISO("✗ ERROR 714: Timeout HTTP");
+    resultado = ENVIO_TIMEOUT_HTTP;
+  } else {
+    // 6xx/7xx los genera el módem; el resto son respuestas reales del servidor
+    LOG_AVISO("✗ Error HTTP %d", statusCode);
+    resultado = statusCode >= 600 ? ENVIO_ERROR_MODEM : ENVIO_ERROR_SERVIDOR;
+  }
+}
+
+bool HTTPClient::asegurarPDP() {
   if (!gsm.estaContextoPDPActivo()) {
-    Serial.println(">> Contexto PDP inactivo. Reactivando...");
+    LOG_AVISO("Contexto PDP inactivo. Reactivando...");
     if (!gsm.verificarConexionGPRS()) {
-      Serial.println(">> Error: No se pudo reactivar GPRS");
+      LOG_ERROR("✗ No se pudo reactivar GPRS");
+      resultado = gsm.estaRegistrado() ? ENVIO_SIN_PDP : ENVIO_SIN_REGISTRO;
       return false;
     }
   }
+  return true;
+}
+
+bool HTTPClient::esperarRespuesta(IdComandoAT accion) {
+  // El resultado llega como URC; mientras tanto el canal queda libre para SMS
+  static const char* const abortos[] = { "+HTTP_NONET_EVENT", "+CGEV: NW PDN DEACT", NULL };
+  bool httpActionRecibido = canal.esperarURC(accion, respuestaURC, abortos);
+  LOG_DEPURACION("%s", respuestaURC.c_str());
+  
+  if (!httpActionRecibido && respuestaURC.length() > 0) {
+    if (respuestaURC.indexOf("+HTTP_NONET_EVENT") != -1) {
+      LOG_AVISO("✗ Sin conexión de red durante HTTP. Terminando HTTP...");
+    } else {
+      LOG_AVISO("✗ Contexto PDP desactivado durante HTTP. Terminando HTTP...");
+    }
+    canal.ejecutar(AT_HTTPTERM);
+    resultado = ENVIO_SIN_PDP;
+    return false;
+  }
+  return true;
+}
+
+bool HTTPClient::enviarReportes(const ColaReportes& cola, int maxLote) {
+  LOG_INFO("Enviando ubicación al servidor (secuencia %lu)...", (unsigned long)cola.masReciente().secuencia);
+  resultado = ENVIO_OK;
+  ack = 0;
+  enLote = 0;
+  enViaje = 0;
+  capturaPedida = false;
+  bitacoraPedida = false;
+  otaPedida[0] = '\0';
+  altaPedida[0] = '\0';
+  bajaPedida[0] = '\0';
+  codigoHTTP = 0;
+  consumo.subida = 0;
+  consumo.bajada = 0;
+  
+  if (!asegurarPDP()) {
+    return false;
+  }
+  
+  if (!construirURL(cola, maxLote)) {
+    return false;
+  }
   
+  unsigned long inicio = millis();
   if (!inicializarHTTP()) {
+    resultado = ENVIO_ERROR_MODEM;
     return false;
   }
   
-  // Construir URL
-  String url = "https://" + String(API_ENDPOINT) + String(API_PATH) + 
-               "?lat=" + String(lat, 6) + 
-               "&lon=" + String(lon, 6) +
-               "&token=" + String(DEVICE_TOKEN);
+  LOG_DEPURACION("URL: %s", url);
+  if (enLote > 0) {
+    LOG_INFO("Lote: %d fixes pendientes en la misma petición", enLote);
+  }
   
-  // Agregar velocidad si está disponible (speed >= 0)
-  if (speed >= 0.0) {
-    url += "&speed=" + String(speed, 1);
-    Serial.println(">> Velocidad: " + String(speed, 1) + " km/h");
+  fijarURL();
+  canal.ejecutar(AT_HTTPACTION_GET);
+  
+  if (!esperarRespuesta(AT_HTTPACTION_GET)) {
+    return false;
   }
   
-  Serial.println(">> URL: " + url);
+  bool isActive = false;
+  bool estadoRecibido = false;
+  bool exito = parsearRespuestaHTTP(respuestaURC, isActive, estadoRecibido);
+  if (codigoHTTP != 0 && codigoHTTP < 600) {
+    tls.registrarSesion(millis() - inicio, consumo);  // Handshake completo: cuenta para la medición
+  }
   
-  gsmSerial.print("AT+HTTPPARA=\"URL\",\"");
-  gsmSerial.print(url);
-  gsmSerial.println("\"");
-  delay(1000);
-  String urlResp = esperarRespuesta();
-  Serial.println(">> URL Config: " + urlResp);
+  // Controlar pines según el estado
+  if (exito && estadoRecibido) {
+    salidas.aplicarDesdeServidor(isActive);
+  }
   
-  Serial.println(">> Ejecutando petición HTTP GET...");
-  gsmSerial.println("AT+HTTPACTION=0");
+  canal.ejecutar(AT_HTTPTERM);
   
-  String respuesta = "";
-  unsigned long timeout = millis() + HTTP_TIMEOUT;
-  bool httpActionRecibido = false;
+  return exito;
+}
+
+void HTTPClient::reiniciarEnvio() {
+  resultado = ENVIO_OK;
+  ack = 0;
+  enLote = 0;
+  enViaje = 0;
+  codigoHTTP = 0;
+  consumo.subida = 0;
+  consumo.bajada = 0;
+}
+
+bool HTTPClient::enviarCuerpo(size_t total, LectorCuerpo lector, void* contexto) {
+  if (!inicializarHTTP()) {
+    resultado = ENVIO_ERROR_MODEM;
+    return false;
+  }
+  fijarURL();
+  canal.ejecutar(AT_HTTPPARA_CONTENT);
   
-  while (millis() < timeout) {
-    while (gsmSerial.available()) {
-      char c = (char)gsmSerial.read();
-      respuesta += c;
-      Serial.print(c);
+  // AT+HTTPDATA responde DOWNLOAD; el cuerpo se envía por bloques desde la flash
+  bool cargado = false;
+  if (canal.iniciar(AT_HTTPDATA, (int)total, HTTP_TIEMPO_DATOS_S)) {
+    ResultadoAT r = canal.sondear();
+    while (r == AT_EN_CURSO) {
+      delay(5);
+      r = canal.sondear();
     }
-    
-    if (respuesta.indexOf("+HTTPACTION:") != -1) {
-      httpActionRecibido = true;
-      break;
-    }
-    
-    if (respuesta.indexOf("+HTTP_NONET_EVENT") != -1) {
-      Serial.println("\n>> ERROR: Sin conexión de red durante HTTP");
-      break;
-    }
-    
-    if (respuesta.indexOf("+CGEV: NW PDN DEACT") != -1) {
-      Serial.println("\n>> ERROR: Contexto PDP desactivado durante HTTP");
-      break;
+    if (r == AT_OK) {
+      uint8_t bloque[256];
+      size_t enviados = 0;
+      while (enviados < total) {
+        size_t pedir = total - enviados < sizeof(bloque) ? total - enviados : sizeof(bloque);
+        size_t leidos = lector(enviados, bloque, pedir, contexto);
+        if (leidos == 0) {
+          break;
+        }
+        canal.enviarBytes(bloque, leidos, HTTP_TIEMPO_DATOS_S * 1000UL);
+        enviados += leidos;
+      }
+      r = canal.sondear();
+      while (r == AT_EN_CURSO) {
+        delay(5);
+        r = canal.sondear();
+      }
+      cargado = enviados == total && r == AT_OK;
     }
-    
-    delay(100);
+    canal.finalizar();
+  }
+  if (!cargado) {
+    LOG_ERROR("✗ El módem no aceptó el cuerpo de la petición");
+    canal.ejecutar(AT_HTTPTERM);
+    resultado = ENVIO_ERROR_MODEM;
+    return false;
   }
   
-  Serial.println();
-  
-  if (!httpActionRecibido && (respuesta.indexOf("+HTTP_NONET_EVENT") != -1 || 
-      respuesta.indexOf("+CGEV: NW PDN DEACT") != -1)) {
-    Serial.println(">> Detectado error de red. Terminando HTTP y saliendo...");
-    gsmSerial.println("AT+HTTPTERM");
-    delay(500);
-    esperarRespuesta();
+  canal.ejecutar(AT_HTTPACTION_POST);
+  if (!esperarRespuesta(AT_HTTPACTION_POST)) {
     return false;
   }
   
   bool isActive = false;
-  bool exito = parsearRespuestaHTTP(respuesta, isActive);
+  bool estadoRecibido = false;
+  bool exito = parsearRespuestaHTTP(respuestaURC, isActive, estadoRecibido);
+  if (consumo.subida > DATOS_BYTES_TCP + DATOS_BYTES_TLS_SUBIDA) {
+    consumo.subida += total;  // La petición salió: el cuerpo también
+  }
+  canal.ejecutar(AT_HTTPTERM);
+  return exito;
+}
+
+static size_t leerCaptura(size_t desde, uint8_t* destino, size_t n, void* contexto) {
+  return static_cast<const CapturaGNSS*>(contexto)->leerCongelada(desde, destino, n);
+}
+
+static size_t leerBitacora(size_t desde, uint8_t* destino, size_t n, void* contexto) {
+  return static_cast<Bitacora*>(contexto)->leerGuardada(desde, destino, n);
+}
+
+bool HTTPClient::enviarCaptura(const CapturaGNSS& captura) {
+  const CabeceraCaptura& c = captura.getCabecera();
+  size_t total = captura.bytesCongelados();
+  LOG_INFO("Subiendo captura de alta frecuencia (%u muestras, %lu bytes, %s)...", (unsigned)c.muestras,
+           (unsigned long)total, CapturaGNSS::nombreMotivo((MotivoCaptura)c.motivo));
+  reiniciarEnvio();
   
-  // Controlar pines según el estado
-  if (exito) {
-    if (isActive) {
-      digitalWrite(PIN_ACTIVE, HIGH);
-      digitalWrite(PIN_INACTIVE, LOW);
-      Serial.println(">> PIN " + String(PIN_ACTIVE) + " encendido, PIN " + String(PIN_INACTIVE) + " apagado");
-    } else {
-      digitalWrite(PIN_ACTIVE, LOW);
-      digitalWrite(PIN_INACTIVE, HIGH);
-      Serial.println(">> PIN " + String(PIN_ACTIVE) + " apagado, PIN " + String(PIN_INACTIVE) + " encendido");
-    }
+  if (!asegurarPDP()) {
+    return false;
+  }
+  
+  // El cuerpo lleva las muestras; la URL solo identifica la captura
+  int n = snprintf(url, sizeof(url), "https://%s%s?token=%s&motivo=%s&n=%u&bytes=%lu",
+                   servidor(), CAPTURA_API_PATH, DEVICE_TOKEN, CapturaGNSS::nombreMotivo((MotivoCaptura)c.motivo),
+                   (unsigned)c.muestras, (unsigned long)total);
+  if (n < 0 || n >= (int)sizeof(url)) {
+    LOG_ERROR("✗ URL demasiado larga para HTTP_LONGITUD_URL");
+    resultado = ENVIO_ERROR_CONFIG;
+    return false;
+  }
+  return enviarCuerpo(total, leerCaptura, const_cast<CapturaGNSS*>(&captura));
+}
+
+bool HTTPClient::enviarBitacora(Bitacora& registro) {
+  size_t total = registro.bytesGuardados();
+  LOG_INFO("Subiendo bitácora (%lu bytes)...", (unsigned long)total);
+  reiniciarEnvio();
+  
+  if (total == 0) {
+    return true;  // Nada guardado: el pedido queda atendido
+  }
+  if (!asegurarPDP()) {
+    return false;
   }
   
-  delay(500);
-  gsmSerial.println("AT+HTTPTERM");
-  delay(500);
-  esperarRespuesta();
+  int n = snprintf(url, sizeof(url), "https://%s%s?token=%s&bytes=%lu", servidor(), BITACORA_API_PATH,
+                   DEVICE_TOKEN, (unsigned long)total);
+  if (n < 0 || n >= (int)sizeof(url)) {
+    LOG_ERROR("✗ URL demasiado larga para HTTP_LONGITUD_URL");
+    resultado = ENVIO_ERROR_CONFIG;
+    return false;
+  }
+  return enviarCuerpo(total, leerBitacora, &registro);
+}
+
+uint32_t HTTPClient::descargarRango(const char* ruta, uint32_t desde, uint32_t n, ReceptorBytes receptor, void* contexto) {
+  LOG_INFO("Descargando bytes %lu-%lu...", (unsigned long)desde, (unsigned long)(desde + n - 1));
+  resultado = ENVIO_OK;
+  codigoHTTP = 0;
+  consumo.subida = 0;
+  consumo.bajada = 0;
   
-  return exito;
+  if (!asegurarPDP()) {
+    return 0;
+  }
+  
+  // Por nombre: USERDATA ya lleva la cabecera Range y el módem admite una sola
+  urlPorIP = false;
+  int largo = snprintf(url, sizeof(url), "https://%s%s", API_ENDPOINT, ruta);
+  if (largo < 0 || largo >= (int)sizeof(url)) {
+    LOG_ERROR("✗ URL demasiado larga para HTTP_LONGITUD_URL");
+    resultado = ENVIO_ERROR_CONFIG;
+    return 0;
+  }
+  
+  if (!inicializarHTTP()) {
+    resultado = ENVIO_ERROR_MODEM;
+    return 0;
+  }
+  canal.ejecutar(AT_HTTPPARA_URL, url);
+  canal.ejecutar(AT_HTTPPARA_RANGO, (unsigned long)desde, (unsigned long)(desde + n - 1));
+  
+  canal.ejecutar(AT_HTTPACTION_GET);
+  if (!esperarRespuesta(AT_HTTPACTION_GET)) {
+    return 0;
+  }
+  
+  int metodo = 0;
+  int statusCode = 0;
+  int dataLen = 0;
+  if (sscanf(respuestaURC.c_str(), "+HTTPACTION: %d , %d , %d", &metodo, &statusCode, &dataLen) != 3) {
+    LOG_AVISO("✗ Timeout o respuesta no reconocida");
+    resultado = ENVIO_TIMEOUT_HTTP;
+    estimarConsumo(0, 0);
+    canal.ejecutar(AT_HTTPTERM);
+    return 0;
+  }
+  codigoHTTP = statusCode;
+  estimarConsumo(statusCode, dataLen);
+  
+  // 206 trae el rango pedido; un 200 (servidor sin Range) solo sirve desde el inicio
+  if (statusCode != 206 && !(statusCode == 200 && desde == 0)) {
+    clasificarError(statusCode);
+    canal.ejecutar(AT_HTTPTERM);
+    return 0;
+  }
+  
+  // El cuerpo llega en binario tras cada "+HTTPREAD: <n>"
+  uint8_t trozo[HTTP_LECTURA_BYTES];
+  uint32_t disponibles = (uint32_t)dataLen < n ? (uint32_t)dataLen : n;
+  uint32_t recibidos = 0;
+  while (recibidos < disponibles) {
+    uint32_t pedir = disponibles - recibidos < sizeof(trozo) ? disponibles - recibidos : sizeof(trozo);
+    ResultadoAT r = canal.ejecutarBinario(trozo, sizeof(trozo), AT_HTTPREAD_DESDE, (unsigned long)recibidos,
+                                          (int)pedir);
+    if (r != AT_OK || canal.binariosRecibidos() == 0) {
+      LOG_AVISO("✗ Lectura del cuerpo interrumpida");
+      break;
+    }
+    if (!receptor(trozo, canal.binariosRecibidos(), contexto)) {
+      break;
+    }
+    recibidos += canal.binariosRecibidos();
+  }
+  canal.ejecutar(AT_HTTPTERM);
+  
+  if (recibidos == 0) {
+    resultado = ENVIO_ERROR_MODEM;
+  }
+  return recibidos;
 }
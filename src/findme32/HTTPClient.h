@@ -3,22 +3,136 @@
 
 #include <Arduino.h>
 #include "GSMModule.h"
+#include "ControlSalidas.h"
+#include "ColaReportes.h"
+#include "ConsumoDatos.h"
+#include "CapturaGNSS.h"
+#include "ContextoTLS.h"
+#include "Bitacora.h"
+#include "ListaAutorizados.h"
+
+class CacheDNS;
+class RegistroViajes;
+
+#define HTTP_LONGITUD_URL 480
+#define HTTP_TIEMPO_DATOS_S 30  // Plazo de AT+HTTPDATA para recibir el cuerpo
+#define HTTP_LECTURA_BYTES 512  // Cuerpo binario leído por cada AT+HTTPREAD
+#define OTA_LONGITUD_VERSION 16 // Versión ofrecida en "ota" (p.ej. "1.4.2")
+#define LISTA_LONGITUD_NUMERO 20 // Número en "allow" / "revoke"
+
+// La URL debe caber en AT+HTTPPARA="URL","..." dentro del búfer del canal
+static_assert(verificacionAT::longitud(COMANDOS_AT[AT_HTTPPARA_URL].texto) - 2 + HTTP_LONGITUD_URL <= AT_LONGITUD_COMANDO,
+              "HTTP_LONGITUD_URL no cabe en AT_LONGITUD_COMANDO");
 
 /**
- * Cliente HTTP/HTTPS para envío de datos GPS
+ * Resultado de un envío, clasificado para el supervisor de conexión
+ */
+enum ResultadoEnvio {
+  ENVIO_OK,
+  ENVIO_SIN_REGISTRO,    // Sin red celular: no se pudo activar el PDP
+  ENVIO_SIN_PDP,         // Registrado, pero sin contexto PDP o perdido durante HTTP
+  ENVIO_DNS,             // Error 703
+  ENVIO_TLS,             // Error 715
+  ENVIO_TIMEOUT_HTTP,    // Error 714 o sin +HTTPACTION
+  ENVIO_ERROR_MODEM,     // AT+HTTPINIT rechazado u otro error 6xx/7xx del módem
+  ENVIO_ERROR_SERVIDOR,  // El servidor respondió, con un código de error: la red funciona
+  ENVIO_ERROR_CONFIG,    // URL demasiado larga: ninguna recuperación lo arregla
+  TOTAL_RESULTADOS_ENVIO
+};
+
+// Recibe cada trozo de una descarga; false la interrumpe
+typedef bool (*ReceptorBytes)(const uint8_t* datos, size_t n, void* contexto);
+// Entrega hasta 'n' bytes del cuerpo desde 'desde'; 0 = sin más datos
+typedef size_t (*LectorCuerpo)(size_t desde, uint8_t* destino, size_t n, void* contexto);
+
+/**
+ * Cliente HTTP/HTTPS para envío de datos GPS.
+ * La URL y los comandos se formatean en búferes fijos: un reporte no usa el heap.
  */
 class HTTPClient {
 public:
-  HTTPClient(GSMModule& gsmModule);
+  HTTPClient(GSMModule& gsmModule, ControlSalidas& salidas);
+  
+  // Envía el fix más nuevo de la cola con hasta 'maxLote' pendientes más antiguos que quepan como lote
+  bool enviarReportes(const ColaReportes& cola, int maxLote = REPORTES_COLA_CAPACIDAD);
+  // POST de la captura congelada en flash (cuerpo binario, ver CapturaGNSS.h)
+  bool enviarCaptura(const CapturaGNSS& captura);
+  // POST de la bitácora guardada en flash (texto, una línea por evento)
+  bool enviarBitacora(Bitacora& registro);
+  // GET de los bytes [desde, desde + n) de API_ENDPOINT + 'ruta' con la cabecera Range.
+  // Entrega el cuerpo a 'receptor' por trozos y devuelve los bytes recibidos (0 = fallo).
+  uint32_t descargarRango(const char* ruta, uint32_t desde, uint32_t n, ReceptorBytes receptor, void* contexto);
+  ResultadoEnvio ultimoResultado() const { return resultado; }
+  // "ack" del último envío exitoso: todo hasta esa secuencia llegó (0 = sin ack)
+  uint32_t ultimoAck() const { return ack; }
+  // Pendientes anteriores que viajaron en el lote del último envío
+  int reportesEnLote() const { return enLote; }
+  // Eventos de viaje que viajaron en el último envío (los más antiguos pendientes)
+  int eventosEnviados() const { return enViaje; }
+  // Bytes estimados de la última sesión, según hasta dónde llegó
+  const ConsumoSesion& ultimoConsumo() const { return consumo; }
+  // El servidor pidió congelar y subir la captura de alta frecuencia ("capture":true)
+  bool capturaSolicitada() const { return capturaPedida; }
+  // El servidor pidió la bitácora guardada en flash ("log":true)
+  bool bitacoraSolicitada() const { return bitacoraPedida; }
+  // Versión de firmware que ofrece el servidor ("ota":"x.y.z"); vacía si no hay
+  const char* otaSolicitada() const { return otaPedida; }
+  // Número que el servidor agrega a la lista blanca ("allow", con "role"); vacío si no hay
+  const char* altaSolicitada() const { return altaPedida; }
+  RolNumero rolSolicitado() const { return rolPedido; }
+  // Número que el servidor quita de la lista blanca ("revoke"); vacío si no hay
+  const char* bajaSolicitada() const { return bajaPedida; }
+  // Código HTTP de la última petición (0 si no llegó respuesta)
+  int ultimoCodigoHTTP() const { return codigoHTTP; }
+  // La última petición fue a la dirección de la caché DNS
+  bool conectoPorIP() const { return urlPorIP; }
   
-  bool enviarUbicacion(double lat, double lon, double speed = -1.0);
+  // Conectar por la dirección de la caché en lugar de resolver API_ENDPOINT en cada sesión
+  void setCacheDNS(CacheDNS* cache) { dns = cache; }
+  // Eventos de viaje pendientes que acompañan a cada reporte (parámetro "viaje")
+  void setViajes(const RegistroViajes* registro) { viajes = registro; }
+  // Certificado y configuración SSL del módem, con la medición por reporte
+  ContextoTLS& getTLS() { return tls; }
+  
+  static const char* nombreResultado(ResultadoEnvio r);
   
 private:
   GSMModule& gsm;
+  CanalAT& canal;
+  ControlSalidas& salidas;
+  
+  char url[HTTP_LONGITUD_URL];
+  String respuestaURC;
+  ResultadoEnvio resultado;
+  uint32_t ack;
+  int enLote;
+  int enViaje;
+  ConsumoSesion consumo;
+  bool capturaPedida;
+  bool bitacoraPedida;
+  char otaPedida[OTA_LONGITUD_VERSION];
+  char altaPedida[LISTA_LONGITUD_NUMERO];
+  RolNumero rolPedido;
+  char bajaPedida[LISTA_LONGITUD_NUMERO];
+  int codigoHTTP;
+  CacheDNS* dns;
+  const RegistroViajes* viajes;
+  bool urlPorIP;
+  ContextoTLS tls;
   
+  bool construirURL(const ColaReportes& cola, int maxLote);
+  // Host de la URL; la dirección de la caché si hay una vigente
+  const char* servidor();
+  void fijarURL();
+  void estimarConsumo(int statusCode, int dataLen);
+  void reiniciarEnvio();
+  // Sube el cuerpo con AT+HTTPDATA y hace el POST a la URL ya armada
+  bool enviarCuerpo(size_t total, LectorCuerpo lector, void* contexto);
   bool inicializarHTTP();
-  String esperarRespuesta(unsigned long timeout_ms = 5000);
-  bool parsearRespuestaHTTP(const String& respuesta, bool& isActive);
+  bool asegurarPDP();
+  bool esperarRespuesta(IdComandoAT accion);
+  bool parsearRespuestaHTTP(const String& respuesta, bool& isActive, bool& estadoRecibido);
+  void clasificarError(int statusCode);
 };
 
 #endif // HTTPCLIENT_H
@@ -0,0 +1,219 @@
+#include "ListaAutorizados.h"
+#include "Bitacora.h"
+
+static_assert((LISTA_SLOTS_INDICE & (LISTA_SLOTS_INDICE - 1)) == 0, "LISTA_SLOTS_INDICE debe ser potencia de 2");
+static_assert(LISTA_SLOTS_INDICE >= 2 * LISTA_MAX_NUMEROS, "El índice debe tener al menos el doble de slots que entradas");
+static_assert(LISTA_MAX_NUMEROS < 65535, "Las posiciones del índice son de 16 bits");
+
+static const uint64_t DIEZ_A_LA_10 = 10000000000ULL;
+
+ListaAutorizados::ListaAutorizados() : cantidad(0) {
+  memset(indice, 0, sizeof(indice));
+}
+
+uint64_t ListaAutorizados::normalizar(const char* numero) {
+  const char* p = numero;
+  while (*p == ' ') p++;
+
+  bool internacional = false;
+  if (*p == '+') {
+    internacional = true;
+    p++;
+  } else if (p[0] == '0' && p[1] == '0') {
+    internacional = true;
+    p += 2;
+  }
+
+  uint64_t n = 0;
+  int digitos = 0;
+  for (; *p; p++) {
+    if (*p >= '0' && *p <= '9') {
+      if (digitos >= 15) return 0;  // E.164 admite como máximo 15 dígitos
+      n = n * 10 + (uint64_t)(*p - '0');
+      digitos++;
+    } else if (*p != ' ' && *p != '-' && *p != '(' && *p != ')' && *p != '.') {
+      return 0;
+    }
+  }
+
+  if (!internacional && digitos == 10) {
+    // Número nacional: anteponer el código de país
+    n += PREFIJO_PAIS * DIEZ_A_LA_10;
+    digitos += (PREFIJO_PAIS >= 10) ? 2 : 1;
+  }
+
+  // México: el antiguo prefijo móvil "1" (+52 1 XXX...) identifica al mismo número
+  if (PREFIJO_PAIS == 52 && digitos == 13 && n / DIEZ_A_LA_10 == 521) {
+    n = 52 * DIEZ_A_LA_10 + n % DIEZ_A_LA_10;
+    digitos = 12;
+  }
+
+  if (digitos < 8) {
+    return 0;  // Códigos cortos y números incompletos no se aceptan
+  }
+  return n;
+}
+
+RolNumero ListaAutorizados::parsearRol(const String& texto) {
+  if (texto.equalsIgnoreCase("localizar")) return ROL_LOCALIZAR;
+  if (texto.equalsIgnoreCase("control")) return ROL_CONTROL;
+  if (texto.equalsIgnoreCase("admin")) return ROL_ADMIN;
+  return ROL_NINGUNO;
+}
+
+const char* ListaAutorizados::nombreRol(RolNumero rol) {
+  switch (rol) {
+    case ROL_LOCALIZAR: return "localizar";
+    case ROL_CONTROL: return "control";
+    case ROL_ADMIN: return "admin";
+    default: return "ninguno";
+  }
+}
+
+uint32_t ListaAutorizados::slotInicial(uint64_t numero) {
+  // Mezcla de splitmix64: los números consecutivos quedan dispersos en el índice
+  numero ^= numero >> 30;
+  numero *= 0xbf58476d1ce4e5b9ULL;
+  numero ^= numero >> 27;
+  numero *= 0x94d049bb133111ebULL;
+  numero ^= numero >> 31;
+  return (uint32_t)numero & (LISTA_SLOTS_INDICE - 1);
+}
+
+int ListaAutorizados::buscar(uint64_t numero) const {
+  uint32_t slot = slotInicial(numero);
+  for (int i = 0; i < LISTA_SLOTS_INDICE; i++) {
+    uint16_t v = indice[slot];
+    if (v == 0) {
+      return -1;
+    }
+    if (numeroDe(entradas[v - 1]) == numero) {
+      return v - 1;
+    }
+    slot = (slot + 1) & (LISTA_SLOTS_INDICE - 1);
+  }
+  return -1;
+}
+
+void ListaAutorizados::indexar(int posicion) {
+  uint32_t slot = slotInicial(numeroDe(entradas[posicion]));
+  while (indice[slot] != 0) {
+    slot = (slot + 1) & (LISTA_SLOTS_INDICE - 1);
+  }
+  indice[slot] = (uint16_t)(posicion + 1);
+}
+
+void ListaAutorizados::reconstruirIndice() {
+  memset(indice, 0, sizeof(indice));
+  for (int i = 0; i < cantidad; i++) {
+    indexar(i);
+  }
+}
+
+void ListaAutorizados::guardarBloque(int bloque) {
+  char clave[8];
+  snprintf(clave, sizeof(clave), "b%d", bloque);
+
+  int inicio = bloque * LISTA_ENTRADAS_POR_BLOQUE;
+  int n = cantidad - inicio;
+  if (n > LISTA_ENTRADAS_POR_BLOQUE) n = LISTA_ENTRADAS_POR_BLOQUE;
+
+  if (n <= 0) {
+    preferences.remove(clave);
+  } else {
+    preferences.putBytes(clave, &entradas[inicio], n * sizeof(uint64_t));
+  }
+}
+
+void ListaAutorizados::guardarCantidad() {
+  preferences.putUShort("n", (uint16_t)cantidad);
+}
+
+bool ListaAutorizados::begin() {
+  if (!preferences.begin("autorizados", false)) {
+    LOG_ERROR("✗ No se pudo abrir NVS para la lista de autorizados");
+    return false;
+  }
+
+  int guardados = preferences.getUShort("n", 0);
+  if (guardados > LISTA_MAX_NUMEROS) guardados = LISTA_MAX_NUMEROS;
+
+  cantidad = 0;
+  for (int inicio = 0; inicio < guardados; inicio += LISTA_ENTRADAS_POR_BLOQUE) {
+    char clave[8];
+    snprintf(clave, sizeof(clave), "b%d", inicio / LISTA_ENTRADAS_POR_BLOQUE);
+
+    int esperados = guardados - inicio;
+    if (esperados > LISTA_ENTRADAS_POR_BLOQUE) esperados = LISTA_ENTRADAS_POR_BLOQUE;
+
+    size_t leidos = preferences.getBytes(clave, &entradas[inicio], esperados * sizeof(uint64_t));
+    cantidad = inicio + (int)(leidos / sizeof(uint64_t));
+    if ((int)(leidos / sizeof(uint64_t)) < esperados) {
+      LOG_ERROR("✗ Bloque %s incompleto. Lista truncada.", clave);
+      break;
+    }
+  }
+
+  reconstruirIndice();
+  LOG_INFO("Lista de autorizados cargada: %d números", cantidad);
+  return true;
+}
+
+RolNumero ListaAutorizados::rol(const char* numero) const {
+  uint64_t n = normalizar(numero);
+  if (n == 0) {
+    return ROL_NINGUNO;
+  }
+  int pos = buscar(n);
+  return (pos < 0) ? ROL_NINGUNO : (RolNumero)(entradas[pos] & 0xFF);
+}
+
+bool ListaAutorizados::agregar(const char* numero, RolNumero rol) {
+  uint64_t n = normalizar(numero);
+  if (n == 0 || rol == ROL_NINGUNO) {
+    return false;
+  }
+
+  int pos = buscar(n);
+  if (pos >= 0) {
+    // Ya existe: solo actualizar el rol
+    entradas[pos] = (n << 8) | rol;
+    guardarBloque(pos / LISTA_ENTRADAS_POR_BLOQUE);
+    return true;
+  }
+
+  if (cantidad >= LISTA_MAX_NUMEROS) {
+    LOG_ERROR("✗ Lista de autorizados llena");
+    return false;
+  }
+
+  entradas[cantidad] = (n << 8) | rol;
+  indexar(cantidad);
+  cantidad++;
+
+  // Primero el bloque y después el contador: un corte de energía no deja entradas inválidas
+  guardarBloque((cantidad - 1) / LISTA_ENTRADAS_POR_BLOQUE);
+  guardarCantidad();
+  return true;
+}
+
+bool ListaAutorizados::eliminar(const char* numero) {
+  uint64_t n = normalizar(numero);
+  int pos = (n == 0) ? -1 : buscar(n);
+  if (pos < 0) {
+    return false;
+  }
+
+  // Mover la última entrada al hueco para mantener el arreglo compacto
+  int ultima = cantidad - 1;
+  entradas[pos] = entradas[ultima];
+  cantidad--;
+  reconstruirIndice();
+
+  guardarBloque(pos / LISTA_ENTRADAS_POR_BLOQUE);
+  guardarCantidad();
+  if (ultima / LISTA_ENTRADAS_POR_BLOQUE != pos / LISTA_ENTRADAS_POR_BLOQUE) {
+    guardarBloque(ultima / LISTA_ENTRADAS_POR_BLOQUE);
+  }
+  return true;
+}
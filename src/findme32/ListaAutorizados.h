@@ -0,0 +1,57 @@
+#ifndef LISTAAUTORIZADOS_H
+#define LISTAAUTORIZADOS_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "config.h"
+
+/**
+ * Rol de un número autorizado. Cada rol incluye los permisos de los anteriores.
+ */
+enum RolNumero : uint8_t {
+  ROL_NINGUNO = 0,
+  ROL_LOCALIZAR = 1,  // Solo "Localizar"
+  ROL_CONTROL = 2,    // Localizar + control del relevador
+  ROL_ADMIN = 3       // Control + alta/baja de números
+};
+
+/**
+ * Lista blanca de números persistida en NVS.
+ *
+ * Cada número se normaliza a E.164 y se guarda como entero de 64 bits junto
+ * con su rol (8 bytes por entrada). Las entradas se persisten en bloques de
+ * LISTA_ENTRADAS_POR_BLOQUE para que una alta o baja solo reescriba uno o dos
+ * bloques. En RAM se mantiene un índice hash con direccionamiento abierto, de
+ * modo que la consulta es de tiempo constante y no reserva memoria dinámica.
+ */
+class ListaAutorizados {
+public:
+  ListaAutorizados();
+
+  bool begin();
+  RolNumero rol(const char* numero) const;
+  bool agregar(const char* numero, RolNumero rol);
+  bool eliminar(const char* numero);
+  int total() const { return cantidad; }
+
+  static uint64_t normalizar(const char* numero);
+  static RolNumero parsearRol(const String& texto);
+  static const char* nombreRol(RolNumero rol);
+
+private:
+  Preferences preferences;
+  uint64_t entradas[LISTA_MAX_NUMEROS];  // (numero << 8) | rol
+  uint16_t indice[LISTA_SLOTS_INDICE];   // Posición en entradas + 1, 0 = vacío
+  int cantidad;
+
+  static uint64_t numeroDe(uint64_t entrada) { return entrada >> 8; }
+  static uint32_t slotInicial(uint64_t numero);
+
+  int buscar(uint64_t numero) const;
+  void indexar(int posicion);
+  void reconstruirIndice();
+  void guardarBloque(int bloque);
+  void guardarCantidad();
+};
+
+#endif // LISTAAUTORIZADOS_H
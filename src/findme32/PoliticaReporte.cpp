@@ -0,0 +1,130 @@
+#include "PoliticaReporte.h"
+#include "GeoUtils.h"
+#include <string.h>
+
+// Como RelojGNSS::segundosEntre(): con la hora GNSS si los dos la traen
+static double segundosEntre(const FixPolitica& antes, const FixPolitica& despues) {
+  if (antes.utc != 0 && despues.utc != 0) {
+    int64_t ms = ((int64_t)despues.utc - antes.utc) * 1000 + ((int)despues.utcMs - antes.utcMs);
+    return ms > 0 ? ms / 1000.0 : 0;
+  }
+  if (antes.monotono != 0 && despues.monotono > antes.monotono) {
+    return (despues.monotono - antes.monotono) / 1000.0;
+  }
+  return 0;
+}
+
+static DecisionReporte sinReporte() {
+  DecisionReporte d = { REPORTE_NINGUNO, false, -1.0f, -1.0f, 0, 0 };
+  return d;
+}
+
+PoliticaReporte::PoliticaReporte(const ParametrosPolitica& parametros)
+  : parametros(parametros),
+    estima(parametros.estimaUmbralMetros, parametros.estimaIntervaloMs / 1000.0, parametros.estimaVelocidadMinKmh),
+    conFix(false), latReportada(0), lonReportada(0), monotonoBase(0), ultimaLectura(0), ultimoEnvio(0) {
+  memset(&actual, 0, sizeof(actual));
+  actual.velocidad = -1.0f;
+  actual.rumbo = -1.0f;
+  ultimoDecidido = actual;
+}
+
+void PoliticaReporte::iniciar(unsigned long ahoraMs) {
+  ultimaLectura = ahoraMs;
+  ultimoEnvio = ahoraMs;
+}
+
+bool PoliticaReporte::tocaLectura(unsigned long ahoraMs, bool urgente) {
+  if (ahoraMs - ultimaLectura < (urgente ? parametros.lecturaUrgenteMs : parametros.lecturaMs)) {
+    return false;
+  }
+  ultimaLectura = ahoraMs;
+  return true;
+}
+
+// Segundos del fix desde la base, contados como el servidor: desde el ts del reporte
+double PoliticaReporte::segundosDesdeBase(const FixPolitica& fix) const {
+  uint32_t utcBase = estima.getBase().utc;
+  if (utcBase != 0 && fix.utc != 0) {
+    return (double)(int32_t)(fix.utc - utcBase) + fix.utcMs / 1000.0;
+  }
+  return fix.monotono > monotonoBase ? (fix.monotono - monotonoBase) / 1000.0 : 0;
+}
+
+DecisionReporte PoliticaReporte::evaluarFix(const FixPolitica& fix, int factor) {
+  DecisionReporte d = sinReporte();
+  actual = fix;
+
+  if (!conFix) {
+    // El primer fix sale siempre y de inmediato
+    conFix = true;
+    ultimoDecidido = fix;
+    d = reporteActual();
+    d.motivo = REPORTE_PRIMER_FIX;
+    d.urgente = true;
+    return d;
+  }
+
+  if (parametros.estima) {
+    d.segundos = segundosDesdeBase(fix);
+    bool reportar = estima.debeReportar(fix.lat, fix.lon, d.segundos, factor);
+    d.metros = estima.ultimoDesvio();
+    if (reportar) {
+      // Arrancar tras estar estacionado sale de inmediato, como en la regla por distancia
+      d.urgente = estima.getBase().rumbo < 0 && d.metros > parametros.estimaUmbralMetros * factor &&
+                  d.segundos * 1000 >= parametros.heartbeatMs;
+      d.motivo = REPORTE_DESVIO_ESTIMA;
+      d.velocidad = fix.velocidad;
+      d.rumbo = fix.rumbo;
+      ultimoDecidido = fix;
+    }
+    return d;
+  }
+
+  // Con presión sobre el presupuesto de datos el umbral crece
+  d.metros = calcularDistancia(latReportada, lonReportada, fix.lat, fix.lon);
+  if (d.metros > parametros.umbralMetros * factor) {
+    // Velocidad media del tramo desde el último fix reportado, con la hora GNSS
+    double segundos = segundosEntre(ultimoDecidido, fix);
+    if (segundos > 0) {
+      d.velocidad = d.metros / segundos * 3.6;
+    }
+    // Arrancar tras estar estacionado no espera a que mejore el enlace ni a completar un lote
+    d.urgente = fix.monotono - ultimoDecidido.monotono >= parametros.heartbeatMs;
+    d.motivo = REPORTE_MOVIMIENTO;
+    ultimoDecidido = fix;
+  }
+  return d;
+}
+
+EstadoHeartbeat PoliticaReporte::evaluarHeartbeat(unsigned long ahoraMs, int factor) {
+  if (ahoraMs - ultimoEnvio < parametros.heartbeatMs * (unsigned long)factor) {
+    return HEARTBEAT_PENDIENTE;
+  }
+  if (!conFix) {
+    ultimoEnvio = ahoraMs;
+    return HEARTBEAT_SIN_FIX;
+  }
+  if (calcularDistancia(latReportada, lonReportada, actual.lat, actual.lon) > 0.1) {
+    return HEARTBEAT_ENVIAR;
+  }
+  ultimoEnvio = ahoraMs;
+  return HEARTBEAT_SIN_CAMBIO;
+}
+
+DecisionReporte PoliticaReporte::reporteActual() const {
+  DecisionReporte d = sinReporte();
+  d.motivo = REPORTE_HEARTBEAT;
+  if (parametros.estima) {
+    d.velocidad = actual.velocidad;
+    d.rumbo = actual.rumbo;
+  }
+  return d;
+}
+
+void PoliticaReporte::fijarReportado(double lat, double lon, const BaseEstima& base, uint64_t monotono) {
+  latReportada = lat;
+  lonReportada = lon;
+  estima.fijarBase(base);
+  monotonoBase = monotono;
+}
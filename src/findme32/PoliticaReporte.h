@@ -0,0 +1,122 @@
+#ifndef POLITICAREPORTE_H
+#define POLITICAREPORTE_H
+
+#include <stdint.h>
+#include "Estima.h"
+
+// ============================
+// POLÍTICA DE REPORTE
+// ============================
+// Cuándo leer el GNSS y qué fixes reportar, sin dependencias de Arduino: el
+// ciclo principal (findme32.cpp) decide con esta clase y el simulador
+// (simulador/politica.cpp) la reproduce sobre trazas grabadas.
+
+/**
+ * Parámetros de la política; en el firmware salen de config.h
+ */
+struct ParametrosPolitica {
+  double umbralMetros;             // UMBRAL_MOVIMIENTO_METROS
+  unsigned long lecturaMs;         // INTERVALO_LECTURA_GPS
+  unsigned long lecturaUrgenteMs;  // INTERVALO_LECTURA_URGENTE
+  unsigned long heartbeatMs;       // INTERVALO_HEARTBEAT
+  bool estima;                     // REPORTE_ESTIMA
+  double estimaUmbralMetros;       // ESTIMA_UMBRAL_METROS
+  unsigned long estimaIntervaloMs; // ESTIMA_INTERVALO_MAX_MS
+  float estimaVelocidadMinKmh;     // ESTIMA_VELOCIDAD_MIN_KMH
+};
+
+/**
+ * Lo que la política usa de un fix válido (GpsData en el firmware)
+ */
+struct FixPolitica {
+  double lat;
+  double lon;
+  uint32_t utc;       // Segundos Unix, 0 si no se conoce
+  uint16_t utcMs;
+  float velocidad;    // km/h según el GNSS, -1 si no se conoce
+  float rumbo;        // Grados desde el norte, -1 si no se conoce
+  uint64_t monotono;  // ms del reloj monótono al leerlo
+};
+
+enum MotivoReporte {
+  REPORTE_NINGUNO,
+  REPORTE_PRIMER_FIX,
+  REPORTE_MOVIMIENTO,     // Más de umbralMetros desde el último reporte
+  REPORTE_DESVIO_ESTIMA,  // Se apartó de la posición prevista o venció el intervalo
+  REPORTE_HEARTBEAT
+};
+
+enum EstadoHeartbeat {
+  HEARTBEAT_PENDIENTE,   // Aún no toca
+  HEARTBEAT_SIN_FIX,     // Toca, pero no hubo ningún fix: se reinicia la espera
+  HEARTBEAT_SIN_CAMBIO,  // Toca, pero el último fix es el ya reportado: se reinicia la espera
+  HEARTBEAT_ENVIAR
+};
+
+struct DecisionReporte {
+  MotivoReporte motivo;
+  bool urgente;      // Arranque tras estar estacionado: no espera lote ni enlace
+  float velocidad;   // La que viaja en el reporte, -1 sin velocidad
+  float rumbo;       // -1 sin rumbo
+  double metros;     // Distancia al último reporte o desvío de la estima
+  double segundos;   // Desde la base de la estima
+};
+
+/**
+ * Reglas de lectura y reporte del ciclo principal.
+ *
+ * Por distancia, un fix se reporta si se alejó más de umbralMetros del último
+ * reporte, con la velocidad media del tramo; por estima, si se apartó de lo
+ * que extrapola el servidor (ReporteEstima). Un heartbeat reporta el último
+ * fix si nada salió en heartbeatMs. El factor de ConsumoDatos agranda umbral
+ * e intervalos. La política no envía: el ciclo avisa con marcarEnvio() y
+ * fijarReportado() lo que de verdad salió o quedó en cola.
+ */
+class PoliticaReporte {
+public:
+  explicit PoliticaReporte(const ParametrosPolitica& parametros);
+
+  const ParametrosPolitica& getParametros() const { return parametros; }
+
+  // Arranque: las esperas de lectura y heartbeat cuentan desde 'ahoraMs'
+  void iniciar(unsigned long ahoraMs);
+
+  // ¿Leer el GNSS? 'urgente' con seguimientos de "Localizar" pendientes
+  bool tocaLectura(unsigned long ahoraMs, bool urgente);
+
+  // Fix válido recién leído
+  DecisionReporte evaluarFix(const FixPolitica& fix, int factor = 1);
+  EstadoHeartbeat evaluarHeartbeat(unsigned long ahoraMs, int factor = 1);
+
+  // Reporte del último fix leído (heartbeat, eventos de viaje): con estima, con su velocidad y rumbo
+  DecisionReporte reporteActual() const;
+
+  // Velocidad y rumbo redondeados como en la URL: desde aquí extrapola el servidor
+  BaseEstima armarBase(double lat, double lon, float velocidad, float rumbo, uint32_t utc) const {
+    return estima.armarBase(lat, lon, velocidad, rumbo, utc);
+  }
+
+  // Algo llegó al servidor o quedó retenido en la cola: reinicia el heartbeat
+  void marcarEnvio(unsigned long ahoraMs) { ultimoEnvio = ahoraMs; }
+  // El reporte de 'lat', 'lon' salió o quedó en cola: de aquí se mide el movimiento
+  void fijarReportado(double lat, double lon, const BaseEstima& base, uint64_t monotono);
+
+  bool hayFix() const { return conFix; }
+  const FixPolitica& getActual() const { return actual; }
+
+private:
+  ParametrosPolitica parametros;
+  ReporteEstima estima;
+  bool conFix;
+  FixPolitica actual;          // Último fix leído
+  FixPolitica ultimoDecidido;  // Último fix que se decidió reportar por movimiento o estima
+  double latReportada;
+  double lonReportada;
+  uint64_t monotonoBase;
+  unsigned long ultimaLectura;
+  unsigned long ultimoEnvio;
+
+  double segundosDesdeBase(const FixPolitica& fix) const;
+};
+
+#endif // POLITICAREPORTE_H
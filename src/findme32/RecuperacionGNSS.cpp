@@ -0,0 +1,143 @@
+#include "RecuperacionGNSS.h"
+#include "Bitacora.h"
+
+RecuperacionGNSS::RecuperacionGNSS(GPSModule& gpsModule)
+  : gps(gpsModule), activo(false), enRecuperacion(false), pasoActual(PASO_ESPERA), inicioPaso(0),
+    esperandoEncendido(false), ultimoFix(0), ultimosSatelites(0) {
+  memset(estadisticas, 0, sizeof(estadisticas));
+}
+
+const char* RecuperacionGNSS::nombrePaso(PasoRecuperacionGNSS p) {
+  switch (p) {
+    case PASO_ESPERA:        return "espera";
+    case PASO_CALIENTE:      return "reinicio caliente";
+    case PASO_TIBIO:         return "reinicio tibio";
+    case PASO_FRIO:          return "reinicio frío";
+    case PASO_CICLO_ENERGIA: return "ciclo de energía";
+    default:                 return "?";
+  }
+}
+
+unsigned long RecuperacionGNSS::ventana(PasoRecuperacionGNSS p) {
+  switch (p) {
+    case PASO_ESPERA:        return GNSS_VENTANA_ESPERA_MS;
+    case PASO_CALIENTE:      return GNSS_VENTANA_CALIENTE_MS;
+    case PASO_TIBIO:         return GNSS_VENTANA_TIBIO_MS;
+    case PASO_FRIO:          return GNSS_VENTANA_FRIO_MS;
+    default:                 return GNSS_VENTANA_CICLO_MS;
+  }
+}
+
+void RecuperacionGNSS::registrarLectura(const GpsData& lectura) {
+  unsigned long ahora = millis();
+  ultimosSatelites = lectura.satelites;
+
+  if (lectura.valida) {
+    ultimoFix = ahora;
+    if (enRecuperacion) {
+      cerrarPaso(true, ahora);
+      enRecuperacion = false;
+      pasoActual = PASO_ESPERA;
+    }
+  } else if (!enRecuperacion && activo && !esperandoEncendido) {
+    // Se perdió el fix: primero solo esperar
+    enRecuperacion = true;
+    iniciarPaso(PASO_ESPERA, ahora);
+  }
+}
+
+void RecuperacionGNSS::iniciarPaso(PasoRecuperacionGNSS p, unsigned long ahora) {
+  pasoActual = p;
+  inicioPaso = ahora;
+  estadisticas[p].intentos++;
+}
+
+void RecuperacionGNSS::cerrarPaso(bool exito, unsigned long ahora) {
+  unsigned long duracion = ahora - inicioPaso;
+  EstadisticaPasoGNSS& e = estadisticas[pasoActual];
+  e.costeMs += duracion;
+  if (exito) {
+    e.exitos++;
+    LOG_INFO("✓ GNSS recuperado tras %s (%lu s)", nombrePaso(pasoActual), duracion / 1000);
+  } else {
+    LOG_AVISO("GNSS sin fix tras %s (%lu s, %d satélites). Escalando...", nombrePaso(pasoActual), duracion / 1000,
+              ultimosSatelites);
+  }
+  imprimirEstadistica(pasoActual);
+}
+
+void RecuperacionGNSS::imprimirEstadistica(PasoRecuperacionGNSS p) const {
+  const EstadisticaPasoGNSS& e = estadisticas[p];
+  if (e.intentos == 0) {
+    return;
+  }
+  LOG_INFO("Estadística GNSS [%s]: %u/%u éxitos (%u%%), coste medio %lu s", nombrePaso(p), (unsigned)e.exitos,
+           (unsigned)e.intentos, (unsigned)(e.exitos * 100 / e.intentos), e.costeMs / e.intentos / 1000);
+}
+
+bool RecuperacionGNSS::aplicarPaso(PasoRecuperacionGNSS p) {
+  switch (p) {
+    case PASO_CALIENTE:
+      return gps.reiniciar(REINICIO_CALIENTE);
+    case PASO_TIBIO:
+      return gps.reiniciar(REINICIO_TIBIO);
+    case PASO_FRIO:
+      return gps.reiniciar(REINICIO_FRIO);
+    case PASO_CICLO_ENERGIA:
+      // El encendido se hace en una llamada posterior, pasada la pausa
+      gps.apagar();
+      esperandoEncendido = true;
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool RecuperacionGNSS::atender(bool gnssEncendido) {
+  unsigned long ahora = millis();
+
+  if (!gnssEncendido) {
+    // Apagado a propósito (ciclo de trabajo en reposo): no es una falla
+    activo = false;
+    enRecuperacion = false;
+    esperandoEncendido = false;
+    return false;
+  }
+
+  if (!activo) {
+    // Encendido nuevo: la búsqueda inicial cuenta como un paso de espera
+    activo = true;
+    enRecuperacion = true;
+    iniciarPaso(PASO_ESPERA, ahora);
+    return false;
+  }
+
+  if (esperandoEncendido) {
+    if (ahora - inicioPaso < GNSS_PAUSA_APAGADO_MS) {
+      return false;
+    }
+    esperandoEncendido = false;
+    gps.inicializar();
+    return true;
+  }
+
+  if (!enRecuperacion) {
+    return false;
+  }
+
+  // Con satélites suficientes el receptor está por obtener fix: darle más tiempo
+  unsigned long limite = ventana(pasoActual);
+  if (ultimosSatelites >= GNSS_SATELITES_PROGRESO) {
+    limite *= 2;
+  }
+  if (ahora - inicioPaso < limite) {
+    return false;
+  }
+
+  cerrarPaso(false, ahora);
+
+  // Tras el ciclo de energía se vuelve a empezar (p.ej. estacionado bajo techo)
+  PasoRecuperacionGNSS siguiente = (PasoRecuperacionGNSS)((pasoActual + 1) % TOTAL_PASOS_GNSS);
+  iniciarPaso(siguiente, ahora);
+  return aplicarPaso(siguiente);
+}
@@ -0,0 +1,77 @@
+#ifndef RECUPERACIONGNSS_H
+#define RECUPERACIONGNSS_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "GPSModule.h"
+
+/**
+ * Pasos de recuperación, en orden de escalamiento
+ */
+enum PasoRecuperacionGNSS {
+  PASO_ESPERA,          // Solo esperar: el receptor sigue buscando
+  PASO_CALIENTE,        // AT+CGPSHOT
+  PASO_TIBIO,           // AT+CGPSWARM
+  PASO_FRIO,            // AT+CGPSCOLD
+  PASO_CICLO_ENERGIA,   // AT+CGNSSPWR=0 / AT+CGNSSPWR=1
+  TOTAL_PASOS_GNSS
+};
+
+/**
+ * Estadísticas de un paso de recuperación
+ */
+struct EstadisticaPasoGNSS {
+  uint16_t intentos;
+  uint16_t exitos;
+  unsigned long costeMs;  // Tiempo acumulado desde la acción hasta el fix o el escalamiento
+};
+
+/**
+ * Máquina de estados de salud del GNSS.
+ *
+ * Recibe el resultado de cada lectura (fix, satélites en uso) y, si pasa la
+ * ventana del paso actual sin fix, escala a la siguiente acción. Mientras el
+ * receptor reporte satélites suficientes la ventana se alarga: está cerca del
+ * fix y reiniciarlo solo lo retrasaría. Ninguna acción bloquea el ciclo: el
+ * apagado del ciclo de energía se completa en una llamada posterior.
+ *
+ * Por cada paso se cuentan intentos, éxitos (fix dentro de su ventana) y el
+ * tiempo invertido, para ajustar las ventanas con datos reales.
+ */
+class RecuperacionGNSS {
+public:
+  RecuperacionGNSS(GPSModule& gps);
+
+  void registrarLectura(const GpsData& lectura);
+
+  // Devuelve true si en esta llamada se aplicó una acción sobre el receptor
+  bool atender(bool gnssEncendido);
+
+  PasoRecuperacionGNSS paso() const { return pasoActual; }
+  bool recuperando() const { return enRecuperacion; }
+  unsigned long instanteUltimoFix() const { return ultimoFix; }
+  const EstadisticaPasoGNSS& estadistica(PasoRecuperacionGNSS p) const { return estadisticas[p]; }
+
+private:
+  GPSModule& gps;
+
+  bool activo;
+  bool enRecuperacion;
+  PasoRecuperacionGNSS pasoActual;
+  unsigned long inicioPaso;
+  bool esperandoEncendido;
+
+  unsigned long ultimoFix;
+  int ultimosSatelites;
+
+  EstadisticaPasoGNSS estadisticas[TOTAL_PASOS_GNSS];
+
+  void iniciarPaso(PasoRecuperacionGNSS p, unsigned long ahora);
+  bool aplicarPaso(PasoRecuperacionGNSS p);
+  void cerrarPaso(bool exito, unsigned long ahora);
+  void imprimirEstadistica(PasoRecuperacionGNSS p) const;
+  static unsigned long ventana(PasoRecuperacionGNSS p);
+  static const char* nombrePaso(PasoRecuperacionGNSS p);
+};
+
+#endif // RECUPERACIONGNSS_H
@@ -0,0 +1,253 @@
+#include "RegistroViajes.h"
+#include "Bitacora.h"
+#include "GeoUtils.h"
+#include <math.h>
+
+static int32_t aMillonesimas(double grados) {
+  return (int32_t)lround(grados * 1e6);
+}
+
+static uint16_t aDecimas(double kmh) {
+  long d = lround(kmh * 10);
+  return d < 0 ? 0 : (d > 0xFFFF ? 0xFFFF : (uint16_t)d);
+}
+
+RegistroViajes::RegistroViajes() : nEventos(0), metrosGuardados(0), utcGuardado(0), vecesGuardado(0) {
+  memset(&estado, 0, sizeof(estado));
+}
+
+void RegistroViajes::begin() {
+  preferences.begin("viajes", true);
+  size_t leidos = preferences.getBytes("estado", &estado, sizeof(estado));
+  size_t largoEventos = preferences.getBytesLength("eventos");
+  if (largoEventos % sizeof(EventoViaje) == 0 && largoEventos <= sizeof(eventos)) {
+    nEventos = preferences.getBytes("eventos", eventos, largoEventos) / sizeof(EventoViaje);
+  }
+  preferences.end();
+  if (leidos != sizeof(estado)) {
+    memset(&estado, 0, sizeof(estado));  // Primer arranque o formato anterior
+  }
+  metrosGuardados = estado.metros;
+  utcGuardado = estado.ultimoUtc;
+  LOG_INFO("Viajes: odómetro %.1f km, %lu viajes%s, %d eventos pendientes", estado.odometro / 1000.0,
+           (unsigned long)estado.numero, estado.enViaje ? " (uno en curso)" : "", nEventos);
+}
+
+void RegistroViajes::guardarEstado() {
+  preferences.begin("viajes", false);
+  preferences.putBytes("estado", &estado, sizeof(estado));
+  preferences.end();
+  metrosGuardados = estado.metros;
+  utcGuardado = estado.ultimoUtc;
+  vecesGuardado++;
+}
+
+void RegistroViajes::guardarEventos() {
+  preferences.begin("viajes", false);
+  preferences.putBytes("eventos", eventos, nEventos * sizeof(EventoViaje));
+  preferences.end();
+  vecesGuardado++;
+}
+
+void RegistroViajes::agregarEvento(const EventoViaje& e) {
+  if (nEventos == VIAJES_EVENTOS_MAX) {
+    LOG_AVISO("Viajes: eventos sin confirmar llenos. Se descarta el más antiguo (%c)", (char)eventos[0].tipo);
+    memmove(eventos, eventos + 1, (nEventos - 1) * sizeof(EventoViaje));
+    nEventos--;
+  }
+  eventos[nEventos++] = e;
+  guardarEventos();
+}
+
+void RegistroViajes::confirmarEventos(int n) {
+  if (n <= 0) {
+    return;
+  }
+  if (n > nEventos) {
+    n = nEventos;
+  }
+  memmove(eventos, eventos + n, (nEventos - n) * sizeof(EventoViaje));
+  nEventos -= n;
+  guardarEventos();
+}
+
+void RegistroViajes::iniciarViaje(double lat, double lon, uint32_t utc) {
+  estado.enViaje = true;
+  estado.numero++;
+  estado.inicioUtc = utc;
+  estado.inicioLat = lat;
+  estado.inicioLon = lon;
+  estado.metros = 0;
+  estado.ocioso = 0;
+  estado.ociosoParada = 0;
+  estado.vmax = 0;
+  estado.quietoDesde = 0;
+  LOG_INFO("Viajes: inicio del viaje %lu", (unsigned long)estado.numero);
+
+  EventoViaje e;
+  memset(&e, 0, sizeof(e));
+  e.tipo = EVENTO_INICIO;
+  e.numero = estado.numero;
+  e.utc = utc;
+  e.lat = aMillonesimas(lat);
+  e.lon = aMillonesimas(lon);
+  agregarEvento(e);
+}
+
+// El viaje termina en el primer fix de la parada, no al cumplirse la espera
+void RegistroViajes::terminarViaje(bool contarOcioso) {
+  if (contarOcioso) {
+    estado.ocioso += estado.ociosoParada;
+  }
+  uint32_t duracion = estado.quietoDesde - estado.inicioUtc;
+  LOG_INFO("Viajes: fin del viaje %lu (%.2f km en %lu min, %lu min ocioso, máx %.1f km/h)",
+           (unsigned long)estado.numero, estado.metros / 1000.0, (unsigned long)duracion / 60,
+           (unsigned long)estado.ocioso / 60, estado.vmax / 10.0);
+
+  EventoViaje e;
+  e.tipo = EVENTO_FIN;
+  e.numero = estado.numero;
+  e.utc = estado.quietoDesde;
+  e.lat = aMillonesimas(estado.quietoLat);
+  e.lon = aMillonesimas(estado.quietoLon);
+  e.metros = (uint32_t)lround(estado.metros);
+  e.segundos = duracion;
+  e.ocioso = estado.ocioso;
+  e.vmax = estado.vmax;
+  e.odometro = (uint32_t)lround(estado.odometro);
+  agregarEvento(e);
+
+  estado.resumenViajes++;
+  estado.resumenMetros += estado.metros;
+  estado.resumenMarcha += duracion;
+  estado.resumenOcioso += estado.ocioso;
+  if (estado.vmax > estado.resumenVmax) {
+    estado.resumenVmax = estado.vmax;
+  }
+  estado.enViaje = false;
+  estado.quietoDesde = 0;
+  // Estacionado, el ancla es el lugar de la parada
+  estado.anclaLat = estado.quietoLat;
+  estado.anclaLon = estado.quietoLon;
+}
+
+void RegistroViajes::emitirResumen(double lat, double lon, uint32_t utc) {
+  EventoViaje e;
+  e.tipo = EVENTO_RESUMEN;
+  e.numero = estado.resumenViajes;
+  e.utc = utc;
+  e.lat = aMillonesimas(lat);
+  e.lon = aMillonesimas(lon);
+  e.metros = (uint32_t)lround(estado.resumenMetros);
+  e.segundos = estado.resumenMarcha;
+  e.ocioso = estado.resumenOcioso;
+  e.vmax = estado.resumenVmax;
+  e.odometro = (uint32_t)lround(estado.odometro);
+  agregarEvento(e);
+  LOG_INFO("Viajes: resumen de %lu viajes, %.2f km", (unsigned long)e.numero, estado.resumenMetros / 1000.0);
+
+  estado.resumenDesde = utc;
+  estado.resumenViajes = 0;
+  estado.resumenMetros = 0;
+  estado.resumenMarcha = 0;
+  estado.resumenOcioso = 0;
+  estado.resumenVmax = 0;
+}
+
+void RegistroViajes::registrarFix(double lat, double lon, float velocidad, uint32_t utc, int ignicion) {
+  if (utc == 0 || (estado.ultimoUtc != 0 && utc <= estado.ultimoUtc)) {
+    return;  // Sin hora no se puede fechar; repetido o fuera de orden
+  }
+  bool transicion = false;
+
+  // Filtro: un salto más rápido que VIAJES_VELOCIDAD_MAX_KMH es un fix malo
+  double distancia = 0;
+  double kmhTramo = -1;
+  if (estado.hayAncla) {
+    distancia = calcularDistancia(estado.anclaLat, estado.anclaLon, lat, lon);
+    if (utc > estado.anclaUtc) {
+      kmhTramo = distancia / (utc - estado.anclaUtc) * 3.6;
+      if (kmhTramo > VIAJES_VELOCIDAD_MAX_KMH) {
+        LOG_AVISO("Viajes: fix descartado (salto de %.0fm a %.0f km/h)", distancia, kmhTramo);
+        return;
+      }
+    }
+  } else {
+    estado.hayAncla = true;
+    estado.anclaLat = lat;
+    estado.anclaLon = lon;
+    estado.anclaUtc = utc;
+    transicion = true;
+  }
+  bool desplazado = distancia >= VIAJES_RUIDO_METROS;
+  bool enMovimiento = desplazado || velocidad >= VIAJES_VELOCIDAD_MOVIMIENTO_KMH;
+
+  if (estado.resumenDesde == 0) {
+    estado.resumenDesde = utc;
+    transicion = true;
+  }
+
+  // Estacionado, un salto sin velocidad del GNSS es multitrayecto: no abre un viaje
+  bool arranque = desplazado && (velocidad < 0 || velocidad >= VIAJES_VELOCIDAD_MOVIMIENTO_KMH);
+  if (!estado.enViaje && (arranque || ignicion == 1)) {
+    // La salida es el lugar donde estaba estacionado
+    iniciarViaje(estado.anclaLat, estado.anclaLon, utc);
+    transicion = true;
+  }
+
+  if (estado.enViaje) {
+    if (desplazado) {
+      estado.metros += distancia;
+      estado.odometro += distancia;
+      estado.anclaLat = lat;
+      estado.anclaLon = lon;
+      estado.anclaUtc = utc;
+    }
+    double kmh = velocidad >= 0 ? velocidad : (desplazado ? kmhTramo : 0);
+    if (kmh <= VIAJES_VELOCIDAD_MAX_KMH && aDecimas(kmh) > estado.vmax) {
+      estado.vmax = aDecimas(kmh);
+    }
+
+    if (enMovimiento) {
+      // Fin de una parada corta: lo que estuvo encendido cuenta como ocioso
+      estado.ocioso += estado.ociosoParada;
+      estado.ociosoParada = 0;
+      estado.quietoDesde = 0;
+    } else if (estado.quietoDesde == 0) {
+      estado.quietoDesde = utc;
+      estado.quietoLat = estado.anclaLat;
+      estado.quietoLon = estado.anclaLon;
+    } else {
+      if (ignicion != 0) {
+        estado.ociosoParada += utc - estado.ultimoUtc;
+      }
+      if (ignicion != 1 && utc - estado.quietoDesde >= VIAJES_PARADA_S) {
+        // Con cable, el motor encendido hasta apagarse fue ocioso; sin él, la espera es estacionamiento
+        terminarViaje(ignicion == 0);
+        transicion = true;
+      }
+    }
+  }
+  estado.ultimoUtc = utc;
+
+  if (!estado.enViaje && utc - estado.resumenDesde >= VIAJES_RESUMEN_S) {
+    emitirResumen(lat, lon, utc);
+    transicion = true;
+  }
+
+  // Escrituras acotadas: transiciones y, en viaje, cada tanto recorrido o tiempo
+  if (transicion || (estado.enViaje && (estado.metros - metrosGuardados >= VIAJES_GUARDAR_CADA_METROS ||
+                                        utc - utcGuardado >= VIAJES_GUARDAR_CADA_S))) {
+    guardarEstado();
+  }
+}
+
+int RegistroViajes::formatearEvento(const EventoViaje& e, char* destino, size_t n) {
+  int m = snprintf(destino, n, "%c,%lu,%lu,%ld,%ld", (char)e.tipo, (unsigned long)e.numero, (unsigned long)e.utc,
+                   (long)e.lat, (long)e.lon);
+  if (e.tipo != EVENTO_INICIO && m >= 0 && (size_t)m < n) {
+    m += snprintf(destino + m, n - m, ",%lu,%lu,%lu,%u,%lu", (unsigned long)e.metros, (unsigned long)e.segundos,
+                  (unsigned long)e.ocioso, (unsigned)e.vmax, (unsigned long)e.odometro);
+  }
+  return m;
+}
@@ -0,0 +1,119 @@
+#ifndef REGISTROVIAJES_H
+#define REGISTROVIAJES_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "config.h"
+
+#define VIAJES_LARGO_EVENTO 112  // Un evento formateado, con holgura para los campos al máximo
+
+enum TipoEventoViaje {
+  EVENTO_INICIO = 'i',
+  EVENTO_FIN = 'f',
+  EVENTO_RESUMEN = 'r'
+};
+
+/**
+ * Evento compacto que viaja con el siguiente reporte (parámetro "viaje")
+ */
+struct EventoViaje {
+  uint8_t tipo;        // TipoEventoViaje
+  uint32_t numero;     // Viaje (inicio y fin) o viajes del periodo (resumen)
+  uint32_t utc;        // Salida, llegada o cierre del periodo
+  int32_t lat;         // Millonésimas de grado: salida, parada o posición actual
+  int32_t lon;
+  uint32_t metros;     // Recorridos en el viaje o en el periodo
+  uint32_t segundos;   // En marcha
+  uint32_t ocioso;     // Detenido con el motor encendido
+  uint16_t vmax;       // km/h x 10
+  uint32_t odometro;   // Metros totales del dispositivo
+};
+
+/**
+ * Estado en curso, persistido en NVS ("viajes")
+ */
+struct EstadoViajes {
+  bool enViaje;
+  uint32_t numero;       // Último viaje iniciado
+  double odometro;       // Metros, solo desplazamientos filtrados
+  // Ancla del odómetro: último punto aceptado
+  bool hayAncla;
+  double anclaLat;
+  double anclaLon;
+  uint32_t anclaUtc;
+  // Viaje en curso
+  uint32_t inicioUtc;
+  double inicioLat;
+  double inicioLon;
+  double metros;
+  uint32_t ocioso;
+  uint32_t ociosoParada;   // De la parada en curso: cuenta si el viaje sigue
+  uint16_t vmax;
+  uint32_t quietoDesde;    // Primer fix de la parada en curso; 0 en marcha
+  double quietoLat;
+  double quietoLon;
+  uint32_t ultimoUtc;
+  // Periodo del resumen
+  uint32_t resumenDesde;
+  uint32_t resumenViajes;
+  double resumenMetros;
+  uint32_t resumenMarcha;
+  uint32_t resumenOcioso;
+  uint16_t resumenVmax;
+};
+
+/**
+ * Viajes, odómetro y tiempo ocioso calculados en el dispositivo.
+ *
+ * Un viaje empieza con la ignición (VIAJES_PIN_IGNICION) o con el primer fix
+ * en movimiento, y termina tras VIAJES_PARADA_S detenido con la ignición
+ * apagada o sin cable de ignición. El odómetro suma solo los desplazamientos
+ * mayores que VIAJES_RUIDO_METROS desde el último punto aceptado y descarta
+ * los saltos imposibles, así el ruido del GNSS estacionado no suma metros.
+ *
+ * Inicio, fin y un resumen cada VIAJES_RESUMEN_S quedan como eventos
+ * pendientes hasta que un reporte que los lleva llega al servidor. El estado
+ * se guarda en NVS en cada transición y, durante un viaje, cada
+ * VIAJES_GUARDAR_CADA_METROS o VIAJES_GUARDAR_CADA_S; estacionado no escribe.
+ */
+class RegistroViajes {
+public:
+  RegistroViajes();
+
+  void begin();
+
+  // Fix leído; 'ignicion' -1 sin cable, 0 apagada, 1 encendida. Sin 'utc' no se cuenta.
+  void registrarFix(double lat, double lon, float velocidad, uint32_t utc, int ignicion);
+
+  bool enViaje() const { return estado.enViaje; }
+  double odometro() const { return estado.odometro; }
+  const EstadoViajes& getEstado() const { return estado; }
+
+  int eventosPendientes() const { return nEventos; }
+  const EventoViaje& evento(int indice) const { return eventos[indice]; }  // 0 = más antiguo
+  // Los 'n' más antiguos llegaron al servidor con un reporte
+  void confirmarEventos(int n);
+
+  int escrituras() const { return vecesGuardado; }
+
+  // "i,12,1714558222,18926113,-99230733"; fin y resumen agregan metros, segundos, ocioso, vmax y odómetro
+  static int formatearEvento(const EventoViaje& e, char* destino, size_t n);
+
+private:
+  Preferences preferences;
+  EstadoViajes estado;
+  EventoViaje eventos[VIAJES_EVENTOS_MAX];
+  int nEventos;
+  double metrosGuardados;
+  uint32_t utcGuardado;
+  int vecesGuardado;
+
+  void iniciarViaje(double lat, double lon, uint32_t utc);
+  void terminarViaje(bool contarOcioso);
+  void emitirResumen(double lat, double lon, uint32_t utc);
+  void agregarEvento(const EventoViaje& e);
+  void guardarEstado();
+  void guardarEventos();
+};
+
+#endif // REGISTROVIAJES_H
@@ -0,0 +1,65 @@
+#include "RelojGNSS.h"
+#include "Bitacora.h"
+
+RelojGNSS::RelojGNSS()
+  : ultimoMillis(0), acumulado(0), referenciaUtcMs(0), referenciaMonotono(0) {}
+
+uint64_t RelojGNSS::ahora() {
+  return extender((uint32_t)millis());
+}
+
+uint64_t RelojGNSS::extender(uint32_t ms) {
+  // La resta sin signo de 32 bits atraviesa el desborde de millis()
+  acumulado += (uint32_t)(ms - ultimoMillis);
+  ultimoMillis = ms;
+  return acumulado;
+}
+
+void RelojGNSS::sincronizar(const GpsData& fix) {
+  if (fix.valida && fix.utc != 0 && fix.monotono != 0) {
+    sincronizar(fix.utc, fix.utcMs, fix.monotono);
+  }
+}
+
+void RelojGNSS::sincronizar(uint32_t utc, uint16_t utcMs, uint64_t monotono) {
+  uint64_t nuevaUtcMs = (uint64_t)utc * 1000 + utcMs;
+
+  // Se llama con cada URC +CGNSSINFO: los avisos no usan el heap
+  if (!sincronizado()) {
+    LOG_INFO("Reloj: hora UTC del GNSS %lu", (unsigned long)utc);
+  } else {
+    // Lo que el reloj habría dicho frente a lo que dice el GNSS
+    int64_t correccion = (int64_t)(nuevaUtcMs - utcMsDe(monotono));
+    if (correccion > RELOJ_SALTO_AVISO_MS || correccion < -RELOJ_SALTO_AVISO_MS) {
+      LOG_AVISO("Reloj: corrección de %ld s respecto al GNSS", (long)(correccion / 1000));
+    }
+  }
+  referenciaUtcMs = nuevaUtcMs;
+  referenciaMonotono = monotono;
+}
+
+uint64_t RelojGNSS::utcMsDe(uint64_t monotono) const {
+  if (!sincronizado()) {
+    return 0;
+  }
+  // Instantes anteriores al ancla también se convierten (fixes en cola)
+  return referenciaUtcMs + (int64_t)(monotono - referenciaMonotono);
+}
+
+uint64_t RelojGNSS::monotonoDe(uint64_t utcMs) const {
+  if (!sincronizado()) {
+    return 0;
+  }
+  return referenciaMonotono + (int64_t)(utcMs - referenciaUtcMs);
+}
+
+double RelojGNSS::segundosEntre(const GpsData& antes, const GpsData& despues) {
+  if (antes.utc != 0 && despues.utc != 0) {
+    int64_t ms = ((int64_t)despues.utc - antes.utc) * 1000 + ((int)despues.utcMs - antes.utcMs);
+    return ms > 0 ? ms / 1000.0 : 0;
+  }
+  if (antes.monotono != 0 && despues.monotono > antes.monotono) {
+    return (despues.monotono - antes.monotono) / 1000.0;
+  }
+  return 0;
+}
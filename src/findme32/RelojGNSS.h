@@ -0,0 +1,54 @@
+#ifndef RELOJGNSS_H
+#define RELOJGNSS_H
+
+#include <Arduino.h>
+#include "GPSModule.h"
+
+// Corrección al resincronizar a partir de la cual se avisa por el monitor
+#define RELOJ_SALTO_AVISO_MS 2000
+
+/**
+ * Reloj monótono del dispositivo y su relación con la hora UTC del GNSS.
+ *
+ * millis() es de 32 bits y se desborda a los 49.7 días; ahora() lo extiende a
+ * 64 bits acumulando la diferencia sin signo desde la última lectura, así que
+ * basta con consultarlo al menos una vez por desborde (el ciclo principal lo
+ * hace en cada vuelta).
+ *
+ * Cada fix con fecha y hora vuelve a anclar el reloj: el par (UTC del fix,
+ * instante monótono en que se leyó) permite convertir en ambos sentidos. La
+ * deriva del cristal entre fixes es de milisegundos.
+ */
+class RelojGNSS {
+public:
+  RelojGNSS();
+
+  // Milisegundos monótonos desde el arranque, sin desbordes
+  uint64_t ahora();
+  // Extiende una lectura de millis(); público para las pruebas
+  uint64_t extender(uint32_t ms);
+
+  // Ancla el reloj con un fix que trae hora GNSS; los demás se ignoran
+  void sincronizar(const GpsData& fix);
+  void sincronizar(uint32_t utc, uint16_t utcMs, uint64_t monotono);
+  bool sincronizado() const { return referenciaUtcMs != 0; }
+
+  // Conversiones; 0 si aún no hay hora GNSS
+  uint64_t utcMsDe(uint64_t monotono) const;
+  uint32_t utcDe(uint64_t monotono) const { return (uint32_t)(utcMsDe(monotono) / 1000); }
+  uint64_t monotonoDe(uint64_t utcMs) const;
+  uint32_t ahoraUTC() { return utcDe(ahora()); }
+
+  // Segundos entre dos fixes: por la hora GNSS si ambos la traen, si no por el
+  // instante monótono de lectura. 0 si no se puede saber.
+  static double segundosEntre(const GpsData& antes, const GpsData& despues);
+
+private:
+  uint32_t ultimoMillis;
+  uint64_t acumulado;
+
+  uint64_t referenciaUtcMs;
+  uint64_t referenciaMonotono;
+};
+
+#endif // RELOJGNSS_H
@@ -0,0 +1,123 @@
+#include "RespaldoSMS.h"
+#include "Bitacora.h"
+#include "FormatoSMS.h"
+
+#define RESPALDO_SMS_VENTANA_MS (24UL * 60 * 60 * 1000)
+
+// Carga de un lote completo: RESPALDO_SMS_MAX_PARTES no puede pedir más que la cola de reportes
+#define RESPALDO_SMS_CAPACIDAD \
+  (RESPALDO_SMS_MAX_PARTES == 1 ? SMS_BINARIO_MAX : RESPALDO_SMS_MAX_PARTES * (SMS_BINARIO_MAX - SMS_UDH_CONCATENADO))
+
+static_assert(RESPALDO_SMS_MAX_PARTES >= 1 && RESPALDO_SMS_MAX_PARTES <= SMS_UMBRAL_CARGA,
+              "Un lote por SMS debe caber en la cola de salida");
+
+RespaldoSMS::RespaldoSMS(ColaSMS& colaSMS, ColaReportes& colaReportes, const char* numeroPasarela)
+  : cola(colaSMS), reportes(colaReportes), pasarela(numeroPasarela), datosCaidos(false), caidaDesde(0),
+    ultimoLote(0), huboLote(false), inicioVentana(0), enviadosVentana(0), secuenciaEnviada(0), secuenciaLote(0),
+    partesEnCurso(0), loteFallido(false) {}
+
+void RespaldoSMS::registrarEnvio(ResultadoEnvio resultado) {
+  if (resultado == ENVIO_ERROR_CONFIG) {
+    return;  // No dice nada de la conexión
+  }
+
+  if (resultado == ENVIO_OK || resultado == ENVIO_ERROR_SERVIDOR) {
+    if (datosCaidos && activo()) {
+      LOG_INFO("Datos de vuelta tras %lu min: fin del respaldo por SMS", (millis() - caidaDesde) / 60000);
+    }
+    datosCaidos = false;
+    return;
+  }
+
+  if (!datosCaidos) {
+    datosCaidos = true;
+    caidaDesde = millis();
+  }
+}
+
+bool RespaldoSMS::activo() const {
+  return pasarela[0] != '\0' && datosCaidos && millis() - caidaDesde >= RESPALDO_SMS_CAIDA_MS;
+}
+
+// Los pendientes que aún no salieron por SMS, del más antiguo al más nuevo
+int RespaldoSMS::armarLote(uint8_t* carga, size_t& largo) {
+  const int maximo = (RESPALDO_SMS_CAPACIDAD - REPORTE_SMS_CABECERA) / REPORTE_SMS_BYTES;
+  ReporteSMS lote[REPORTES_COLA_CAPACIDAD];
+  int n = 0;
+  for (int i = 0; i < reportes.pendientes() && n < maximo && n < REPORTES_COLA_CAPACIDAD; i++) {
+    const Reporte& r = reportes.en(i);
+    if (r.secuencia <= secuenciaEnviada) {
+      continue;
+    }
+    ReporteSMS& s = lote[n++];
+    s.secuencia = r.secuencia;
+    s.utc = r.utc;
+    s.lat = (int32_t)lround(r.lat * 1e6);
+    s.lon = (int32_t)lround(r.lon * 1e6);
+    long decimas = lround(r.velocidad * 10);
+    s.velocidad = r.velocidad < 0 ? REPORTE_SMS_SIN_VELOCIDAD
+                                   : (uint16_t)(decimas < REPORTE_SMS_SIN_VELOCIDAD ? decimas : REPORTE_SMS_SIN_VELOCIDAD - 1);
+  }
+  if (n == 0) {
+    return 0;
+  }
+  secuenciaLote = lote[n - 1].secuencia;
+  largo = empaquetarReportes(reportes.masAntiguo().secuencia, lote, n, carga);
+  return n;
+}
+
+bool RespaldoSMS::atender() {
+  if (!activo() || partesEnCurso > 0) {
+    return false;
+  }
+  unsigned long ahora = millis();
+  if (huboLote && ahora - ultimoLote < RESPALDO_SMS_INTERVALO_MS) {
+    return false;
+  }
+  if (ahora - inicioVentana >= RESPALDO_SMS_VENTANA_MS) {
+    inicioVentana = ahora;
+    enviadosVentana = 0;
+  }
+
+  uint8_t carga[REPORTE_SMS_CABECERA + REPORTES_COLA_CAPACIDAD * REPORTE_SMS_BYTES];
+  size_t largo = 0;
+  int n = armarLote(carga, largo);
+  if (n == 0) {
+    return false;  // Nada nuevo desde el último lote
+  }
+
+  int partes = ColaSMS::partesBinario(largo);
+  if (enviadosVentana + partes > RESPALDO_SMS_MAX_DIA) {
+    LOG_AVISO("Respaldo por SMS: límite diario alcanzado (%d SMS)", enviadosVentana);
+    huboLote = true;
+    ultimoLote = ahora;  // Volver a mirar en un intervalo
+    return false;
+  }
+  if (cola.encolarBinario(pasarela, carga, largo, alTerminarParte, this) == 0) {
+    return false;  // Cola de SMS ocupada: se intenta en la siguiente vuelta
+  }
+
+  LOG_INFO("Datos caídos hace %lu min: %d reportes por SMS en %d partes", (ahora - caidaDesde) / 60000, n, partes);
+  huboLote = true;
+  ultimoLote = ahora;
+  enviadosVentana += partes;
+  partesEnCurso = partes;
+  loteFallido = false;
+  return true;
+}
+
+void RespaldoSMS::alTerminarParte(bool enviado, void* contexto) {
+  RespaldoSMS* self = (RespaldoSMS*)contexto;
+  if (!enviado) {
+    self->loteFallido = true;
+  }
+  if (--self->partesEnCurso > 0) {
+    return;
+  }
+  if (self->loteFallido) {
+    LOG_AVISO("✗ Lote por SMS incompleto: se repetirá en el próximo intervalo");
+  } else {
+    self->secuenciaEnviada = self->secuenciaLote;
+    LOG_INFO("✓ Reportes hasta la secuencia %lu entregados al centro de mensajes", (unsigned long)self->secuenciaEnviada);
+  }
+}
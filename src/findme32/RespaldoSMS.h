@@ -0,0 +1,58 @@
+#ifndef RESPALDOSMS_H
+#define RESPALDOSMS_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "ColaReportes.h"
+#include "ColaSMS.h"
+#include "HTTPClient.h"
+
+/**
+ * Respaldo de los reportes por SMS cuando la conexión de datos no funciona.
+ *
+ * Cuenta cuánto lleva caída la conexión a partir del resultado de cada sesión
+ * HTTP. Pasado RESPALDO_SMS_CAIDA_MS, empaqueta los reportes en cola que aún
+ * no salieron por SMS (FormatoSMS.h) y los envía en un SMS binario, en partes
+ * concatenadas si hace falta, al número de la pasarela. Como mucho un lote
+ * cada RESPALDO_SMS_INTERVALO_MS y RESPALDO_SMS_MAX_DIA SMS por día.
+ *
+ * Los reportes siguen en la ColaReportes: al volver los datos se reenvían por
+ * HTTP y el servidor descarta los que ya recibió de la pasarela por su
+ * secuencia. Si una parte del lote no sale, el lote se repite entero.
+ */
+class RespaldoSMS {
+public:
+  // numeroPasarela: formato internacional; "" deshabilita el respaldo
+  RespaldoSMS(ColaSMS& cola, ColaReportes& reportes, const char* numeroPasarela);
+
+  void registrarEnvio(ResultadoEnvio resultado);
+
+  // Devuelve true si en esta llamada se encoló un lote
+  bool atender();
+
+  bool activo() const;
+  uint32_t enviadoHasta() const { return secuenciaEnviada; }
+
+private:
+  ColaSMS& cola;
+  ColaReportes& reportes;
+  const char* pasarela;
+
+  bool datosCaidos;
+  unsigned long caidaDesde;
+
+  unsigned long ultimoLote;
+  bool huboLote;
+  unsigned long inicioVentana;
+  int enviadosVentana;
+
+  uint32_t secuenciaEnviada;  // La más alta que llegó al centro de mensajes
+  uint32_t secuenciaLote;     // La más alta del lote en curso
+  int partesEnCurso;
+  bool loteFallido;
+
+  int armarLote(uint8_t* carga, size_t& largo);
+  static void alTerminarParte(bool enviado, void* contexto);
+};
+
+#endif // RESPALDOSMS_H
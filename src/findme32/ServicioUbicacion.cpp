@@ -0,0 +1,221 @@
+#include "ServicioUbicacion.h"
+#include "Bitacora.h"
+#include "GeoUtils.h"
+
+ServicioUbicacion::ServicioUbicacion(GPSModule& gpsModule, ColaSMS& colaSMS)
+  : gps(gpsModule), cola(colaSMS), fixValido(false), lat(0.0), lon(0.0), instanteFix(0),
+    latAncla(0.0), lonAncla(0.0), ultimoMovimiento(0), encendido(true), inicioVentana(0),
+    proximoDespertar(0), trazaInicio(0), trazaCount(0), seguimientosCount(0) {}
+
+String ServicioUbicacion::formatearEdad(unsigned long ms) {
+  unsigned long s = ms / 1000;
+  if (s < 120) return String(s) + " s";
+  if (s < 2 * 3600) return String(s / 60) + " min";
+  return String(s / 3600) + " h";
+}
+
+// El enlace más informativo que cabe en 'disponible' caracteres
+String ServicioUbicacion::enlace(size_t disponible) const {
+  String traza = enlaceTraza(disponible);
+  if (traza.length() > 0) {
+    return traza;
+  }
+  return "https://maps.google.com/?q=" + String(lat, 6) + "," + String(lon, 6);
+}
+
+String ServicioUbicacion::enlaceTraza(size_t disponible) const {
+  static const char prefijo[] = "https://" API_ENDPOINT UBICACION_VISOR_PATH "?p=";
+  if (disponible > SMS_LONGITUD_MAXIMA) {
+    disponible = SMS_LONGITUD_MAXIMA;
+  }
+  if (disponible < sizeof(prefijo) - 1) {
+    return String();
+  }
+  size_t presupuesto = disponible - (sizeof(prefijo) - 1);
+
+  // Vértices dentro de la ventana; el último se cambia por el fix actual, a menos de UBICACION_TRAZA_METROS
+  int32_t lats[UBICACION_TRAZA_PUNTOS];
+  int32_t lons[UBICACION_TRAZA_PUNTOS];
+  int n = 0;
+  unsigned long ahora = millis();
+  for (int i = 0; i < trazaCount; i++) {
+    const PuntoTraza& p = traza[(trazaInicio + i) % UBICACION_TRAZA_PUNTOS];
+    if (ahora - p.instante <= UBICACION_TRAZA_MS) {
+      lats[n] = p.lat;
+      lons[n] = p.lon;
+      n++;
+    }
+  }
+  if (n < 2) {
+    return String();
+  }
+  lats[n - 1] = aUnidadesPolilinea(lat);
+  lons[n - 1] = aUnidadesPolilinea(lon);
+
+  // Del más reciente hacia atrás: el primer vértice va absoluto y los demás como diferencias
+  int primero = -1;
+  size_t diferencias = 0;
+  for (int i = n - 1; i >= 0; i--) {
+    if (largoPolilinea(lats[i]) + largoPolilinea(lons[i]) + diferencias > presupuesto) {
+      break;
+    }
+    if (i < n - 1) {
+      primero = i;
+    }
+    if (i > 0) {
+      diferencias += largoPolilinea(lats[i] - lats[i - 1]) + largoPolilinea(lons[i] - lons[i - 1]);
+    }
+  }
+  if (primero < 0) {
+    return String();
+  }
+
+  char texto[SMS_LONGITUD_MAXIMA + 1];
+  size_t largo = sizeof(prefijo) - 1;
+  memcpy(texto, prefijo, largo);
+  largo += codificarPolilinea(lats[primero], texto + largo);
+  largo += codificarPolilinea(lons[primero], texto + largo);
+  for (int i = primero + 1; i < n; i++) {
+    largo += codificarPolilinea(lats[i] - lats[i - 1], texto + largo);
+    largo += codificarPolilinea(lons[i] - lons[i - 1], texto + largo);
+  }
+  texto[largo] = '\0';
+  return String(texto);
+}
+
+bool ServicioUbicacion::enReposo() const {
+#if UBICACION_REPOSO_MS > 0
+  return fixValido && millis() - ultimoMovimiento >= UBICACION_REPOSO_MS;
+#else
+  return false;
+#endif
+}
+
+void ServicioUbicacion::registrarFix(double latFix, double lonFix) {
+  unsigned long ahora = millis();
+
+  if (!fixValido || calcularDistancia(latAncla, lonAncla, latFix, lonFix) > UMBRAL_MOVIMIENTO_METROS) {
+    latAncla = latFix;
+    lonAncla = lonFix;
+    ultimoMovimiento = ahora;
+  }
+
+  fixValido = true;
+  lat = latFix;
+  lon = lonFix;
+  instanteFix = ahora;
+  agregarATraza(ahora);
+
+  // Fix nuevo: responder a quienes esperaban una ubicación actualizada
+  for (int i = seguimientosCount - 1; i >= 0; i--) {
+    if ((long)(instanteFix - seguimientos[i].solicitadoEn) >= 0) {
+      static const char encabezado[] = "Ubicacion actualizada: ";
+      cola.encolar(seguimientos[i].numero, String(encabezado) + enlace(SMS_LONGITUD_MAXIMA - (sizeof(encabezado) - 1)));
+      quitarSeguimiento(i);
+    }
+  }
+}
+
+void ServicioUbicacion::agregarATraza(unsigned long ahora) {
+  // Sin moverse no se agregan vértices: solo se renueva el último
+  if (trazaCount > 0) {
+    PuntoTraza& ultimo = traza[(trazaInicio + trazaCount - 1) % UBICACION_TRAZA_PUNTOS];
+    if (calcularDistancia(ultimo.lat / 1e5, ultimo.lon / 1e5, lat, lon) <= UBICACION_TRAZA_METROS) {
+      ultimo.instante = ahora;
+      return;
+    }
+  }
+
+  if (trazaCount == UBICACION_TRAZA_PUNTOS) {
+    trazaInicio = (trazaInicio + 1) % UBICACION_TRAZA_PUNTOS;  // Descartar el más antiguo
+    trazaCount--;
+  }
+  PuntoTraza& p = traza[(trazaInicio + trazaCount++) % UBICACION_TRAZA_PUNTOS];
+  p.lat = aUnidadesPolilinea(lat);
+  p.lon = aUnidadesPolilinea(lon);
+  p.instante = ahora;
+}
+
+void ServicioUbicacion::agregarSeguimiento(const String& remitente) {
+  for (int i = 0; i < seguimientosCount; i++) {
+    if (remitente == seguimientos[i].numero) {
+      return;  // Ya tiene uno pendiente
+    }
+  }
+  if (seguimientosCount >= UBICACION_MAX_SEGUIMIENTOS) {
+    quitarSeguimiento(0);  // Descartar el más antiguo
+  }
+
+  Seguimiento& s = seguimientos[seguimientosCount++];
+  strncpy(s.numero, remitente.c_str(), sizeof(s.numero) - 1);
+  s.numero[sizeof(s.numero) - 1] = '\0';
+  s.solicitadoEn = millis();
+}
+
+void ServicioUbicacion::quitarSeguimiento(int indice) {
+  for (int i = indice; i < seguimientosCount - 1; i++) {
+    seguimientos[i] = seguimientos[i + 1];
+  }
+  seguimientosCount--;
+}
+
+String ServicioUbicacion::responder(const String& remitente) {
+  if (!fixValido) {
+    agregarSeguimiento(remitente);
+    return "Buscando senal GPS. Enviare la ubicacion en cuanto haya fix.";
+  }
+
+  unsigned long edad = millis() - instanteFix;
+  String sufijo = " (hace " + formatearEdad(edad) + ")";
+
+  if (edad > UBICACION_MAX_EDAD_MS) {
+    agregarSeguimiento(remitente);
+    sufijo += ". Enviare una actualizada.";
+  }
+  return enlace(SMS_LONGITUD_MAXIMA - sufijo.length()) + sufijo;
+}
+
+void ServicioUbicacion::despertar() {
+  ultimoMovimiento = millis();
+  if (!encendido) {
+    proximoDespertar = ultimoMovimiento;
+  }
+}
+
+void ServicioUbicacion::atender() {
+  unsigned long ahora = millis();
+
+  // Seguimientos vencidos: avisar una sola vez y olvidarlos
+  for (int i = seguimientosCount - 1; i >= 0; i--) {
+    if (ahora - seguimientos[i].solicitadoEn >= UBICACION_TIMEOUT_SEGUIMIENTO_MS) {
+      cola.encolar(seguimientos[i].numero, "No se pudo obtener una ubicacion actualizada.");
+      quitarSeguimiento(i);
+    }
+  }
+
+  if (UBICACION_REPOSO_MS == 0) {
+    return;  // Ciclo de trabajo del GNSS deshabilitado
+  }
+
+  if (encendido) {
+    // En reposo y sin nadie esperando: apagar al terminar la ventana de refresco
+    if (enReposo() && seguimientosCount == 0 && ahora - inicioVentana >= UBICACION_VENTANA_MS) {
+      if (gps.apagar()) {
+        LOG_INFO("GNSS en reposo. Próximo refresco de efemérides en %lu min", UBICACION_CICLO_MS / 60000);
+        encendido = false;
+        proximoDespertar = ahora + UBICACION_CICLO_MS;
+      }
+    }
+  } else if (seguimientosCount > 0 || (long)(ahora - proximoDespertar) >= 0) {
+    const char* motivo = seguimientosCount > 0 ? "un Localizar pendiente"
+                         : enReposo()           ? "refrescar efemérides"
+                                                : "seguir a la ignición";
+    LOG_INFO("Encendiendo GNSS para %s...", motivo);
+    if (gps.inicializar()) {
+      encendido = true;
+      inicioVentana = ahora;
+    } else {
+      proximoDespertar = ahora + UBICACION_VENTANA_MS;  // Reintentar más tarde
+    }
+  }
+}
@@ -0,0 +1,85 @@
+#ifndef SERVICIOUBICACION_H
+#define SERVICIOUBICACION_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "GPSModule.h"
+#include "ColaSMS.h"
+
+#define UBICACION_MAX_SEGUIMIENTOS 4
+
+/**
+ * Servicio de ubicación para las respuestas "Localizar".
+ *
+ * Guarda el último fix del rastreador y responde al instante con él y su
+ * antigüedad. Si el fix es viejo (o no hay), registra un seguimiento y envía
+ * un segundo SMS con la ubicación actualizada en cuanto llega un fix nuevo.
+ *
+ * Con el vehículo en reposo, el GNSS se apaga y se enciende periódicamente
+ * durante una ventana corta para mantener las efemérides frescas, de modo que
+ * el siguiente fix sea un arranque en caliente. Mientras está apagado un
+ * arranque no se ve hasta la siguiente ventana; despertar() lo adelanta.
+ *
+ * Guarda además los últimos UBICACION_TRAZA_MS de recorrido (un vértice cada
+ * UBICACION_TRAZA_METROS). Con dos vértices o más la respuesta lleva, en vez
+ * del enlace a Google Maps, el del visor con la traza como polilínea
+ * codificada, recortada desde el vértice más antiguo para caber en un SMS.
+ */
+class ServicioUbicacion {
+public:
+  ServicioUbicacion(GPSModule& gps, ColaSMS& cola);
+
+  void registrarFix(double lat, double lon);
+  String responder(const String& remitente);
+  void atender();
+  // Ignición encendida: sin reposo y, si el GNSS estaba apagado, se enciende en la siguiente vuelta
+  void despertar();
+
+  bool gnssActivo() const { return encendido; }
+  bool haySeguimientos() const { return seguimientosCount > 0; }
+
+private:
+  struct PuntoTraza {
+    int32_t lat;  // Unidades de la polilínea (1e-5 grados)
+    int32_t lon;
+    unsigned long instante;  // Último fix en este punto
+  };
+
+  struct Seguimiento {
+    char numero[20];
+    unsigned long solicitadoEn;
+  };
+
+  GPSModule& gps;
+  ColaSMS& cola;
+
+  bool fixValido;
+  double lat;
+  double lon;
+  unsigned long instanteFix;
+
+  double latAncla;
+  double lonAncla;
+  unsigned long ultimoMovimiento;
+
+  bool encendido;
+  unsigned long inicioVentana;
+  unsigned long proximoDespertar;
+
+  PuntoTraza traza[UBICACION_TRAZA_PUNTOS];
+  int trazaInicio;
+  int trazaCount;
+
+  Seguimiento seguimientos[UBICACION_MAX_SEGUIMIENTOS];
+  int seguimientosCount;
+
+  bool enReposo() const;
+  void agregarSeguimiento(const String& remitente);
+  void quitarSeguimiento(int indice);
+  void agregarATraza(unsigned long ahora);
+  String enlace(size_t disponible) const;
+  String enlaceTraza(size_t disponible) const;
+  static String formatearEdad(unsigned long ms);
+};
+
+#endif // SERVICIOUBICACION_H
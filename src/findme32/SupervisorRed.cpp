@@ -0,0 +1,230 @@
+#include "SupervisorRed.h"
+#include "Bitacora.h"
+#include <esp_idf_version.h>
+#include <esp_task_wdt.h>
+
+SupervisorRed::SupervisorRed(GSMModule& gsmModule)
+  : gsm(gsmModule), reconfigurarModem(NULL), nivelActual(NIVEL_NINGUNO), instanteAccion(0),
+    fallosSeguidos(0) {
+  memset(fallosPorClase, 0, sizeof(fallosPorClase));
+  memset(&telemetria, 0, sizeof(telemetria));
+}
+
+const char* SupervisorRed::nombreNivel(NivelRecuperacionRed n) {
+  switch (n) {
+    case NIVEL_NINGUNO:       return "ninguno";
+    case NIVEL_REACTIVAR_PDP: return "reactivar PDP";
+    case NIVEL_CICLO_RADIO:   return "ciclo de radio";
+    case NIVEL_CICLO_MODEM:   return "ciclo del módem";
+    case NIVEL_REINICIO_ESP:  return "reinicio del ESP32";
+    default:                  return "?";
+  }
+}
+
+NivelRecuperacionRed SupervisorRed::nivelMinimo(ResultadoEnvio clase) {
+  switch (clase) {
+    case ENVIO_SIN_REGISTRO: return NIVEL_CICLO_RADIO;   // Un PDP nuevo no registra en la red
+    case ENVIO_ERROR_MODEM:  return NIVEL_CICLO_MODEM;   // Pila HTTP del módem trabada
+    default:                 return NIVEL_REACTIVAR_PDP;
+  }
+}
+
+unsigned long SupervisorRed::enfriamiento(NivelRecuperacionRed n) {
+  switch (n) {
+    case NIVEL_REACTIVAR_PDP: return RED_ENFRIAMIENTO_PDP_MS;
+    case NIVEL_CICLO_RADIO:   return RED_ENFRIAMIENTO_RADIO_MS;
+    case NIVEL_CICLO_MODEM:   return RED_ENFRIAMIENTO_MODEM_MS;
+    default:                  return 0;
+  }
+}
+
+void SupervisorRed::begin() {
+  preferences.begin("red", true);
+  size_t leidos = preferences.getBytes("telemetria", &telemetria, sizeof(telemetria));
+  preferences.end();
+  if (leidos != sizeof(telemetria)) {
+    memset(&telemetria, 0, sizeof(telemetria));  // Primer arranque o formato anterior
+  }
+
+  if (telemetria.nivelPendiente == NIVEL_REINICIO_ESP) {
+    // El siguiente envío decide si el reinicio sirvió
+    LOG_AVISO("Arranque tras un reinicio por falta de conexión");
+    nivelActual = NIVEL_REINICIO_ESP;
+    instanteAccion = millis();
+  } else if (telemetria.nivelPendiente != NIVEL_NINGUNO) {
+    // Reinicio a mitad de una acción (watchdog, corte de energía): no se supo si sirvió
+    cerrarPendiente(false);
+  }
+  imprimirTelemetria();
+
+#if ESP_IDF_VERSION_MAJOR >= 5
+  esp_task_wdt_config_t config = { RED_WATCHDOG_S * 1000, 0, true };
+  esp_task_wdt_reconfigure(&config);
+#else
+  esp_task_wdt_init(RED_WATCHDOG_S, true);
+#endif
+  esp_task_wdt_add(NULL);
+  LOG_INFO("Watchdog de tareas activo (%d s)", RED_WATCHDOG_S);
+}
+
+void SupervisorRed::alimentarWatchdog() {
+  esp_task_wdt_reset();
+}
+
+void SupervisorRed::registrarEnvio(ResultadoEnvio resultado) {
+  if (resultado == ENVIO_ERROR_CONFIG) {
+    return;  // No es un problema de conexión
+  }
+
+  if (resultado == ENVIO_OK || resultado == ENVIO_ERROR_SERVIDOR) {
+    // El servidor respondió: la conexión funciona aunque el código sea de error
+    if (telemetria.nivelPendiente != NIVEL_NINGUNO) {
+      cerrarPendiente(true);
+    }
+    nivelActual = NIVEL_NINGUNO;
+    fallosSeguidos = 0;
+    memset(fallosPorClase, 0, sizeof(fallosPorClase));
+    return;
+  }
+
+  fallosSeguidos++;
+  fallosPorClase[resultado]++;
+  telemetria.fallos[resultado]++;
+  LOG_AVISO("Supervisor de red: envío fallido (%s), %d seguidos", HTTPClient::nombreResultado(resultado),
+            fallosSeguidos);
+}
+
+NivelRecuperacionRed SupervisorRed::siguienteNivel() const {
+  // Tras el reinicio del ESP32 se vuelve a empezar desde el nivel más suave
+  int n = (nivelActual == NIVEL_REINICIO_ESP) ? NIVEL_REACTIVAR_PDP : nivelActual + 1;
+
+  for (int c = 0; c < TOTAL_RESULTADOS_ENVIO; c++) {
+    if (fallosPorClase[c] > 0 && nivelMinimo((ResultadoEnvio)c) > n) {
+      n = nivelMinimo((ResultadoEnvio)c);
+    }
+  }
+
+  if (n >= NIVEL_REINICIO_ESP) {
+    n = NIVEL_REINICIO_ESP;
+    if (millis() < RED_UPTIME_MINIMO_REINICIO_MS) {
+      n = NIVEL_CICLO_MODEM;  // Recién encendido: repetir el ciclo del módem antes que reiniciar
+    }
+  }
+  return (NivelRecuperacionRed)n;
+}
+
+bool SupervisorRed::atender() {
+  if (fallosSeguidos < RED_FALLOS_PARA_ESCALAR) {
+    return false;
+  }
+
+  unsigned long ahora = millis();
+  if (nivelActual != NIVEL_NINGUNO && ahora - instanteAccion < enfriamiento(nivelActual)) {
+    return false;  // La acción anterior todavía está en su enfriamiento
+  }
+
+  NivelRecuperacionRed n = siguienteNivel();
+  if (telemetria.nivelPendiente != NIVEL_NINGUNO) {
+    cerrarPendiente(false);  // No bastó: se escala
+  }
+
+  LOG_AVISO("Supervisor de red: %d envíos fallidos seguidos. Aplicando %s...", fallosSeguidos, nombreNivel(n));
+
+  nivelActual = n;
+  instanteAccion = ahora;
+  fallosSeguidos = 0;
+  telemetria.intentos[n]++;
+  telemetria.nivelPendiente = n;
+  guardarTelemetria();
+
+  alimentarWatchdog();
+  bool aplicado = aplicarNivel(n);
+  alimentarWatchdog();
+
+  if (aplicado) {
+    LOG_INFO("Acción de recuperación aplicada. Se confirmará con el próximo envío.");
+  } else {
+    LOG_ERROR("✗ La acción de recuperación no dejó la conexión lista");
+  }
+  return true;
+}
+
+bool SupervisorRed::aplicarNivel(NivelRecuperacionRed n) {
+  switch (n) {
+    case NIVEL_REACTIVAR_PDP:
+      gsm.desactivarContextoPDP();
+      return gsm.verificarConexionGPRS();
+
+    case NIVEL_CICLO_RADIO:
+      if (!gsm.ciclarRadio()) {
+        return false;
+      }
+      return gsm.verificarConexionGPRS();
+
+    case NIVEL_CICLO_MODEM:
+      gsm.reiniciarModulo();
+      alimentarWatchdog();
+      if (reconfigurarModem != NULL) {
+        reconfigurarModem();
+      }
+      if (!gsm.esperarRegistroRed(NETWORK_REGISTER_TIMEOUT)) {
+        return false;
+      }
+      alimentarWatchdog();
+      return gsm.verificarConexionGPRS();
+
+    case NIVEL_REINICIO_ESP:
+      LOG_ERROR("Reiniciando ESP32...");
+      // El anillo sobrevive al reinicio, pero lo pendiente no saldría por Serial
+      bitacora.drenar();
+      Serial.flush();
+      ESP.restart();
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+void SupervisorRed::cerrarPendiente(bool exito) {
+  NivelRecuperacionRed p = (NivelRecuperacionRed)telemetria.nivelPendiente;
+  if (p >= TOTAL_NIVELES_RED) {
+    p = NIVEL_NINGUNO;
+  }
+
+  if (exito) {
+    telemetria.exitos[p]++;
+    LOG_INFO("✓ Conexión recuperada tras %s (%lu s)", nombreNivel(p), (millis() - instanteAccion) / 1000);
+  } else {
+    LOG_AVISO("%s no recuperó la conexión", nombreNivel(p));
+  }
+
+  telemetria.nivelPendiente = NIVEL_NINGUNO;
+  guardarTelemetria();
+  imprimirTelemetria();
+}
+
+void SupervisorRed::guardarTelemetria() {
+  preferences.begin("red", false);
+  preferences.putBytes("telemetria", &telemetria, sizeof(telemetria));
+  preferences.end();
+}
+
+void SupervisorRed::imprimirTelemetria() const {
+  for (int n = NIVEL_REACTIVAR_PDP; n < TOTAL_NIVELES_RED; n++) {
+    if (telemetria.intentos[n] == 0) continue;
+    LOG_INFO("Telemetría red [%s]: %u/%u éxitos", nombreNivel((NivelRecuperacionRed)n), (unsigned)telemetria.exitos[n],
+             (unsigned)telemetria.intentos[n]);
+  }
+
+  char fallos[BITACORA_LINEA_MAX];
+  int largo = 0;
+  for (int c = 0; c < TOTAL_RESULTADOS_ENVIO && largo < (int)sizeof(fallos); c++) {
+    if (telemetria.fallos[c] == 0) continue;
+    largo += snprintf(fallos + largo, sizeof(fallos) - largo, " %s=%u", HTTPClient::nombreResultado((ResultadoEnvio)c),
+                      (unsigned)telemetria.fallos[c]);
+  }
+  if (largo > 0) {
+    LOG_INFO("Telemetría red, fallos por clase:%s", fallos);
+  }
+}
@@ -0,0 +1,89 @@
+#ifndef SUPERVISORRED_H
+#define SUPERVISORRED_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "config.h"
+#include "GSMModule.h"
+#include "HTTPClient.h"
+
+/**
+ * Niveles de recuperación de la conexión, en orden de escalamiento
+ */
+enum NivelRecuperacionRed {
+  NIVEL_NINGUNO,
+  NIVEL_REACTIVAR_PDP,   // AT+CGACT=0,1 y volver a activar el contexto
+  NIVEL_CICLO_RADIO,     // AT+CFUN=0 / AT+CFUN=1
+  NIVEL_CICLO_MODEM,     // Apagar y encender el A7670 con PWRKEY
+  NIVEL_REINICIO_ESP,    // ESP.restart()
+  TOTAL_NIVELES_RED
+};
+
+/**
+ * Telemetría persistente en NVS ("red")
+ */
+struct TelemetriaRed {
+  uint16_t intentos[TOTAL_NIVELES_RED];
+  uint16_t exitos[TOTAL_NIVELES_RED];        // El siguiente envío tras la acción fue exitoso
+  uint16_t fallos[TOTAL_RESULTADOS_ENVIO];   // Envíos fallidos por clase
+  uint8_t nivelPendiente;                    // Acción sin resultado aún; sobrevive al reinicio del ESP32
+};
+
+typedef void (*ReconfigurarModem)();
+
+/**
+ * Supervisor de la conexión de datos.
+ *
+ * Cuenta los envíos fallidos consecutivos por clase (sin registro, sin PDP,
+ * DNS, TLS, timeout HTTP) y, tras RED_FALLOS_PARA_ESCALAR fallos seguidos,
+ * aplica el siguiente nivel de recuperación. Cada clase fija el nivel mínimo
+ * por el que empezar: sin registro no tiene sentido reactivar el PDP. Después
+ * de cada acción se espera su enfriamiento antes de escalar otra vez, y el
+ * reinicio del ESP32 exige un tiempo mínimo encendido para no entrar en bucle.
+ *
+ * El watchdog de tareas del ESP32 respalda al supervisor: si el ciclo se
+ * bloquea más de RED_WATCHDOG_S, el chip se reinicia.
+ */
+class SupervisorRed {
+public:
+  SupervisorRed(GSMModule& gsm);
+
+  void begin();
+  void registrarEnvio(ResultadoEnvio resultado);
+
+  // Devuelve true si en esta llamada se aplicó una acción de recuperación
+  bool atender();
+  void alimentarWatchdog();
+
+  // Tras ciclar el módem se pierde su configuración (SMS, GNSS)
+  void setReconfigurarModem(ReconfigurarModem funcion) { reconfigurarModem = funcion; }
+
+  NivelRecuperacionRed nivel() const { return nivelActual; }
+  int fallosConsecutivos() const { return fallosSeguidos; }
+  int fallosConsecutivos(ResultadoEnvio clase) const { return fallosPorClase[clase]; }
+  const TelemetriaRed& getTelemetria() const { return telemetria; }
+
+  static const char* nombreNivel(NivelRecuperacionRed n);
+
+private:
+  GSMModule& gsm;
+  Preferences preferences;
+  ReconfigurarModem reconfigurarModem;
+
+  NivelRecuperacionRed nivelActual;
+  unsigned long instanteAccion;
+  int fallosSeguidos;
+  int fallosPorClase[TOTAL_RESULTADOS_ENVIO];
+
+  TelemetriaRed telemetria;
+
+  NivelRecuperacionRed siguienteNivel() const;
+  bool aplicarNivel(NivelRecuperacionRed n);
+  void cerrarPendiente(bool exito);
+  void guardarTelemetria();
+  void imprimirTelemetria() const;
+  static NivelRecuperacionRed nivelMinimo(ResultadoEnvio clase);
+  static unsigned long enfriamiento(NivelRecuperacionRed n);
+};
+
+#endif // SUPERVISORRED_H
@@ -17,9 +17,9 @@
 #define TXD1_PIN 21
 #define BAUD_RATE 115200 
 
-// Pines de control de estado
-#define PIN_ACTIVE 9    // LED/Relé cuando isActive=true
-#define PIN_INACTIVE 8  // LED/Relé cuando isActive=false
+// Pines de control de estado (compartidos por el servidor y los comandos SMS)
+#define PIN_ACTIVE 9    // LED/Relé cuando isActive=true o tras el SMS "Apagar"
+#define PIN_INACTIVE 8  // LED/Relé cuando isActive=false o tras el SMS "Prender"
 
 // ============================
 // LÓGICA DE MOVIMIENTO
@@ -28,10 +28,184 @@
 #define INTERVALO_LECTURA_GPS (20 * 1000)   // 20 segundos
 #define INTERVALO_HEARTBEAT (5 * 60 * 1000) // 5 minutos
 
+// ============================
+// REPORTE POR ESTIMA
+// ============================
+// Dispositivo y servidor extrapolan desde el último reporte con su velocidad y
+// rumbo (parámetro "course"): solo se reporta cuando el fix se aparta de lo previsto
+#define REPORTE_ESTIMA 0                          // 1: reemplaza la regla de UMBRAL_MOVIMIENTO_METROS
+#define ESTIMA_UMBRAL_METROS 25.0                 // Desvío máximo entre el fix y la posición prevista
+#define ESTIMA_INTERVALO_MAX_MS (5UL * 60 * 1000) // Reporte aunque la predicción acierte
+#define ESTIMA_VELOCIDAD_MIN_KMH 8.0f             // Por debajo el rumbo del GNSS es ruido: no se extrapola
+
+// ============================
+// REPORTES AL SERVIDOR
+// ============================
+// Cada fix lleva un número de secuencia persistente; el servidor confirma con "ack"
+#define REPORTES_COLA_CAPACIDAD 16   // Fixes sin confirmar; lleno, se descarta el más antiguo
+#define REPORTES_MAX_POR_CICLO 3     // Peticiones por ciclo para vaciar la cola (cada una es un lote)
+
+// ============================
+// CONSUMO DE DATOS
+// ============================
+// El módem no informa bytes por sesión: se estiman por operación
+#define DATOS_PRESUPUESTO_MENSUAL_KB 51200UL      // Plan de la SIM (50 MB); 0 = sin límite
+#define DATOS_DIA_CORTE 1                         // Día del mes en que se renueva el plan (1-28)
+#define DATOS_HOLGURA_PCT 10                      // Adelanto permitido sobre el consumo prorrateado
+#define DATOS_MODERADO_PCT 80                     // Desde aquí se agrupan reportes
+#define DATOS_GUARDAR_CADA_BYTES 32768UL          // Escrituras en NVS acotadas
+#define DATOS_LOTE_REPORTES 6                     // Con presión: fixes por lote
+#define DATOS_LOTE_ESPERA_MS (10UL * 60 * 1000)   // Con presión: espera máxima del fix más antiguo
+// Estimaciones por sesión HTTPS (TLS 1.2 completo, sin reanudación)
+#define DATOS_BYTES_TCP 480                       // DNS, SYN/FIN y cabeceras IP/TCP
+#define DATOS_BYTES_TLS_SUBIDA 650
+#define DATOS_BYTES_TLS_BAJADA 4800               // Incluye la cadena de certificados
+#define DATOS_BYTES_CABECERAS_SUBIDA 120          // GET, Host y cabeceras del módem (más la URL)
+#define DATOS_BYTES_CABECERAS_BAJADA 260          // Línea de estado y cabeceras (más el cuerpo)
+#define DATOS_BYTES_AGPS 12288UL                  // Descarga AT+CAGPS
+
+// ============================
+// CALIDAD DE SEÑAL
+// ============================
+// Con enlace malo los reportes no urgentes esperan en la cola a que mejore
+#define SENAL_VALIDEZ_MS 30000UL                  // Reutilizar la medición (AT+CSQ/AT+CPSI) este tiempo
+#define SENAL_DIFERIR_MAX_MS (10UL * 60 * 1000)   // Espera máxima del fix más antiguo con enlace malo
+#define SENAL_CSQ_MALO 7                          // CSQ menor: enlace malo (-99 dBm)
+#define SENAL_CSQ_BUENO 15                        // CSQ desde aquí: enlace bueno (-83 dBm)
+#define SENAL_RSRP_MALO -115                      // dBm, LTE
+#define SENAL_RSRP_BUENO -100
+#define SENAL_SINR_MALO 0                         // dB, LTE
+#define SENAL_SINR_BUENO 10
+#define SENAL_LOTE_REGULAR 4                      // Pendientes por petición con enlace regular
+#define SENAL_LOTE_MALO 1                         // Con enlace malo (al vencer la espera o si es urgente)
+
+// ============================
+// ASISTENCIA GNSS (AGPS)
+// ============================
+#define AGPS_HABILITADO 1
+#define AGPS_VALIDEZ_MS (4UL * 60 * 60 * 1000)  // Vigencia de las efemérides asistidas
+#define AGPS_REINTENTO_MS (30UL * 60 * 1000)    // Espera tras una descarga fallida
+#define AGPS_TIMEOUT_MS 30000UL                 // Espera del URC +AGPS
+
+// ============================
+// VIAJES Y ODÓMETRO
+// ============================
+// Inicio por ignición o movimiento y fin tras una parada; los eventos viajan con el siguiente reporte
+#define VIAJES_HABILITADOS 1
+#define VIAJES_PIN_IGNICION -1                    // GPIO de la ignición, activo en alto; -1 = sin cable, solo movimiento
+#define VIAJES_VELOCIDAD_MOVIMIENTO_KMH 5.0f      // Velocidad del GNSS que cuenta como movimiento
+#define VIAJES_RUIDO_METROS 20.0                  // Desplazamientos menores no suman al odómetro
+#define VIAJES_VELOCIDAD_MAX_KMH 250.0            // Un salto más rápido entre fixes se descarta
+#define VIAJES_PARADA_S 300UL                     // Detenido (e ignición apagada) este tiempo: fin del viaje
+#define VIAJES_RESUMEN_S 86400UL                  // Periodo del evento de resumen
+#define VIAJES_EVENTOS_MAX 8                      // Sin confirmar; lleno, se descarta el más antiguo
+#define VIAJES_GUARDAR_CADA_METROS 2000.0         // Escrituras en NVS acotadas durante un viaje...
+#define VIAJES_GUARDAR_CADA_S 600UL               // ...o cada este tiempo, lo que ocurra primero
+
+// ============================
+// CAPTURA DE ALTA FRECUENCIA
+// ============================
+// Los últimos minutos de fixes en RAM; un disparo los congela en flash y los sube
+#define CAPTURA_HABILITADA 1
+#define CAPTURA_PERIODO_S 1                       // URC +CGNSSINFO (el A7670 no baja de 1 s por el puerto AT)
+#define CAPTURA_MUESTRAS 600                      // 16 bytes cada una: 10 min a 1 Hz en 9.6 KB
+#define CAPTURA_POST_DISPARO_MS 30000UL           // Se sigue grabando tras el disparo
+#define CAPTURA_DELTA_KMH_S 15                    // Cambio de velocidad que dispara (~0.4 g: frenado o choque)
+#define CAPTURA_PIN_DISPARO -1                    // GPIO activo en bajo que dispara; -1 = sin pin
+#define CAPTURA_REINTENTO_MS 60000UL              // Entre intentos de subida o de activar el URC
+#define CAPTURA_ARCHIVO "/captura.bin"            // En la partición spiffs (LittleFS)
+#define CAPTURA_API_PATH "/api/gps/captura"
+
+// ============================
+// ACTUALIZACIÓN OTA
+// ============================
+// Delta firmado contra la imagen en ejecución, descargado por rangos a LittleFS
+#define OTA_HABILITADA 1
+#define OTA_API_PATH "/api/gps/ota"
+#define OTA_BLOQUE_BYTES 16384UL                  // Bytes por petición con Range: lo que se pierde si se cae la red
+#define OTA_REINTENTO_MS 300000UL                 // Espera tras un bloque fallido
+#define OTA_VALIDACION_MS 900000UL                // La imagen nueva debe reportar al servidor antes de esto...
+#define OTA_ARRANQUES_MAX 3                       // ...y sin reiniciarse más veces; si no, se vuelve a la anterior
+#define OTA_ARCHIVO "/ota.delta"                  // En la partición spiffs (LittleFS)
+// Clave pública ECDSA P-256 que firma los deltas (PEM)
+#define OTA_CLAVE_PUBLICA \
+  "-----BEGIN PUBLIC KEY-----\n" \
+  "TU_CLAVE_PUBLICA_AQUI\n" \
+  "-----END PUBLIC KEY-----\n"
+
+// ============================
+// RECUPERACIÓN GNSS
+// ============================
+// Tiempo sin fix en cada paso antes de escalar al siguiente
+#define GNSS_VENTANA_ESPERA_MS (2UL * 60 * 1000)    // Solo esperar (mayor que UBICACION_VENTANA_MS)
+#define GNSS_VENTANA_CALIENTE_MS (60UL * 1000)      // Tras AT+CGPSHOT
+#define GNSS_VENTANA_TIBIO_MS (2UL * 60 * 1000)     // Tras AT+CGPSWARM
+#define GNSS_VENTANA_FRIO_MS (5UL * 60 * 1000)      // Tras AT+CGPSCOLD
+#define GNSS_VENTANA_CICLO_MS (5UL * 60 * 1000)     // Tras apagar y encender el GNSS
+#define GNSS_PAUSA_APAGADO_MS 3000UL
+#define GNSS_SATELITES_PROGRESO 4                   // Con esta cantidad la ventana se duplica
+
+// ============================
+// SUPERVISOR DE CONEXIÓN
+// ============================
+// Niveles: reactivar PDP -> ciclo de radio (CFUN) -> ciclo del módem -> reinicio del ESP32
+#define RED_FALLOS_PARA_ESCALAR 3                         // Envíos fallidos seguidos antes de cada acción
+#define RED_ENFRIAMIENTO_PDP_MS (2UL * 60 * 1000)         // Espera mínima tras cada nivel antes de escalar
+#define RED_ENFRIAMIENTO_RADIO_MS (5UL * 60 * 1000)
+#define RED_ENFRIAMIENTO_MODEM_MS (10UL * 60 * 1000)
+#define RED_UPTIME_MINIMO_REINICIO_MS (30UL * 60 * 1000)  // Reiniciar el ESP32 solo tras este tiempo encendido
+#define RED_PAUSA_RADIO_MS 3000UL                         // Entre AT+CFUN=0 y AT+CFUN=1
+#define RED_WATCHDOG_S 300                                // Watchdog de tareas: el ciclo o una espera AT sin avanzar
+
+// ============================
+// SERVICIO DE UBICACIÓN (Localizar)
+// ============================
+#define UBICACION_MAX_EDAD_MS (2UL * 60 * 1000)             // Fix más viejo: se envía un SMS de seguimiento
+#define UBICACION_TIMEOUT_SEGUIMIENTO_MS (10UL * 60 * 1000) // Máximo para enviar el seguimiento
+#define INTERVALO_LECTURA_URGENTE (5 * 1000)                // Lecturas GPS mientras hay seguimientos
+// Con el GNSS ciclado, un arranque (robo, inicio de viaje) se ve hasta UBICACION_CICLO_MS tarde,
+// salvo con VIAJES_PIN_IGNICION, que lo despierta. 0: lecturas continuas, sin esa latencia
+#define UBICACION_REPOSO_MS 0                               // Reposo antes de ciclar el GNSS (p.ej. 30 min)
+#define UBICACION_CICLO_MS (15UL * 60 * 1000)               // Periodo de refresco de efemérides en reposo
+#define UBICACION_VENTANA_MS (90UL * 1000)                  // Duración de cada ventana de refresco
+#define UBICACION_TRAZA_MS (15UL * 60 * 1000)              // Recorrido que acompaña a la respuesta
+#define UBICACION_TRAZA_PUNTOS 32                           // Vértices guardados
+#define UBICACION_TRAZA_METROS 50.0                         // Desplazamiento para un vértice nuevo
+#define UBICACION_VISOR_PATH "/r"                           // Visor: https://API_ENDPOINT/r?p=<polilínea>
+
 // ============================
 // CONFIGURACIÓN APN
 // ============================
-#define APN_TELCEL "internet.itelcel.com"
+// El APN se elige por el operador de la SIM (IMSI, o AT+COPS? si no se
+// puede leer) con la tabla de GSMModule.cpp; el último que activó el
+// contexto queda en NVS para ese operador.
+#define APN_FORZADO ""                                      // No vacío: usar siempre este APN
+#define APN_PREDETERMINADO "internet.itelcel.com"           // Operador fuera de la tabla
+
+// ============================
+// CACHÉ DNS
+// ============================
+// Con DNS_CONECTAR_POR_IP 1, API_ENDPOINT se resuelve con AT+CDNSGIP fuera de
+// los envíos y se conecta por IP con el nombre en la cabecera Host. El módem
+// toma el SNI del host de la URL, así que el handshake lleva la IP: activarlo
+// solo si el servidor no necesita SNI (un túnel de Cloudflare sí lo necesita).
+#define DNS_CONECTAR_POR_IP 0
+#define DNS_DIRECCIONES 2                                   // Direcciones guardadas por resolución
+#define DNS_TTL_MS (6UL * 60 * 60 * 1000)                   // AT+CDNSGIP no da el TTL: vigencia fija
+#define DNS_REINTENTO_MS (5UL * 60 * 1000)                  // Tras una resolución fallida
+
+// ============================
+// TLS
+// ============================
+// CA del servidor (o su propio certificado, para fijarlo) en PEM. Se sube una
+// sola vez al sistema de archivos del módem (AT+CCERTDOWN) y el módem verifica
+// al servidor con él. Vacío no compila salvo con TLS_SIN_VERIFICAR 1.
+// Con verificación la URL va siempre por nombre (DNS_CONECTAR_POR_IP se ignora).
+#define TLS_CA_PEM ""
+#define TLS_SIN_VERIFICAR 0                                 // 1: sin TLS_CA_PEM, aceptar cualquier certificado (authmode 0)
+#define TLS_CA_ARCHIVO "findme_ca.pem"                      // Nombre en el módem
+#define TLS_IGNORAR_HORA 0                                  // 1: nunca validar la vigencia. 0: en cuanto el reloj del módem tiene fecha (NITZ o GNSS)
+#define TLS_MEDICION_SESIONES 20                            // Reportes por cada resumen de ms y bytes en la bitácora
 
 // ============================
 // TIMEOUTS Y REINTENTOS
@@ -41,4 +215,55 @@
 #define HTTP_TIMEOUT 60000
 #define NETWORK_REGISTER_TIMEOUT 30
 
+// ============================
+// DEPURACIÓN
+// ============================
+#define GRABAR_UART 0   // 1 = emitir la transcripción del módem (#T...) para test/fixtures
+
+// ============================
+// BITÁCORA
+// ============================
+// Niveles: 0 nada, 1 errores, 2 avisos, 3 información, 4 depuración
+#define BITACORA_NIVEL 3                // Los niveles más detallados no se compilan
+#define BITACORA_SERIE 1                // 0 = unidades de campo: nada por Serial, solo RAM y flash
+#define BITACORA_GUARDAR_NIVEL 1        // Una línea de este nivel o más grave lleva el anillo a la flash
+#define BITACORA_RAM_BYTES 4096         // Anillo en RAM no inicializada
+#define BITACORA_LINEA_MAX 160          // Incluye la marca de tiempo y el nivel
+#define BITACORA_DRENADO_MS 20          // Período de la tarea que vacía el anillo
+#define BITACORA_FLASH_BYTES 16384UL    // Historia en flash, repartida en dos archivos
+#define BITACORA_API_PATH "/api/gps/bitacora"
+
+// ============================
+// CONTROL POR SMS
+// ============================
+// Números sembrados con rol admin en el primer arranque (formato internacional).
+// Después la lista se administra por SMS con "Alta" y "Baja".
+#define NUMEROS_AUTORIZADOS_INICIALES { "+52XXXXXXXXXX" }
+#define PREFIJO_PAIS 52ULL                    // Se antepone a números nacionales de 10 dígitos
+#define INTERVALO_REVISION_SMS (60 * 1000)    // Respaldo por si se pierde un +CMTI
+
+// Cola de SMS salientes
+#define SMS_COLA_CAPACIDAD 8
+#define SMS_UMBRAL_CARGA 4                    // A partir de aquí se descartan respuestas de baja prioridad
+#define SMS_MAX_INTENTOS 4
+#define SMS_BACKOFF_BASE_MS 5000UL            // 5 s, 10 s, 20 s...
+#define SMS_TIMEOUT_PROMPT_MS 5000UL          // Espera del '>' tras AT+CMGS
+#define SMS_TIMEOUT_CMGS_MS 60000UL           // Espera de +CMGS / +CMS ERROR tras Ctrl+Z
+#define SMS_VENTANA_POR_NUMERO_MS (10UL * 60 * 1000)
+#define SMS_MAX_POR_NUMERO 5                  // Respuestas por ventana a un número autorizado
+#define SMS_MAX_POR_NUMERO_BAJA 1             // Respuestas por ventana a un número no autorizado
+#define SMS_LONGITUD_MAXIMA 160
+
+// Lista blanca de números (NVS)
+#define LISTA_MAX_NUMEROS 2048                // Requiere la partición NVS ampliada de partitions.csv
+#define LISTA_SLOTS_INDICE 4096               // Potencia de 2, al menos el doble de LISTA_MAX_NUMEROS
+#define LISTA_ENTRADAS_POR_BLOQUE 128
+
+// Respaldo de los reportes por SMS binario (modo PDU) cuando los datos no funcionan
+#define RESPALDO_SMS_NUMERO ""                      // Número de la pasarela (formato internacional); "" = deshabilitado
+#define RESPALDO_SMS_CAIDA_MS (15UL * 60 * 1000)    // Datos caídos al menos este tiempo antes de usar SMS
+#define RESPALDO_SMS_INTERVALO_MS (10UL * 60 * 1000) // Espera mínima entre lotes
+#define RESPALDO_SMS_MAX_PARTES 3                   // Partes concatenadas por lote (no más que SMS_UMBRAL_CARGA)
+#define RESPALDO_SMS_MAX_DIA 48                     // SMS por cada 24 h
+
 #endif // CONFIG_H
@@ -3,49 +3,327 @@
 #include "GSMModule.h"
 #include "GPSModule.h"
 #include "HTTPClient.h"
-#include "GeoUtils.h"
+#include "ColaReportes.h"
+#include "ConsumoDatos.h"
+#include "CanalAT.h"
+#include "ControlSalidas.h"
+#include "ColaSMS.h"
+#include "ListaAutorizados.h"
+#include "ControlSMS.h"
+#include "ServicioUbicacion.h"
+#include "RecuperacionGNSS.h"
+#include "SupervisorRed.h"
+#include "CapturaGNSS.h"
+#include "RelojGNSS.h"
+#include "RespaldoSMS.h"
+#include "CacheDNS.h"
+#include "ActualizacionOTA.h"
+#include "Bitacora.h"
+#include "Estima.h"
+#include "PoliticaReporte.h"
+#include "RegistroViajes.h"
 
 // ============================
 // VARIABLES GLOBALES
 // ============================
 HardwareSerial& gsmSerial = Serial1;
 
-GSMModule gsm(gsmSerial, PWR_PIN, RXD1_PIN, TXD1_PIN, BAUD_RATE);
-GPSModule gps(gsmSerial);
-HTTPClient httpClient(gsm);
+// Un solo canal AT para el rastreador y el control SMS
+CanalAT canal(gsmSerial);
 
-unsigned long ultimoCheckGPS = 0;
-unsigned long ultimoEnvioServidor = 0;
-unsigned long tiempoUltimaLectura = 0;
+// Reloj monótono de 64 bits anclado a la hora GNSS de cada fix
+RelojGNSS reloj;
 
-int fallosGPSConsecutivos = 0;
-const int MAX_FALLOS_GPS = 3;
+GSMModule gsm(canal, PWR_PIN, RXD1_PIN, TXD1_PIN, BAUD_RATE);
+GPSModule gps(canal, reloj);
+ControlSalidas salidas(PIN_ACTIVE, PIN_INACTIVE);
+HTTPClient httpClient(gsm, salidas);
+ColaReportes reportes;
+ConsumoDatos consumo(reloj);
+
+ColaSMS colaSMS(canal);
+ListaAutorizados listaAutorizados;
+ControlSMS controlSMS(canal, colaSMS, listaAutorizados, salidas);
+ServicioUbicacion ubicacion(gps, colaSMS);
+RecuperacionGNSS recuperacionGNSS(gps);
+SupervisorRed supervisorRed(gsm);
+CapturaGNSS captura(canal, reloj);
+ActualizacionOTA ota(httpClient);
+RespaldoSMS respaldoSMS(colaSMS, reportes, RESPALDO_SMS_NUMERO);
+CacheDNS cacheDNS(canal, API_ENDPOINT);
+RegistroViajes viajes;
+
+// Lectura del GNSS, movimiento, estima y heartbeat: las mismas reglas que reproduce simulador/politica.cpp
+const ParametrosPolitica parametrosPolitica = {
+  UMBRAL_MOVIMIENTO_METROS, INTERVALO_LECTURA_GPS, INTERVALO_LECTURA_URGENTE, INTERVALO_HEARTBEAT,
+  REPORTE_ESTIMA != 0, ESTIMA_UMBRAL_METROS, ESTIMA_INTERVALO_MAX_MS, ESTIMA_VELOCIDAD_MIN_KMH
+};
+PoliticaReporte politica(parametrosPolitica);
+
+#if GRABAR_UART
+GrabadorUART grabadorUART(Serial);
+#endif
+
+unsigned long ultimoIntentoLote = 0;
+bool envioDiferido = false;  // Fixes retenidos en la cola por enlace malo
+unsigned long ultimoIntentoCaptura = 0;
+bool bitacoraPendiente = false;  // El servidor pidió la bitácora ("log":true)
+unsigned long ultimoFalloOTA = 0;
 
-bool posicionActualValida = false;
 double lat_actual_leida = 0.0;
 double lon_actual_leida = 0.0;
-double lat_ultimo_envio = 0.0;
-double lon_ultimo_envio = 0.0;
+uint32_t utc_actual_leida = 0;
+uint64_t monotono_actual_leido = 0;
+
+// Reporte por estima: la base pasa a ser el fix enviado cuando sale o queda en cola
+BaseEstima baseEnCurso;
+uint64_t monotonoEnCurso = 0;
 
 // ============================
 // HELPER DE ENVÍO
 // ============================
-void enviarYActualizar(double lat, double lon, double speed = -1.0);
+void enviarYActualizar(double lat, double lon, uint32_t utc, double speed = -1.0, bool urgente = false,
+                       float rumbo = -1.0f);
+
+// ============================
+// INTEGRACIÓN CON CONTROL SMS
+// ============================
+
+// Se ejecuta mientras el rastreador espera al módem (p.ej. +HTTPACTION)
+void tareaFondo() {
+  controlSMS.atender();
+}
+
+// Una vuelta puede encadenar sesiones HTTP, captura, bitácora y OTA: el watchdog
+// solo debe saltar si una espera deja de avanzar, no por su suma
+void alimentarWatchdog() {
+  supervisorRed.alimentarWatchdog();
+}
+
+// Respuesta a "Localizar": inmediata con el último fix; el seguimiento llega por la cola
+String ubicacionParaSMS(const String& remitente) {
+  return ubicacion.responder(remitente);
+}
+
+// La vigencia del certificado se valida con el reloj del módem: sin NITZ, el
+// primer fix con hora GNSS se lo fija
+void fijarRelojModem(uint32_t utc) {
+  ContextoTLS& tls = httpClient.getTLS();
+  if (utc == 0 || tls.relojValido() || !tls.verificaServidor()) {
+    return;
+  }
+  if (gsm.fijarReloj(utc)) {
+    LOG_INFO("✓ Reloj del módem fijado con la hora GNSS");
+    tls.setRelojValido(true);
+  }
+}
+
+// Tras apagar y encender el módem se pierde la configuración de SMS y GNSS
+void reconfigurarModem() {
+  controlSMS.configurarModem();
+  httpClient.getTLS().invalidar();
+  if (httpClient.getTLS().verificaServidor()) {
+    httpClient.getTLS().setRelojValido(gsm.relojConFecha());
+  }
+  captura.reiniciar();
+  if (ubicacion.gnssActivo() && !gps.inicializar()) {
+    LOG_AVISO("✗ Error al reinicializar GPS");
+  }
+}
 
 // ============================
 // HELPER DE ENVÍO
 // ============================
-void enviarYActualizar(double lat, double lon, double speed) {
-  if (httpClient.enviarUbicacion(lat, lon, speed)) {
-    Serial.println(">> Envío exitoso. Actualizando posición base.");
-    lat_ultimo_envio = lat;
-    lon_ultimo_envio = lon;
-    ultimoEnvioServidor = millis();
+// AGPS solo si hace falta y el presupuesto de datos lo permite
+bool asistenciaPendiente() {
+  return gps.debeRefrescarAsistencia() && consumo.permiteAsistencia();
+}
+
+void descargarAsistencia() {
+  if (gps.descargarAsistencia()) {
+    ConsumoSesion c = { DATOS_BYTES_TCP, DATOS_BYTES_AGPS };
+    consumo.registrar(DATOS_AGPS, c);
+  }
+}
+
+// Cada sesión alimenta la recuperación de la red y el respaldo por SMS
+void registrarResultado() {
+  supervisorRed.registrarEnvio(httpClient.ultimoResultado());
+  respaldoSMS.registrarEnvio(httpClient.ultimoResultado());
+  cacheDNS.registrarConexion(httpClient.ultimoResultado(), httpClient.conectoPorIP());
+}
+
+// Altas y bajas de la lista blanca pedidas por el servidor. El servidor las
+// repite hasta verlas aplicadas: solo se escribe en NVS lo que cambia.
+void aplicarListaServidor() {
+  const char* alta = httpClient.altaSolicitada();
+  RolNumero rol = httpClient.rolSolicitado();
+  if (alta[0] != '\0' && listaAutorizados.rol(alta) != rol) {
+    if (listaAutorizados.agregar(alta, rol)) {
+      LOG_INFO("✓ Servidor: alta de %s (%s)", alta, ListaAutorizados::nombreRol(rol));
+    } else {
+      LOG_AVISO("✗ Servidor: no se pudo dar de alta %s", alta);
+    }
+  }
+  const char* baja = httpClient.bajaSolicitada();
+  if (baja[0] != '\0' && listaAutorizados.rol(baja) != ROL_NINGUNO) {
+    if (listaAutorizados.eliminar(baja)) {
+      LOG_INFO("✓ Servidor: baja de %s", baja);
+    }
+  }
+}
+
+// Una petición: el fix más nuevo y, como lote, hasta 'maxLote' pendientes.
+// Descarta de la cola lo que el servidor recibió o confirma con "ack".
+bool enviarLote(int maxLote) {
+  bool enviado = httpClient.enviarReportes(reportes, maxLote);
+  consumo.registrar(DATOS_REPORTE, httpClient.ultimoConsumo());
+  registrarResultado();
+  if (enviado) {
+    reportes.confirmarEnvio(httpClient.reportesEnLote(), httpClient.ultimoAck());
+    viajes.confirmarEventos(httpClient.eventosEnviados());
+    if (httpClient.capturaSolicitada()) {
+      captura.disparar(CAPTURA_SERVIDOR);
+    }
+    if (httpClient.bitacoraSolicitada()) {
+      bitacoraPendiente = true;
+    }
+    // Un reporte que llegó al servidor confirma una imagen a prueba
+    ota.confirmarArranque();
+    ota.solicitar(httpClient.otaSolicitada());
+    aplicarListaServidor();
+  }
+  return enviado;
+}
+
+// La captura congelada se borra de la flash solo cuando el servidor la recibió
+void enviarCaptura() {
+  bool enviado = httpClient.enviarCaptura(captura);
+  consumo.registrar(DATOS_CAPTURA, httpClient.ultimoConsumo());
+  registrarResultado();
+  if (enviado) {
+    captura.descartarCongelada();
+  }
+}
+
+// La historia en flash queda congelada durante la subida y se borra solo si llegó
+void enviarBitacora() {
+  if (!bitacora.prepararEnvio()) {
+    return;  // La tarea de drenado está guardando: se intenta en la próxima vuelta
+  }
+  bool enviado = httpClient.enviarBitacora(bitacora);
+  bitacora.terminarEnvio(enviado);
+  consumo.registrar(DATOS_CAPTURA, httpClient.ultimoConsumo());
+  registrarResultado();
+  if (enviado) {
+    bitacoraPendiente = false;
+  }
+}
+
+// Un bloque del delta por vuelta; con el último se instala y se reinicia
+void descargarOTA() {
+  bool descargado = ota.descargarBloque();
+  consumo.registrar(DATOS_OTA, httpClient.ultimoConsumo());
+  registrarResultado();
+  ultimoFalloOTA = descargado ? 0 : millis();
+}
+
+// Con enlace débil, sesiones cortas: menos pendientes por petición y una sola petición
+int loteSegunEnlace(NivelEnlace enlace) {
+  switch (enlace) {
+    case ENLACE_REGULAR: return SENAL_LOTE_REGULAR;
+    case ENLACE_MALO:
+    case ENLACE_SIN_SERVICIO: return SENAL_LOTE_MALO;
+    default: return REPORTES_COLA_CAPACIDAD;  // Todo lo que quepa en la URL
+  }
+}
+
+// Vacía la cola en hasta REPORTES_MAX_POR_CICLO peticiones
+bool enviarPendientes() {
+  ultimoIntentoLote = millis();
+  NivelEnlace enlace = gsm.medirSenal().nivel;
+  int maxLote = loteSegunEnlace(enlace);
+  int peticiones = (enlace == ENLACE_BUENO || enlace == ENLACE_DESCONOCIDO) ? REPORTES_MAX_POR_CICLO : 1;
+  if (!enviarLote(maxLote)) {
+    return false;
+  }
+  for (int i = 1; i < peticiones && reportes.pendientes() > 0; i++) {
+    if (!enviarLote(maxLote)) {
+      break;
+    }
+  }
+  envioDiferido = false;
+  politica.marcarEnvio(millis());
+  
+  // El contexto PDP ya está activo: aprovechar para refrescar la asistencia AGPS
+  if (asistenciaPendiente()) {
+    descargarAsistencia();
+  }
+  return true;
+}
+
+// Con presión sobre el presupuesto de datos, los fixes esperan a completar un lote
+bool loteListo() {
+  return reportes.pendientes() >= DATOS_LOTE_REPORTES ||
+         millis() - reportes.masAntiguo().encolado >= DATOS_LOTE_ESPERA_MS;
+}
+
+// Con enlace malo los fixes esperan en la cola, como mucho SENAL_DIFERIR_MAX_MS
+bool enlaceInsuficiente() {
+  NivelEnlace enlace = gsm.medirSenal().nivel;
+  return (enlace == ENLACE_MALO || enlace == ENLACE_SIN_SERVICIO) &&
+         millis() - reportes.masAntiguo().encolado < SENAL_DIFERIR_MAX_MS;
+}
+
+// El fix queda en cola pero cuenta como reportado para el movimiento y el heartbeat
+void retenerFix(double lat, double lon) {
+  politica.fijarReportado(lat, lon, baseEnCurso, monotonoEnCurso);
+  politica.marcarEnvio(millis());
+}
+
+// Los fixes urgentes (primer fix, arranque tras estar estacionado) salen siempre de inmediato
+void enviarYActualizar(double lat, double lon, uint32_t utc, double speed, bool urgente, float rumbo) {
+  // Velocidad y rumbo redondeados como viajan en la URL: el servidor extrapola con los mismos valores
+  baseEnCurso = politica.armarBase(lat, lon, speed, rumbo, utc);
+  monotonoEnCurso = monotono_actual_leido;
+  reportes.agregar(lat, lon, baseEnCurso.velocidad, utc, baseEnCurso.rumbo);
+
+  if (!urgente && consumo.agruparReportes() && !loteListo()) {
+    LOG_INFO("Datos: fix en cola para el próximo lote (%d de %d)", reportes.pendientes(), DATOS_LOTE_REPORTES);
+    retenerFix(lat, lon);
+    return;
+  }
+
+  if (!urgente && enlaceInsuficiente()) {
+    LOG_INFO("Enlace %s: fix en cola hasta que mejore (%d pendientes)", GSMModule::nombreEnlace(gsm.getSenal().nivel),
+             reportes.pendientes());
+    envioDiferido = true;
+    retenerFix(lat, lon);
+    return;
+  }
+
+  if (enviarPendientes()) {
+    LOG_INFO("Envío exitoso. Actualizando posición base.");
+    politica.fijarReportado(lat, lon, baseEnCurso, monotonoEnCurso);
   } else {
-    Serial.println(">> Falla de envío. Se reintentará en el próximo ciclo.");
+    LOG_AVISO("Falla de envío. Se reintentará en el próximo ciclo.");
   }
 }
 
+// El último fix leído; con el reporte por estima, con su velocidad y rumbo
+void enviarUbicacionActual() {
+  DecisionReporte d = politica.reporteActual();
+  enviarYActualizar(lat_actual_leida, lon_actual_leida, utc_actual_leida, d.velocidad, false, d.rumbo);
+}
+
+// Nivel de la ignición: 1 encendida, 0 apagada, -1 sin cable
+int leerIgnicion() {
+#if VIAJES_PIN_IGNICION >= 0
+  return digitalRead(VIAJES_PIN_IGNICION) == HIGH ? 1 : 0;
+#else
+  return -1;
+#endif
+}
 
 // ============================
 // SETUP
@@ -53,138 +331,229 @@ void enviarYActualizar(double lat, double lon, double speed) {
 void setup() {
   Serial.begin(BAUD_RATE);
   delay(2000);
-  Serial.println("\n\n>> =============================");
-  Serial.println(">> GPS Tracker - FindMe32 (Modular)");
-  Serial.println(">> =============================");
-  Serial.println(">> Device Token: " + String(DEVICE_TOKEN));
-  Serial.println(">> Umbral Movimiento: " + String(UMBRAL_MOVIMIENTO_METROS) + " metros");
-  Serial.println(">> Intervalo GPS: 30 segundos");
-  Serial.println(">> Intervalo Heartbeat: 5 minutos");
-  Serial.println(">> =============================\n");
+  // Antes que nada: rescata a la flash la bitácora de la sesión anterior
+  bitacora.begin();
+  LOG_INFO("=============================");
+  LOG_INFO("GPS Tracker + Control SMS - FindMe32 (Modular)");
+  LOG_INFO("Device Token: %s", DEVICE_TOKEN);
+  if (REPORTE_ESTIMA) {
+    LOG_INFO("Reporte por estima: desvío %.0f metros, máximo %lu min", (double)ESTIMA_UMBRAL_METROS,
+             (unsigned long)ESTIMA_INTERVALO_MAX_MS / 60000);
+  } else {
+    LOG_INFO("Umbral Movimiento: %.0f metros", (double)UMBRAL_MOVIMIENTO_METROS);
+  }
+  LOG_INFO("Intervalo GPS: %lu s, Heartbeat: %lu min", (unsigned long)INTERVALO_LECTURA_GPS / 1000,
+           (unsigned long)INTERVALO_HEARTBEAT / 60000);
+  LOG_INFO("=============================");
   
-  // Inicializar pines de control
-  pinMode(PIN_ACTIVE, OUTPUT);
-  pinMode(PIN_INACTIVE, OUTPUT);
-  digitalWrite(PIN_ACTIVE, LOW);
-  digitalWrite(PIN_INACTIVE, LOW);
-  Serial.println(">> Pines de control inicializados (" + String(PIN_ACTIVE) + ", " + String(PIN_INACTIVE) + ")");
+  // Inicializar pines de control (estado restaurado desde NVS)
+  salidas.begin();
+  reportes.begin();
+  consumo.begin();
+  captura.begin();
+  ota.begin();
+  // Con TLS_CA_PEM el certificado se verifica contra el host de la URL: siempre por nombre
+  if (DNS_CONECTAR_POR_IP && httpClient.getTLS().verificaServidor()) {
+    LOG_AVISO("DNS_CONECTAR_POR_IP ignorado: con TLS_CA_PEM se conecta a %s por nombre", API_ENDPOINT);
+  } else {
+    cacheDNS.begin();
+    httpClient.setCacheDNS(&cacheDNS);
+  }
+  if (VIAJES_HABILITADOS) {
+    viajes.begin();
+    httpClient.setViajes(&viajes);
+  }
+#if VIAJES_PIN_IGNICION >= 0
+  pinMode(VIAJES_PIN_IGNICION, INPUT);
+#endif
   
+#if GRABAR_UART
+  canal.setGrabador(&grabadorUART);
+#endif
   gsm.begin();
   
+  controlSMS.setProveedorUbicacion(ubicacionParaSMS);
+  controlSMS.begin();
+  canal.setTareaFondo(tareaFondo);
+  
   if (!gsm.esperarRegistroRed()) {
-    Serial.println(">> ✗ ADVERTENCIA: No se pudo registrar en la red");
+    LOG_AVISO("✗ No se pudo registrar en la red");
   }
   
   gsm.verificarCalidadSenal();
   
-  if (!gsm.verificarYSincronizarReloj()) {
-    Serial.println(">> ✗ ADVERTENCIA: Problemas con sincronización de reloj");
+  bool relojModem = gsm.verificarYSincronizarReloj();
+  if (!relojModem) {
+    LOG_AVISO("✗ Problemas con sincronización de reloj");
   }
+  httpClient.getTLS().setRelojValido(relojModem);
   
   if (!gps.inicializar()) {
-    Serial.println(">> ✗ ADVERTENCIA: Error al inicializar GPS");
+    LOG_AVISO("✗ Error al inicializar GPS");
   }
   
   if (!gsm.verificarConexionGPRS()) {
-    Serial.println(">> ✗ ADVERTENCIA: No se pudo configurar GPRS");
+    LOG_AVISO("✗ No se pudo configurar GPRS");
+    respaldoSMS.registrarEnvio(ENVIO_SIN_PDP);  // La caída cuenta desde el arranque
+  } else if (asistenciaPendiente()) {
+    // Asistencia antes del primer fix para evitar un arranque en frío
+    descargarAsistencia();
   }
   
-  Serial.println("\n>> Sistema listo. Comenzando ciclo de envío...\n");
-  Serial.println("\n>> Esperando primer 'fix' de GPS (puede tardar)...");
-  ultimoCheckGPS = millis();
-  ultimoEnvioServidor = millis();
+  LOG_INFO("Sistema listo. Esperando primer 'fix' de GPS (puede tardar)...");
+  politica.iniciar(millis());
+
+  // Desde aquí el watchdog vigila el ciclo principal; cada espera del canal lo alimenta
+  supervisorRed.setReconfigurarModem(reconfigurarModem);
+  supervisorRed.begin();
+  canal.setLatido(alimentarWatchdog);
 }
 
 // ============================
 // LOOP PRINCIPAL
 // ============================
 void loop() {
+  supervisorRed.alimentarWatchdog();
+  reloj.ahora();  // Al menos una lectura por desborde de millis(), aun con el GNSS apagado
+
+  // Comandos SMS y cola de salida: nunca bloquean el ciclo de rastreo
+  canal.atender();
+  controlSMS.atender();
+
   unsigned long tiempoActual = millis();
 
-  // --- 1. LÓGICA DE LECTURA DE GPS (Cada 30 segundos) ---
-  if (tiempoActual - ultimoCheckGPS >= INTERVALO_LECTURA_GPS) {
-    ultimoCheckGPS = tiempoActual;
+  // Ciclo de trabajo del GNSS y seguimientos de "Localizar"; con la ignición no hay reposo
+  if (leerIgnicion() == 1) {
+    ubicacion.despertar();
+  }
+  ubicacion.atender();
+
+  // Captura de alta frecuencia: URC +CGNSSINFO con el GNSS encendido, disparos y congelado
+  captura.atender(ubicacion.gnssActivo());
 
+  // Salud del GNSS: escala reinicios sin bloquear el ciclo
+  if (recuperacionGNSS.atender(ubicacion.gnssActivo())) {
+    if (asistenciaPendiente() && gsm.estaContextoPDPActivo()) {
+      descargarAsistencia();
+    }
+  }
+
+  // --- 1. LÓGICA DE LECTURA DE GPS (Cada 20 segundos, antes si hay un Localizar pendiente) ---
+  if (ubicacion.gnssActivo() && politica.tocaLectura(tiempoActual, ubicacion.haySeguimientos())) {
     GpsData pos = gps.obtenerCoordenadas(3);
+    recuperacionGNSS.registrarLectura(pos);
     
     if (pos.valida) {
-      fallosGPSConsecutivos = 0; // Resetear contador de fallos
-      unsigned long tiempoActualLectura = millis();
+      ubicacion.registrarFix(pos.lat, pos.lon);
       lat_actual_leida = pos.lat;
       lon_actual_leida = pos.lon;
+      // Sin hora en el fix, la del reloj al leerlo: el servidor no debe fecharlo a su llegada
+      utc_actual_leida = pos.utc != 0 ? pos.utc : reloj.utcDe(pos.monotono);
+      monotono_actual_leido = pos.monotono;
+      consumo.actualizarHora();
+      fijarRelojModem(pos.utc);
+      if (VIAJES_HABILITADOS) {
+        viajes.registrarFix(pos.lat, pos.lon, pos.velocidad, utc_actual_leida, leerIgnicion());
+      }
 
-      if (!posicionActualValida) {
-        // --- CASO A: Es el primer fix válido ---
-        Serial.println(">> Primera ubicación GPS obtenida. Enviando...");
-        posicionActualValida = true;
-        tiempoUltimaLectura = tiempoActualLectura;
-        enviarYActualizar(lat_actual_leida, lon_actual_leida);
-      
-      } else {
-        // --- CASO B: Ya teníamos un fix, comparar si hay movimiento ---
-        double distancia = calcularDistancia(lat_ultimo_envio, lon_ultimo_envio, lat_actual_leida, lon_actual_leida);
-
-        if (distancia > UMBRAL_MOVIMIENTO_METROS) {
-          // Calcular velocidad: distancia (m) / tiempo (s) = m/s -> * 3.6 = km/h
-          unsigned long tiempoTranscurrido = (tiempoActualLectura - tiempoUltimaLectura) / 1000; // segundos
-          double velocidadKmh = -1.0;
-          
-          if (tiempoTranscurrido > 0) {
-            double velocidadMs = distancia / (double)tiempoTranscurrido;
-            velocidadKmh = velocidadMs * 3.6; // Convertir m/s a km/h
+      // Con presión sobre el presupuesto de datos el umbral y los intervalos crecen
+      FixPolitica fix = { pos.lat, pos.lon, pos.utc, pos.utcMs, pos.velocidad, pos.rumbo, pos.monotono };
+      DecisionReporte d = politica.evaluarFix(fix, consumo.factorIntervalo());
+      switch (d.motivo) {
+        case REPORTE_PRIMER_FIX:
+          LOG_INFO("Primera ubicación GPS obtenida. Enviando...");
+          break;
+        case REPORTE_DESVIO_ESTIMA:
+          LOG_INFO("DESVÍO DE LA ESTIMA (%.1fm a los %.0f s). Enviando...", d.metros, d.segundos);
+          break;
+        case REPORTE_MOVIMIENTO:
+          LOG_INFO("MOVIMIENTO DETECTADO (%.1fm). Enviando...", d.metros);
+          break;
+        default:
+          if (REPORTE_ESTIMA) {
+            LOG_INFO("Según la estima (desvío %.1fm). Sin reporte.", d.metros);
+          } else {
+            LOG_INFO("Estacionario (Variación: %.1fm). Esperando heartbeat...", d.metros);
           }
-          
-          Serial.println(">> MOVIMIENTO DETECTADO (" + String(distancia, 1) + "m). Enviando...");
-          tiempoUltimaLectura = tiempoActualLectura;
-          enviarYActualizar(lat_actual_leida, lon_actual_leida, velocidadKmh);
-        } else {
-          Serial.println(">> Estacionario (Variación: " + String(distancia, 1) + "m). Esperando heartbeat...");
-        }
+          break;
       }
-    } else {
-      Serial.println(">> No se obtuvo fix de GPS en este ciclo.");
-      fallosGPSConsecutivos++;
-      
-      if (fallosGPSConsecutivos >= MAX_FALLOS_GPS) {
-        Serial.println(">> ❗ " + String(MAX_FALLOS_GPS) + " fallos consecutivos de GPS. Reiniciando GPS...");
-        
-        // Reinicializar GPS
-        if (gps.inicializar()) {
-          Serial.println(">> ✓ GPS reiniciado correctamente");
-          fallosGPSConsecutivos = 0;
-          
-          // Dar tiempo al GPS para buscar satélites (mínimo 30 segundos)
-          Serial.println(">> Esperando 30 segundos para que el GPS busque satélites...");
-          delay(30000);
-          Serial.println(">> GPS listo para obtener coordenadas");
-        } else {
-          Serial.println(">> ✗ Error al reiniciar GPS");
-        }
+      if (d.motivo != REPORTE_NINGUNO) {
+        enviarYActualizar(lat_actual_leida, lon_actual_leida, utc_actual_leida, d.velocidad, d.urgente, d.rumbo);
+      }
+
+      // Inicio o fin de un viaje sin un reporte en cola que lo lleve: sale con el fix actual
+      if (viajes.eventosPendientes() > 0 && reportes.pendientes() == 0) {
+        LOG_INFO("Viajes: %d eventos pendientes. Enviando...", viajes.eventosPendientes());
+        enviarUbicacionActual();
       }
+    } else {
+      LOG_INFO("No se obtuvo fix de GPS en este ciclo (%d satélites).", (int)pos.satelites);
     }
-  } // Fin del chequeo de 30 segundos
+  } // Fin del chequeo de lectura
 
 
   // --- 2. LÓGICA DE HEARTBEAT (Cada 5 minutos) ---
-  if (tiempoActual - ultimoEnvioServidor >= INTERVALO_HEARTBEAT) {
-    Serial.println(">> Han pasado 5 min (Heartbeat). Verificando si hay que enviar...");
-
-    if (posicionActualValida) {
-      double dist_desde_ultimo_envio = calcularDistancia(lat_ultimo_envio, lon_ultimo_envio, lat_actual_leida, lon_actual_leida);
-
-      if (dist_desde_ultimo_envio > 0.1) { 
-         Serial.println(">> Enviando última ubicación conocida (Heartbeat)...");
-         enviarYActualizar(lat_actual_leida, lon_actual_leida);
-      } else {
-         Serial.println(">> Heartbeat: Ubicación no ha cambiado desde el último envío. Omitiendo.");
-         ultimoEnvioServidor = tiempoActual; // Reiniciar timer
+  // Releer el reloj: un envío en el paso 1 deja el último envío después de tiempoActual
+  tiempoActual = millis();
+  switch (politica.evaluarHeartbeat(tiempoActual, consumo.factorIntervalo())) {
+    case HEARTBEAT_ENVIAR:
+      LOG_INFO("Heartbeat (%lu min): enviando última ubicación conocida...",
+               (unsigned long)INTERVALO_HEARTBEAT * consumo.factorIntervalo() / 60000);
+      enviarUbicacionActual();
+      break;
+    case HEARTBEAT_SIN_CAMBIO:
+      LOG_INFO("Heartbeat: Ubicación no ha cambiado desde el último envío. Omitiendo.");
+      break;
+    case HEARTBEAT_SIN_FIX:
+      LOG_INFO("Heartbeat: Aún sin fix GPS válido. No se envía nada.");
+      break;
+    default:
+      break;
+  }
+
+  // --- 3. REPORTES RETENIDOS (presión sobre el presupuesto de datos o enlace malo) ---
+  if (reportes.pendientes() > 0 && (consumo.agruparReportes() || envioDiferido) &&
+      (!consumo.agruparReportes() || loteListo()) &&
+      millis() - ultimoIntentoLote >= INTERVALO_LECTURA_GPS && !enlaceInsuficiente()) {
+    LOG_INFO("Enviando lote de %d reportes...", reportes.pendientes());
+    enviarPendientes();
+  }
+
+  // Datos caídos desde hace RESPALDO_SMS_CAIDA_MS: los pendientes salen por SMS a la pasarela
+  respaldoSMS.atender();
+
+  // Dirección del servidor vencida: se resuelve aquí y no en la sesión de un reporte
+  cacheDNS.atender();
+
+  // --- 4. SUBIDA DE CAPTURAS Y BITÁCORA (no esperan al presupuesto, sí a un enlace usable) ---
+  if ((captura.hayCongelada() || bitacoraPendiente) && millis() - ultimoIntentoCaptura >= CAPTURA_REINTENTO_MS) {
+    ultimoIntentoCaptura = millis();
+    NivelEnlace enlace = gsm.medirSenal().nivel;
+    if (enlace != ENLACE_MALO && enlace != ENLACE_SIN_SERVICIO) {
+      if (captura.hayCongelada()) {
+        enviarCaptura();
+      }
+      if (bitacoraPendiente) {
+        enviarBitacora();
       }
+      ultimoIntentoCaptura = millis();
+    }
+  }
 
+  // --- 5. ACTUALIZACIÓN OTA (por bloques, solo con enlace usable y holgura en el presupuesto) ---
+  ota.atender();
+  if (ota.descargaPendiente() && consumo.permiteActualizacion() &&
+      (ultimoFalloOTA == 0 || millis() - ultimoFalloOTA >= OTA_REINTENTO_MS)) {
+    NivelEnlace enlace = gsm.medirSenal().nivel;
+    if (enlace != ENLACE_MALO && enlace != ENLACE_SIN_SERVICIO) {
+      descargarOTA();
     } else {
-      Serial.println(">> Heartbeat: Aún sin fix GPS válido. No se envía nada.");
-      ultimoEnvioServidor = tiempoActual; // Reiniciar timer
+      ultimoFalloOTA = millis();
     }
-  } // Fin del chequeo de 5 minutos
+  }
+
+  // --- 6. RECUPERACIÓN DE LA CONEXIÓN (tras varios envíos fallidos) ---
+  supervisorRed.atender();
 
-  delay(1000); // Pequeño delay
+  delay(10); // Pequeño delay
 }
\ No newline at end of file
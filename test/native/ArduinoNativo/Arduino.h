@@ -0,0 +1,208 @@
+#ifndef ARDUINO_NATIVO_H
+#define ARDUINO_NATIVO_H
+
+// ============================
+// ARDUINO MÍNIMO PARA PRUEBAS NATIVAS
+// ============================
+// Solo lo que usa src/findme32. El reloj es virtual: delay() lo adelanta al
+// instante, así una reproducción corre mucho más rápido que en tiempo real.
+// String envuelve std::string: las asignaciones de memoria no son idénticas
+// a las del core de ESP32, pero sí comparables entre versiones del firmware.
+
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <cctype>
+#include <cmath>
+#include <deque>
+#include <algorithm>
+
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define SERIAL_8N1 0
+#define PI 3.1415926535897932384626433832795
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+void pinMode(int pin, int modo);
+void digitalWrite(int pin, int valor);
+int digitalRead(int pin);
+
+// Reloj virtual
+void avanzarReloj(unsigned long ms);
+void fijarReloj(unsigned long ms);
+
+class String {
+public:
+  String() {}
+  String(const char* c) : s(c ? c : "") {}
+  String(const std::string& x) : s(x) {}
+  explicit String(char c) : s(1, c) {}
+  String(int v) : s(std::to_string(v)) {}
+  String(unsigned int v) : s(std::to_string(v)) {}
+  String(long v) : s(std::to_string(v)) {}
+  String(unsigned long v) : s(std::to_string(v)) {}
+  String(long long v) : s(std::to_string(v)) {}
+  String(unsigned long long v) : s(std::to_string(v)) {}
+  String(double v, unsigned int decimales = 2) { formatear(v, decimales); }
+  String(float v, unsigned int decimales = 2) { formatear(v, decimales); }
+
+  unsigned int length() const { return s.size(); }
+  const char* c_str() const { return s.c_str(); }
+  void reserve(unsigned int n) { s.reserve(n); }
+
+  char charAt(unsigned int i) const { return i < s.size() ? s[i] : 0; }
+  char operator[](unsigned int i) const { return charAt(i); }
+
+  int indexOf(char c, unsigned int desde = 0) const { return pos(s.find(c, desde)); }
+  int indexOf(const String& x, unsigned int desde = 0) const { return pos(s.find(x.s, desde)); }
+  int lastIndexOf(char c) const { return pos(s.rfind(c)); }
+  int lastIndexOf(const String& x) const { return pos(s.rfind(x.s)); }
+
+  String substring(unsigned int desde) const { return desde >= s.size() ? String() : String(s.substr(desde)); }
+  String substring(unsigned int desde, unsigned int hasta) const {
+    if (desde > hasta) std::swap(desde, hasta);
+    if (desde >= s.size()) return String();
+    return String(s.substr(desde, hasta - desde));
+  }
+
+  bool startsWith(const String& x) const { return s.compare(0, x.s.size(), x.s) == 0; }
+  bool endsWith(const String& x) const {
+    return s.size() >= x.s.size() && s.compare(s.size() - x.s.size(), x.s.size(), x.s) == 0;
+  }
+  bool equals(const String& x) const { return s == x.s; }
+  bool equalsIgnoreCase(const String& x) const {
+    if (s.size() != x.s.size()) return false;
+    for (size_t i = 0; i < s.size(); i++) {
+      if (tolower((unsigned char)s[i]) != tolower((unsigned char)x.s[i])) return false;
+    }
+    return true;
+  }
+
+  long toInt() const { return atol(s.c_str()); }
+  float toFloat() const { return (float)atof(s.c_str()); }
+  double toDouble() const { return atof(s.c_str()); }
+
+  void trim() {
+    size_t a = s.find_first_not_of(" \t\r\n");
+    if (a == std::string::npos) { s.clear(); return; }
+    size_t b = s.find_last_not_of(" \t\r\n");
+    s = s.substr(a, b - a + 1);
+  }
+  void toUpperCase() { for (auto& c : s) c = toupper((unsigned char)c); }
+  void toLowerCase() { for (auto& c : s) c = tolower((unsigned char)c); }
+  void remove(unsigned int i) { if (i < s.size()) s.erase(i); }
+  void remove(unsigned int i, unsigned int n) { if (i < s.size()) s.erase(i, n); }
+  void replace(const String& a, const String& b) {
+    if (a.s.empty()) return;
+    size_t p = 0;
+    while ((p = s.find(a.s, p)) != std::string::npos) { s.replace(p, a.s.size(), b.s); p += b.s.size(); }
+  }
+
+  bool concat(const String& x) { s += x.s; return true; }
+  bool concat(char c) { s += c; return true; }
+  String& operator=(const char* x) { s.assign(x ? x : ""); return *this; }  // Reusa la capacidad, como en Arduino
+  String& operator+=(const String& x) { s += x.s; return *this; }
+  String& operator+=(const char* x) { s += x; return *this; }
+  String& operator+=(char c) { s += c; return *this; }
+
+  bool operator==(const String& x) const { return s == x.s; }
+  bool operator==(const char* x) const { return s == x; }
+  bool operator!=(const String& x) const { return s != x.s; }
+  bool operator!=(const char* x) const { return s != x; }
+  bool operator<(const String& x) const { return s < x.s; }
+
+  const std::string& str() const { return s; }
+
+private:
+  std::string s;
+
+  static int pos(size_t p) { return p == std::string::npos ? -1 : (int)p; }
+  void formatear(double v, unsigned int decimales) {
+    char b[64];
+    snprintf(b, sizeof(b), "%.*f", (int)decimales, v);
+    s = b;
+  }
+};
+
+inline String operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, const char* b) { String r(a); r += b; return r; }
+inline String operator+(const char* a, const String& b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, char b) { String r(a); r += b; return r; }
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* b, size_t n) { for (size_t i = 0; i < n; i++) write(b[i]); return n; }
+  size_t write(const char* c) { return write((const uint8_t*)c, strlen(c)); }
+
+  size_t print(const String& x) { return write((const uint8_t*)x.c_str(), x.length()); }
+  size_t print(const char* x) { return write(x); }
+  size_t print(char c) { return write((uint8_t)c); }
+  // Números sin pasar por String: como en el ESP32, imprimir no usa el heap
+  size_t print(int v) { return printf("%d", v); }
+  size_t print(unsigned int v) { return printf("%u", v); }
+  size_t print(long v) { return printf("%ld", v); }
+  size_t print(unsigned long v) { return printf("%lu", v); }
+  size_t print(double v, int decimales = 2) { return printf("%.*f", decimales, v); }
+
+  size_t println() { return write("\r\n"); }
+  template <class T> size_t println(const T& v) { size_t n = print(v); return n + println(); }
+  size_t println(double v, int decimales) { size_t n = print(v, decimales); return n + println(); }
+
+  size_t printf(const char* formato, ...) __attribute__((format(printf, 2, 3)));
+  virtual void flush() {}
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+};
+
+/**
+ * UART en memoria: lo escrito queda en tx, lo que se agregue a rx se lee.
+ */
+class HardwareSerial : public Stream {
+public:
+  std::deque<uint8_t> rx;
+  std::string tx;
+
+  void begin(unsigned long, int = 0, int = -1, int = -1) {}
+  void end() {}
+  int available() override { return (int)rx.size(); }
+  int read() override {
+    if (rx.empty()) return -1;
+    int c = rx.front();
+    rx.pop_front();
+    return c;
+  }
+  int peek() override { return rx.empty() ? -1 : rx.front(); }
+  size_t write(uint8_t c) override { tx += (char)c; return 1; }
+  using Print::write;
+  operator bool() const { return true; }
+};
+
+extern HardwareSerial& Serial;
+extern HardwareSerial& Serial1;
+
+struct EspClass {
+  int reinicios = 0;  // Las pruebas comprueban el reinicio en vez de terminar el proceso
+  void restart() { reinicios++; }
+  uint32_t getFreeHeap() { return 200000; }
+};
+extern EspClass ESP;
+
+#endif // ARDUINO_NATIVO_H
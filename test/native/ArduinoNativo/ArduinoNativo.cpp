@@ -0,0 +1,53 @@
+#include <Arduino.h>
+#include <cstdarg>
+#include <LittleFS.h>
+
+static unsigned long relojVirtual = 0;
+static int pines[64];
+
+unsigned long millis() { return relojVirtual; }
+unsigned long micros() { return relojVirtual * 1000UL; }
+void delay(unsigned long ms) { relojVirtual += ms; }
+void delayMicroseconds(unsigned int) {}
+void yield() {}
+
+void avanzarReloj(unsigned long ms) { relojVirtual += ms; }
+void fijarReloj(unsigned long ms) { relojVirtual = ms; }
+
+void pinMode(int, int) {}
+void digitalWrite(int pin, int valor) { if (pin >= 0 && pin < 64) pines[pin] = valor; }
+int digitalRead(int pin) { return pin >= 0 && pin < 64 ? pines[pin] : LOW; }
+
+size_t Print::printf(const char* formato, ...) {
+  char b[512];
+  va_list args;
+  va_start(args, formato);
+  vsnprintf(b, sizeof(b), formato, args);
+  va_end(args);
+  return write(b);
+}
+
+/**
+ * Consola de depuración: se descarta salvo con FINDME_ECO=1 en el entorno.
+ */
+class ConsolaNativa : public HardwareSerial {
+public:
+  size_t write(uint8_t c) override {
+    static const bool eco = getenv("FINDME_ECO") != NULL;
+    if (eco) fputc(c, stdout);
+    return 1;
+  }
+  using Print::write;
+};
+
+static ConsolaNativa consola;
+static HardwareSerial uartPorDefecto;
+
+HardwareSerial& Serial = consola;
+
+// Las pruebas que reproducen el firmware completo redefinen Serial1
+__attribute__((weak)) HardwareSerial& Serial1 = uartPorDefecto;
+
+EspClass ESP;
+
+LittleFSNativo LittleFS;
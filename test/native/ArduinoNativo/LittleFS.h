@@ -0,0 +1,79 @@
+#ifndef LITTLEFS_NATIVO_H
+#define LITTLEFS_NATIVO_H
+
+#include <Arduino.h>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * Archivo de LittleFS en memoria. Como fs::File, se copia como un manejador
+ * del mismo contenido; "w" trunca y "a" agrega al final.
+ */
+class File {
+public:
+  File() : datos(NULL), pos(0) {}
+  explicit File(std::vector<uint8_t>* d) : datos(d), pos(0) {}
+
+  size_t write(const uint8_t* b, size_t n) {
+    if (datos == NULL) return 0;
+    datos->insert(datos->end(), b, b + n);
+    return n;
+  }
+  size_t write(uint8_t b) { return write(&b, 1); }
+  size_t read(uint8_t* b, size_t n) {
+    if (datos == NULL || pos >= datos->size()) return 0;
+    size_t total = std::min(n, datos->size() - pos);
+    memcpy(b, datos->data() + pos, total);
+    pos += total;
+    return total;
+  }
+  bool seek(size_t p) {
+    if (datos == NULL || p > datos->size()) return false;
+    pos = p;
+    return true;
+  }
+  size_t size() const { return datos == NULL ? 0 : datos->size(); }
+  void close() { datos = NULL; }
+  operator bool() const { return datos != NULL; }
+
+private:
+  std::vector<uint8_t>* datos;
+  size_t pos;
+};
+
+/**
+ * Flash en memoria: persiste entre instancias durante el proceso de prueba,
+ * igual que Preferences.
+ */
+class LittleFSNativo {
+public:
+  bool begin(bool = false) { return true; }
+  File open(const char* ruta, const char* modo = "r") {
+    if (modo[0] == 'r' && !exists(ruta)) return File();
+    std::vector<uint8_t>& d = archivos()[ruta];
+    if (modo[0] == 'w') d.clear();
+    return File(&d);
+  }
+  bool exists(const char* ruta) { return archivos().count(ruta) > 0; }
+  bool remove(const char* ruta) { return archivos().erase(ruta) > 0; }
+  bool rename(const char* desde, const char* hacia) {
+    if (!exists(desde)) return false;
+    archivos()[hacia].swap(archivos()[desde]);
+    archivos().erase(desde);
+    return true;
+  }
+
+  // Solo pruebas: borrar todos los archivos
+  static void borrarTodo() { archivos().clear(); }
+
+private:
+  static std::map<std::string, std::vector<uint8_t> >& archivos() {
+    static std::map<std::string, std::vector<uint8_t> > a;
+    return a;
+  }
+};
+
+extern LittleFSNativo LittleFS;
+
+#endif // LITTLEFS_NATIVO_H
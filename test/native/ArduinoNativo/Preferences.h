@@ -0,0 +1,80 @@
+#ifndef PREFERENCES_NATIVO_H
+#define PREFERENCES_NATIVO_H
+
+#include <Arduino.h>
+#include <map>
+#include <vector>
+
+/**
+ * NVS en memoria: persiste entre instancias durante el proceso de prueba,
+ * igual que la NVS real persiste entre reinicios.
+ */
+class Preferences {
+public:
+  bool begin(const char* ns, bool = false) { espacio = ns; return true; }
+  void end() {}
+  bool clear() { almacen()[espacio].clear(); return true; }
+  bool remove(const char* clave) { return almacen()[espacio].erase(clave) > 0; }
+  bool isKey(const char* clave) { return almacen()[espacio].count(clave) > 0; }
+
+  size_t putBool(const char* k, bool v) { return poner(k, v); }
+  bool getBool(const char* k, bool d = false) { return obtener(k, d); }
+  size_t putUChar(const char* k, uint8_t v) { return poner(k, v); }
+  uint8_t getUChar(const char* k, uint8_t d = 0) { return obtener(k, d); }
+  size_t putUShort(const char* k, uint16_t v) { return poner(k, v); }
+  uint16_t getUShort(const char* k, uint16_t d = 0) { return obtener(k, d); }
+  size_t putUInt(const char* k, uint32_t v) { return poner(k, v); }
+  uint32_t getUInt(const char* k, uint32_t d = 0) { return obtener(k, d); }
+  size_t putInt(const char* k, int32_t v) { return poner(k, v); }
+  int32_t getInt(const char* k, int32_t d = 0) { return obtener(k, d); }
+  size_t putULong64(const char* k, uint64_t v) { return poner(k, v); }
+  uint64_t getULong64(const char* k, uint64_t d = 0) { return obtener(k, d); }
+
+  size_t putString(const char* k, const char* v) { return putBytes(k, v, strlen(v) + 1); }
+  size_t getString(const char* k, char* destino, size_t n) {
+    size_t total = getBytes(k, destino, n);
+    if (total == 0 || n == 0) return 0;
+    destino[std::min(total, n) - 1] = '\0';
+    return total;
+  }
+
+  size_t putBytes(const char* k, const void* datos, size_t n) {
+    const uint8_t* p = (const uint8_t*)datos;
+    almacen()[espacio][k] = std::vector<uint8_t>(p, p + n);
+    return n;
+  }
+  size_t getBytes(const char* k, void* destino, size_t n) {
+    auto& ns = almacen()[espacio];
+    auto it = ns.find(k);
+    if (it == ns.end()) return 0;
+    size_t total = std::min(n, it->second.size());
+    memcpy(destino, it->second.data(), total);
+    return total;
+  }
+  size_t getBytesLength(const char* k) {
+    auto& ns = almacen()[espacio];
+    auto it = ns.find(k);
+    return it == ns.end() ? 0 : it->second.size();
+  }
+  size_t freeEntries() { return 1000; }
+
+  // Solo pruebas: borrar todos los espacios
+  static void borrarTodo() { almacen().clear(); }
+
+private:
+  std::string espacio;
+
+  typedef std::map<std::string, std::vector<uint8_t> > EspacioNVS;
+  static std::map<std::string, EspacioNVS>& almacen() {
+    static std::map<std::string, EspacioNVS> a;
+    return a;
+  }
+
+  template <class T> size_t poner(const char* k, T v) { return putBytes(k, &v, sizeof(v)); }
+  template <class T> T obtener(const char* k, T d) {
+    T v;
+    return getBytesLength(k) == sizeof(T) && getBytes(k, &v, sizeof(T)) == sizeof(T) ? v : d;
+  }
+};
+
+#endif // PREFERENCES_NATIVO_H
@@ -0,0 +1,7 @@
+#ifndef CONFIG_H
+// Pruebas nativas: la plantilla sin credenciales es suficiente
+#include "../../../src/findme32/config_template.h"
+// Sin servidor real ni CA: las pruebas que verifican pasan su PEM a ContextoTLS
+#undef TLS_SIN_VERIFICAR
+#define TLS_SIN_VERIFICAR 1
+#endif
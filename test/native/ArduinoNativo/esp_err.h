@@ -0,0 +1,10 @@
+// Códigos de error del ESP-IDF
+#ifndef ESP_ERR_NATIVO_H
+#define ESP_ERR_NATIVO_H
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_ARG 0x102
+
+#endif // ESP_ERR_NATIVO_H
@@ -0,0 +1,7 @@
+// Versión del ESP-IDF que simula el entorno nativo (API del watchdog 4.x)
+#ifndef ESP_IDF_VERSION_NATIVO_H
+#define ESP_IDF_VERSION_NATIVO_H
+
+#define ESP_IDF_VERSION_MAJOR 4
+
+#endif // ESP_IDF_VERSION_NATIVO_H
@@ -0,0 +1,27 @@
+// Selección de la partición de arranque sobre las particiones en memoria
+#ifndef ESP_OTA_OPS_NATIVO_H
+#define ESP_OTA_OPS_NATIVO_H
+
+#include <esp_partition.h>
+
+inline const esp_partition_t* esp_ota_get_running_partition() {
+  return ParticionesNativas::particion(ParticionesNativas::enEjecucion());
+}
+
+inline const esp_partition_t* esp_ota_get_boot_partition() {
+  return ParticionesNativas::particion(ParticionesNativas::deArranque());
+}
+
+inline const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t*) {
+  return ParticionesNativas::particion((ParticionesNativas::enEjecucion() + 1) % ParticionesNativas::TOTAL);
+}
+
+// El IDF verifica la imagen; aquí basta con que empiece con el byte mágico 0xE9
+inline esp_err_t esp_ota_set_boot_partition(const esp_partition_t* p) {
+  int i = ParticionesNativas::indice(p);
+  if (i < 0 || ParticionesNativas::contenido(p)[0] != 0xE9) return ESP_FAIL;
+  ParticionesNativas::deArranque() = i;
+  return ESP_OK;
+}
+
+#endif // ESP_OTA_OPS_NATIVO_H
@@ -0,0 +1,88 @@
+// Particiones de la flash en memoria: app0/app1 con el tamaño de partitions.csv
+#ifndef ESP_PARTITION_NATIVO_H
+#define ESP_PARTITION_NATIVO_H
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <esp_err.h>
+
+typedef enum { ESP_PARTITION_TYPE_APP = 0x00, ESP_PARTITION_TYPE_DATA = 0x01 } esp_partition_type_t;
+typedef enum { ESP_PARTITION_SUBTYPE_ANY = 0xff } esp_partition_subtype_t;
+
+typedef struct {
+  esp_partition_type_t type;
+  uint32_t address;
+  uint32_t size;
+  char label[17];
+} esp_partition_t;
+
+/**
+ * Estado de las dos particiones de aplicación. Persiste durante el proceso de
+ * prueba, como la flash real entre reinicios; arrancar() simula el reinicio.
+ */
+class ParticionesNativas {
+public:
+  static const int TOTAL = 2;
+
+  static const esp_partition_t* particion(int i) {
+    static const esp_partition_t p[TOTAL] = {
+      { ESP_PARTITION_TYPE_APP, 0x20000, 0x180000, "app0" },
+      { ESP_PARTITION_TYPE_APP, 0x1A0000, 0x180000, "app1" },
+    };
+    return &p[i];
+  }
+  static int indice(const esp_partition_t* p) {
+    for (int i = 0; i < TOTAL; i++) {
+      if (p == particion(i)) return i;
+    }
+    return -1;
+  }
+  static std::vector<uint8_t>& contenido(const esp_partition_t* p) {
+    static std::vector<uint8_t> c[TOTAL];
+    std::vector<uint8_t>& v = c[indice(p)];
+    if (v.size() != p->size) v.assign(p->size, 0xFF);
+    return v;
+  }
+  static int& enEjecucion() { static int i = 0; return i; }
+  static int& deArranque() { static int i = 0; return i; }
+
+  // Solo pruebas
+  static void arrancar() { enEjecucion() = deArranque(); }
+  static void reiniciarTodo() {
+    for (int i = 0; i < TOTAL; i++) contenido(particion(i)).assign(particion(i)->size, 0xFF);
+    enEjecucion() = 0;
+    deArranque() = 0;
+  }
+};
+
+inline esp_err_t esp_partition_read(const esp_partition_t* p, size_t desde, void* destino, size_t n) {
+  if (ParticionesNativas::indice(p) < 0 || desde + n > p->size) return ESP_ERR_INVALID_ARG;
+  memcpy(destino, ParticionesNativas::contenido(p).data() + desde, n);
+  return ESP_OK;
+}
+
+inline esp_err_t esp_partition_write(const esp_partition_t* p, size_t desde, const void* datos, size_t n) {
+  if (ParticionesNativas::indice(p) < 0 || desde + n > p->size) return ESP_ERR_INVALID_ARG;
+  memcpy(ParticionesNativas::contenido(p).data() + desde, datos, n);
+  return ESP_OK;
+}
+
+inline esp_err_t esp_partition_erase_range(const esp_partition_t* p, size_t desde, size_t n) {
+  if (ParticionesNativas::indice(p) < 0 || desde + n > p->size || desde % 4096 != 0 || n % 4096 != 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  memset(ParticionesNativas::contenido(p).data() + desde, 0xFF, n);
+  return ESP_OK;
+}
+
+inline const esp_partition_t* esp_partition_find_first(esp_partition_type_t tipo, esp_partition_subtype_t,
+                                                       const char* etiqueta) {
+  for (int i = 0; i < ParticionesNativas::TOTAL; i++) {
+    const esp_partition_t* p = ParticionesNativas::particion(i);
+    if (p->type == tipo && (etiqueta == NULL || strcmp(p->label, etiqueta) == 0)) return p;
+  }
+  return NULL;
+}
+
+#endif // ESP_PARTITION_NATIVO_H
@@ -0,0 +1,12 @@
+// Watchdog de tareas del ESP-IDF: sin efecto en el host
+#ifndef ESP_TASK_WDT_NATIVO_H
+#define ESP_TASK_WDT_NATIVO_H
+
+#include <stdint.h>
+#include <esp_err.h>
+
+inline esp_err_t esp_task_wdt_init(uint32_t, bool) { return ESP_OK; }
+inline esp_err_t esp_task_wdt_add(void*) { return ESP_OK; }
+inline esp_err_t esp_task_wdt_reset() { return ESP_OK; }
+
+#endif // ESP_TASK_WDT_NATIVO_H
@@ -0,0 +1,30 @@
+// Verificación de firmas con la API de mbedtls. En el host no hay ECDSA: una
+// "firma" de prueba es válida si es exactamente el hash firmado.
+#ifndef MBEDTLS_PK_NATIVO_H
+#define MBEDTLS_PK_NATIVO_H
+
+#include <stddef.h>
+#include <string.h>
+
+#define MBEDTLS_ERR_PK_BAD_INPUT_DATA -0x3E80
+
+typedef enum { MBEDTLS_MD_NONE = 0, MBEDTLS_MD_SHA256 = 6 } mbedtls_md_type_t;
+
+typedef struct {
+  bool cargada;
+} mbedtls_pk_context;
+
+inline void mbedtls_pk_init(mbedtls_pk_context* ctx) { ctx->cargada = false; }
+inline void mbedtls_pk_free(mbedtls_pk_context* ctx) { ctx->cargada = false; }
+
+inline int mbedtls_pk_parse_public_key(mbedtls_pk_context* ctx, const unsigned char* clave, size_t n) {
+  ctx->cargada = clave != NULL && n > 0;
+  return ctx->cargada ? 0 : MBEDTLS_ERR_PK_BAD_INPUT_DATA;
+}
+
+inline int mbedtls_pk_verify(mbedtls_pk_context* ctx, mbedtls_md_type_t, const unsigned char* hash, size_t n,
+                             const unsigned char* firma, size_t largo) {
+  return ctx->cargada && largo == n && memcmp(hash, firma, n) == 0 ? 0 : MBEDTLS_ERR_PK_BAD_INPUT_DATA;
+}
+
+#endif // MBEDTLS_PK_NATIVO_H
@@ -0,0 +1,250 @@
+#include "ReproductorModem.h"
+
+int ReproductorModem::profundidad = 0;
+
+ReproductorModem::ReproductorModem() : modoTexto(false), porCargar(0) {}
+
+ReproductorModem::ReproductorModem(const std::vector<RegistroUART>& registros) : modoTexto(false), porCargar(0) {
+  cargar(registros);
+}
+
+bool ReproductorModem::esCuerpoSMS(const std::string& datos) {
+  return !datos.empty() && (datos.back() == 26 || datos.back() == 27);
+}
+
+std::string ReproductorModem::limpiar(const std::string& comando) {
+  std::string r = comando;
+  while (!r.empty() && (r.back() == '\r' || r.back() == '\n')) {
+    r.pop_back();
+  }
+  return r;
+}
+
+std::string ReproductorModem::clave(const std::string& comando) {
+  if (esCuerpoSMS(comando)) {
+    return comando.back() == 26 ? "<Ctrl+Z>" : "<ESC>";
+  }
+  if (comando.compare(0, 10, "-----BEGIN") == 0) {
+    return "<PEM>";
+  }
+  std::string c = limpiar(comando);
+  if (c.compare(0, 3, "AT+") == 0) {
+    size_t fin = c.find_first_of("=?");
+    if (fin != std::string::npos) {
+      return c.substr(0, fin + 1);
+    }
+  }
+  return c;
+}
+
+// URCs que responden a un comando anterior: se asocian a ese comando, no al que
+// estaba en curso cuando llegaron durante la grabación
+static const char* const URC_DE_COMANDO[][2] = {
+  { "+HTTPACTION:", "AT+HTTPACTION=" },
+  { "+AGPS:",       "AT+CAGPS" },
+};
+
+// URCs independientes de cualquier comando: se reproducen en su instante grabado
+static const char* const URC_ESPONTANEOS[] = {
+  "+CMTI:", "+CGEV:", "+CPIN:", "+CREG:", "+CEREG:", "+CGREG:", "+HTTP_NONET_EVENT",
+  "+HTTP_PEER_CLOSED", "RDY", "SMS DONE", "PB DONE", "*ATREADY"
+};
+
+static bool empiezaCon(const std::string& s, const char* prefijo) {
+  return s.compare(0, strlen(prefijo), prefijo) == 0;
+}
+
+// Prefijo de la respuesta propia de un comando: "AT+CREG?" -> "+CREG:"
+static std::string prefijoRespuesta(const std::string& comando) {
+  if (comando.compare(0, 3, "AT+") != 0) return "";
+  size_t fin = comando.find_first_of("=?\r\n", 3);
+  return "+" + comando.substr(3, fin == std::string::npos ? std::string::npos : fin - 3) + ":";
+}
+
+void ReproductorModem::cargar(const std::vector<RegistroUART>& registros) {
+  struct Intercambio {
+    std::string comando;
+    unsigned long instante;
+    Respuesta respuesta;
+  };
+  std::vector<Intercambio> intercambios;
+  unsigned long instante = 0;
+
+  for (size_t i = 0; i < registros.size(); i++) {
+    const RegistroUART& r = registros[i];
+    instante += r.delta;
+
+    if (r.direccion == '>') {
+      // Un comando largo puede venir en varios registros seguidos
+      if (!intercambios.empty()) {
+        Intercambio& ultimo = intercambios.back();
+        if (ultimo.respuesta.empty() && ultimo.comando.back() != '\n' && !esCuerpoSMS(ultimo.comando)) {
+          ultimo.comando += r.datos;
+          continue;
+        }
+      }
+      intercambios.push_back({r.datos, instante, Respuesta()});
+      continue;
+    }
+
+    bool asociado = false;
+    for (size_t u = 0; u < sizeof(URC_DE_COMANDO) / sizeof(URC_DE_COMANDO[0]) && !asociado; u++) {
+      if (!empiezaCon(r.datos, URC_DE_COMANDO[u][0])) continue;
+      for (size_t k = intercambios.size(); k-- > 0;) {
+        if (clave(intercambios[k].comando) == URC_DE_COMANDO[u][1]) {
+          intercambios[k].respuesta.push_back({instante - intercambios[k].instante, r.datos});
+          asociado = true;
+          break;
+        }
+      }
+    }
+    if (asociado) continue;
+
+    bool propia = !intercambios.empty() && !prefijoRespuesta(intercambios.back().comando).empty() &&
+                  empiezaCon(r.datos, prefijoRespuesta(intercambios.back().comando).c_str());
+    bool espontaneo = intercambios.empty();
+    for (size_t u = 0; u < sizeof(URC_ESPONTANEOS) / sizeof(URC_ESPONTANEOS[0]) && !propia; u++) {
+      if (empiezaCon(r.datos, URC_ESPONTANEOS[u])) espontaneo = true;
+    }
+
+    if (espontaneo && !propia) {
+      emitir(r.datos, instante);
+    } else {
+      Intercambio& actual = intercambios.back();
+      actual.respuesta.push_back({instante - actual.instante, r.datos});
+    }
+  }
+
+  for (size_t k = 0; k < intercambios.size(); k++) {
+    const std::string& c = intercambios[k].comando;
+    respuestas[clave(c)].push_back(intercambios[k].respuesta);
+    comandosGrabados.push_back(esCuerpoSMS(c) ? c : limpiar(c));
+  }
+}
+
+bool ReproductorModem::cargarArchivo(const char* ruta) {
+  std::vector<RegistroUART> registros;
+  if (!cargarTranscripcion(ruta, registros)) {
+    return false;
+  }
+  cargar(registros);
+  return true;
+}
+
+void ReproductorModem::emitir(const std::string& datos, unsigned long retardo) {
+  programadas.insert(std::make_pair(millis() + retardo, datos));
+}
+
+void ReproductorModem::liberarProgramadas() {
+  unsigned long ahora = millis();
+  while (!programadas.empty() && programadas.begin()->first <= ahora) {
+    const std::string& datos = programadas.begin()->second;
+    rx.insert(rx.end(), datos.begin(), datos.end());
+    programadas.erase(programadas.begin());
+  }
+}
+
+int ReproductorModem::available() {
+  Dentro d;
+  liberarProgramadas();
+  return HardwareSerial::available();
+}
+
+int ReproductorModem::read() {
+  Dentro d;
+  liberarProgramadas();
+  return HardwareSerial::read();
+}
+
+int ReproductorModem::peek() {
+  Dentro d;
+  liberarProgramadas();
+  return HardwareSerial::peek();
+}
+
+size_t ReproductorModem::write(uint8_t c) {
+  Dentro d;
+  entrada += (char)c;
+
+  if (modoTexto) {
+    if (c == 26 || c == 27) {
+      modoTexto = false;
+      std::string cuerpo = entrada;
+      entrada.clear();
+      responder(cuerpo);
+    }
+    return 1;
+  }
+
+  // El archivo de AT+CCERTDOWN va por largo, con sus propios saltos de línea
+  if (porCargar > 0) {
+    if (--porCargar == 0) {
+      std::string cuerpo = entrada;
+      entrada.clear();
+      responder(cuerpo);
+    }
+    return 1;
+  }
+
+  if (c == '\n') {
+    std::string comando = limpiar(entrada);
+    entrada.clear();
+    if (!comando.empty()) {
+      modoTexto = comando.compare(0, 8, "AT+CMGS=") == 0;
+      if (comando.compare(0, 13, "AT+CCERTDOWN=") == 0) {
+        porCargar = strtoul(comando.c_str() + comando.rfind(',') + 1, NULL, 10);
+      }
+      responder(comando);
+    }
+  } else if (c == 27) {
+    // ESC suelto: cancela un AT+CMGS que no recibió el prompt
+    entrada.clear();
+    modoTexto = false;
+  }
+  return 1;
+}
+
+void ReproductorModem::responder(const std::string& comando) {
+  comandosEnviados.push_back(comando);
+  std::string k = clave(comando);
+
+  std::map<std::string, std::deque<Respuesta> >::iterator it = respuestas.find(k);
+  if (it == respuestas.end()) {
+    sinGrabacion.push_back(comando);
+    emitir("\r\nOK\r\n", 10);
+    return;
+  }
+
+  if (it->second.empty()) {
+    // Agotadas: solo OK, para no repetir datos (p.ej. procesar dos veces un +CMGL)
+    emitir("\r\nOK\r\n", 10);
+    return;
+  }
+
+  const Respuesta& respuesta = it->second.front();
+  for (size_t i = 0; i < respuesta.size(); i++) {
+    emitir(respuesta[i].datos, respuesta[i].retardo);
+  }
+  it->second.pop_front();
+}
+
+std::vector<std::string> ReproductorModem::enviadosCon(const std::string& prefijo) const {
+  std::vector<std::string> r;
+  for (size_t i = 0; i < comandosEnviados.size(); i++) {
+    if (comandosEnviados[i].compare(0, prefijo.size(), prefijo) == 0) r.push_back(comandosEnviados[i]);
+  }
+  return r;
+}
+
+std::vector<std::string> ReproductorModem::grabadosCon(const std::string& prefijo) const {
+  std::vector<std::string> r;
+  for (size_t i = 0; i < comandosGrabados.size(); i++) {
+    if (comandosGrabados[i].compare(0, prefijo.size(), prefijo) == 0) r.push_back(comandosGrabados[i]);
+  }
+  return r;
+}
+
+size_t ReproductorModem::respuestasRestantes(const std::string& k) const {
+  std::map<std::string, std::deque<Respuesta> >::const_iterator it = respuestas.find(k);
+  return it == respuestas.end() ? 0 : it->second.size();
+}
@@ -0,0 +1,90 @@
+#ifndef REPRODUCTORMODEM_H
+#define REPRODUCTORMODEM_H
+
+#include <Arduino.h>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include "Transcripcion.h"
+
+/**
+ * Módem simulado que reproduce una transcripción grabada.
+ *
+ * Cada comando grabado (registro '>') se asocia con los registros '<' que lo
+ * siguen, con sus retardos. Al reproducir, el comando que envía el firmware
+ * se busca por su clave ("AT+HTTPPARA=", "AT+CGNSSINFO", el cuerpo de un
+ * SMS o "<PEM>" para el certificado que sigue a AT+CCERTDOWN) y se devuelve
+ * la siguiente respuesta grabada para esa clave, en orden.
+ * Así el firmware puede intercalar comandos distinto a la grabación (SMS
+ * durante HTTP, lecturas GPS extra) sin que la reproducción se desfase.
+ *
+ * Agotadas las respuestas de una clave se contesta solo OK; un comando nunca
+ * grabado también recibe OK y queda en desconocidos() para que la prueba lo
+ * detecte.
+ * Los retardos usan el reloj virtual: la reproducción es determinista y tan
+ * rápida como el firmware pueda procesarla.
+ */
+class ReproductorModem : public HardwareSerial {
+public:
+  ReproductorModem();
+  explicit ReproductorModem(const std::vector<RegistroUART>& registros);
+
+  void cargar(const std::vector<RegistroUART>& registros);
+  bool cargarArchivo(const char* ruta);
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t c) override;
+  using Print::write;
+
+  // Inyectar una salida no solicitada (p.ej. +CMTI) tras 'retardo' ms
+  void emitir(const std::string& datos, unsigned long retardo = 0);
+
+  // Lo que envió el firmware, un elemento por comando o cuerpo de SMS
+  const std::vector<std::string>& enviados() const { return comandosEnviados; }
+  std::vector<std::string> enviadosCon(const std::string& prefijo) const;
+
+  // Lo que la grabación espera que se envíe
+  std::vector<std::string> grabadosCon(const std::string& prefijo) const;
+
+  size_t respuestasRestantes(const std::string& clave) const;
+  const std::vector<std::string>& desconocidos() const { return sinGrabacion; }
+
+  static std::string clave(const std::string& comando);
+
+  // true mientras se ejecuta código del reproductor (para no contar su heap)
+  static bool enCurso() { return profundidad > 0; }
+
+private:
+  struct Trozo {
+    unsigned long retardo;  // Desde el comando
+    std::string datos;
+  };
+  typedef std::vector<Trozo> Respuesta;
+
+  std::map<std::string, std::deque<Respuesta> > respuestas;
+  std::vector<std::string> comandosGrabados;
+
+  std::multimap<unsigned long, std::string> programadas;
+  std::string entrada;
+  bool modoTexto;
+  size_t porCargar;  // Bytes anunciados por AT+CCERTDOWN que faltan del archivo
+
+  std::vector<std::string> comandosEnviados;
+  std::vector<std::string> sinGrabacion;
+
+  static int profundidad;
+  struct Dentro {
+    Dentro() { profundidad++; }
+    ~Dentro() { profundidad--; }
+  };
+
+  void liberarProgramadas();
+  void responder(const std::string& comando);
+  static std::string limpiar(const std::string& comando);
+  static bool esCuerpoSMS(const std::string& datos);
+};
+
+#endif // REPRODUCTORMODEM_H
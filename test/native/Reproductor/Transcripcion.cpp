@@ -0,0 +1,68 @@
+#include "Transcripcion.h"
+#include <cstdlib>
+#include <fstream>
+
+std::string desescapar(const std::string& texto) {
+  std::string r;
+  r.reserve(texto.size());
+  for (size_t i = 0; i < texto.size(); i++) {
+    char c = texto[i];
+    if (c != '\\' || i + 1 >= texto.size()) {
+      r += c;
+      continue;
+    }
+    char e = texto[++i];
+    if (e == 'r') {
+      r += '\r';
+    } else if (e == 'n') {
+      r += '\n';
+    } else if (e == 'x' && i + 2 < texto.size()) {
+      r += (char)strtol(texto.substr(i + 1, 2).c_str(), NULL, 16);
+      i += 2;
+    } else {
+      r += e;
+    }
+  }
+  return r;
+}
+
+bool parsearRegistro(const std::string& linea, RegistroUART& registro) {
+  if (linea.size() < 4 || linea.compare(0, 2, "#T") != 0) {
+    return false;
+  }
+  char dir = linea[2];
+  if (dir != '<' && dir != '>') {
+    return false;
+  }
+
+  size_t espacio = linea.find(' ', 3);
+  if (espacio == std::string::npos) {
+    return false;
+  }
+
+  std::string datos = linea.substr(espacio + 1);
+  while (!datos.empty() && (datos.back() == '\r' || datos.back() == '\n')) {
+    datos.pop_back();
+  }
+
+  registro.direccion = dir;
+  registro.delta = strtoul(linea.substr(3, espacio - 3).c_str(), NULL, 10);
+  registro.datos = desescapar(datos);
+  return true;
+}
+
+bool cargarTranscripcion(const char* ruta, std::vector<RegistroUART>& registros) {
+  std::ifstream archivo(ruta);
+  if (!archivo) {
+    return false;
+  }
+
+  std::string linea;
+  RegistroUART registro;
+  while (std::getline(archivo, linea)) {
+    if (parsearRegistro(linea, registro)) {
+      registros.push_back(registro);
+    }
+  }
+  return true;
+}
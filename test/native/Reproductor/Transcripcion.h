@@ -0,0 +1,26 @@
+#ifndef TRANSCRIPCION_H
+#define TRANSCRIPCION_H
+
+#include <string>
+#include <vector>
+
+/**
+ * Un registro de la transcripción grabada por GrabadorUART:
+ *   #T<dir><delta_ms> <datos escapados>
+ */
+struct RegistroUART {
+  char direccion;        // '>' ESP32 -> módem, '<' módem -> ESP32
+  unsigned long delta;   // ms desde el registro anterior
+  std::string datos;     // Ya sin escapar
+};
+
+/**
+ * Carga una transcripción. Las líneas que no empiezan con "#T" se ignoran,
+ * así sirve tanto un archivo de test/fixtures como el log completo del monitor.
+ */
+bool cargarTranscripcion(const char* ruta, std::vector<RegistroUART>& registros);
+
+bool parsearRegistro(const std::string& linea, RegistroUART& registro);
+std::string desescapar(const std::string& texto);
+
+#endif // TRANSCRIPCION_H
@@ -0,0 +1,246 @@
+// Rendimiento de los parsers y de la reproducción completa: parseos por
+// segundo y asignaciones de memoria por parseo (operator new en el host).
+// Los números sirven para comparar versiones del firmware entre sí, no para
+// estimar tiempos absolutos en el ESP32-C3.
+#include <unity.h>
+#include <Arduino.h>
+#include <Preferences.h>
+#include <chrono>
+#include <new>
+#include "CanalAT.h"
+#include "GPSModule.h"
+#include "GSMModule.h"
+#include "HTTPClient.h"
+#include "ColaReportes.h"
+#include "ColaSMS.h"
+#include "ControlSalidas.h"
+#include "ControlSMS.h"
+#include "ListaAutorizados.h"
+#include "CapturaGNSS.h"
+#include "ReproductorModem.h"
+
+#define FIXTURES "test/fixtures/"
+
+#define ITERACIONES_PARSEO 20000
+#define ITERACIONES_BANDEJA 200
+#define ITERACIONES_REPORTE 200
+#define ITERACIONES_CAPTURA 20000
+
+// El parseo GNSS y el reporte HTTP no usan el heap; la bandeja SMS sí (String),
+// con un umbral holgado que solo falla ante una regresión evidente
+#define MAX_ASIGNACIONES_CGNSSINFO 0
+#define MAX_ASIGNACIONES_BANDEJA 4000
+#define MAX_ASIGNACIONES_REPORTE 0
+#define MAX_ASIGNACIONES_CAPTURA 0
+
+static unsigned long asignaciones = 0;
+static unsigned long asignacionesFirmware = 0;  // Sin las del módem simulado
+
+void* operator new(size_t n) {
+  asignaciones++;
+  if (!ReproductorModem::enCurso()) asignacionesFirmware++;
+  void* p = malloc(n ? n : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+static ReproductorModem modem;
+HardwareSerial& Serial1 = modem;
+
+extern ListaAutorizados listaAutorizados;
+void setup();
+void loop();
+
+static ListaAutorizados lista;
+
+void setUp() {}
+void tearDown() {}
+
+static double segundosDesde(std::chrono::steady_clock::time_point inicio) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+}
+
+static void informar(const char* nombre, double porSegundo, const char* unidad, double asignacionesPorOp) {
+  char msg[160];
+  snprintf(msg, sizeof(msg), "%s: %.0f %s/s, %.1f asignaciones/op", nombre, porSegundo, unidad, asignacionesPorOp);
+  TEST_MESSAGE(msg);
+}
+
+void test_bench_cgnssinfo() {
+  const String respuesta =
+    "\r\n+CGNSSINFO: 3,12,,04,00,18.9261240,N,99.2307125,W,010524,101010.00,1500.0,10.0,90.0,1.2,0.8,0.9\r\n\r\nOK\r\n";
+  GpsData d = {0.0, 0.0, false, 0, 0, 0, -1.0f, -1.0f, 0};
+
+  unsigned long asignacionesInicio = asignaciones;
+  std::chrono::steady_clock::time_point inicio = std::chrono::steady_clock::now();
+  for (int i = 0; i < ITERACIONES_PARSEO; i++) {
+    d.valida = false;
+    GPSModule::parsearCGNSSINFO(respuesta, d);
+  }
+  double segundos = segundosDesde(inicio);
+  double porParseo = (double)(asignaciones - asignacionesInicio) / ITERACIONES_PARSEO;
+
+  TEST_ASSERT_TRUE(d.valida);
+  informar("CGNSSINFO", ITERACIONES_PARSEO / segundos, "parseos", porParseo);
+  TEST_ASSERT_LESS_OR_EQUAL(MAX_ASIGNACIONES_CGNSSINFO, porParseo);
+}
+
+// Ritmo sostenido de la captura de alta frecuencia: URC +CGNSSINFO -> anillo.
+// Sin el armado de líneas del UART, que es el mismo para cualquier URC.
+static CanalAT canalCaptura(modem);
+static RelojGNSS relojCaptura;
+static CapturaGNSS captura(canalCaptura, relojCaptura);
+
+void test_bench_captura() {
+  // Una línea por segundo GNSS, a velocidad constante para no disparar
+  static char lineas[60][128];
+  for (int i = 0; i < 60; i++) {
+    snprintf(lineas[i], sizeof(lineas[i]),
+             "+CGNSSINFO: 3,12,,04,00,%.7f,N,99.2307125,W,010524,1010%02d.00,1500.0,21.6,%.1f,1.2,0.8,0.9",
+             18.9261240 + i * 1e-5, i, 90.0 + i * 0.5);
+  }
+
+  unsigned long asignacionesInicio = asignaciones;
+  std::chrono::steady_clock::time_point inicio = std::chrono::steady_clock::now();
+  for (int i = 0; i < ITERACIONES_CAPTURA; i++) {
+    avanzarReloj(1000);  // Cada fix ancla el reloj; al repetir las líneas hay una corrección por vuelta
+    captura.ingerir(lineas[i % 60]);
+  }
+  double segundos = segundosDesde(inicio);
+  double porMuestra = (double)(asignaciones - asignacionesInicio) / ITERACIONES_CAPTURA;
+
+  TEST_ASSERT_EQUAL(CAPTURA_MUESTRAS, captura.muestras());
+  TEST_ASSERT_FALSE(captura.disparada());
+  double porSegundo = ITERACIONES_CAPTURA / segundos;
+  informar("Captura GNSS", porSegundo, "muestras", porMuestra);
+
+  char msg[160];
+  snprintf(msg, sizeof(msg), "Captura GNSS: %u bytes/muestra, anillo de %u muestras en %u bytes, %.0fx el ritmo de 10 Hz",
+           (unsigned)sizeof(MuestraGNSS), (unsigned)CAPTURA_MUESTRAS, (unsigned)(CAPTURA_MUESTRAS * sizeof(MuestraGNSS)),
+           porSegundo / 10.0);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_LESS_OR_EQUAL(MAX_ASIGNACIONES_CAPTURA, porMuestra);
+}
+
+void test_bench_bandeja_sms() {
+  std::vector<RegistroUART> registros;
+  TEST_ASSERT_TRUE(cargarTranscripcion(FIXTURES "sms_cmgl.txt", registros));
+  lista.begin();
+  lista.agregar("+527771234567", ROL_ADMIN);
+
+  unsigned long asignacionesTotal = 0;
+  double segundos = 0;
+  for (int i = 0; i < ITERACIONES_BANDEJA; i++) {
+    // La carga de la grabación no cuenta: solo el firmware procesando la bandeja
+    ReproductorModem bandeja(registros);
+    CanalAT canal(bandeja);
+    ColaSMS cola(canal);
+    ControlSalidas salidas(PIN_ACTIVE, PIN_INACTIVE);
+    ControlSMS control(canal, cola, lista, salidas);
+
+    unsigned long asignacionesInicio = asignaciones;
+    std::chrono::steady_clock::time_point inicio = std::chrono::steady_clock::now();
+    control.begin();
+    unsigned long fin = millis() + 20000;
+    while (millis() < fin) {
+      canal.atender();
+      control.atender();
+      delay(10);
+    }
+    segundos += segundosDesde(inicio);
+    asignacionesTotal += asignaciones - asignacionesInicio;
+
+    TEST_ASSERT_EQUAL(3, bandeja.enviadosCon("AT+CMGD=").size());
+  }
+
+  double porBandeja = (double)asignacionesTotal / ITERACIONES_BANDEJA;
+  informar("Bandeja +CMGL (3 SMS, 20 s virtuales)", ITERACIONES_BANDEJA / segundos, "bandejas", porBandeja);
+  TEST_ASSERT_LESS_OR_EQUAL(MAX_ASIGNACIONES_BANDEJA, porBandeja);
+}
+
+// Sesión HTTP mínima: el resto de comandos recibe OK del reproductor
+static void agregarSesionHTTP(std::vector<RegistroUART>& registros) {
+  registros.push_back({'>', 0, "AT+CGACT?\r\n"});
+  registros.push_back({'<', 20, "\r\n+CGACT: 1,1\r\n\r\nOK\r\n"});
+  registros.push_back({'>', 0, "AT+HTTPACTION=0\r\n"});
+  registros.push_back({'<', 20, "\r\nOK\r\n"});
+  registros.push_back({'<', 900, "\r\n+HTTPACTION: 0,200,0\r\n"});
+}
+
+void test_bench_reporte_http() {
+  std::vector<RegistroUART> registros;
+  for (int i = 0; i <= ITERACIONES_REPORTE; i++) {
+    agregarSesionHTTP(registros);
+  }
+  ReproductorModem servidor(registros);
+  CanalAT canal(servidor);
+  GSMModule gsm(canal, PWR_PIN, RXD1_PIN, TXD1_PIN, BAUD_RATE);
+  ControlSalidas salidas(PIN_ACTIVE, PIN_INACTIVE);
+  HTTPClient http(gsm, salidas);
+
+  // El primer reporte hace crecer la respuesta del canal hasta su tamaño de trabajo
+  ColaReportes cola;
+  cola.agregar(18.926124, -99.230713, 42.5f, 1714558210UL);
+  TEST_ASSERT_TRUE(http.enviarReportes(cola));
+  cola.confirmarEnvio(http.reportesEnLote(), http.ultimoAck());
+
+  // La cola (NVS simulada) queda fuera de la medición: solo el envío
+  std::vector<Reporte> fixes;
+  for (int i = 0; i < ITERACIONES_REPORTE; i++) {
+    fixes.push_back(cola.agregar(18.926124 + (i + 1) * 1e-4, -99.230713, 42.5f, 1714558210UL + (i + 1) * 20));
+    cola.confirmarEnvio(0, 0);
+  }
+
+  unsigned long firmwareInicio = asignacionesFirmware;
+  std::chrono::steady_clock::time_point inicio = std::chrono::steady_clock::now();
+  for (int i = 0; i < ITERACIONES_REPORTE; i++) {
+    TEST_ASSERT_TRUE(http.enviarReportes(cola));
+  }
+  double segundos = segundosDesde(inicio);
+  double porReporte = (double)(asignacionesFirmware - firmwareInicio) / ITERACIONES_REPORTE;
+
+  informar("Reporte HTTP (sin el módem simulado)", ITERACIONES_REPORTE / segundos, "reportes", porReporte);
+  TEST_ASSERT_LESS_OR_EQUAL(MAX_ASIGNACIONES_REPORTE, porReporte);
+}
+
+void test_bench_recorrido() {
+  TEST_ASSERT_TRUE(modem.cargarArchivo(FIXTURES "recorrido_urbano.txt"));
+  listaAutorizados.begin();
+  listaAutorizados.agregar("+527771234567", ROL_ADMIN);
+
+  unsigned long inicioVirtual = millis();
+  unsigned long asignacionesInicio = asignaciones;
+  std::chrono::steady_clock::time_point inicio = std::chrono::steady_clock::now();
+  setup();
+  unsigned long firmwareInicio = asignacionesFirmware;
+  unsigned long ciclos = 0;
+  while (modem.respuestasRestantes("AT+CGNSSINFO") > 0) {
+    loop();
+    ciclos++;
+  }
+  double segundos = segundosDesde(inicio);
+  double virtuales = (millis() - inicioVirtual) / 1000.0;
+
+  size_t reportes = modem.enviadosCon("AT+HTTPPARA=\"URL\"").size();
+  double firmwarePorReporte = (double)(asignacionesFirmware - firmwareInicio) / reportes;
+
+  char msg[240];
+  snprintf(msg, sizeof(msg), "Recorrido: %.0f s virtuales en %.3f s (%.0fx tiempo real), %lu ciclos, "
+           "%.0f asignaciones/reporte (%.1f del firmware tras setup)",
+           virtuales, segundos, virtuales / segundos, ciclos, (double)(asignaciones - asignacionesInicio) / reportes,
+           firmwarePorReporte);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_EQUAL(18, reportes);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_bench_cgnssinfo);
+  RUN_TEST(test_bench_captura);
+  RUN_TEST(test_bench_bandeja_sms);
+  RUN_TEST(test_bench_reporte_http);
+  RUN_TEST(test_bench_recorrido);
+  return UNITY_END();
+}
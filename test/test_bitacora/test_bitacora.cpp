@@ -0,0 +1,138 @@
+// Bitácora: niveles compilados, anillo en RAM, rescate tras reinicio y flash rotada
+#include <unity.h>
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <string>
+#include "Bitacora.h"
+
+// Memoria "no inicializada": sobrevive entre instancias como a un reinicio por software
+static MemoriaBitacora memoria;
+
+static std::string leerFlash(Bitacora& b) {
+  std::string texto(b.bytesGuardados(), '\0');
+  size_t leidos = b.leerGuardada(0, (uint8_t*)&texto[0], texto.size());
+  texto.resize(leidos);
+  return texto;
+}
+
+static int contarLineas(const std::string& texto) {
+  int n = 0;
+  for (size_t i = 0; i < texto.size(); i++) {
+    if (texto[i] == '\n') n++;
+  }
+  return n;
+}
+
+void setUp() {
+  LittleFSNativo::borrarTodo();
+  memset(&memoria, 0xA5, sizeof(memoria));  // Basura, como tras un corte de alimentación
+  fijarReloj(0);
+}
+
+void tearDown() {}
+
+void test_niveles_no_compilados_no_evaluan_argumentos() {
+  int evaluados = 0;
+  LOG_INFO("info %d", ++evaluados);
+  LOG_DEPURACION("depuración %d", ++evaluados);  // BITACORA_NIVEL 3: ni se evalúa
+  TEST_ASSERT_EQUAL(BITACORA_NIVEL >= BITACORA_DEPURACION ? 2 : 1, evaluados);
+}
+
+void test_anillo_pisa_lineas_completas_y_cuenta_descartes() {
+  Bitacora b(memoria);
+  b.begin();
+  b.diferirDrenado();
+  TEST_ASSERT_EQUAL_UINT32(0, b.descartadas());
+
+  // Más texto que el anillo sin drenar: se pierden las más antiguas, enteras
+  int total = 2 * BITACORA_RAM_BYTES / 40;
+  for (int i = 0; i < total; i++) {
+    fijarReloj(i);
+    b.registrar(BITACORA_INFO, "línea %04d de relleno para el anillo", i);
+  }
+  TEST_ASSERT_TRUE(b.descartadas() > 0);
+  int drenadas = b.drenar();
+  TEST_ASSERT_EQUAL(total, drenadas + (int)b.descartadas());
+  TEST_ASSERT_EQUAL(0, b.drenar());
+
+  // En la flash, lo que quedaba en RAM: empieza en una línea completa y termina en la última
+  b.guardar();
+  std::string texto = leerFlash(b);
+  TEST_ASSERT_EQUAL(drenadas, contarLineas(texto));
+  char ultima[64];
+  snprintf(ultima, sizeof(ultima), "I línea %04d de relleno para el anillo\n", total - 1);
+  TEST_ASSERT_TRUE(texto.size() >= strlen(ultima));
+  TEST_ASSERT_EQUAL_STRING(ultima, texto.c_str() + texto.size() - strlen(ultima));
+  TEST_ASSERT_EQUAL_STRING_LEN(" I línea ", texto.c_str() + 8, 9);  // Marca de tiempo de 8 columnas
+}
+
+void test_reinicio_rescata_lo_no_guardado() {
+  {
+    Bitacora antes(memoria);
+    antes.begin();
+    fijarReloj(1234);
+    antes.registrar(BITACORA_INFO, "antes del reinicio");
+    TEST_ASSERT_EQUAL(0, (int)antes.bytesGuardados());  // INFO no va a la flash por sí solo
+  }
+
+  // El watchdog reinicia: la RAM conserva el anillo y begin() lo pasa a la flash
+  Bitacora despues(memoria);
+  despues.begin();
+  std::string texto = leerFlash(despues);
+  TEST_ASSERT_EQUAL_STRING("    1234 I antes del reinicio\n", texto.c_str());
+
+  // Un corte de alimentación deja basura: no se rescata nada
+  LittleFSNativo::borrarTodo();
+  memset(&memoria, 0xA5, sizeof(memoria));
+  Bitacora corte(memoria);
+  corte.begin();
+  TEST_ASSERT_EQUAL(0, (int)corte.bytesGuardados());
+}
+
+void test_error_guarda_y_la_flash_rota() {
+  Bitacora b(memoria);
+  b.begin();
+  b.registrar(BITACORA_INFO, "contexto previo");
+  b.registrar(BITACORA_ERROR, "fallo %d", 7);
+  std::string texto = leerFlash(b);
+  TEST_ASSERT_EQUAL(2, contarLineas(texto));
+  TEST_ASSERT_TRUE(texto.find("E fallo 7\n") != std::string::npos);
+
+  // Muchos errores: la historia se reparte en dos archivos y no crece sin límite
+  for (int i = 0; i < 2 * (int)BITACORA_FLASH_BYTES / 30; i++) {
+    b.registrar(BITACORA_ERROR, "error repetido %d", i);
+  }
+  TEST_ASSERT_TRUE(LittleFS.exists(BITACORA_ARCHIVO_ANTERIOR));
+  TEST_ASSERT_TRUE(b.bytesGuardados() <= BITACORA_FLASH_BYTES + BITACORA_LINEA_MAX);
+  TEST_ASSERT_TRUE(leerFlash(b).find("error repetido 0\n") == std::string::npos);
+}
+
+void test_subida_congela_la_flash() {
+  Bitacora b(memoria);
+  b.begin();
+  b.registrar(BITACORA_AVISO, "antes de la subida");
+  TEST_ASSERT_TRUE(b.prepararEnvio());
+  size_t congelados = b.bytesGuardados();
+  TEST_ASSERT_TRUE(congelados > 0);
+
+  // Durante la subida un error no toca los archivos; queda pendiente para después
+  TEST_ASSERT_FALSE(b.prepararEnvio());
+  b.registrar(BITACORA_ERROR, "durante la subida");
+  TEST_ASSERT_EQUAL((int)congelados, (int)b.bytesGuardados());
+
+  // El servidor la recibió: se borra y lo pendiente se guarda en la siguiente vuelta
+  b.terminarEnvio(true);
+  TEST_ASSERT_EQUAL(0, (int)b.bytesGuardados());
+  b.atender();
+  TEST_ASSERT_TRUE(leerFlash(b).find("E durante la subida\n") != std::string::npos);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_niveles_no_compilados_no_evaluan_argumentos);
+  RUN_TEST(test_anillo_pisa_lineas_completas_y_cuenta_descartes);
+  RUN_TEST(test_reinicio_rescata_lo_no_guardado);
+  RUN_TEST(test_error_guarda_y_la_flash_rota);
+  RUN_TEST(test_subida_congela_la_flash);
+  return UNITY_END();
+}
@@ -0,0 +1,177 @@
+// Caché DNS: AT+CDNSGIP, conexión por IP con Host, paso a la siguiente dirección y al nombre
+#include <unity.h>
+#include <Arduino.h>
+#include <Preferences.h>
+#include "CanalAT.h"
+#include "GSMModule.h"
+#include "HTTPClient.h"
+#include "CacheDNS.h"
+#include "ColaReportes.h"
+#include "ControlSalidas.h"
+#include "ReproductorModem.h"
+
+#define HOST "api.ejemplo.mx"
+
+static const char* const RESUELTO = "\r\n+CDNSGIP: 1,\"api.ejemplo.mx\",\"203.0.113.10\",\"203.0.113.11\"\r\n\r\nOK\r\n";
+
+static void agregarResolucion(std::vector<RegistroUART>& g, const char* respuesta) {
+  g.push_back({ '>', 0, "AT+CDNSGIP=\"" HOST "\"\r\n" });
+  g.push_back({ '<', 300, respuesta });
+}
+
+// Una sesión HTTP con PDP activo que termina con 'codigo' en +HTTPACTION
+static void agregarSesion(std::vector<RegistroUART>& g, int codigo) {
+  g.push_back({ '>', 0, "AT+CGACT?\r\n" });
+  g.push_back({ '<', 10, "\r\n+CGACT: 1,1\r\n\r\nOK\r\n" });
+  g.push_back({ '>', 0, "AT+HTTPACTION=0\r\n" });
+  g.push_back({ '<', 10, "\r\nOK\r\n" });
+  char urc[40];
+  snprintf(urc, sizeof(urc), "\r\n+HTTPACTION: 0,%d,0\r\n", codigo);
+  g.push_back({ '<', 900, urc });
+}
+
+void setUp() {
+  Preferences::borrarTodo();
+  fijarReloj(0);
+}
+
+void tearDown() {}
+
+void test_parsear_cdnsgip() {
+  char ips[DNS_DIRECCIONES][DNS_LONGITUD_IP];
+  TEST_ASSERT_EQUAL(2, CacheDNS::parsearCDNSGIP(RESUELTO, ips, DNS_DIRECCIONES));
+  TEST_ASSERT_EQUAL_STRING("203.0.113.10", ips[0]);
+  TEST_ASSERT_EQUAL_STRING("203.0.113.11", ips[1]);
+  TEST_ASSERT_EQUAL(1, CacheDNS::parsearCDNSGIP("+CDNSGIP: 1,\"h\",\"2001:db8::1\"\r\n", ips, DNS_DIRECCIONES));
+  TEST_ASSERT_EQUAL_STRING("2001:db8::1", ips[0]);
+  TEST_ASSERT_EQUAL(0, CacheDNS::parsearCDNSGIP("\r\n+CDNSGIP: 0,10\r\n\r\nERROR\r\n", ips, DNS_DIRECCIONES));
+  TEST_ASSERT_EQUAL(0, CacheDNS::parsearCDNSGIP("\r\nOK\r\n", ips, DNS_DIRECCIONES));
+
+  TEST_ASSERT_TRUE(CacheDNS::esDireccionIP("10.0.0.1"));
+  TEST_ASSERT_FALSE(CacheDNS::esDireccionIP(HOST));
+  TEST_ASSERT_FALSE(CacheDNS::esDireccionIP(""));
+}
+
+void test_reporte_por_ip_con_host() {
+  std::vector<RegistroUART> g;
+  agregarResolucion(g, RESUELTO);
+  agregarSesion(g, 200);
+  ReproductorModem modem(g);
+  CanalAT canal(modem);
+  GSMModule gsm(canal, PWR_PIN, RXD1_PIN, TXD1_PIN, BAUD_RATE);
+  ControlSalidas salidas(PIN_ACTIVE, PIN_INACTIVE);
+  HTTPClient http(gsm, salidas);
+  ColaReportes reportes;
+  salidas.begin();
+  reportes.begin();
+  CacheDNS dns(canal, HOST, true);
+  dns.begin();
+  http.setCacheDNS(&dns);
+
+  TEST_ASSERT_FALSE(dns.porIP());
+  TEST_ASSERT_TRUE(dns.atender());
+  TEST_ASSERT_EQUAL(2, dns.direcciones());
+  // Vigente: no se vuelve a resolver
+  TEST_ASSERT_FALSE(dns.atender());
+  TEST_ASSERT_EQUAL(1, modem.enviadosCon("AT+CDNSGIP=").size());
+
+  reportes.agregar(18.926113, -99.230733, -1.0f, 1714558222UL);
+  TEST_ASSERT_TRUE(http.enviarReportes(reportes));
+  TEST_ASSERT_TRUE(http.conectoPorIP());
+  std::vector<std::string> urls = modem.enviadosCon("AT+HTTPPARA=\"URL\"");
+  TEST_ASSERT_EQUAL(1, urls.size());
+  TEST_ASSERT_EQUAL(0, urls[0].find("AT+HTTPPARA=\"URL\",\"https://203.0.113.10/"));
+  std::vector<std::string> host = modem.enviadosCon("AT+HTTPPARA=\"USERDATA\"");
+  TEST_ASSERT_EQUAL(1, host.size());
+  TEST_ASSERT_EQUAL_STRING("AT+HTTPPARA=\"USERDATA\",\"Host: " API_ENDPOINT "\"", host[0].c_str());
+
+  // Las direcciones sobreviven al reinicio, vencidas hasta la próxima resolución
+  CacheDNS tras(canal, HOST, true);
+  tras.begin();
+  TEST_ASSERT_TRUE(tras.porIP());
+  TEST_ASSERT_EQUAL_STRING("203.0.113.10", tras.servidor());
+}
+
+void test_fallo_por_ip_pasa_a_la_siguiente_y_al_nombre() {
+  std::vector<RegistroUART> g;
+  agregarResolucion(g, RESUELTO);
+  agregarResolucion(g, "\r\n+CDNSGIP: 1,\"api.ejemplo.mx\",\"203.0.113.20\"\r\n\r\nOK\r\n");
+  ReproductorModem modem(g);
+  CanalAT canal(modem);
+  CacheDNS dns(canal, HOST, true);
+  dns.begin();
+  TEST_ASSERT_TRUE(dns.atender());
+
+  dns.registrarConexion(ENVIO_TIMEOUT_HTTP, true);
+  TEST_ASSERT_EQUAL_STRING("203.0.113.11", dns.servidor());
+  // Una sesión por nombre (la descarga OTA) no cuenta contra la dirección
+  dns.registrarConexion(ENVIO_TLS, false);
+  TEST_ASSERT_EQUAL_STRING("203.0.113.11", dns.servidor());
+
+  dns.registrarConexion(ENVIO_TLS, true);
+  TEST_ASSERT_FALSE(dns.porIP());
+  TEST_ASSERT_EQUAL_STRING(HOST, dns.servidor());
+
+  // Agotadas: se resuelve de nuevo sin esperar a que venza
+  fijarReloj(millis() + 1000);
+  TEST_ASSERT_TRUE(dns.atender());
+  TEST_ASSERT_EQUAL_STRING("203.0.113.20", dns.servidor());
+  TEST_ASSERT_EQUAL(2, modem.enviadosCon("AT+CDNSGIP=").size());
+}
+
+void test_resolucion_fallida_y_vencimiento() {
+  std::vector<RegistroUART> g;
+  agregarResolucion(g, "\r\n+CDNSGIP: 0,10\r\n\r\nERROR\r\n");
+  agregarResolucion(g, RESUELTO);
+  agregarResolucion(g, RESUELTO);
+  ReproductorModem modem(g);
+  CanalAT canal(modem);
+  CacheDNS dns(canal, HOST, true);
+  dns.begin();
+
+  TEST_ASSERT_FALSE(dns.atender());
+  TEST_ASSERT_FALSE(dns.porIP());
+  fijarReloj(millis() + DNS_REINTENTO_MS - 1000);
+  TEST_ASSERT_FALSE(dns.atender());
+  TEST_ASSERT_EQUAL(1, modem.enviadosCon("AT+CDNSGIP=").size());
+
+  // Sin datos no se intenta
+  dns.registrarConexion(ENVIO_SIN_PDP, false);
+  fijarReloj(millis() + 2000);
+  TEST_ASSERT_FALSE(dns.atender());
+  dns.registrarConexion(ENVIO_OK, false);
+  TEST_ASSERT_TRUE(dns.atender());
+  TEST_ASSERT_EQUAL(2, modem.enviadosCon("AT+CDNSGIP=").size());
+
+  // Vencida tras DNS_TTL_MS
+  fijarReloj(millis() + DNS_TTL_MS - 1000);
+  TEST_ASSERT_FALSE(dns.atender());
+  fijarReloj(millis() + 2000);
+  TEST_ASSERT_TRUE(dns.atender());
+  TEST_ASSERT_EQUAL(3, modem.enviadosCon("AT+CDNSGIP=").size());
+  TEST_ASSERT_EQUAL(0, modem.desconocidos().size());
+}
+
+void test_por_omision_conecta_por_nombre() {
+  // Con la plantilla (DNS_CONECTAR_POR_IP 0) el SNI lleva el nombre: ni se resuelve ni cambia la URL
+  std::vector<RegistroUART> g;
+  agregarResolucion(g, RESUELTO);
+  ReproductorModem modem(g);
+  CanalAT canal(modem);
+  CacheDNS dns(canal, HOST);
+  dns.begin();
+  TEST_ASSERT_FALSE(dns.atender());
+  TEST_ASSERT_FALSE(dns.porIP());
+  TEST_ASSERT_EQUAL_STRING(HOST, dns.servidor());
+  TEST_ASSERT_EQUAL(0, modem.enviadosCon("AT+CDNSGIP=").size());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_parsear_cdnsgip);
+  RUN_TEST(test_reporte_por_ip_con_host);
+  RUN_TEST(test_fallo_por_ip_pasa_a_la_siguiente_y_al_nombre);
+  RUN_TEST(test_resolucion_fallida_y_vencimiento);
+  RUN_TEST(test_por_omision_conecta_por_nombre);
+  return UNITY_END();
+}
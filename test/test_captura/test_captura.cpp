@@ -0,0 +1,163 @@
+// Captura de alta frecuencia: anillo en punto fijo, disparos y congelado en flash
+#include <unity.h>
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <Preferences.h>
+#include "CanalAT.h"
+#include "CapturaGNSS.h"
+#include "ReproductorModem.h"
+
+static const uint32_t UTC_INICIO = 1714558200UL;  // 2024-05-01 10:10:00
+
+// Un URC +CGNSSINFO por segundo: 'segundo' fija la hora GNSS y el reloj virtual
+static void emitirFix(CapturaGNSS& captura, int segundo, double lat, float nudos) {
+  char linea[128];
+  uint32_t t = UTC_INICIO + segundo;
+  snprintf(linea, sizeof(linea),
+           "+CGNSSINFO: 3,09,,03,01,%.7f,N,99.2307130,W,010524,%02lu%02lu%02lu.00,1500.0,%.1f,180.5,1.4,0.9,1.1",
+           lat, (unsigned long)(t / 3600 % 24), (unsigned long)(t / 60 % 60), (unsigned long)(t % 60), nudos);
+  fijarReloj(segundo * 1000UL);
+  captura.ingerir(linea);
+}
+
+static ReproductorModem modem;
+static CanalAT canal(modem);
+
+void setUp() {
+  Preferences::borrarTodo();
+  LittleFSNativo::borrarTodo();
+  fijarReloj(0);
+}
+
+void tearDown() {}
+
+void test_anillo_y_disparo_por_velocidad() {
+  static RelojGNSS reloj;
+  static CapturaGNSS captura(canal, reloj);
+  captura.begin();
+
+  // Más fixes que el anillo: quedan los últimos CAPTURA_MUESTRAS, del más antiguo al más nuevo
+  int segundo = 0;
+  for (; segundo < CAPTURA_MUESTRAS + 10; segundo++) {
+    emitirFix(captura, segundo, 18.92 + segundo * 1e-5, 30.0f);
+  }
+  TEST_ASSERT_EQUAL(CAPTURA_MUESTRAS, captura.muestras());
+  TEST_ASSERT_EQUAL_UINT32(10 * 1000UL, captura.muestra(0).ms);
+  TEST_ASSERT_EQUAL_INT32(189201000, captura.muestra(0).lat);
+  TEST_ASSERT_EQUAL_INT32(-992307130, captura.muestra(0).lon);
+  TEST_ASSERT_EQUAL(5556, captura.muestra(0).velocidad);  // 30 nudos en km/h x 100
+  TEST_ASSERT_EQUAL(18050, captura.muestra(0).rumbo);
+  TEST_ASSERT_FALSE(captura.disparada());
+
+  // Frenado de 30 a 20 nudos en un segundo: 18.5 km/h/s
+  emitirFix(captura, segundo++, 18.93, 20.0f);
+  TEST_ASSERT_TRUE(captura.disparada());
+  unsigned long msDisparo = millis();
+
+  // Sigue grabando durante la ventana posterior y luego congela
+  int posteriores = CAPTURA_POST_DISPARO_MS / 1000;
+  for (int i = 0; i < posteriores; i++) {
+    emitirFix(captura, segundo++, 18.93, 0.0f);  // Nunca dispara dos veces
+    captura.atender(false);
+  }
+  TEST_ASSERT_TRUE(captura.hayCongelada());
+  TEST_ASSERT_FALSE(captura.disparada());
+
+  const CabeceraCaptura& c = captura.getCabecera();
+  TEST_ASSERT_EQUAL_UINT32(CAPTURA_MAGIA, c.magia);
+  TEST_ASSERT_EQUAL(CAPTURA_MUESTRAS, c.muestras);
+  TEST_ASSERT_EQUAL(CAPTURA_VELOCIDAD, c.motivo);
+  TEST_ASSERT_EQUAL_UINT32(msDisparo, c.msDisparo);
+  TEST_ASSERT_EQUAL_UINT32(UTC_INICIO + segundo - 1, c.utcReferencia);
+  TEST_ASSERT_EQUAL_UINT32((segundo - 1) * 1000UL, c.msReferencia);
+
+  // El archivo sigue el orden del anillo al congelar
+  TEST_ASSERT_EQUAL(sizeof(CabeceraCaptura) + CAPTURA_MUESTRAS * sizeof(MuestraGNSS), captura.bytesCongelados());
+  MuestraGNSS primera, ultima;
+  TEST_ASSERT_EQUAL(sizeof(primera), captura.leerCongelada(sizeof(CabeceraCaptura), (uint8_t*)&primera, sizeof(primera)));
+  captura.leerCongelada(captura.bytesCongelados() - sizeof(ultima), (uint8_t*)&ultima, sizeof(ultima));
+  TEST_ASSERT_EQUAL_UINT32(captura.muestra(0).ms, primera.ms);
+  TEST_ASSERT_EQUAL_UINT32(captura.muestra(CAPTURA_MUESTRAS - 1).ms, ultima.ms);
+  TEST_ASSERT_EQUAL(0, ultima.velocidad);
+}
+
+void test_sin_disparo_en_huecos_ni_aceleracion_suave() {
+  static RelojGNSS reloj;
+  static CapturaGNSS captura(canal, reloj);
+  captura.begin();
+
+  // Aceleración normal: 2 nudos por segundo (3.7 km/h/s)
+  for (int s = 0; s < 10; s++) {
+    emitirFix(captura, s, 18.92, 2.0f * s);
+  }
+  // Hueco de un minuto sin fix: la diferencia de velocidad no es un frenado
+  emitirFix(captura, 70, 18.93, 0.0f);
+  TEST_ASSERT_FALSE(captura.disparada());
+
+  // Los fixes sin posición no entran al anillo
+  captura.ingerir("+CGNSSINFO: 2,02,,01,00,,,,,,,,,,,,");
+  TEST_ASSERT_EQUAL(11, captura.muestras());
+}
+
+void test_congelada_sobrevive_reinicio() {
+  {
+    static RelojGNSS reloj;
+    static CapturaGNSS antes(canal, reloj);
+    antes.begin();
+    emitirFix(antes, 0, 18.92, 10.0f);
+    antes.disparar(CAPTURA_SERVIDOR);
+    fijarReloj(CAPTURA_POST_DISPARO_MS);
+    antes.atender(false);
+    TEST_ASSERT_TRUE(antes.hayCongelada());
+  }
+
+  static RelojGNSS reloj;
+  static CapturaGNSS despues(canal, reloj);
+  despues.begin();
+  TEST_ASSERT_TRUE(despues.hayCongelada());
+  TEST_ASSERT_EQUAL(1, despues.getCabecera().muestras);
+  TEST_ASSERT_EQUAL(CAPTURA_SERVIDOR, despues.getCabecera().motivo);
+
+  // Mientras no se sube, un nuevo disparo no la reemplaza
+  despues.disparar(CAPTURA_PIN);
+  TEST_ASSERT_FALSE(despues.disparada());
+
+  despues.descartarCongelada();
+  TEST_ASSERT_FALSE(despues.hayCongelada());
+  TEST_ASSERT_FALSE(LittleFS.exists(CAPTURA_ARCHIVO));
+}
+
+void test_urc_solo_con_gnss_encendido() {
+  ReproductorModem modemUrc;
+  CanalAT canalUrc(modemUrc);
+  static RelojGNSS reloj;
+  static CapturaGNSS captura(canalUrc, reloj);
+  captura.begin();
+
+  captura.atender(true);
+  captura.atender(true);
+  TEST_ASSERT_EQUAL(1, modemUrc.enviadosCon("AT+CGNSSINFO=1").size());
+
+  // El URC llega por el canal al manejador registrado
+  modemUrc.emitir("\r\n+CGNSSINFO: 3,09,,03,01,18.9261240,N,99.2307130,W,010524,101000.00,1500.0,5.0,90.0,1.4,0.9,1.1\r\n");
+  canalUrc.atender();
+  TEST_ASSERT_EQUAL(1, captura.muestras());
+
+  captura.atender(false);
+  TEST_ASSERT_EQUAL(1, modemUrc.enviadosCon("AT+CGNSSINFO=0").size());
+
+  // Tras ciclar el módem se vuelve a configurar
+  captura.atender(true);
+  captura.reiniciar();
+  captura.atender(true);
+  TEST_ASSERT_EQUAL(3, modemUrc.enviadosCon("AT+CGNSSINFO=1").size());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_anillo_y_disparo_por_velocidad);
+  RUN_TEST(test_sin_disparo_en_huecos_ni_aceleracion_suave);
+  RUN_TEST(test_congelada_sobrevive_reinicio);
+  RUN_TEST(test_urc_solo_con_gnss_encendido);
+  return UNITY_END();
+}
@@ -0,0 +1,102 @@
+// Consumo de datos: periodos de facturación, presión sobre el presupuesto y persistencia en NVS
+#include <unity.h>
+#include <Arduino.h>
+#include <Preferences.h>
+#include "ConsumoDatos.h"
+
+static const uint32_t DIA = 86400UL;
+static const uint32_t MAYO_2024 = 1714521600UL;  // 2024-05-01 00:00:00 UTC
+
+// Como un fix con hora GNSS en este instante
+static void fijarHora(RelojGNSS& reloj, ConsumoDatos& consumo, uint32_t utc) {
+  reloj.sincronizar(utc, 0, reloj.ahora());
+  consumo.actualizarHora();
+}
+
+static void consumir(ConsumoDatos& consumo, uint32_t bytes) {
+  ConsumoSesion s = { 0, bytes };
+  consumo.registrar(DATOS_REPORTE, s);
+}
+
+void setUp() {
+  Preferences::borrarTodo();
+  fijarReloj(0);
+}
+
+void tearDown() {}
+
+void test_limites_periodo() {
+  uint32_t inicio = ConsumoDatos::inicioPeriodo(MAYO_2024 + 14 * DIA + 3600);
+  TEST_ASSERT_EQUAL_UINT32(MAYO_2024 + (DATOS_DIA_CORTE - 1) * DIA, inicio);
+  TEST_ASSERT_EQUAL_UINT32(MAYO_2024 + (31 + DATOS_DIA_CORTE - 1) * DIA, ConsumoDatos::finPeriodo(inicio));
+
+  // Diciembre -> enero cambia de año
+  uint32_t diciembre = 1733011200UL;  // 2024-12-01
+  TEST_ASSERT_EQUAL_UINT32(1735689600UL + (DATOS_DIA_CORTE - 1) * DIA,
+                           ConsumoDatos::finPeriodo(ConsumoDatos::inicioPeriodo(diciembre + 20 * DIA)));
+}
+
+void test_presion_prorrateada() {
+  RelojGNSS reloj;
+  ConsumoDatos consumo(reloj);
+  consumo.begin();
+
+  // Sin fecha solo cuenta el presupuesto completo
+  consumir(consumo, DATOS_PRESUPUESTO_MENSUAL_KB * 1024UL / 2);
+  TEST_ASSERT_EQUAL(PRESION_NORMAL, consumo.presion());
+
+  // Al 10% del periodo (más la holgura) la mitad del presupuesto ya es demasiado
+  uint32_t inicio = ConsumoDatos::inicioPeriodo(MAYO_2024);
+  uint32_t duracion = ConsumoDatos::finPeriodo(inicio) - inicio;
+  fijarHora(reloj, consumo, inicio + duracion / 10);
+  TEST_ASSERT_EQUAL(PRESION_ALTA, consumo.presion());
+  TEST_ASSERT_EQUAL(4, consumo.factorIntervalo());
+  TEST_ASSERT_FALSE(consumo.permiteAsistencia());
+
+  // A la mitad del periodo el prorrateo alcanza lo consumido
+  fijarReloj((unsigned long)(duracion * 4 / 10) * 1000UL);
+  TEST_ASSERT_EQUAL(PRESION_MODERADA, consumo.presion());
+  TEST_ASSERT_TRUE(consumo.agruparReportes());
+  TEST_ASSERT_TRUE(consumo.permiteAsistencia());
+
+  consumir(consumo, DATOS_PRESUPUESTO_MENSUAL_KB * 1024UL / 2);
+  TEST_ASSERT_EQUAL(PRESION_AGOTADA, consumo.presion());
+  TEST_ASSERT_EQUAL(12, consumo.factorIntervalo());
+}
+
+void test_persistencia_y_cambio_periodo() {
+  uint32_t inicio = ConsumoDatos::inicioPeriodo(MAYO_2024);
+  {
+    RelojGNSS reloj;
+    ConsumoDatos antes(reloj);
+    antes.begin();
+    fijarHora(reloj, antes, inicio + DIA);
+    consumir(antes, DATOS_GUARDAR_CADA_BYTES);
+    consumir(antes, 100);  // Aún sin guardar
+  }
+
+  // Tras el reinicio se pierde a lo sumo lo no guardado
+  RelojGNSS reloj;
+  ConsumoDatos despues(reloj);
+  despues.begin();
+  TEST_ASSERT_EQUAL_UINT32(DATOS_GUARDAR_CADA_BYTES, despues.totalBytes());
+  TEST_ASSERT_EQUAL_UINT32(inicio, despues.getPeriodo().inicio);
+  TEST_ASSERT_EQUAL_UINT32(1, despues.getPeriodo().sesiones);
+
+  // Una operación que no llegó a la red no cuenta
+  consumir(despues, 0);
+  TEST_ASSERT_EQUAL_UINT32(1, despues.getPeriodo().sesiones);
+
+  fijarHora(reloj, despues, ConsumoDatos::finPeriodo(inicio) + 60);
+  TEST_ASSERT_EQUAL_UINT32(0, despues.totalBytes());
+  TEST_ASSERT_EQUAL_UINT32(DATOS_GUARDAR_CADA_BYTES, despues.getPeriodo().totalAnterior);
+  TEST_ASSERT_EQUAL_UINT32(ConsumoDatos::finPeriodo(inicio), despues.getPeriodo().inicio);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_limites_periodo);
+  RUN_TEST(test_presion_prorrateada);
+  RUN_TEST(test_persistencia_y_cambio_periodo);
+  return UNITY_END();
+}
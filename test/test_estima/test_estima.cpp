@@ -0,0 +1,147 @@
+// Reporte por estima: predicción compartida con el servidor, redondeo como en la URL y reportes ahorrados
+#include <unity.h>
+#include <Arduino.h>
+#include <Preferences.h>
+#include <math.h>
+#include <string>
+#include "CanalAT.h"
+#include "GSMModule.h"
+#include "HTTPClient.h"
+#include "ColaReportes.h"
+#include "ControlSalidas.h"
+#include "GeoUtils.h"
+#include "Estima.h"
+#include "ReproductorModem.h"
+#include "../../servidor/ContratoGPS.h"
+
+static BaseEstima base(double lat, double lon, float velocidad, float rumbo) {
+  BaseEstima b = { lat, lon, velocidad, rumbo, 1714558222UL };
+  return b;
+}
+
+void setUp() {
+  Preferences::borrarTodo();
+  fijarReloj(0);
+}
+
+void tearDown() {}
+
+void test_prediccion_rectilinea() {
+  double lat, lon;
+  // 36 km/h = 10 m/s
+  predecirPosicion(base(19.0, -99.0, 36.0f, 0.0f), 60, lat, lon);
+  TEST_ASSERT_FLOAT_WITHIN(0.5, 600.0, calcularDistancia(19.0, -99.0, lat, lon));
+  TEST_ASSERT_TRUE(lat > 19.0 && lon == -99.0);
+
+  predecirPosicion(base(19.0, -99.0, 36.0f, 90.0f), 60, lat, lon);
+  TEST_ASSERT_FLOAT_WITHIN(0.5, 600.0, calcularDistancia(19.0, -99.0, lat, lon));
+  TEST_ASSERT_FLOAT_WITHIN(1e-7, 19.0, lat);
+
+  // Sin rumbo, sin velocidad o sin tiempo transcurrido: la posición del reporte
+  predecirPosicion(base(19.0, -99.0, 36.0f, ESTIMA_SIN_RUMBO), 60, lat, lon);
+  TEST_ASSERT_TRUE(lat == 19.0 && lon == -99.0);
+  predecirPosicion(base(19.0, -99.0, -1.0f, 45.0f), 60, lat, lon);
+  TEST_ASSERT_TRUE(lat == 19.0 && lon == -99.0);
+}
+
+void test_base_redondeada_como_la_url() {
+  ReporteEstima estima(25.0, 300.0, 8.0f);
+  BaseEstima b = estima.armarBase(18.9261134, -99.2307336, 42.25f, 359.97f, 1714558222UL);
+  TEST_ASSERT_EQUAL(18926113, lround(b.lat * 1e6));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 42.3f, b.velocidad);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 0.0f, b.rumbo);  // 360.0 es el norte
+
+  // Casi detenido el rumbo del GNSS es ruido: el servidor no extrapola
+  b = estima.armarBase(18.9, -99.2, 5.0f, 120.0f, 0);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, ESTIMA_SIN_RUMBO, b.rumbo);
+  b = estima.armarBase(18.9, -99.2, -1.0f, 120.0f, 0);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, -1.0f, b.velocidad);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, ESTIMA_SIN_RUMBO, b.rumbo);
+}
+
+void test_carretera_con_curva() {
+  ReporteEstima estima(25.0, 300.0, 8.0f);
+  TEST_ASSERT_TRUE(estima.debeReportar(19.0, -99.0, 0));  // Sin base: el primer fix sale siempre
+
+  // 100 km/h al este, un fix cada 20 s durante 10 minutos
+  BaseEstima real = estima.armarBase(19.0, -99.0, 100.0f, 90.0f, 1714558222UL);
+  estima.fijarBase(real);
+  int porEstima = 0, porDistancia = 0;
+  double latEnviado = 19.0, lonEnviado = -99.0;
+  double segundosBase = 0;
+  for (int t = 20; t <= 600; t += 20) {
+    double lat, lon;
+    predecirPosicion(real, t, lat, lon);
+    lat += 3e-5 * ((t / 20) % 2);  // Unos 3 m de ruido del GNSS
+    if (estima.debeReportar(lat, lon, t - segundosBase)) {
+      porEstima++;
+      TEST_ASSERT_TRUE(estima.ultimoDesvio() < 25.0);  // Solo por el intervalo máximo
+      estima.fijarBase(estima.armarBase(lat, lon, 100.0f, 90.0f, 1714558222UL + t));
+      segundosBase = t;
+    }
+    if (calcularDistancia(latEnviado, lonEnviado, lat, lon) > UMBRAL_MOVIMIENTO_METROS) {
+      porDistancia++;
+      latEnviado = lat;
+      lonEnviado = lon;
+    }
+  }
+  TEST_ASSERT_EQUAL(2, porEstima);
+  TEST_ASSERT_EQUAL(30, porDistancia);
+
+  // Vuelta al norte: a los 20 s de la curva el fix ya se apartó de lo previsto
+  double latBase = estima.getBase().lat, lonBase = estima.getBase().lon;
+  double lat, lon;
+  predecirPosicion(base(latBase, lonBase, 100.0f, 0.0f), 20, lat, lon);
+  TEST_ASSERT_TRUE(estima.debeReportar(lat, lon, 20));
+  TEST_ASSERT_FLOAT_WITHIN(1.0, 556 * sqrt(2.0), estima.ultimoDesvio());
+}
+
+// Lo que el servidor lee de la URL del firmware extrapola al mismo punto que el dispositivo
+void test_url_y_servidor_extrapolan_igual() {
+  std::vector<RegistroUART> g;
+  g.push_back({ '>', 0, "AT+CGACT?\r\n" });
+  g.push_back({ '<', 10, "\r\n+CGACT: 1,1\r\n\r\nOK\r\n" });
+  g.push_back({ '>', 0, "AT+HTTPACTION=0\r\n" });
+  g.push_back({ '<', 10, "\r\nOK\r\n" });
+  g.push_back({ '<', 900, "\r\n+HTTPACTION: 0,200,0\r\n" });
+  ReproductorModem modem(g);
+  CanalAT canal(modem);
+  GSMModule gsm(canal, PWR_PIN, RXD1_PIN, TXD1_PIN, BAUD_RATE);
+  ControlSalidas salidas(PIN_ACTIVE, PIN_INACTIVE);
+  HTTPClient http(gsm, salidas);
+  ColaReportes reportes;
+  salidas.begin();
+  reportes.begin();
+
+  ReporteEstima estima(ESTIMA_UMBRAL_METROS, ESTIMA_INTERVALO_MAX_MS / 1000.0, ESTIMA_VELOCIDAD_MIN_KMH);
+  BaseEstima enviada = estima.armarBase(18.9261137, -99.2307331, 87.46f, 213.26f, 1714558222UL);
+  reportes.agregar(18.9261137, -99.2307331, enviada.velocidad, enviada.utc, enviada.rumbo);
+  TEST_ASSERT_TRUE(http.enviarReportes(reportes));
+
+  std::string comando = modem.enviadosCon("AT+HTTPPARA=\"URL\"")[0];
+  TEST_ASSERT_TRUE(comando.find("&speed=87.5&course=213.3&") != std::string::npos);
+  size_t inicio = comando.find(API_PATH);
+  std::string texto = "GET " + comando.substr(inicio, comando.rfind('"') - inicio) + " HTTP/1.1\r\n\r\n";
+  static PeticionGPS peticion;
+  TEST_ASSERT_EQUAL(ANALISIS_OK, analizarPeticion(texto.c_str(), texto.size(), peticion));
+  TEST_ASSERT_TRUE(peticion.consulta);
+  const FixGPS& f = peticion.fixes[0];
+  TEST_ASSERT_EQUAL(2133, f.rumbo);
+
+  // La conversión de servidor/ingesta.cpp
+  BaseEstima leida = { f.lat / 1e6, f.lon / 1e6, f.velocidad / 10.0f, f.rumbo / 10.0f, f.ts };
+  double latD, lonD, latS, lonS;
+  predecirPosicion(enviada, 240, latD, lonD);
+  predecirPosicion(leida, 240, latS, lonS);
+  TEST_ASSERT_TRUE(calcularDistancia(latD, lonD, latS, lonS) < 0.05);
+  TEST_ASSERT_TRUE(calcularDistancia(18.9261137, -99.2307331, latS, lonS) > 5000);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_prediccion_rectilinea);
+  RUN_TEST(test_base_redondeada_como_la_url);
+  RUN_TEST(test_carretera_con_curva);
+  RUN_TEST(test_url_y_servidor_extrapolan_igual);
+  return UNITY_END();
+}
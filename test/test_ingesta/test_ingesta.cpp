@@ -0,0 +1,118 @@
+// Contrato del servidor de referencia: análisis de la petición del rastreador y confirmación por dispositivo
+#include <unity.h>
+#include <string.h>
+#include "../../servidor/ContratoGPS.h"
+
+static PeticionGPS peticion;
+
+static ResultadoAnalisis analizar(const char* texto) {
+  return analizarPeticion(texto, strlen(texto), peticion);
+}
+
+void setUp() {
+  memset(&peticion, 0, sizeof(peticion));
+}
+
+void tearDown() {}
+
+void test_fijo_decimal() {
+  int32_t v = 0;
+  TEST_ASSERT_TRUE(contrato::leerFijo("18.926113", 9, 6, v));
+  TEST_ASSERT_EQUAL(18926113, v);
+  TEST_ASSERT_TRUE(contrato::leerFijo("-99.2307", 8, 6, v));
+  TEST_ASSERT_EQUAL(-99230700, v);
+  TEST_ASSERT_TRUE(contrato::leerFijo("42.35", 5, 1, v));
+  TEST_ASSERT_EQUAL(424, v);  // Décimas de km/h, redondeando
+  TEST_ASSERT_TRUE(contrato::leerFijo("7", 1, 1, v));
+  TEST_ASSERT_EQUAL(70, v);
+  TEST_ASSERT_FALSE(contrato::leerFijo("-", 1, 6, v));
+  TEST_ASSERT_FALSE(contrato::leerFijo("1.2x", 4, 6, v));
+  TEST_ASSERT_FALSE(contrato::leerFijo("99999.0", 7, 6, v));  // No cabe en 32 bits
+}
+
+void test_reporte_del_firmware_con_lote() {
+  const char* texto =
+    "GET /api/gps?token=abc123&lat=18.926113&lon=-99.230733&speed=42.5&seq=120&ts=1714558222"
+    "&oldest=117&lote=3,-150,200,90_1,-40,25,30&bat=87 HTTP/1.1\r\n"
+    "Host: findme.example\r\n\r\n";
+  TEST_ASSERT_EQUAL(ANALISIS_OK, analizar(texto));
+  TEST_ASSERT_TRUE(peticion.metodo.igual("GET"));
+  TEST_ASSERT_TRUE(peticion.ruta.igual("/api/gps"));
+  TEST_ASSERT_TRUE(peticion.token.igual("abc123"));
+  TEST_ASSERT_TRUE(peticion.consulta);
+  TEST_ASSERT_TRUE(peticion.mantener);
+  TEST_ASSERT_EQUAL(strlen(texto), peticion.largo);
+
+  TEST_ASSERT_EQUAL(3, peticion.nFixes);
+  TEST_ASSERT_EQUAL(120, peticion.fixes[0].seq);
+  TEST_ASSERT_EQUAL(425, peticion.fixes[0].velocidad);
+  TEST_ASSERT_EQUAL(117, peticion.fixes[1].seq);
+  TEST_ASSERT_EQUAL(18925963, peticion.fixes[1].lat);
+  TEST_ASSERT_EQUAL(-99230533, peticion.fixes[1].lon);
+  TEST_ASSERT_EQUAL(1714558132UL, peticion.fixes[1].ts);
+  TEST_ASSERT_EQUAL(CONTRATO_SIN_VELOCIDAD, peticion.fixes[1].velocidad);
+  TEST_ASSERT_EQUAL(119, peticion.fixes[2].seq);
+  TEST_ASSERT_TRUE(peticion.hayOldest);
+  TEST_ASSERT_EQUAL(117, peticion.oldest);
+
+  // Lo que el contrato aún no define se conserva tal cual
+  TEST_ASSERT_EQUAL(1, peticion.nExtra);
+  TEST_ASSERT_TRUE(peticion.extra[0].igual("bat=87"));
+}
+
+void test_peticion_incompleta_cierre_e_invalida() {
+  const char* completa = "GET /api/gps?token=t&lat=1&lon=2&seq=1 HTTP/1.1\r\nConnection: close\r\n\r\n";
+  for (size_t n = 0; n < strlen(completa); n++) {
+    memset(&peticion, 0, sizeof(peticion));
+    TEST_ASSERT_EQUAL(ANALISIS_INCOMPLETA, analizarPeticion(completa, n, peticion));
+  }
+  memset(&peticion, 0, sizeof(peticion));
+  TEST_ASSERT_EQUAL(ANALISIS_OK, analizar(completa));
+  TEST_ASSERT_FALSE(peticion.mantener);
+  TEST_ASSERT_EQUAL(-1, peticion.fixes[0].velocidad);
+  TEST_ASSERT_EQUAL(0, peticion.fixes[0].ts);
+
+  // Sin seq no se puede deduplicar: 400 aunque la línea sea HTTP válida
+  memset(&peticion, 0, sizeof(peticion));
+  TEST_ASSERT_EQUAL(ANALISIS_OK, analizar("GET /api/gps?token=t&lat=1&lon=2 HTTP/1.1\r\n\r\n"));
+  TEST_ASSERT_FALSE(peticion.consulta);
+
+  memset(&peticion, 0, sizeof(peticion));
+  TEST_ASSERT_EQUAL(ANALISIS_INVALIDA, analizar("HOLA\r\n\r\n"));
+}
+
+void test_confirmacion_con_duplicados_y_huecos() {
+  EstadoConfirmacion e;
+  e.reiniciar();
+  TEST_ASSERT_TRUE(e.registrar(1));
+  TEST_ASSERT_TRUE(e.registrar(3));
+  TEST_ASSERT_EQUAL(1, e.ack);  // Falta la 2
+  TEST_ASSERT_FALSE(e.registrar(3));
+  TEST_ASSERT_TRUE(e.registrar(2));
+  TEST_ASSERT_EQUAL(3, e.ack);
+  TEST_ASSERT_FALSE(e.registrar(2));
+
+  // La 4 y la 5 se descartaron en el dispositivo (cola llena): oldest=6 las da por recibidas
+  TEST_ASSERT_TRUE(e.registrar(7));
+  e.aplicarOldest(6);
+  TEST_ASSERT_EQUAL(5, e.ack);
+  TEST_ASSERT_TRUE(e.registrar(6));
+  TEST_ASSERT_EQUAL(7, e.ack);
+
+  // Tras reiniciar el servidor el estado se reconstruye desde oldest
+  e.reiniciar();
+  e.aplicarOldest(500);
+  TEST_ASSERT_EQUAL(499, e.ack);
+  TEST_ASSERT_FALSE(e.registrar(450));
+  TEST_ASSERT_TRUE(e.registrar(500));
+  TEST_ASSERT_EQUAL(500, e.ack);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_fijo_decimal);
+  RUN_TEST(test_reporte_del_firmware_con_lote);
+  RUN_TEST(test_peticion_incompleta_cierre_e_invalida);
+  RUN_TEST(test_confirmacion_con_duplicados_y_huecos);
+  return UNITY_END();
+}
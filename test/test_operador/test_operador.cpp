@@ -0,0 +1,187 @@
+// Operador de la SIM, tabla de APN, APN guardado en NVS y perfil PDP que no se reescribe
+#include <unity.h>
+#include <Arduino.h>
+#include <Preferences.h>
+#include "CanalAT.h"
+#include "GSMModule.h"
+#include "ReproductorModem.h"
+
+static const char* const IMSI_MOVISTAR = "\r\n334030123456789\r\n\r\nOK\r\n";
+static const char* const IMSI_TELCEL = "\r\n334020987654321\r\n\r\nOK\r\n";
+
+// Una activación: contexto inactivo y, según 'activa', la respuesta de AT+CGACT=1,1
+static void agregarActivacion(std::vector<RegistroUART>& g, bool activa) {
+  g.push_back({ '>', 0, "AT+CGACT?\r\n" });
+  g.push_back({ '<', 10, "\r\n+CGACT: 1,0\r\n\r\nOK\r\n" });
+  g.push_back({ '>', 0, "AT+CGACT=1,1\r\n" });
+  g.push_back({ '<', 800, activa ? "\r\nOK\r\n" : "\r\n+CME ERROR: 33\r\n" });
+  if (activa) {
+    g.push_back({ '>', 0, "AT+CGPADDR=1\r\n" });
+    g.push_back({ '<', 10, "\r\n+CGPADDR: 1,10.45.12.7\r\n\r\nOK\r\n" });
+  } else {
+    g.push_back({ '>', 0, "AT+CGACT?\r\n" });
+    g.push_back({ '<', 10, "\r\n+CGACT: 1,0\r\n\r\nOK\r\n" });
+  }
+}
+
+static void agregarSenal(std::vector<RegistroUART>& g, int veces) {
+  for (int i = 0; i < veces; i++) {
+    g.push_back({ '>', 0, "AT+CSQ\r\n" });
+    g.push_back({ '<', 10, "\r\n+CSQ: 20,99\r\n\r\nOK\r\n" });
+    g.push_back({ '>', 0, "AT+CPSI?\r\n" });
+    g.push_back({ '<', 10, "\r\n+CPSI: GSM,Online,334-020,0x1234,5678,12\r\n\r\nOK\r\n" });
+    g.push_back({ '>', 0, "AT+CREG?\r\n" });
+    g.push_back({ '<', 10, "\r\n+CREG: 0,1\r\n\r\nOK\r\n" });
+  }
+}
+
+void setUp() {
+  Preferences::borrarTodo();
+  fijarReloj(0);
+}
+
+void tearDown() {}
+
+void test_parsers_operador() {
+  char operador[OPERADOR_LONGITUD + 1];
+  TEST_ASSERT_TRUE(GSMModule::parsearIMSI("AT+CIMI\r\n334020123456789\r\n\r\nOK\r\n", operador));
+  TEST_ASSERT_EQUAL_STRING("334020", operador);
+  TEST_ASSERT_FALSE(GSMModule::parsearIMSI("\r\n+CME ERROR: 10\r\n", operador));
+
+  TEST_ASSERT_TRUE(GSMModule::parsearCOPS("\r\n+COPS: 0,2,\"33403\",7\r\n\r\nOK\r\n", operador));
+  TEST_ASSERT_EQUAL_STRING("33403", operador);
+  TEST_ASSERT_FALSE(GSMModule::parsearCOPS("\r\n+COPS: 0,0,\"TELCEL\",7\r\n", operador));
+  TEST_ASSERT_FALSE(GSMModule::parsearCOPS("\r\n+COPS: 0\r\n", operador));
+
+  char apn[APN_LONGITUD_MAX + 1];
+  TEST_ASSERT_TRUE(GSMModule::parsearCGDCONT(
+      "\r\n+CGDCONT: 1,\"IP\",\"internet.itelcel.com\",\"0.0.0.0\",0,0,0,0\r\n"
+      "+CGDCONT: 2,\"IPV4V6\",\"ims\",\"\",0,0\r\n\r\nOK\r\n", apn, sizeof(apn)));
+  TEST_ASSERT_EQUAL_STRING("internet.itelcel.com", apn);
+  TEST_ASSERT_TRUE(GSMModule::parsearCGDCONT("\r\n+CGDCONT: 1,\"IP\",\"\",\"0.0.0.0\",0,0\r\n", apn, sizeof(apn)));
+  TEST_ASSERT_EQUAL_STRING("", apn);
+  TEST_ASSERT_FALSE(GSMModule::parsearCGDCONT("\r\n+CGDCONT: 2,\"IP\",\"ims\"\r\n\r\nOK\r\n", apn, sizeof(apn)));
+
+  TEST_ASSERT_EQUAL_STRING("internet.movistar.com.mx", GSMModule::apnDeOperador("334030"));
+  TEST_ASSERT_TRUE(GSMModule::apnDeOperador("310410") == NULL);
+  TEST_ASSERT_TRUE(GSMModule::apnDeOperador("") == NULL);
+}
+
+void test_sim_de_otro_operador_y_perfil_guardado() {
+  std::vector<RegistroUART> g;
+  agregarSenal(g, 3);
+  g.push_back({ '>', 0, "AT+CIMI\r\n" });
+  g.push_back({ '<', 10, IMSI_MOVISTAR });
+  g.push_back({ '>', 0, "AT+CIMI\r\n" });
+  g.push_back({ '<', 10, IMSI_MOVISTAR });
+  // El módem trae el perfil de la SIM anterior; tras reescribirlo el siguiente arranque ya coincide
+  g.push_back({ '>', 0, "AT+CGDCONT?\r\n" });
+  g.push_back({ '<', 10, "\r\n+CGDCONT: 1,\"IP\",\"internet.itelcel.com\",\"0.0.0.0\",0,0\r\n\r\nOK\r\n" });
+  g.push_back({ '>', 0, "AT+CGDCONT?\r\n" });
+  g.push_back({ '<', 10, "\r\n+CGDCONT: 1,\"IP\",\"internet.movistar.com.mx\",\"0.0.0.0\",0,0\r\n\r\nOK\r\n" });
+  g.push_back({ '>', 0, "AT+CGDCONT=1,\"IP\",\"internet.movistar.com.mx\"\r\n" });
+  g.push_back({ '<', 10, "\r\nOK\r\n" });
+  for (int i = 0; i < 3; i++) {
+    agregarActivacion(g, true);
+  }
+  ReproductorModem modem(g);
+  CanalAT canal(modem);
+
+  {
+    GSMModule gsm(canal, PWR_PIN, RXD1_PIN, TXD1_PIN, BAUD_RATE);
+    TEST_ASSERT_TRUE(gsm.verificarConexionGPRS());
+    TEST_ASSERT_EQUAL_STRING("334030", gsm.getOperador());
+    TEST_ASSERT_EQUAL_STRING("internet.movistar.com.mx", gsm.getAPN());
+    TEST_ASSERT_EQUAL(1, modem.enviadosCon("AT+CGDCONT=").size());
+
+    // Reconexión: ni IMSI, ni consulta ni reescritura del perfil, solo la activación
+    TEST_ASSERT_TRUE(gsm.verificarConexionGPRS());
+    TEST_ASSERT_EQUAL(1, modem.enviadosCon("AT+CIMI").size());
+    TEST_ASSERT_EQUAL(1, modem.enviadosCon("AT+CGDCONT?").size());
+    TEST_ASSERT_EQUAL(1, modem.enviadosCon("AT+CGDCONT=").size());
+    TEST_ASSERT_EQUAL(2, modem.enviadosCon("AT+CGACT=1,1").size());
+  }
+
+  Preferences p;
+  p.begin("apn", true);
+  char apn[APN_LONGITUD_MAX + 1] = "";
+  p.getString("apn", apn, sizeof(apn));
+  p.end();
+  TEST_ASSERT_EQUAL_STRING("internet.movistar.com.mx", apn);
+
+  // Reinicio con la misma SIM: el perfil del módem coincide con el guardado
+  GSMModule gsm(canal, PWR_PIN, RXD1_PIN, TXD1_PIN, BAUD_RATE);
+  TEST_ASSERT_TRUE(gsm.verificarConexionGPRS());
+  TEST_ASSERT_EQUAL(2, modem.enviadosCon("AT+CGDCONT?").size());
+  TEST_ASSERT_EQUAL(1, modem.enviadosCon("AT+CGDCONT=").size());
+  TEST_ASSERT_EQUAL(0, modem.desconocidos().size());
+}
+
+void test_apn_guardado_que_ya_no_sirve() {
+  Preferences p;
+  p.begin("apn", false);
+  p.putString("operador", "334020");
+  p.putString("apn", "apn.viejo");
+  p.end();
+
+  std::vector<RegistroUART> g;
+  agregarSenal(g, 2);
+  g.push_back({ '>', 0, "AT+CIMI\r\n" });
+  g.push_back({ '<', 10, IMSI_TELCEL });
+  g.push_back({ '>', 0, "AT+CGDCONT?\r\n" });
+  g.push_back({ '<', 10, "\r\n+CGDCONT: 1,\"IP\",\"apn.viejo\",\"0.0.0.0\",0,0\r\n\r\nOK\r\n" });
+  g.push_back({ '>', 0, "AT+CGDCONT=1,\"IP\",\"internet.itelcel.com\"\r\n" });
+  g.push_back({ '<', 10, "\r\nOK\r\n" });
+  agregarActivacion(g, false);
+  agregarActivacion(g, true);
+  ReproductorModem modem(g);
+  CanalAT canal(modem);
+  GSMModule gsm(canal, PWR_PIN, RXD1_PIN, TXD1_PIN, BAUD_RATE);
+
+  // El guardado va primero; al fallar, el de la tabla
+  TEST_ASSERT_FALSE(gsm.verificarConexionGPRS());
+  TEST_ASSERT_EQUAL(0, modem.enviadosCon("AT+CGDCONT=").size());
+  TEST_ASSERT_EQUAL_STRING("internet.itelcel.com", gsm.getAPN());
+
+  TEST_ASSERT_TRUE(gsm.verificarConexionGPRS());
+  TEST_ASSERT_EQUAL(1, modem.enviadosCon("AT+CGDCONT=").size());
+
+  char apn[APN_LONGITUD_MAX + 1] = "";
+  p.begin("apn", true);
+  p.getString("apn", apn, sizeof(apn));
+  p.end();
+  TEST_ASSERT_EQUAL_STRING("internet.itelcel.com", apn);
+  TEST_ASSERT_EQUAL(0, modem.desconocidos().size());
+}
+
+void test_sin_imsi_usa_cops() {
+  std::vector<RegistroUART> g;
+  agregarSenal(g, 1);
+  g.push_back({ '>', 0, "AT+CIMI\r\n" });
+  g.push_back({ '<', 10, "\r\n+CME ERROR: 14\r\n" });
+  g.push_back({ '>', 0, "AT+COPS=3,2\r\n" });
+  g.push_back({ '<', 10, "\r\nOK\r\n" });
+  g.push_back({ '>', 0, "AT+COPS?\r\n" });
+  g.push_back({ '<', 10, "\r\n+COPS: 0,2,\"334090\",7\r\n\r\nOK\r\n" });
+  g.push_back({ '>', 0, "AT+CGDCONT?\r\n" });
+  g.push_back({ '<', 10, "\r\n+CGDCONT: 1,\"IP\",\"internet.att.com.mx\",\"0.0.0.0\",0,0\r\n\r\nOK\r\n" });
+  agregarActivacion(g, true);
+  ReproductorModem modem(g);
+  CanalAT canal(modem);
+  GSMModule gsm(canal, PWR_PIN, RXD1_PIN, TXD1_PIN, BAUD_RATE);
+
+  TEST_ASSERT_TRUE(gsm.verificarConexionGPRS());
+  TEST_ASSERT_EQUAL_STRING("334090", gsm.getOperador());
+  TEST_ASSERT_EQUAL_STRING("internet.att.com.mx", gsm.getAPN());
+  TEST_ASSERT_EQUAL(0, modem.enviadosCon("AT+CGDCONT=").size());
+  TEST_ASSERT_EQUAL(0, modem.desconocidos().size());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_parsers_operador);
+  RUN_TEST(test_sim_de_otro_operador_y_perfil_guardado);
+  RUN_TEST(test_apn_guardado_que_ya_no_sirve);
+  RUN_TEST(test_sin_imsi_usa_cops);
+  return UNITY_END();
+}
@@ -0,0 +1,441 @@
+// Actualización OTA: aplicación del delta, descarga reanudable por rangos (también
+// con un SMS en curso), instalación sobre la otra partición y vuelta a la imagen anterior
+#include <unity.h>
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <Preferences.h>
+#include <esp_ota_ops.h>
+#include <string>
+#include <vector>
+#include "CanalAT.h"
+#include "GSMModule.h"
+#include "ControlSalidas.h"
+#include "HTTPClient.h"
+#include "ActualizacionOTA.h"
+#include "ColaSMS.h"
+#include "ReproductorModem.h"
+
+typedef std::vector<uint8_t> Bytes;
+
+static Bytes aleatorios(size_t n, uint32_t semilla) {
+  Bytes b(n);
+  for (size_t i = 0; i < n; i++) {
+    semilla = semilla * 1103515245UL + 12345UL;
+    b[i] = (uint8_t)(semilla >> 16);
+  }
+  return b;
+}
+
+// Imagen arrancable: empieza con el byte mágico de las imágenes del ESP32
+static Bytes imagen(size_t n, uint32_t semilla) {
+  Bytes b = aleatorios(n, semilla);
+  b[0] = 0xE9;
+  return b;
+}
+
+static void sha256(const uint8_t* datos, size_t n, uint8_t* resumen) {
+  mbedtls_sha256_context ctx;
+  mbedtls_sha256_init(&ctx);
+  mbedtls_sha256_starts(&ctx, 0);
+  mbedtls_sha256_update(&ctx, datos, n);
+  mbedtls_sha256_finish(&ctx, resumen);
+  mbedtls_sha256_free(&ctx);
+}
+
+static void agregarU32(Bytes& b, uint32_t v) {
+  for (int i = 0; i < 4; i++) b.push_back((uint8_t)(v >> (8 * i)));
+}
+
+// Delta de prueba: 'prefijo' bytes copiados del origen, 'nuevos' insertados y
+// el resto del origen desde 'prefijo'. La firma del stub es el propio hash.
+static Bytes construirDelta(const Bytes& origen, size_t prefijo, const Bytes& nuevos, Bytes& destino) {
+  destino.assign(origen.begin(), origen.begin() + prefijo);
+  destino.insert(destino.end(), nuevos.begin(), nuevos.end());
+  destino.insert(destino.end(), origen.begin() + prefijo, origen.end());
+
+  Bytes ops;
+  ops.push_back(DELTA_COPIAR);
+  agregarU32(ops, 0);
+  agregarU32(ops, prefijo);
+  ops.push_back(DELTA_INSERTAR);
+  agregarU32(ops, nuevos.size());
+  ops.insert(ops.end(), nuevos.begin(), nuevos.end());
+  ops.push_back(DELTA_COPIAR);
+  agregarU32(ops, prefijo);
+  agregarU32(ops, origen.size() - prefijo);
+  ops.push_back(DELTA_FIN);
+
+  CabeceraDelta c;
+  memset(&c, 0, sizeof(c));
+  c.magia = DELTA_MAGIA;
+  c.bytesDelta = sizeof(c) + ops.size();
+  c.tamanoOrigen = origen.size();
+  c.tamanoDestino = destino.size();
+  sha256(origen.data(), origen.size(), c.shaOrigen);
+  sha256(destino.data(), destino.size(), c.shaDestino);
+  sha256((const uint8_t*)&c, DELTA_BYTES_FIRMADOS, c.firma);
+  c.firmaLargo = 32;
+
+  Bytes delta((const uint8_t*)&c, (const uint8_t*)&c + sizeof(c));
+  delta.insert(delta.end(), ops.begin(), ops.end());
+  return delta;
+}
+
+static void grabarParticion(int indice, const Bytes& contenido) {
+  std::vector<uint8_t>& p = ParticionesNativas::contenido(ParticionesNativas::particion(indice));
+  std::copy(contenido.begin(), contenido.end(), p.begin());
+}
+
+static bool particionContiene(int indice, const Bytes& contenido) {
+  const std::vector<uint8_t>& p = ParticionesNativas::contenido(ParticionesNativas::particion(indice));
+  return std::equal(contenido.begin(), contenido.end(), p.begin());
+}
+
+static void escribirArchivo(const char* ruta, const Bytes& datos) {
+  File f = LittleFS.open(ruta, "w");
+  f.write(datos.data(), datos.size());
+  f.close();
+}
+
+// Aplicador sobre vectores en memoria
+struct Memoria {
+  const Bytes* origen;
+  Bytes destino;
+};
+
+static bool leerMemoria(uint32_t desde, uint8_t* destino, size_t n, void* contexto) {
+  const Bytes& o = *static_cast<Memoria*>(contexto)->origen;
+  memcpy(destino, o.data() + desde, n);
+  return true;
+}
+
+static bool escribirMemoria(uint32_t desde, const uint8_t* datos, size_t n, void* contexto) {
+  Bytes& d = static_cast<Memoria*>(contexto)->destino;
+  if (d.size() < desde + n) d.resize(desde + n);
+  memcpy(d.data() + desde, datos, n);
+  return true;
+}
+
+static bool aplicarEnTrozos(const Bytes& delta, const Bytes& origen, size_t trozo, Bytes& resultado) {
+  CabeceraDelta c;
+  memcpy(&c, delta.data(), sizeof(c));
+  Memoria m = { &origen, Bytes() };
+  AplicadorDelta aplicador(c, leerMemoria, escribirMemoria, &m);
+  for (size_t i = sizeof(c); i < delta.size(); i += trozo) {
+    size_t n = std::min(trozo, delta.size() - i);
+    if (!aplicador.consumir(delta.data() + i, n)) break;
+  }
+  resultado = m.destino;
+  return aplicador.valido();
+}
+
+static ReproductorModem modem;
+static CanalAT canal(modem);
+static GSMModule gsm(canal, PWR_PIN, RXD1_PIN, TXD1_PIN, BAUD_RATE);
+static ControlSalidas salidas(PIN_ACTIVE, PIN_INACTIVE);
+static HTTPClient http(gsm, salidas);
+
+void setUp() {
+  Preferences::borrarTodo();
+  LittleFSNativo::borrarTodo();
+  ParticionesNativas::reiniciarTodo();
+  ESP.reinicios = 0;
+  fijarReloj(0);
+}
+
+void tearDown() {}
+
+void test_aplicar_delta_por_trozos() {
+  Bytes origen = imagen(3000, 1);
+  Bytes destino;
+  Bytes delta = construirDelta(origen, 1000, aleatorios(700, 2), destino);
+
+  // El resultado no depende de cómo se parta el delta al llegar
+  size_t trozos[] = { 1, 7, 512, delta.size() };
+  for (size_t t = 0; t < sizeof(trozos) / sizeof(trozos[0]); t++) {
+    Bytes resultado;
+    TEST_ASSERT_TRUE(aplicarEnTrozos(delta, origen, trozos[t], resultado));
+    TEST_ASSERT_TRUE(resultado == destino);
+  }
+
+  // Un byte insertado alterado: la imagen no coincide con el hash firmado
+  Bytes alterado = delta;
+  alterado[sizeof(CabeceraDelta) + 9 + 5 + 100] ^= 0x01;
+  Bytes resultado;
+  TEST_ASSERT_FALSE(aplicarEnTrozos(alterado, origen, 512, resultado));
+
+  // Una copia fuera de la imagen en ejecución se rechaza sin leerla
+  Bytes fuera = delta;
+  fuera[sizeof(CabeceraDelta) + 5] = 0xFF;  // n de la primera copia
+  fuera[sizeof(CabeceraDelta) + 6] = 0xFF;
+  TEST_ASSERT_FALSE(aplicarEnTrozos(fuera, origen, 512, resultado));
+
+  // Datos tras el fin
+  Bytes sobrante = delta;
+  sobrante.push_back(DELTA_FIN);
+  TEST_ASSERT_FALSE(aplicarEnTrozos(sobrante, origen, 512, resultado));
+}
+
+void test_instalar_confirmar_y_revertir() {
+  Bytes origen = imagen(20000, 3);
+  Bytes destino;
+  Bytes delta = construirDelta(origen, 5000, aleatorios(3000, 4), destino);
+  grabarParticion(0, origen);
+
+  {
+    ActualizacionOTA ota(http);
+    ota.begin();
+    ota.solicitar("2.0.0");
+    TEST_ASSERT_TRUE(ota.descargaPendiente());
+    escribirArchivo(OTA_ARCHIVO, delta);
+    TEST_ASSERT_TRUE(ota.instalar());
+  }
+  TEST_ASSERT_EQUAL(1, ESP.reinicios);
+  TEST_ASSERT_EQUAL(1, ParticionesNativas::deArranque());
+  TEST_ASSERT_TRUE(particionContiene(1, destino));
+  TEST_ASSERT_FALSE(LittleFS.exists(OTA_ARCHIVO));
+
+  // Arranca la imagen nueva, a prueba; un reporte exitoso la confirma
+  ParticionesNativas::arrancar();
+  {
+    ActualizacionOTA ota(http);
+    ota.begin();
+    TEST_ASSERT_TRUE(ota.validando());
+    TEST_ASSERT_FALSE(ota.descargaPendiente());
+    ota.confirmarArranque();
+    TEST_ASSERT_FALSE(ota.validando());
+  }
+  {
+    ActualizacionOTA ota(http);
+    ota.begin();
+    TEST_ASSERT_FALSE(ota.validando());
+  }
+
+  // Otra instalación que nunca llega al servidor: pasado el plazo vuelve a app1
+  Bytes tercera;
+  Bytes delta2 = construirDelta(destino, 100, aleatorios(500, 5), tercera);
+  {
+    ActualizacionOTA ota(http);
+    ota.begin();
+    ota.solicitar("3.0.0");
+    escribirArchivo(OTA_ARCHIVO, delta2);
+    TEST_ASSERT_TRUE(ota.instalar());
+  }
+  TEST_ASSERT_EQUAL(0, ParticionesNativas::deArranque());
+  ParticionesNativas::arrancar();
+  {
+    ActualizacionOTA ota(http);
+    ota.begin();
+    TEST_ASSERT_TRUE(ota.validando());
+    fijarReloj(OTA_VALIDACION_MS - 1);
+    ota.atender();
+    TEST_ASSERT_EQUAL(0, ParticionesNativas::deArranque());
+    fijarReloj(OTA_VALIDACION_MS);
+    ota.atender();
+    TEST_ASSERT_FALSE(ota.validando());
+  }
+  TEST_ASSERT_EQUAL(1, ParticionesNativas::deArranque());
+  TEST_ASSERT_EQUAL(3, ESP.reinicios);
+}
+
+void test_revierte_tras_reinicios_sin_reportar() {
+  Bytes origen = imagen(8000, 6);
+  Bytes destino;
+  Bytes delta = construirDelta(origen, 4000, aleatorios(1000, 7), destino);
+  grabarParticion(0, origen);
+
+  {
+    ActualizacionOTA ota(http);
+    ota.begin();
+    ota.solicitar("2.0.0");
+    escribirArchivo(OTA_ARCHIVO, delta);
+    TEST_ASSERT_TRUE(ota.instalar());
+  }
+
+  // Cada arranque de la imagen a prueba cuenta; el siguiente al máximo vuelve a app0
+  for (int i = 0; i < OTA_ARRANQUES_MAX; i++) {
+    ParticionesNativas::arrancar();
+    ActualizacionOTA ota(http);
+    ota.begin();
+    TEST_ASSERT_TRUE(ota.validando());
+    TEST_ASSERT_EQUAL(1, ParticionesNativas::deArranque());
+  }
+  ParticionesNativas::arrancar();
+  {
+    ActualizacionOTA ota(http);
+    ota.begin();
+    TEST_ASSERT_FALSE(ota.validando());
+  }
+  TEST_ASSERT_EQUAL(0, ParticionesNativas::deArranque());
+  TEST_ASSERT_EQUAL(2, ESP.reinicios);
+
+  // Si el bootloader ya volvió solo, la imagen anterior marca la nueva como rechazada
+  ParticionesNativas::reiniciarTodo();
+  Preferences::borrarTodo();
+  grabarParticion(0, origen);
+  {
+    ActualizacionOTA ota(http);
+    ota.begin();
+    ota.solicitar("2.0.0");
+    escribirArchivo(OTA_ARCHIVO, delta);
+    TEST_ASSERT_TRUE(ota.instalar());
+  }
+  ParticionesNativas::deArranque() = 0;
+  ParticionesNativas::arrancar();
+  ActualizacionOTA ota(http);
+  ota.begin();
+  TEST_ASSERT_FALSE(ota.validando());
+  ota.solicitar("2.0.0");
+  TEST_ASSERT_FALSE(ota.descargaPendiente());
+}
+
+// Una petición con Range: CGACT, +HTTPACTION con 206 y el cuerpo en 'lecturas'
+// trozos de HTTP_LECTURA_BYTES desde 'desde'
+static void agregarRango(std::vector<RegistroUART>& registros, const Bytes& delta, size_t desde, size_t n,
+                         int lecturas) {
+  registros.push_back({'>', 0, "AT+CGACT?\r\n"});
+  registros.push_back({'<', 20, "\r\n+CGACT: 1,1\r\n\r\nOK\r\n"});
+  registros.push_back({'>', 0, "AT+HTTPACTION=0\r\n"});
+  registros.push_back({'<', 20, "\r\nOK\r\n"});
+  registros.push_back({'<', 900, "\r\n+HTTPACTION: 0,206," + std::to_string(n) + "\r\n"});
+  for (int i = 0; i < lecturas; i++) {
+    size_t inicio = desde + i * HTTP_LECTURA_BYTES;
+    size_t largo = std::min((size_t)HTTP_LECTURA_BYTES, desde + n - inicio);
+    std::string cuerpo(delta.begin() + inicio, delta.begin() + inicio + largo);
+    registros.push_back({'>', 0, "AT+HTTPREAD=\r\n"});
+    registros.push_back({'<', 30, "\r\nOK\r\n\r\n+HTTPREAD: " + std::to_string(largo) + "\r\n" + cuerpo +
+                                  "\r\n+HTTPREAD: 0\r\n"});
+  }
+}
+
+void test_descarga_reanudable_por_rangos() {
+  Bytes origen = imagen(30000, 8);
+  Bytes destino;
+  Bytes delta = construirDelta(origen, 10000, aleatorios(20000, 9), destino);
+  TEST_ASSERT_TRUE(delta.size() > OTA_BLOQUE_BYTES);
+  grabarParticion(0, origen);
+
+  ReproductorModem servidor;
+  CanalAT canalServidor(servidor);
+  GSMModule gsmServidor(canalServidor, PWR_PIN, RXD1_PIN, TXD1_PIN, BAUD_RATE);
+  HTTPClient cliente(gsmServidor, salidas);
+  ActualizacionOTA ota(cliente);
+  ota.begin();
+  ota.solicitar("2.0.0");
+
+  // Se pierde la cobertura tras 10 trozos del primer bloque: se conserva lo recibido
+  std::vector<RegistroUART> primero;
+  agregarRango(primero, delta, 0, OTA_BLOQUE_BYTES, 10);
+  servidor.cargar(primero);
+  TEST_ASSERT_TRUE(ota.descargarBloque());
+  TEST_ASSERT_EQUAL_UINT32(10 * HTTP_LECTURA_BYTES, ota.descargados());
+  TEST_ASSERT_EQUAL_UINT32(delta.size(), ota.totalDelta());
+
+  // Tras un reinicio se retoma desde el byte siguiente, hasta el final del delta
+  ActualizacionOTA retomada(cliente);
+  retomada.begin();
+  TEST_ASSERT_TRUE(retomada.descargaPendiente());
+  TEST_ASSERT_EQUAL_UINT32(delta.size(), retomada.totalDelta());
+
+  size_t desde = 10 * HTTP_LECTURA_BYTES;
+  size_t resto = delta.size() - desde;
+  std::vector<RegistroUART> segundo;
+  agregarRango(segundo, delta, desde, resto, (resto + HTTP_LECTURA_BYTES - 1) / HTTP_LECTURA_BYTES);
+  servidor.cargar(segundo);
+  TEST_ASSERT_TRUE(retomada.descargarBloque());
+
+  std::vector<std::string> rangos = servidor.enviadosCon("AT+HTTPPARA=\"USERDATA\"");
+  TEST_ASSERT_EQUAL(2, rangos.size());
+  TEST_ASSERT_EQUAL_STRING("AT+HTTPPARA=\"USERDATA\",\"Range: bytes=0-16383\"", rangos[0].c_str());
+  char esperado[64];
+  snprintf(esperado, sizeof(esperado), "AT+HTTPPARA=\"USERDATA\",\"Range: bytes=%u-%u\"", (unsigned)desde,
+           (unsigned)(delta.size() - 1));
+  TEST_ASSERT_EQUAL_STRING(esperado, rangos[1].c_str());
+  TEST_ASSERT_EQUAL_STRING("AT+HTTPREAD=0,512", servidor.enviadosCon("AT+HTTPREAD=")[0].c_str());
+
+  // Completo: instalado en app1 y reinicio
+  TEST_ASSERT_EQUAL(1, ESP.reinicios);
+  TEST_ASSERT_TRUE(particionContiene(1, destino));
+  TEST_ASSERT_FALSE(retomada.descargaPendiente());
+}
+
+static ColaSMS* colaEnCurso = NULL;
+
+static void procesarSMS() {
+  colaEnCurso->procesar();
+}
+
+static bool guardarBytes(const uint8_t* datos, size_t n, void* contexto) {
+  Bytes& b = *static_cast<Bytes*>(contexto);
+  b.insert(b.end(), datos, datos + n);
+  return true;
+}
+
+void test_sms_en_curso_durante_la_lectura_del_rango() {
+  Bytes delta = aleatorios(2 * HTTP_LECTURA_BYTES, 12);
+  std::vector<RegistroUART> registros;
+  agregarRango(registros, delta, 0, delta.size(), 2);
+  // La respuesta del SMS llega después del +HTTPACTION, cuando la primera lectura espera el canal
+  registros.push_back({'>', 0, "AT+CMGS=\"+527770000000\"\r\n"});
+  registros.push_back({'<', 100, "\r\n> "});
+  registros.push_back({'>', 0, "Apagado\x1A"});
+  registros.push_back({'<', 2000, "\r\n+CMGS: 57\r\n\r\nOK\r\n"});
+  ReproductorModem servidor(registros);
+  CanalAT canalServidor(servidor);
+  GSMModule gsmServidor(canalServidor, PWR_PIN, RXD1_PIN, TXD1_PIN, BAUD_RATE);
+  HTTPClient cliente(gsmServidor, salidas);
+  ColaSMS cola(canalServidor);
+  colaEnCurso = &cola;
+  canalServidor.setTareaFondo(procesarSMS);
+  TEST_ASSERT_TRUE(cola.encolar("+527770000000", "Apagado"));
+
+  Bytes recibido;
+  TEST_ASSERT_EQUAL_UINT32(delta.size(), cliente.descargarRango("/delta", 0, delta.size(), guardarBytes, &recibido));
+  TEST_ASSERT_TRUE(recibido == delta);
+
+  // "+CMGS: 57" no se toma por un cuerpo binario: el SMS sale una vez y sin esperar su timeout
+  TEST_ASSERT_FALSE(cola.ocupada());
+  TEST_ASSERT_EQUAL(0, cola.pendientes());
+  TEST_ASSERT_EQUAL(1, servidor.enviadosCon("AT+CMGS=").size());
+  TEST_ASSERT_TRUE(millis() < SMS_TIMEOUT_CMGS_MS);
+  canalServidor.setTareaFondo(NULL);
+  colaEnCurso = NULL;
+}
+
+void test_firma_invalida_rechaza_la_version() {
+  Bytes origen = imagen(4000, 10);
+  Bytes destino;
+  Bytes delta = construirDelta(origen, 2000, aleatorios(500, 11), destino);
+  delta[offsetof(CabeceraDelta, firma)] ^= 0x01;
+  grabarParticion(0, origen);
+
+  ActualizacionOTA ota(http);
+  ota.begin();
+  ota.solicitar("2.0.0");
+  escribirArchivo(OTA_ARCHIVO, delta);
+  TEST_ASSERT_FALSE(ota.instalar());
+  TEST_ASSERT_EQUAL(0, ESP.reinicios);
+  TEST_ASSERT_EQUAL(0, ParticionesNativas::deArranque());
+  TEST_ASSERT_FALSE(LittleFS.exists(OTA_ARCHIVO));
+
+  // La misma versión no se vuelve a descargar, ni tras un reinicio
+  ota.solicitar("2.0.0");
+  TEST_ASSERT_FALSE(ota.descargaPendiente());
+  ActualizacionOTA despues(http);
+  despues.begin();
+  despues.solicitar("2.0.0");
+  TEST_ASSERT_FALSE(despues.descargaPendiente());
+  despues.solicitar("2.0.1");
+  TEST_ASSERT_TRUE(despues.descargaPendiente());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_aplicar_delta_por_trozos);
+  RUN_TEST(test_instalar_confirmar_y_revertir);
+  RUN_TEST(test_revierte_tras_reinicios_sin_reportar);
+  RUN_TEST(test_descarga_reanudable_por_rangos);
+  RUN_TEST(test_sms_en_curso_durante_la_lectura_del_rango);
+  RUN_TEST(test_firma_invalida_rechaza_la_version);
+  return UNITY_END();
+}
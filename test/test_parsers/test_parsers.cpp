@@ -0,0 +1,311 @@
+// Parsers de respuestas del módem, alimentados con transcripciones de test/fixtures
+#include <unity.h>
+#include <Arduino.h>
+#include <Preferences.h>
+#include "CanalAT.h"
+#include "GPSModule.h"
+#include "RelojGNSS.h"
+#include "GSMModule.h"
+#include "HTTPClient.h"
+#include "ColaReportes.h"
+#include "ControlSalidas.h"
+#include "ColaSMS.h"
+#include "ListaAutorizados.h"
+#include "ControlSMS.h"
+#include "ReproductorModem.h"
+
+#define FIXTURES "test/fixtures/"
+
+// ListaAutorizados ocupa ~24 KB: fuera de la pila
+static ListaAutorizados lista;
+
+void setUp() {
+  Preferences::borrarTodo();
+  fijarReloj(0);
+}
+
+void tearDown() {}
+
+static void avanzarHasta(CanalAT& canal, ControlSMS& control, unsigned long ms) {
+  unsigned long fin = millis() + ms;
+  while (millis() < fin) {
+    canal.atender();
+    control.atender();
+    delay(10);
+  }
+}
+
+static std::vector<std::string> cuerposSMS(const std::vector<std::string>& comandos) {
+  std::vector<std::string> r;
+  for (size_t i = 0; i < comandos.size(); i++) {
+    if (!comandos[i].empty() && comandos[i].back() == 26) r.push_back(comandos[i]);
+  }
+  return r;
+}
+
+void test_cgnssinfo_casos() {
+  ReproductorModem modem;
+  TEST_ASSERT_TRUE(modem.cargarArchivo(FIXTURES "gnss_casos.txt"));
+  CanalAT canal(modem);
+  RelojGNSS reloj;
+  GPSModule gps(canal, reloj);
+
+  GpsData d = gps.obtenerCoordenadas(1);
+  TEST_ASSERT_TRUE(d.valida);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 18.926124, d.lat);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, -99.2307125, d.lon);
+  TEST_ASSERT_EQUAL(16, d.satelites);
+  TEST_ASSERT_EQUAL_UINT32(1714558210UL, d.utc);  // 2024-05-01 10:10:10 UTC
+  // El fix ancla el reloj: su instante monótono corresponde a su hora GNSS
+  TEST_ASSERT_TRUE(reloj.sincronizado());
+  TEST_ASSERT_EQUAL_UINT32(d.utc, reloj.utcDe(d.monotono));
+  TEST_ASSERT_EQUAL(250, GPSModule::milisegundos("101010.25"));
+  TEST_ASSERT_EQUAL(0, GPSModule::milisegundos("101010"));
+
+  d = gps.obtenerCoordenadas(1);
+  TEST_ASSERT_FALSE(d.valida);
+  TEST_ASSERT_EQUAL(0, d.satelites);
+
+  d = gps.obtenerCoordenadas(1);
+  TEST_ASSERT_FALSE(d.valida);
+  TEST_ASSERT_EQUAL(4, d.satelites);
+
+  d = gps.obtenerCoordenadas(1);
+  TEST_ASSERT_TRUE(d.valida);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, -33.8688197, d.lat);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 151.2092955, d.lon);
+  TEST_ASSERT_EQUAL(16, d.satelites);
+
+  d = gps.obtenerCoordenadas(1);
+  TEST_ASSERT_FALSE(d.valida);
+
+  TEST_ASSERT_EQUAL(0, modem.desconocidos().size());
+
+  TEST_ASSERT_EQUAL_UINT32(951868799UL, GPSModule::segundosUnix("290200", "235959.00"));
+  TEST_ASSERT_EQUAL_UINT32(0, GPSModule::segundosUnix("320124", "101010.00"));
+  TEST_ASSERT_EQUAL_UINT32(0, GPSModule::segundosUnix("", ""));
+}
+
+void test_http_respuestas() {
+  ReproductorModem modem;
+  TEST_ASSERT_TRUE(modem.cargarArchivo(FIXTURES "http_respuestas.txt"));
+  CanalAT canal(modem);
+  GSMModule gsm(canal, PWR_PIN, RXD1_PIN, TXD1_PIN, BAUD_RATE);
+  ControlSalidas salidas(PIN_ACTIVE, PIN_INACTIVE);
+  HTTPClient http(gsm, salidas);
+  ColaReportes reportes;
+  salidas.begin();
+  reportes.begin();
+
+  // Tres fixes en cola: una sola petición con el más nuevo y los otros dos como lote
+  reportes.agregar(18.926124, -99.230713, -1.0, 1714558210UL);
+  reportes.agregar(18.927, -99.231, -1.0, 1714558240UL);
+  reportes.agregar(18.928, -99.232, 12.5, 1714558270UL);
+  TEST_ASSERT_TRUE(http.enviarReportes(reportes));
+  TEST_ASSERT_TRUE(salidas.estaActivo());
+  TEST_ASSERT_EQUAL(2, http.reportesEnLote());
+  TEST_ASSERT_EQUAL(0, http.ultimoAck());
+  TEST_ASSERT_EQUAL_STRING("", http.otaSolicitada());
+  TEST_ASSERT_EQUAL(DATOS_BYTES_TCP + DATOS_BYTES_TLS_BAJADA + DATOS_BYTES_CABECERAS_BAJADA + 27,
+                    http.ultimoConsumo().bajada);
+  reportes.confirmarEnvio(http.reportesEnLote(), http.ultimoAck());
+  TEST_ASSERT_EQUAL(0, reportes.pendientes());
+
+  // "ack":4 confirma el envío; "ota" ofrece una versión
+  reportes.agregar(18.929, -99.233, -1.0, 1714558300UL);
+  TEST_ASSERT_TRUE(http.enviarReportes(reportes));
+  TEST_ASSERT_FALSE(salidas.estaActivo());
+  TEST_ASSERT_EQUAL(4, http.ultimoAck());
+  TEST_ASSERT_EQUAL_STRING("1.1.0", http.otaSolicitada());
+  reportes.confirmarEnvio(http.reportesEnLote(), http.ultimoAck());
+  TEST_ASSERT_EQUAL(0, reportes.pendientes());
+
+  // 715: fallo TLS, sin cuerpo que leer y sin tocar las salidas; el fix queda en cola
+  Reporte r5 = reportes.agregar(18.93, -99.234, -1.0, 1714558330UL);
+  TEST_ASSERT_FALSE(http.enviarReportes(reportes));
+  TEST_ASSERT_EQUAL(ENVIO_TLS, http.ultimoResultado());
+  TEST_ASSERT_EQUAL(715, http.ultimoCodigoHTTP());
+  TEST_ASSERT_EQUAL_STRING("", http.otaSolicitada());
+  TEST_ASSERT_FALSE(salidas.estaActivo());
+  TEST_ASSERT_EQUAL(DATOS_BYTES_TCP + DATOS_BYTES_TLS_SUBIDA, http.ultimoConsumo().subida);
+
+  // El heartbeat del mismo fix conserva su secuencia: no hay duplicado
+  TEST_ASSERT_EQUAL(r5.secuencia, reportes.agregar(18.93, -99.234, -1.0, 1714558330UL).secuencia);
+  TEST_ASSERT_EQUAL(1, reportes.pendientes());
+
+  // Sin ack solo sale el enviado; con ack, todo lo confirmado
+  reportes.agregar(18.931, -99.235, -1.0, 1714558360UL);
+  reportes.agregar(18.932, -99.236, -1.0, 1714558390UL);
+  reportes.confirmarEnvio(0, 0);
+  TEST_ASSERT_EQUAL(2, reportes.pendientes());
+  reportes.confirmarEnvio(0, 5);
+  TEST_ASSERT_EQUAL(0, reportes.pendientes());
+
+  // La secuencia sobrevive al reinicio
+  ColaReportes trasReinicio;
+  trasReinicio.begin();
+  TEST_ASSERT_EQUAL(8, trasReinicio.agregar(18.933, -99.237, -1.0, 0).secuencia);
+
+  std::vector<std::string> esperadas = modem.grabadosCon("AT+HTTPPARA=\"URL\"");
+  std::vector<std::string> enviadas = modem.enviadosCon("AT+HTTPPARA=\"URL\"");
+  TEST_ASSERT_EQUAL(esperadas.size(), enviadas.size());
+  for (size_t i = 0; i < esperadas.size(); i++) {
+    TEST_ASSERT_EQUAL_STRING(esperadas[i].c_str(), enviadas[i].c_str());
+  }
+  TEST_ASSERT_EQUAL(2, modem.enviadosCon("AT+HTTPREAD=").size());
+  TEST_ASSERT_EQUAL(6, modem.enviadosCon("AT+HTTPTERM").size());  // Antes y después de cada sesión
+  TEST_ASSERT_EQUAL(0, modem.desconocidos().size());
+}
+
+// Sesión de reporte cuya respuesta trae 'cuerpo'; el resto de los comandos responde OK
+static std::vector<RegistroUART> sesionConCuerpo(const std::string& cuerpo) {
+  std::string largo = std::to_string(cuerpo.size());
+  std::vector<RegistroUART> grabacion;
+  grabacion.push_back({ '>', 0, "AT+CGACT?\r\n" });
+  grabacion.push_back({ '<', 20, "\r\n+CGACT: 1,1\r\n\r\nOK\r\n" });
+  grabacion.push_back({ '>', 0, "AT+HTTPACTION=0\r\n" });
+  grabacion.push_back({ '<', 20, "\r\nOK\r\n" });
+  grabacion.push_back({ '<', 1850, "\r\n+HTTPACTION: 0,200," + largo + "\r\n" });
+  grabacion.push_back({ '>', 5, "AT+HTTPREAD=0," + largo + "\r\n" });
+  grabacion.push_back({ '<', 20, "\r\nOK\r\n\r\n+HTTPREAD: " + largo + "\r\n" + cuerpo + "\r\n+HTTPREAD: 0\r\n" });
+  return grabacion;
+}
+
+void test_lista_desde_el_servidor() {
+  ControlSalidas salidas(PIN_ACTIVE, PIN_INACTIVE);
+  ColaReportes reportes;
+  salidas.begin();
+  reportes.begin();
+  reportes.agregar(18.926124, -99.230713, -1.0, 1714558210UL);
+
+  ReproductorModem modem(sesionConCuerpo(
+      "{\"isActive\":true,\"allow\":\"+527771112233\",\"role\":\"localizar\",\"revoke\":\"+527779998877\"}"));
+  CanalAT canal(modem);
+  GSMModule gsm(canal, PWR_PIN, RXD1_PIN, TXD1_PIN, BAUD_RATE);
+  HTTPClient http(gsm, salidas);
+  TEST_ASSERT_TRUE(http.enviarReportes(reportes));
+  TEST_ASSERT_EQUAL_STRING("+527771112233", http.altaSolicitada());
+  TEST_ASSERT_EQUAL(ROL_LOCALIZAR, http.rolSolicitado());
+  TEST_ASSERT_EQUAL_STRING("+527779998877", http.bajaSolicitada());
+
+  // Sin "role" el alta es de control, como "Alta" por SMS; un rol desconocido la descarta
+  ReproductorModem sinRol(sesionConCuerpo("{\"isActive\":true,\"allow\":\"+527771112233\"}"));
+  CanalAT canalSinRol(sinRol);
+  GSMModule gsmSinRol(canalSinRol, PWR_PIN, RXD1_PIN, TXD1_PIN, BAUD_RATE);
+  HTTPClient httpSinRol(gsmSinRol, salidas);
+  TEST_ASSERT_TRUE(httpSinRol.enviarReportes(reportes));
+  TEST_ASSERT_EQUAL(ROL_CONTROL, httpSinRol.rolSolicitado());
+  TEST_ASSERT_EQUAL_STRING("", httpSinRol.bajaSolicitada());
+
+  ReproductorModem rolMalo(sesionConCuerpo("{\"isActive\":true,\"allow\":\"+527771112233\",\"role\":\"root\"}"));
+  CanalAT canalRolMalo(rolMalo);
+  GSMModule gsmRolMalo(canalRolMalo, PWR_PIN, RXD1_PIN, TXD1_PIN, BAUD_RATE);
+  HTTPClient httpRolMalo(gsmRolMalo, salidas);
+  TEST_ASSERT_TRUE(httpRolMalo.enviarReportes(reportes));
+  TEST_ASSERT_EQUAL_STRING("", httpRolMalo.altaSolicitada());
+}
+
+void test_senal_casos() {
+  CalidadSenal s;
+  memset(&s, 0, sizeof(s));
+  TEST_ASSERT_TRUE(GSMModule::parsearCSQ("\r\n+CSQ: 18,99\r\n\r\nOK\r\n", s));
+  TEST_ASSERT_EQUAL(18, s.csq);
+  TEST_ASSERT_EQUAL(-77, s.rssi);
+  TEST_ASSERT_EQUAL(ENLACE_BUENO, GSMModule::clasificarEnlace(s));
+  TEST_ASSERT_TRUE(GSMModule::parsearCSQ("+CSQ: 3,99", s));
+  TEST_ASSERT_EQUAL(ENLACE_MALO, GSMModule::clasificarEnlace(s));
+  TEST_ASSERT_TRUE(GSMModule::parsearCSQ("+CSQ: 99,99", s));
+  TEST_ASSERT_EQUAL(ENLACE_DESCONOCIDO, GSMModule::clasificarEnlace(s));
+  TEST_ASSERT_FALSE(GSMModule::parsearCSQ("+CSQ: 45,99", s));
+  TEST_ASSERT_FALSE(GSMModule::parsearCSQ("ERROR", s));
+
+  // LTE en décimas (RSRQ -9.4 dB, RSRP -85.0 dBm): manda sobre el CSQ
+  TEST_ASSERT_TRUE(GSMModule::parsearCPSI(
+      "+CPSI: LTE,Online,334-020,0x1A2B,12345678,123,EUTRAN-BAND4,2175,5,5,-94,-850,-545,15\r\n", s));
+  TEST_ASSERT_TRUE(s.lte);
+  TEST_ASSERT_EQUAL(-9, s.rsrq);
+  TEST_ASSERT_EQUAL(-85, s.rsrp);
+  TEST_ASSERT_EQUAL(15, s.sinr);
+  TEST_ASSERT_EQUAL(ENLACE_BUENO, GSMModule::clasificarEnlace(s));
+
+  // Celda lejana con interferencia, valores en unidades enteras
+  TEST_ASSERT_TRUE(GSMModule::parsearCPSI(
+      "+CPSI: LTE,Online,334-020,0x1A2B,12345678,123,EUTRAN-BAND4,2175,5,5,-15,-118,-90,-3", s));
+  TEST_ASSERT_EQUAL(-118, s.rsrp);
+  TEST_ASSERT_EQUAL(ENLACE_MALO, GSMModule::clasificarEnlace(s));
+  s.rsrp = -108;
+  s.sinr = 4;
+  TEST_ASSERT_EQUAL(ENLACE_REGULAR, GSMModule::clasificarEnlace(s));
+
+  memset(&s, 0, sizeof(s));
+  s.csq = 99;
+  TEST_ASSERT_TRUE(GSMModule::parsearCPSI("+CPSI: NO SERVICE,Online", s));
+  TEST_ASSERT_EQUAL(ENLACE_SIN_SERVICIO, GSMModule::clasificarEnlace(s));
+  TEST_ASSERT_FALSE(GSMModule::parsearCPSI("+CPSI: LTE,Online,334-020,0x1A2B", s));
+}
+
+void test_cmgl_comandos() {
+  ReproductorModem modem;
+  TEST_ASSERT_TRUE(modem.cargarArchivo(FIXTURES "sms_cmgl.txt"));
+  CanalAT canal(modem);
+  ColaSMS cola(canal);
+  ControlSalidas salidas(PIN_ACTIVE, PIN_INACTIVE);
+  ControlSMS control(canal, cola, lista, salidas);
+
+  salidas.begin();
+  lista.begin();
+  TEST_ASSERT_TRUE(lista.agregar("+527771234567", ROL_ADMIN));
+  control.begin();
+
+  avanzarHasta(canal, control, 20000);
+
+  // Apagar (admin) enciende el relevador; Prender (no autorizado) no lo toca
+  TEST_ASSERT_TRUE(salidas.estaActivo());
+
+  std::vector<std::string> borrados = modem.enviadosCon("AT+CMGD=");
+  TEST_ASSERT_EQUAL(3, borrados.size());
+  TEST_ASSERT_EQUAL_STRING("AT+CMGD=3", borrados[0].c_str());
+  TEST_ASSERT_EQUAL_STRING("AT+CMGD=4", borrados[1].c_str());
+  TEST_ASSERT_EQUAL_STRING("AT+CMGD=5", borrados[2].c_str());
+
+  // Las respuestas salen en el orden grabado: destinatario y cuerpo + Ctrl+Z
+  std::vector<std::string> esperados = modem.grabadosCon("AT+CMGS=");
+  std::vector<std::string> enviados = modem.enviadosCon("AT+CMGS=");
+  TEST_ASSERT_EQUAL(esperados.size(), enviados.size());
+  for (size_t i = 0; i < esperados.size(); i++) {
+    TEST_ASSERT_EQUAL_STRING(esperados[i].c_str(), enviados[i].c_str());
+  }
+  esperados = cuerposSMS(modem.grabadosCon(""));
+  enviados = cuerposSMS(modem.enviados());
+  TEST_ASSERT_EQUAL(3, enviados.size());
+  for (size_t i = 0; i < esperados.size(); i++) {
+    TEST_ASSERT_EQUAL_STRING(esperados[i].c_str(), enviados[i].c_str());
+  }
+  TEST_ASSERT_EQUAL(0, modem.desconocidos().size());
+  TEST_ASSERT_EQUAL(0, cola.pendientes());
+}
+
+void test_comando_demasiado_largo() {
+  ReproductorModem modem;
+  CanalAT canal(modem);
+
+  // La plantilla cabe (verificado al compilar) pero el argumento desborda el búfer
+  std::string largo(AT_LONGITUD_COMANDO, 'x');
+  TEST_ASSERT_EQUAL(AT_ERROR, canal.ejecutar(AT_HTTPPARA_URL, largo.c_str()));
+  TEST_ASSERT_EQUAL(0, modem.enviados().size());
+
+  TEST_ASSERT_EQUAL(AT_OK, canal.ejecutar(AT_CMGD, 7));
+  TEST_ASSERT_EQUAL(1, modem.enviados().size());
+  TEST_ASSERT_EQUAL_STRING("AT+CMGD=7", modem.enviados()[0].c_str());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_cgnssinfo_casos);
+  RUN_TEST(test_http_respuestas);
+  RUN_TEST(test_lista_desde_el_servidor);
+  RUN_TEST(test_senal_casos);
+  RUN_TEST(test_cmgl_comandos);
+  RUN_TEST(test_comando_demasiado_largo);
+  return UNITY_END();
+}
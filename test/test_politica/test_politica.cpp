@@ -0,0 +1,203 @@
+// Política de reporte extraída del ciclo principal y su simulación sobre trazas:
+// regla por distancia, lecturas y heartbeat, regla por estima y barrido de parámetros
+#include <unity.h>
+#include <Arduino.h>
+#include <math.h>
+#include <vector>
+#include "GeoUtils.h"
+#include "PoliticaReporte.h"
+#include "../../simulador/SimulacionPolitica.h"
+
+#define T0 1714558222UL
+#define LAT0 18.9261130
+#define LON0 (-99.2307330)
+
+static ParametrosPolitica parametros(bool estima) {
+  ParametrosPolitica p = { 25.0, 20000, 5000, 300000, estima, 25.0, 300000, 8.0f };
+  return p;
+}
+
+// Metros al este de LON0 sobre el paralelo de LAT0, con la esfera de calcularDistancia()
+static double alEste(double metros) {
+  return LON0 + metros / (6371000.0 * M_PI / 180.0 * cos(LAT0 * M_PI / 180.0));
+}
+
+static FixPolitica fix(uint32_t segundos, double metrosEste, float velocidad, float rumbo) {
+  FixPolitica f = { LAT0, alEste(metrosEste), (uint32_t)(T0 + segundos), 0, velocidad, rumbo, 1000ULL * segundos + 1 };
+  return f;
+}
+
+// Lo que hace enviarYActualizar() cuando el reporte sale
+static void reportar(PoliticaReporte& politica, const DecisionReporte& d, unsigned long ahoraMs) {
+  const FixPolitica& f = politica.getActual();
+  politica.fijarReportado(f.lat, f.lon, politica.armarBase(f.lat, f.lon, d.velocidad, d.rumbo, f.utc), f.monotono);
+  politica.marcarEnvio(ahoraMs);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_regla_por_distancia() {
+  PoliticaReporte politica(parametros(false));
+  politica.iniciar(0);
+  DecisionReporte d = politica.evaluarFix(fix(20, 0, 0.3f, 45.0f));
+  TEST_ASSERT_EQUAL(REPORTE_PRIMER_FIX, d.motivo);
+  TEST_ASSERT_TRUE(d.urgente);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, -1.0f, d.velocidad);  // Sin estima no viajan velocidad ni rumbo del GNSS
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, -1.0f, d.rumbo);
+  reportar(politica, d, 20000);
+
+  // Ruido estacionado por debajo del umbral
+  d = politica.evaluarFix(fix(40, 12, 0.3f, -1.0f));
+  TEST_ASSERT_EQUAL(REPORTE_NINGUNO, d.motivo);
+  TEST_ASSERT_FLOAT_WITHIN(0.5, 12, d.metros);
+
+  // Arranque tras más de un heartbeat quieto: urgente, con la velocidad media del tramo
+  d = politica.evaluarFix(fix(400, 380, 50.0f, 90.0f));
+  TEST_ASSERT_EQUAL(REPORTE_MOVIMIENTO, d.motivo);
+  TEST_ASSERT_TRUE(d.urgente);
+  TEST_ASSERT_FLOAT_WITHIN(0.1, 380 / 380.0 * 3.6, d.velocidad);
+  reportar(politica, d, 400000);
+
+  d = politica.evaluarFix(fix(420, 680, 54.0f, 90.0f));
+  TEST_ASSERT_EQUAL(REPORTE_MOVIMIENTO, d.motivo);
+  TEST_ASSERT_FALSE(d.urgente);
+  TEST_ASSERT_FLOAT_WITHIN(0.2, 54.0, d.velocidad);
+  reportar(politica, d, 420000);
+
+  // Con presión sobre el presupuesto el umbral se multiplica
+  TEST_ASSERT_EQUAL(REPORTE_NINGUNO, politica.evaluarFix(fix(440, 720, 7.0f, 90.0f), 2).motivo);
+  TEST_ASSERT_EQUAL(REPORTE_MOVIMIENTO, politica.evaluarFix(fix(460, 740, 7.0f, 90.0f), 1).motivo);
+}
+
+void test_lecturas_y_heartbeat() {
+  PoliticaReporte politica(parametros(false));
+  politica.iniciar(1000);
+  TEST_ASSERT_FALSE(politica.tocaLectura(20999, false));
+  TEST_ASSERT_TRUE(politica.tocaLectura(21000, false));
+  TEST_ASSERT_FALSE(politica.tocaLectura(25999, true));
+  TEST_ASSERT_TRUE(politica.tocaLectura(26000, true));  // Con un Localizar pendiente
+
+  // Sin ningún fix el heartbeat solo reinicia la espera
+  TEST_ASSERT_EQUAL(HEARTBEAT_PENDIENTE, politica.evaluarHeartbeat(300999));
+  TEST_ASSERT_EQUAL(HEARTBEAT_SIN_FIX, politica.evaluarHeartbeat(301000));
+  TEST_ASSERT_EQUAL(HEARTBEAT_PENDIENTE, politica.evaluarHeartbeat(302000));
+
+  DecisionReporte d = politica.evaluarFix(fix(310, 0, -1.0f, -1.0f));
+  reportar(politica, d, 310000);
+  politica.evaluarFix(fix(330, 0, -1.0f, -1.0f));
+  TEST_ASSERT_EQUAL(HEARTBEAT_SIN_CAMBIO, politica.evaluarHeartbeat(610000));
+  TEST_ASSERT_EQUAL(HEARTBEAT_PENDIENTE, politica.evaluarHeartbeat(700000));
+
+  // Movido por debajo del umbral: el heartbeat lo reporta, con factor 2 el doble de tarde
+  TEST_ASSERT_EQUAL(REPORTE_NINGUNO, politica.evaluarFix(fix(620, 10, -1.0f, -1.0f)).motivo);
+  TEST_ASSERT_EQUAL(HEARTBEAT_ENVIAR, politica.evaluarHeartbeat(910000));
+  TEST_ASSERT_EQUAL(HEARTBEAT_PENDIENTE, politica.evaluarHeartbeat(910000, 2));
+  d = politica.reporteActual();
+  TEST_ASSERT_EQUAL(REPORTE_HEARTBEAT, d.motivo);
+  reportar(politica, d, 910000);
+  TEST_ASSERT_EQUAL(HEARTBEAT_PENDIENTE, politica.evaluarHeartbeat(1209999));
+  TEST_ASSERT_EQUAL(HEARTBEAT_SIN_CAMBIO, politica.evaluarHeartbeat(1210000));
+}
+
+void test_regla_por_estima() {
+  PoliticaReporte politica(parametros(true));
+  politica.iniciar(0);
+  DecisionReporte d = politica.evaluarFix(fix(0, 0, 72.0f, 90.0f));
+  TEST_ASSERT_EQUAL(REPORTE_PRIMER_FIX, d.motivo);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 90.0f, d.rumbo);
+  reportar(politica, d, 0);
+
+  // 72 km/h al este: la predicción acierta
+  for (uint32_t t = 20; t <= 200; t += 20) {
+    d = politica.evaluarFix(fix(t, 20.0 * t, 72.0f, 90.0f));
+    TEST_ASSERT_EQUAL(REPORTE_NINGUNO, d.motivo);
+    TEST_ASSERT_TRUE(d.metros < 1.0);
+  }
+  // Frenó: se aparta de lo previsto y reporta con su velocidad y rumbo
+  d = politica.evaluarFix(fix(220, 4100, 10.0f, 90.0f));
+  TEST_ASSERT_EQUAL(REPORTE_DESVIO_ESTIMA, d.motivo);
+  TEST_ASSERT_FALSE(d.urgente);
+  TEST_ASSERT_FLOAT_WITHIN(1.0, 300, d.metros);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 220, d.segundos);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 10.0f, d.velocidad);
+  reportar(politica, d, 220000);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 90.0f, politica.reporteActual().rumbo);
+
+  // Se detiene: sin rumbo el servidor no extrapola; arrancar tras un heartbeat es urgente
+  d = politica.evaluarFix(fix(240, 4150, 0.0f, 90.0f));
+  TEST_ASSERT_EQUAL(REPORTE_NINGUNO, d.motivo);
+  d = politica.evaluarFix(fix(260, 4150, 0.0f, -1.0f));
+  TEST_ASSERT_EQUAL(REPORTE_DESVIO_ESTIMA, d.motivo);
+  reportar(politica, d, 260000);
+  d = politica.evaluarFix(fix(600, 4200, 30.0f, 90.0f));
+  TEST_ASSERT_EQUAL(REPORTE_DESVIO_ESTIMA, d.motivo);
+  TEST_ASSERT_TRUE(d.urgente);
+}
+
+// 5 min estacionado y 20 min a 40 km/h con una vuelta cada 4 min, a 1 Hz
+static std::vector<MuestraTraza> trazaReparto() {
+  std::vector<MuestraTraza> traza;
+  double lat = LAT0, lon = LON0;
+  float rumbo = 0;
+  for (uint32_t t = 0; t < 1500; t++) {
+    float velocidad = 0;
+    if (t >= 300) {
+      if ((t - 300) % 240 == 0) {
+        rumbo = fmodf(rumbo + 90, 360);
+      }
+      velocidad = 40;
+      BaseEstima b = { lat, lon, velocidad, rumbo, 0 };
+      predecirPosicion(b, 1, lat, lon);
+    }
+    MuestraTraza m = { (uint32_t)(T0 + t), 0, lat, lon, velocidad, t >= 300 ? rumbo : -1.0f };
+    traza.push_back(m);
+  }
+  return traza;
+}
+
+void test_simulacion_sobre_traza() {
+  std::vector<MuestraTraza> traza = trazaReparto();
+  CostoSesion costo = { 6500, 60 };
+  ResultadoSimulacion lento, rapido, estima;
+  memset(&lento, 0, sizeof(lento));
+  memset(&rapido, 0, sizeof(rapido));
+  memset(&estima, 0, sizeof(estima));
+
+  ParametrosPolitica p = parametros(false);
+  simularTraza(traza.data(), traza.size(), p, costo, 900, lento);
+  p.lecturaMs = 5000;
+  simularTraza(traza.data(), traza.size(), p, costo, 900, rapido);
+  p.estima = true;
+  simularTraza(traza.data(), traza.size(), p, costo, 900, estima);
+
+  // Por distancia, el primer fix y un reporte por lectura en marcha salvo la del arranque (11 m)
+  TEST_ASSERT_EQUAL(1 + 59, lento.reportes);
+  TEST_ASSERT_EQUAL(1 + 239, rapido.reportes);
+  TEST_ASSERT_EQUAL(0, lento.heartbeats);
+  TEST_ASSERT_TRUE(lento.bytes > 60ULL * 6560 && lento.bytes < 60ULL * 6700);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 1499, lento.segundos);
+
+  // El error queda por debajo de lo recorrido entre lecturas
+  TEST_ASSERT_TRUE(lento.errorMax > 200 && lento.errorMax <= 20 * 40 / 3.6 + 1);
+  TEST_ASSERT_TRUE(rapido.errorMax <= 5 * 40 / 3.6 + 1);
+  TEST_ASSERT_TRUE(rapido.errorMedio() < lento.errorMedio());
+
+  // Por estima, en línea recta no hace falta reportar: solo arranque, vueltas y el intervalo máximo
+  TEST_ASSERT_TRUE(estima.reportes <= 8);
+  // En una vuelta la predicción sigue de frente hasta la siguiente lectura: el error máximo es ese tramo
+  TEST_ASSERT_TRUE(estima.errorMax <= 5 * 40 / 3.6 * sqrt(2.0) + 1);
+  TEST_ASSERT_TRUE(estima.errorMedio() < rapido.errorMedio() / 10);
+  // El error cuenta desde el primer reporte, con la primera lectura
+  TEST_ASSERT_EQUAL(1500 - 20, lento.muestras);
+  TEST_ASSERT_EQUAL(1500 - 5, estima.muestras);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_regla_por_distancia);
+  RUN_TEST(test_lecturas_y_heartbeat);
+  RUN_TEST(test_regla_por_estima);
+  RUN_TEST(test_simulacion_sobre_traza);
+  return UNITY_END();
+}
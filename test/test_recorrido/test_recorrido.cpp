@@ -0,0 +1,166 @@
+// Firmware completo (setup/loop de findme32.cpp) contra un recorrido grabado:
+// qué lecturas se reportan y con qué campos se fija aquí, a partir de las
+// lecturas de la grabación, no solo comparando con los comandos grabados
+#include <unity.h>
+#include <Arduino.h>
+#include <Preferences.h>
+#include <fstream>
+#include <stdlib.h>
+#include "GeoUtils.h"
+#include "GPSModule.h"
+#include "ListaAutorizados.h"
+#include "ReproductorModem.h"
+
+#define FIXTURES "test/fixtures/"
+
+// Límite de tiempo virtual por si el firmware deja de consumir la grabación
+#define RECORRIDO_MAX_MS (60UL * 60 * 1000)
+
+static ReproductorModem modem;
+HardwareSerial& Serial1 = modem;
+
+extern ListaAutorizados listaAutorizados;
+void setup();
+void loop();
+
+void setUp() {}
+void tearDown() {}
+
+struct Lectura {
+  std::string lat;  // Con 6 decimales y signo, como en la URL
+  std::string lon;
+  double latGrados;
+  double lonGrados;
+  uint32_t utc;
+};
+
+// Respuestas +CGNSSINFO con fix de la grabación, en orden
+static std::vector<Lectura> lecturasGrabadas(const char* ruta) {
+  std::vector<Lectura> lecturas;
+  std::ifstream archivo(ruta);
+  std::string linea;
+  while (std::getline(archivo, linea)) {
+    size_t inicio = linea.find("+CGNSSINFO: 3,");
+    if (inicio == std::string::npos) {
+      continue;
+    }
+    std::vector<std::string> campos;
+    size_t desde = inicio + 12;
+    for (size_t coma; (coma = linea.find(',', desde)) != std::string::npos; desde = coma + 1) {
+      campos.push_back(linea.substr(desde, coma - desde));
+    }
+    Lectura l;
+    l.latGrados = strtod(campos[5].c_str(), NULL) * (campos[6] == "S" ? -1 : 1);
+    l.lonGrados = strtod(campos[7].c_str(), NULL) * (campos[8] == "W" ? -1 : 1);
+    char texto[16];
+    snprintf(texto, sizeof(texto), "%.6f", l.latGrados);
+    l.lat = texto;
+    snprintf(texto, sizeof(texto), "%.6f", l.lonGrados);
+    l.lon = texto;
+    l.utc = GPSModule::segundosUnix(campos[9].c_str(), campos[10].c_str());
+    lecturas.push_back(l);
+  }
+  return lecturas;
+}
+
+// Valor de 'nombre' en la URL de un AT+HTTPPARA="URL"; vacío si no está
+static std::string parametro(const std::string& comando, const char* nombre) {
+  std::string clave = std::string(nombre) + "=";
+  size_t pos = comando.find("?" + clave);
+  if (pos == std::string::npos) {
+    pos = comando.find("&" + clave);
+  }
+  if (pos == std::string::npos) {
+    return "";
+  }
+  pos += clave.size() + 1;
+  return comando.substr(pos, comando.find_first_of("&\"", pos) - pos);
+}
+
+static uint32_t numero(const std::string& texto) {
+  return strtoul(texto.c_str(), NULL, 10);
+}
+
+static void compararEnviados(const char* prefijo) {
+  std::vector<std::string> esperados = modem.grabadosCon(prefijo);
+  std::vector<std::string> enviados = modem.enviadosCon(prefijo);
+  TEST_ASSERT_EQUAL(esperados.size(), enviados.size());
+  for (size_t i = 0; i < esperados.size(); i++) {
+    TEST_ASSERT_EQUAL_STRING(esperados[i].c_str(), enviados[i].c_str());
+  }
+}
+
+void test_recorrido_urbano() {
+  TEST_ASSERT_TRUE(modem.cargarArchivo(FIXTURES "recorrido_urbano.txt"));
+
+  // El número autorizado de la grabación; la plantilla de config.h no tiene uno válido
+  listaAutorizados.begin();
+  TEST_ASSERT_TRUE(listaAutorizados.agregar("+527771234567", ROL_ADMIN));
+
+  setup();
+  while (modem.respuestasRestantes("AT+CGNSSINFO") > 0 && millis() < RECORRIDO_MAX_MS) {
+    loop();
+  }
+  TEST_ASSERT_EQUAL(0, modem.respuestasRestantes("AT+CGNSSINFO"));
+
+  // Lecturas cada 20 s: 6 estacionado, 15 tramos de ~100 m y el resto estacionado.
+  // Se reportan el primer fix (1), cada tramo (7 a 21) y, a los 5 min sin envíos,
+  // el último fix si se movió: la 36 (ruido de 1-3 m) y la 51. De la 46 en
+  // adelante las lecturas son idénticas: no hay un tercer heartbeat.
+  std::vector<Lectura> lecturas = lecturasGrabadas(FIXTURES "recorrido_urbano.txt");
+  TEST_ASSERT_EQUAL(65, lecturas.size());
+  std::vector<int> reportadas;
+  reportadas.push_back(1);
+  for (int i = 7; i <= 21; i++) {
+    reportadas.push_back(i);
+  }
+  reportadas.push_back(36);
+  reportadas.push_back(51);
+
+  std::vector<std::string> urls = modem.enviadosCon("AT+HTTPPARA=\"URL\"");
+  TEST_ASSERT_EQUAL(reportadas.size(), urls.size());
+  for (size_t i = 0; i < urls.size() && i < reportadas.size(); i++) {
+    const Lectura& l = lecturas[reportadas[i] - 1];
+    TEST_ASSERT_EQUAL_STRING(l.lat.c_str(), parametro(urls[i], "lat").c_str());
+    TEST_ASSERT_EQUAL_STRING(l.lon.c_str(), parametro(urls[i], "lon").c_str());
+    TEST_ASSERT_EQUAL_UINT32(l.utc, numero(parametro(urls[i], "ts")));
+    // Todo llega al primer intento: secuencia consecutiva y nada pendiente detrás
+    TEST_ASSERT_EQUAL_UINT32(i + 1, numero(parametro(urls[i], "seq")));
+    TEST_ASSERT_EQUAL_UINT32(i + 1, numero(parametro(urls[i], "oldest")));
+    TEST_ASSERT_EQUAL_STRING("", parametro(urls[i], "lote").c_str());
+
+    // Los tramos llevan la velocidad media desde el reporte anterior; el primer fix y los heartbeats, ninguna
+    std::string velocidad = parametro(urls[i], "speed");
+    if (reportadas[i] >= 7 && reportadas[i] <= 21) {
+      const Lectura& anterior = lecturas[reportadas[i - 1] - 1];
+      double kmh = calcularDistancia(anterior.latGrados, anterior.lonGrados, l.latGrados, l.lonGrados) /
+                   (l.utc - anterior.utc) * 3.6;
+      TEST_ASSERT_FLOAT_WITHIN(0.051, kmh, strtod(velocidad.c_str(), NULL));
+    } else {
+      TEST_ASSERT_EQUAL_STRING("", velocidad.c_str());
+    }
+  }
+
+  // Localizar del admin: aviso sin fix, ubicación al primer fix y respuesta al +CMTI.
+  // Apagar de un número no autorizado: solo el rechazo.
+  std::vector<std::string> sms = modem.enviadosCon("AT+CMGS=");
+  TEST_ASSERT_EQUAL(4, sms.size());
+  const char* const destinos[] = { "+5217771234567", "+15550001111", "+5217771234567", "+5217771234567" };
+  for (size_t i = 0; i < sms.size() && i < 4; i++) {
+    TEST_ASSERT_EQUAL_STRING((std::string("AT+CMGS=\"") + destinos[i] + "\"").c_str(), sms[i].c_str());
+  }
+  std::vector<std::string> borrados = modem.enviadosCon("AT+CMGD=");
+  TEST_ASSERT_EQUAL(4, borrados.size());
+
+  // Además, idénticos a los grabados (host, token, textos de los SMS)
+  compararEnviados("AT+HTTPPARA=\"URL\"");
+  compararEnviados("AT+CMGS=");
+  compararEnviados("AT+CMGD=");
+  TEST_ASSERT_EQUAL(0, modem.desconocidos().size());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_recorrido_urbano);
+  return UNITY_END();
+}
@@ -0,0 +1,72 @@
+// Reloj monótono: desborde de millis(), anclaje a la hora GNSS y tiempo entre fixes
+#include <unity.h>
+#include <Arduino.h>
+#include "RelojGNSS.h"
+
+static const uint32_t UTC_INICIO = 1714558200UL;  // 2024-05-01 10:10:00
+
+static GpsData fix(uint32_t utc, uint16_t utcMs, uint64_t monotono) {
+  GpsData d = {18.92, -99.23, true, 9, utc, utcMs, -1.0f, -1.0f, monotono};
+  return d;
+}
+
+void setUp() {
+  fijarReloj(0);
+}
+
+void tearDown() {}
+
+void test_desborde_de_millis() {
+  RelojGNSS reloj;
+  TEST_ASSERT_EQUAL_UINT32(4294967000UL, reloj.extender(4294967000UL));
+
+  // millis() vuelve a empezar: el reloj sigue contando
+  uint64_t tras = reloj.extender(704);
+  TEST_ASSERT_TRUE(tras == 4294967296ULL + 704);
+  tras = reloj.extender(4294967000UL);
+  TEST_ASSERT_TRUE(tras == 4294967296ULL + 4294967000ULL);
+  tras = reloj.extender(1000);
+  TEST_ASSERT_TRUE(tras == 2 * 4294967296ULL + 1000);
+}
+
+void test_conversion_utc() {
+  RelojGNSS reloj;
+  TEST_ASSERT_FALSE(reloj.sincronizado());
+  TEST_ASSERT_EQUAL_UINT32(0, reloj.utcDe(5000));
+
+  // Un fix de las 10:10:00.50 leído en el ms 4294960000, poco antes del desborde
+  reloj.extender(4294960000UL);
+  reloj.sincronizar(fix(UTC_INICIO, 500, 4294960000ULL));
+  TEST_ASSERT_TRUE(reloj.sincronizado());
+
+  // Pasado el desborde la hora sigue siendo continua
+  uint64_t despues = reloj.extender(12500);  // 19796 ms más tarde
+  TEST_ASSERT_EQUAL_UINT32(UTC_INICIO + 20, reloj.utcDe(despues));
+  TEST_ASSERT_TRUE(reloj.utcMsDe(despues) == UTC_INICIO * 1000ULL + 500 + 19796);
+
+  // Un fix en cola, anterior al ancla, y la conversión inversa
+  TEST_ASSERT_EQUAL_UINT32(UTC_INICIO - 60, reloj.utcDe(4294960000ULL - 60500));
+  TEST_ASSERT_TRUE(reloj.monotonoDe((UTC_INICIO + 1) * 1000ULL) == 4294960000ULL + 500);
+
+  // Los fixes sin hora no mueven el ancla
+  reloj.sincronizar(fix(0, 0, despues));
+  TEST_ASSERT_EQUAL_UINT32(UTC_INICIO + 20, reloj.utcDe(despues));
+}
+
+void test_segundos_entre_fixes() {
+  // Con hora GNSS cuenta la del receptor, con milisegundos, no la de lectura
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 1.5, RelojGNSS::segundosEntre(fix(UTC_INICIO, 500, 1000), fix(UTC_INICIO + 2, 0, 9000)));
+  // Sin hora, la del reloj monótono
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 8.25, RelojGNSS::segundosEntre(fix(0, 0, 1000), fix(UTC_INICIO, 0, 9250)));
+  // Orden invertido o sin datos: desconocido
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0, RelojGNSS::segundosEntre(fix(UTC_INICIO + 2, 0, 0), fix(UTC_INICIO, 0, 0)));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0, RelojGNSS::segundosEntre(fix(0, 0, 0), fix(0, 0, 5000)));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_desborde_de_millis);
+  RUN_TEST(test_conversion_utc);
+  RUN_TEST(test_segundos_entre_fixes);
+  return UNITY_END();
+}
@@ -0,0 +1,256 @@
+// Respaldo por SMS: PDU de 8 bits, carga de reportes y envío tras la caída de los datos
+#include <unity.h>
+#include <Arduino.h>
+#include <Preferences.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "CanalAT.h"
+#include "ColaSMS.h"
+#include "ColaReportes.h"
+#include "FormatoSMS.h"
+#include "RespaldoSMS.h"
+#include "ReproductorModem.h"
+
+#define PASARELA "+5215550001111"
+
+static std::vector<uint8_t> deHex(const char* texto) {
+  std::vector<uint8_t> datos(strlen(texto) / 2);
+  TEST_ASSERT_EQUAL(datos.size(), deHexadecimal(texto, datos.data(), datos.size()));
+  return datos;
+}
+
+// Lo que recibiría la pasarela: los PDU que el firmware escribió tras cada AT+CMGS, unidos
+static std::vector<uint8_t> cargaEnviada(const ReproductorModem& modem, size_t desde, int& sms) {
+  std::map<uint8_t, std::vector<uint8_t> > partes;
+  sms = 0;
+  for (size_t i = desde; i < modem.enviados().size(); i++) {
+    std::string cuerpo = modem.enviados()[i];
+    if (cuerpo.empty() || cuerpo.back() != 26) {
+      continue;
+    }
+    cuerpo.pop_back();
+    std::vector<uint8_t> pdu = deHex(cuerpo.c_str());
+    SMSBinario leido;
+    TEST_ASSERT_TRUE(leerPDU(pdu.data(), pdu.size(), leido));
+    TEST_ASSERT_EQUAL_STRING(PASARELA, leido.numero);
+    partes[leido.concatenado ? leido.parte : 1].assign(leido.datos, leido.datos + leido.largo);
+    sms++;
+  }
+  std::vector<uint8_t> carga;
+  for (std::map<uint8_t, std::vector<uint8_t> >::iterator it = partes.begin(); it != partes.end(); ++it) {
+    carga.insert(carga.end(), it->second.begin(), it->second.end());
+  }
+  return carga;
+}
+
+// El módem acepta 'n' envíos: cambio de modo, prompt, +CMGS y vuelta a texto
+static std::vector<RegistroUART> grabacionSMS(int n) {
+  std::vector<RegistroUART> grabacion;
+  for (int i = 0; i < n; i++) {
+    grabacion.push_back({ '>', 0, "AT+CMGF=0\r\n" });
+    grabacion.push_back({ '<', 10, "\r\nOK\r\n" });
+    grabacion.push_back({ '>', 0, "AT+CMGS=40\r\n" });
+    grabacion.push_back({ '<', 100, "\r\n> " });
+    grabacion.push_back({ '>', 0, "00\x1A" });
+    grabacion.push_back({ '<', 2000, "\r\n+CMGS: 7\r\n\r\nOK\r\n" });
+    grabacion.push_back({ '>', 0, "AT+CMGF=1\r\n" });
+    grabacion.push_back({ '<', 10, "\r\nOK\r\n" });
+  }
+  return grabacion;
+}
+
+// El módem acepta 'n' respuestas de texto
+static std::vector<RegistroUART> grabacionTexto(int n) {
+  std::vector<RegistroUART> grabacion;
+  for (int i = 0; i < n; i++) {
+    grabacion.push_back({ '>', 0, "AT+CMGS=\"+527770000000\"\r\n" });
+    grabacion.push_back({ '<', 100, "\r\n> " });
+    grabacion.push_back({ '>', 0, "Apagado\x1A" });
+    grabacion.push_back({ '<', 2000, "\r\n+CMGS: 7\r\n\r\nOK\r\n" });
+  }
+  return grabacion;
+}
+
+static void procesarCola(ColaSMS& cola) {
+  unsigned long limite = millis() + 60000;
+  while ((cola.ocupada() || cola.pendientes() > 0) && millis() < limite) {
+    cola.procesar();
+    delay(10);
+  }
+  TEST_ASSERT_FALSE(cola.ocupada());
+}
+
+void setUp() {
+  Preferences::borrarTodo();
+  fijarReloj(0);
+}
+
+void tearDown() {}
+
+void test_pdu_de_envio_y_de_entrega() {
+  const uint8_t datos[] = { 0x01, 0x02, 0x03 };
+  uint8_t pdu[SMS_PDU_MAX];
+  char hex[2 * SMS_PDU_MAX + 1];
+  size_t n = armarPDUEnvio(PASARELA, datos, sizeof(datos), false, pdu);
+  aHexadecimal(pdu, n, hex);
+  // SMSC de la SIM, SUBMIT con validez relativa, destino internacional de 13 dígitos, 8 bits, 24 h
+  TEST_ASSERT_EQUAL_STRING("0011000D91255155001011F10004A703010203", hex);
+  TEST_ASSERT_EQUAL(0, (int)armarPDUEnvio("+52-555", datos, sizeof(datos), false, pdu));
+
+  // Lo que entrega la red a la pasarela: SMS-DELIVER con SMSC, UDH de concatenación y sello de tiempo
+  std::vector<uint8_t> entrega = deHex("07912521010000F0440D91255155001011F1000442501001000000"
+                                       "090500032A0201AABBCC");
+  SMSBinario sms;
+  TEST_ASSERT_TRUE(leerPDU(entrega.data(), entrega.size(), sms));
+  TEST_ASSERT_EQUAL_STRING(PASARELA, sms.numero);
+  TEST_ASSERT_TRUE(sms.concatenado);
+  TEST_ASSERT_EQUAL(0x2A, sms.referencia);
+  TEST_ASSERT_EQUAL(2, sms.partes);
+  TEST_ASSERT_EQUAL(1, sms.parte);
+  TEST_ASSERT_EQUAL(3, (int)sms.largo);
+  TEST_ASSERT_EQUAL(0xCC, sms.datos[2]);
+
+  // Texto de 7 bits (DCS 00): no es un reporte
+  entrega[entrega.size() - 18] = 0x00;
+  TEST_ASSERT_FALSE(leerPDU(entrega.data(), entrega.size(), sms));
+}
+
+void test_reportes_ida_y_vuelta() {
+  ReporteSMS reportes[2] = { { 41, 1714558222UL, 18926113, -99230733, 425 },
+                             { 42, 0, -33456789, 151234567, REPORTE_SMS_SIN_VELOCIDAD } };
+  uint8_t carga[REPORTE_SMS_CABECERA + 2 * REPORTE_SMS_BYTES];
+  TEST_ASSERT_EQUAL(sizeof(carga), empaquetarReportes(37, reportes, 2, carga));
+
+  ReporteSMS leidos[4];
+  uint32_t masAntigua = 0;
+  TEST_ASSERT_EQUAL(2, desempaquetarReportes(carga, sizeof(carga), masAntigua, leidos, 4));
+  TEST_ASSERT_EQUAL_UINT32(37, masAntigua);
+  TEST_ASSERT_EQUAL_UINT32(1714558222UL, leidos[0].utc);
+  TEST_ASSERT_EQUAL_INT32(-99230733, leidos[0].lon);
+  TEST_ASSERT_EQUAL(425, leidos[0].velocidad);
+  TEST_ASSERT_EQUAL_UINT32(42, leidos[1].secuencia);
+  TEST_ASSERT_EQUAL_INT32(-33456789, leidos[1].lat);
+  TEST_ASSERT_EQUAL(REPORTE_SMS_SIN_VELOCIDAD, leidos[1].velocidad);
+
+  // Una parte perdida cambia el largo: la carga no se acepta
+  TEST_ASSERT_EQUAL(-1, desempaquetarReportes(carga, sizeof(carga) - 1, masAntigua, leidos, 4));
+}
+
+void test_respaldo_espera_la_caida_y_envia_en_modo_pdu() {
+  ReproductorModem modem(grabacionSMS(3));
+  CanalAT canal(modem);
+  ColaSMS cola(canal);
+  ColaReportes reportes;
+  reportes.begin();
+  RespaldoSMS respaldo(cola, reportes, PASARELA);
+
+  for (int i = 0; i < 10; i++) {
+    reportes.agregar(18.92 + i * 0.001, -99.23, i == 0 ? -1.0f : i * 5.0f, 1714558200UL + i * 30);
+  }
+
+  // Caída de los datos: todavía no alcanza RESPALDO_SMS_CAIDA_MS
+  respaldo.registrarEnvio(ENVIO_SIN_PDP);
+  fijarReloj(RESPALDO_SMS_CAIDA_MS - 1000);
+  respaldo.registrarEnvio(ENVIO_DNS);  // Otro fallo no reinicia la cuenta
+  TEST_ASSERT_FALSE(respaldo.atender());
+
+  // Pasado el plazo: 10 reportes = 186 bytes, dos SMS concatenados
+  fijarReloj(RESPALDO_SMS_CAIDA_MS);
+  TEST_ASSERT_TRUE(respaldo.atender());
+  procesarCola(cola);
+  TEST_ASSERT_EQUAL(2, (int)modem.enviadosCon("AT+CMGF=0").size());
+  TEST_ASSERT_EQUAL(2, (int)modem.enviadosCon("AT+CMGF=1").size());
+  TEST_ASSERT_EQUAL_STRING("AT+CMGS=155", modem.enviadosCon("AT+CMGS=")[0].c_str());
+
+  int sms = 0;
+  std::vector<uint8_t> carga = cargaEnviada(modem, 0, sms);
+  TEST_ASSERT_EQUAL(2, sms);
+  ReporteSMS leidos[16];
+  uint32_t masAntigua = 0;
+  TEST_ASSERT_EQUAL(10, desempaquetarReportes(carga.data(), carga.size(), masAntigua, leidos, 16));
+  TEST_ASSERT_EQUAL_UINT32(1, masAntigua);
+  TEST_ASSERT_EQUAL_INT32(18929000, leidos[9].lat);
+  TEST_ASSERT_EQUAL(REPORTE_SMS_SIN_VELOCIDAD, leidos[0].velocidad);
+  TEST_ASSERT_EQUAL(450, leidos[9].velocidad);
+  TEST_ASSERT_EQUAL_UINT32(10, respaldo.enviadoHasta());
+
+  // Antes del intervalo no sale nada; después, solo lo nuevo y en un solo SMS
+  reportes.agregar(18.935, -99.23, 20.0f, 1714558600UL);
+  TEST_ASSERT_FALSE(respaldo.atender());
+  size_t enviados = modem.enviados().size();
+  fijarReloj(RESPALDO_SMS_CAIDA_MS + RESPALDO_SMS_INTERVALO_MS);
+  TEST_ASSERT_TRUE(respaldo.atender());
+  procesarCola(cola);
+  carga = cargaEnviada(modem, enviados, sms);
+  TEST_ASSERT_EQUAL(1, sms);
+  TEST_ASSERT_EQUAL(1, desempaquetarReportes(carga.data(), carga.size(), masAntigua, leidos, 16));
+  TEST_ASSERT_EQUAL_UINT32(11, leidos[0].secuencia);
+
+  // Los datos vuelven: se acabó el respaldo
+  respaldo.registrarEnvio(ENVIO_OK);
+  TEST_ASSERT_FALSE(respaldo.activo());
+  TEST_ASSERT_EQUAL(0, (int)modem.desconocidos().size());
+}
+
+void test_parte_desplazada_por_una_respuesta_repite_el_lote() {
+  ReproductorModem modem(grabacionSMS(SMS_COLA_CAPACIDAD + 1));
+  CanalAT canal(modem);
+  ColaSMS cola(canal);
+  ColaReportes reportes;
+  reportes.begin();
+  RespaldoSMS respaldo(cola, reportes, PASARELA);
+  for (int i = 0; i < 10; i++) {
+    reportes.agregar(18.92 + i * 0.001, -99.23, 10.0f, 1714558200UL + i * 30);
+  }
+  respaldo.registrarEnvio(ENVIO_TLS);
+  fijarReloj(RESPALDO_SMS_CAIDA_MS);
+  TEST_ASSERT_TRUE(respaldo.atender());
+  TEST_ASSERT_EQUAL(2, cola.pendientes());
+
+  // La cola se llena de respuestas: la última parte binaria cede su lugar
+  for (int i = 0; cola.pendientes() < SMS_COLA_CAPACIDAD; i++) {
+    cola.encolar(String("+52777123450") + String(i), "Apagado");
+  }
+  TEST_ASSERT_TRUE(cola.encolar("+527771234599", "Encendido"));
+  TEST_ASSERT_EQUAL_UINT32(0, respaldo.enviadoHasta());
+
+  // Nada queda marcado como enviado: el lote completo sale en el siguiente intervalo
+  procesarCola(cola);
+  TEST_ASSERT_EQUAL_UINT32(0, respaldo.enviadoHasta());
+  fijarReloj(millis() + RESPALDO_SMS_INTERVALO_MS);
+  TEST_ASSERT_TRUE(respaldo.atender());
+  TEST_ASSERT_EQUAL(2, cola.pendientes());
+}
+
+void test_cola_llena_no_gasta_la_cuota_del_numero() {
+  ReproductorModem modem(grabacionTexto(SMS_COLA_CAPACIDAD));
+  CanalAT canal(modem);
+  ColaSMS cola(canal);
+  for (int i = 0; i < SMS_COLA_CAPACIDAD; i++) {
+    TEST_ASSERT_TRUE(cola.encolar(String("+52777123450") + String(i), "Apagado"));
+  }
+
+  // Nada de baja prioridad que desplazar: las respuestas se descartan sin contar para el remitente
+  for (int i = 0; i < SMS_MAX_POR_NUMERO; i++) {
+    TEST_ASSERT_FALSE(cola.encolar("+527771234599", "Encendido"));
+  }
+  procesarCola(cola);
+  TEST_ASSERT_EQUAL(0, cola.pendientes());
+
+  // Con lugar, el remitente conserva su cuota completa y el límite sigue vigente
+  for (int i = 0; i < SMS_MAX_POR_NUMERO; i++) {
+    TEST_ASSERT_TRUE(cola.encolar("+527771234599", "Encendido"));
+  }
+  TEST_ASSERT_FALSE(cola.encolar("+527771234599", "Encendido"));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_pdu_de_envio_y_de_entrega);
+  RUN_TEST(test_reportes_ida_y_vuelta);
+  RUN_TEST(test_respaldo_espera_la_caida_y_envia_en_modo_pdu);
+  RUN_TEST(test_parte_desplazada_por_una_respuesta_repite_el_lote);
+  RUN_TEST(test_cola_llena_no_gasta_la_cuota_del_numero);
+  return UNITY_END();
+}
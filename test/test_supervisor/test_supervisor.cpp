@@ -0,0 +1,178 @@
+// Supervisor de red: escalamiento por clase de fallo, enfriamientos y telemetría en NVS
+#include <unity.h>
+#include <Arduino.h>
+#include <Preferences.h>
+#include "CanalAT.h"
+#include "GSMModule.h"
+#include "SupervisorRed.h"
+#include "ReproductorModem.h"
+
+static int reconfiguraciones = 0;
+
+static void contarReconfiguracion() {
+  reconfiguraciones++;
+}
+
+static void fallar(SupervisorRed& supervisor, ResultadoEnvio clase, int veces) {
+  for (int i = 0; i < veces; i++) {
+    supervisor.registrarEnvio(clase);
+  }
+}
+
+static unsigned long ultimoLatido = 0;
+static unsigned long mayorHueco = 0;
+
+static void latido() {
+  if (millis() - ultimoLatido > mayorHueco) {
+    mayorHueco = millis() - ultimoLatido;
+  }
+  ultimoLatido = millis();
+}
+
+void setUp() {
+  Preferences::borrarTodo();
+  fijarReloj(0);
+  reconfiguraciones = 0;
+  ESP.reinicios = 0;
+}
+
+void tearDown() {}
+
+void test_escalamiento_completo() {
+  // Sin grabación: todo comando recibe OK, pero nunca registro ni PDP activo
+  ReproductorModem modem;
+  CanalAT canal(modem);
+  GSMModule gsm(canal, PWR_PIN, RXD1_PIN, TXD1_PIN, BAUD_RATE);
+  SupervisorRed supervisor(gsm);
+  supervisor.setReconfigurarModem(contarReconfiguracion);
+  supervisor.begin();
+
+  // Por debajo del umbral no se actúa
+  fallar(supervisor, ENVIO_TIMEOUT_HTTP, RED_FALLOS_PARA_ESCALAR - 1);
+  TEST_ASSERT_FALSE(supervisor.atender());
+
+  supervisor.registrarEnvio(ENVIO_TIMEOUT_HTTP);
+  TEST_ASSERT_TRUE(supervisor.atender());
+  TEST_ASSERT_EQUAL(NIVEL_REACTIVAR_PDP, supervisor.nivel());
+  TEST_ASSERT_EQUAL(1, modem.enviadosCon("AT+CGACT=0,1").size());
+
+  // Dentro del enfriamiento no se escala aunque sigan los fallos
+  fallar(supervisor, ENVIO_DNS, RED_FALLOS_PARA_ESCALAR);
+  TEST_ASSERT_FALSE(supervisor.atender());
+
+  fijarReloj(millis() + RED_ENFRIAMIENTO_PDP_MS);
+  TEST_ASSERT_TRUE(supervisor.atender());
+  TEST_ASSERT_EQUAL(NIVEL_CICLO_RADIO, supervisor.nivel());
+  TEST_ASSERT_EQUAL(1, modem.enviadosCon("AT+CFUN=0").size());
+  TEST_ASSERT_EQUAL(1, modem.enviadosCon("AT+CFUN=1").size());
+
+  fallar(supervisor, ENVIO_SIN_REGISTRO, RED_FALLOS_PARA_ESCALAR);
+  fijarReloj(millis() + RED_ENFRIAMIENTO_RADIO_MS);
+  TEST_ASSERT_TRUE(supervisor.atender());
+  TEST_ASSERT_EQUAL(NIVEL_CICLO_MODEM, supervisor.nivel());
+  TEST_ASSERT_EQUAL(1, reconfiguraciones);
+
+  // Poco tiempo encendido: se repite el ciclo del módem en vez de reiniciar el ESP32
+  fallar(supervisor, ENVIO_SIN_REGISTRO, RED_FALLOS_PARA_ESCALAR);
+  fijarReloj(millis() + RED_ENFRIAMIENTO_MODEM_MS);
+  TEST_ASSERT_TRUE(millis() < RED_UPTIME_MINIMO_REINICIO_MS);
+  TEST_ASSERT_TRUE(supervisor.atender());
+  TEST_ASSERT_EQUAL(NIVEL_CICLO_MODEM, supervisor.nivel());
+  TEST_ASSERT_EQUAL(0, ESP.reinicios);
+
+  fallar(supervisor, ENVIO_SIN_REGISTRO, RED_FALLOS_PARA_ESCALAR);
+  fijarReloj(RED_UPTIME_MINIMO_REINICIO_MS + RED_ENFRIAMIENTO_MODEM_MS);
+  TEST_ASSERT_TRUE(supervisor.atender());
+  TEST_ASSERT_EQUAL(NIVEL_REINICIO_ESP, supervisor.nivel());
+  TEST_ASSERT_EQUAL(1, ESP.reinicios);
+
+  const TelemetriaRed& t = supervisor.getTelemetria();
+  TEST_ASSERT_EQUAL(1, t.intentos[NIVEL_REACTIVAR_PDP]);
+  TEST_ASSERT_EQUAL(1, t.intentos[NIVEL_CICLO_RADIO]);
+  TEST_ASSERT_EQUAL(2, t.intentos[NIVEL_CICLO_MODEM]);
+  TEST_ASSERT_EQUAL(1, t.intentos[NIVEL_REINICIO_ESP]);
+  TEST_ASSERT_EQUAL(0, t.exitos[NIVEL_CICLO_MODEM]);
+  TEST_ASSERT_EQUAL(NIVEL_REINICIO_ESP, t.nivelPendiente);
+}
+
+void test_clase_fija_nivel_minimo() {
+  ReproductorModem modem;
+  CanalAT canal(modem);
+  GSMModule gsm(canal, PWR_PIN, RXD1_PIN, TXD1_PIN, BAUD_RATE);
+  SupervisorRed supervisor(gsm);
+  supervisor.begin();
+
+  // Sin registro en la red, reactivar el PDP no sirve: se empieza por el radio
+  fallar(supervisor, ENVIO_SIN_REGISTRO, RED_FALLOS_PARA_ESCALAR);
+  TEST_ASSERT_TRUE(supervisor.atender());
+  TEST_ASSERT_EQUAL(NIVEL_CICLO_RADIO, supervisor.nivel());
+  TEST_ASSERT_EQUAL(0, modem.enviadosCon("AT+CGACT=0,1").size());
+
+  // Un error del servidor confirma que la red funciona
+  fallar(supervisor, ENVIO_TIMEOUT_HTTP, 1);
+  supervisor.registrarEnvio(ENVIO_ERROR_SERVIDOR);
+  TEST_ASSERT_EQUAL(NIVEL_NINGUNO, supervisor.nivel());
+  TEST_ASSERT_EQUAL(0, supervisor.fallosConsecutivos());
+  TEST_ASSERT_EQUAL(1, supervisor.getTelemetria().exitos[NIVEL_CICLO_RADIO]);
+
+  // Los errores de configuración no cuentan como fallos de conexión
+  fallar(supervisor, ENVIO_ERROR_CONFIG, RED_FALLOS_PARA_ESCALAR);
+  TEST_ASSERT_FALSE(supervisor.atender());
+}
+
+void test_telemetria_sobrevive_reinicio() {
+  ReproductorModem modem;
+  CanalAT canal(modem);
+  GSMModule gsm(canal, PWR_PIN, RXD1_PIN, TXD1_PIN, BAUD_RATE);
+
+  {
+    SupervisorRed antes(gsm);
+    antes.begin();
+    fallar(antes, ENVIO_TLS, RED_FALLOS_PARA_ESCALAR);
+    fijarReloj(RED_UPTIME_MINIMO_REINICIO_MS);
+    TEST_ASSERT_TRUE(antes.atender());
+    TEST_ASSERT_EQUAL(NIVEL_REACTIVAR_PDP, antes.nivel());
+  }
+
+  // El ESP32 se reinició a mitad de la acción: se cierra como fallida
+  fijarReloj(0);
+  SupervisorRed despues(gsm);
+  despues.begin();
+  const TelemetriaRed& t = despues.getTelemetria();
+  TEST_ASSERT_EQUAL(1, t.intentos[NIVEL_REACTIVAR_PDP]);
+  TEST_ASSERT_EQUAL(0, t.exitos[NIVEL_REACTIVAR_PDP]);
+  TEST_ASSERT_EQUAL(RED_FALLOS_PARA_ESCALAR, t.fallos[ENVIO_TLS]);
+  TEST_ASSERT_EQUAL(NIVEL_NINGUNO, t.nivelPendiente);
+}
+
+void test_esperas_del_canal_alimentan_el_watchdog() {
+  // Una sesión HTTP lenta: el resultado llega a los 50 s
+  std::vector<RegistroUART> grabacion;
+  grabacion.push_back({ '>', 0, "AT+HTTPACTION=0\r\n" });
+  grabacion.push_back({ '<', 20, "\r\nOK\r\n" });
+  grabacion.push_back({ '<', 50000, "\r\n+HTTPACTION: 0,200,0\r\n" });
+  ReproductorModem modem(grabacion);
+  CanalAT canal(modem);
+  canal.setLatido(latido);
+  ultimoLatido = 0;
+  mayorHueco = 0;
+
+  TEST_ASSERT_EQUAL(AT_OK, canal.ejecutar(AT_HTTPACTION_GET));
+  String urc;
+  TEST_ASSERT_TRUE(canal.esperarURC(AT_HTTPACTION_GET, urc));
+  canal.pausa(30000);
+
+  // Nunca pasa más de una vuelta de espera sin alimentar al watchdog
+  TEST_ASSERT_TRUE(millis() >= 80000);
+  TEST_ASSERT_TRUE(mayorHueco <= 20);
+  TEST_ASSERT_TRUE(millis() - ultimoLatido <= 20);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_escalamiento_completo);
+  RUN_TEST(test_clase_fija_nivel_minimo);
+  RUN_TEST(test_telemetria_sobrevive_reinicio);
+  RUN_TEST(test_esperas_del_canal_alimentan_el_watchdog);
+  return UNITY_END();
+}
@@ -0,0 +1,195 @@
+// Certificado del servidor en el módem, verificación y contexto SSL configurado una vez por encendido
+#include <unity.h>
+#include <Arduino.h>
+#include <Preferences.h>
+#include "CanalAT.h"
+#include "GSMModule.h"
+#include "HTTPClient.h"
+#include "ContextoTLS.h"
+#include "ColaReportes.h"
+#include "ControlSalidas.h"
+#include "ReproductorModem.h"
+
+#define ARCHIVO "prueba_ca.pem"
+
+static const char* const PEM =
+  "-----BEGIN CERTIFICATE-----\n"
+  "MIIBszCCAVmgAwIBAgIUZmluZG1lMzItcHJ1ZWJhMAoGCCqGSM49BAMCMBQxEjAQ\n"
+  "-----END CERTIFICATE-----\n";
+
+static void agregarOK(std::vector<RegistroUART>& g, const char* comando) {
+  g.push_back({ '>', 0, comando });
+  g.push_back({ '<', 10, "\r\nOK\r\n" });
+}
+
+static void agregarCarga(std::vector<RegistroUART>& g, const char* final) {
+  g.push_back({ '>', 0, "AT+CCERTDOWN=\"" ARCHIVO "\",119\r\n" });
+  g.push_back({ '<', 20, "\r\n>" });
+  g.push_back({ '>', 0, PEM });
+  g.push_back({ '<', 200, final });
+}
+
+// 'ignorarHora': 1 mientras el reloj del módem no tiene fecha
+static void agregarContexto(std::vector<RegistroUART>& g, bool verificar, bool ignorarHora = true) {
+  agregarOK(g, "AT+CSSLCFG=\"sslversion\",0,3\r\n");
+  if (verificar) {
+    agregarOK(g, "AT+CSSLCFG=\"cacert\",0,\"" ARCHIVO "\"\r\n");
+    agregarOK(g, ignorarHora ? "AT+CSSLCFG=\"ignorelocaltime\",0,1\r\n" : "AT+CSSLCFG=\"ignorelocaltime\",0,0\r\n");
+  }
+  agregarOK(g, verificar ? "AT+CSSLCFG=\"authmode\",0,1\r\n" : "AT+CSSLCFG=\"authmode\",0,0\r\n");
+  agregarOK(g, "AT+CSSLCFG=\"enableSNI\",0,1\r\n");
+}
+
+// Un reporte con PDP activo que el servidor acepta
+static void agregarSesion(std::vector<RegistroUART>& g) {
+  g.push_back({ '>', 0, "AT+CGACT?\r\n" });
+  g.push_back({ '<', 10, "\r\n+CGACT: 1,1\r\n\r\nOK\r\n" });
+  g.push_back({ '>', 0, "AT+HTTPACTION=0\r\n" });
+  g.push_back({ '<', 10, "\r\nOK\r\n" });
+  g.push_back({ '<', 900, "\r\n+HTTPACTION: 0,200,0\r\n" });
+}
+
+void setUp() {
+  Preferences::borrarTodo();
+  fijarReloj(0);
+}
+
+void tearDown() {}
+
+void test_certificado_listado() {
+  const char* lista = "\r\n+CCERTLIST: \"otro.pem\"\r\n+CCERTLIST: \"" ARCHIVO "\"\r\n\r\nOK\r\n";
+  TEST_ASSERT_TRUE(ContextoTLS::certificadoListado(lista, ARCHIVO));
+  TEST_ASSERT_TRUE(ContextoTLS::certificadoListado(lista, "otro.pem"));
+  TEST_ASSERT_FALSE(ContextoTLS::certificadoListado(lista, "prueba"));
+  TEST_ASSERT_FALSE(ContextoTLS::certificadoListado("\r\nOK\r\n", ARCHIVO));
+}
+
+void test_certificado_se_sube_una_vez() {
+  TEST_ASSERT_EQUAL(119, strlen(PEM));  // El largo que anuncia AT+CCERTDOWN
+  std::vector<RegistroUART> g;
+  agregarCarga(g, "\r\nOK\r\n");
+  agregarContexto(g, true);
+  g.push_back({ '>', 0, "AT+CCERTLIST\r\n" });
+  g.push_back({ '<', 10, "\r\n+CCERTLIST: \"" ARCHIVO "\"\r\n\r\nOK\r\n" });
+  agregarContexto(g, true);
+  ReproductorModem modem(g);
+  CanalAT canal(modem);
+
+  {
+    ContextoTLS tls(canal, PEM, ARCHIVO);
+    TEST_ASSERT_TRUE(tls.verificaServidor());
+    TEST_ASSERT_TRUE(tls.preparar());
+    TEST_ASSERT_EQUAL(1, modem.enviadosCon("AT+CCERTDOWN=").size());
+    TEST_ASSERT_EQUAL(1, modem.enviadosCon("-----BEGIN").size());
+    TEST_ASSERT_EQUAL_STRING(PEM, modem.enviadosCon("-----BEGIN")[0].c_str());
+    TEST_ASSERT_EQUAL(1, modem.enviadosCon("AT+CSSLCFG=\"authmode\",0,1").size());
+
+    // Siguiente sesión: nada que subir ni configurar
+    TEST_ASSERT_TRUE(tls.preparar());
+    TEST_ASSERT_EQUAL(1, modem.enviadosCon("AT+CSSLCFG=\"authmode\"").size());
+    TEST_ASSERT_EQUAL(1, tls.configuraciones());
+  }
+
+  // Reinicio del ESP32: el resumen en NVS coincide y el módem conserva el archivo
+  ContextoTLS tras(canal, PEM, ARCHIVO);
+  TEST_ASSERT_TRUE(tras.preparar());
+  TEST_ASSERT_EQUAL(1, modem.enviadosCon("AT+CCERTDOWN=").size());
+  TEST_ASSERT_EQUAL(1, modem.enviadosCon("AT+CCERTLIST").size());
+  TEST_ASSERT_EQUAL(2, modem.enviadosCon("AT+CSSLCFG=\"cacert\",0,\"" ARCHIVO "\"").size());
+  TEST_ASSERT_EQUAL(0, modem.desconocidos().size());
+}
+
+void test_carga_rechazada_no_abre_sesion_sin_verificar() {
+  std::vector<RegistroUART> g;
+  agregarCarga(g, "\r\nERROR\r\n");
+  agregarCarga(g, "\r\nOK\r\n");
+  agregarContexto(g, true);
+  ReproductorModem modem(g);
+  CanalAT canal(modem);
+  ContextoTLS tls(canal, PEM, ARCHIVO);
+
+  TEST_ASSERT_FALSE(tls.preparar());
+  TEST_ASSERT_EQUAL(0, modem.enviadosCon("AT+CSSLCFG=").size());
+
+  TEST_ASSERT_TRUE(tls.preparar());
+  TEST_ASSERT_EQUAL(2, modem.enviadosCon("AT+CCERTDOWN=").size());
+  TEST_ASSERT_EQUAL(1, modem.enviadosCon("AT+CSSLCFG=\"authmode\",0,1").size());
+  TEST_ASSERT_EQUAL(0, modem.desconocidos().size());
+}
+
+void test_vigencia_con_el_reloj_del_modem() {
+  std::vector<RegistroUART> g;
+  agregarCarga(g, "\r\nOK\r\n");
+  agregarContexto(g, true);
+  agregarOK(g, "AT+CCLK=\"24/05/01,10:10:22+00\"\r\n");
+  agregarContexto(g, true, false);
+  agregarContexto(g, true);
+  ReproductorModem modem(g);
+  CanalAT canal(modem);
+  GSMModule gsm(canal, PWR_PIN, RXD1_PIN, TXD1_PIN, BAUD_RATE);
+  ContextoTLS tls(canal, PEM, ARCHIVO);
+
+  // Reloj en 1980: el certificado se verifica, pero no su vigencia
+  TEST_ASSERT_TRUE(tls.preparar());
+  TEST_ASSERT_EQUAL(1, modem.enviadosCon("AT+CSSLCFG=\"ignorelocaltime\",0,1").size());
+
+  // Primer fix con hora GNSS: se fija el reloj y el contexto pasa a validarla
+  TEST_ASSERT_TRUE(gsm.fijarReloj(1714558222UL));
+  TEST_ASSERT_EQUAL_STRING("AT+CCLK=\"24/05/01,10:10:22+00\"", modem.enviadosCon("AT+CCLK=")[0].c_str());
+  tls.setRelojValido(true);
+  TEST_ASSERT_TRUE(tls.preparar());
+  TEST_ASSERT_EQUAL(1, modem.enviadosCon("AT+CSSLCFG=\"ignorelocaltime\",0,0").size());
+  TEST_ASSERT_TRUE(tls.preparar());
+  TEST_ASSERT_EQUAL(2, tls.configuraciones());
+
+  // Reinicio del módulo: hasta saber que conserva la fecha, de nuevo sin validarla
+  tls.invalidar();
+  TEST_ASSERT_FALSE(tls.relojValido());
+  TEST_ASSERT_TRUE(tls.preparar());
+  TEST_ASSERT_EQUAL(2, modem.enviadosCon("AT+CSSLCFG=\"ignorelocaltime\",0,1").size());
+  TEST_ASSERT_EQUAL(0, modem.desconocidos().size());
+}
+
+void test_contexto_por_encendido_y_medicion() {
+  std::vector<RegistroUART> g;
+  agregarContexto(g, false);
+  agregarContexto(g, false);
+  for (int i = 0; i < 3; i++) {
+    agregarSesion(g);
+  }
+  ReproductorModem modem(g);
+  CanalAT canal(modem);
+  GSMModule gsm(canal, PWR_PIN, RXD1_PIN, TXD1_PIN, BAUD_RATE);
+  ControlSalidas salidas(PIN_ACTIVE, PIN_INACTIVE);
+  HTTPClient http(gsm, salidas);
+  ColaReportes reportes;
+  salidas.begin();
+  reportes.begin();
+  reportes.agregar(18.926113, -99.230733, -1.0f, 1714558222UL);
+
+  // Sin TLS_CA_PEM: sin verificación, pero tampoco se reconfigura en cada reporte
+  TEST_ASSERT_FALSE(http.getTLS().verificaServidor());
+  TEST_ASSERT_TRUE(http.enviarReportes(reportes));
+  TEST_ASSERT_TRUE(http.enviarReportes(reportes));
+  TEST_ASSERT_EQUAL(1, modem.enviadosCon("AT+CSSLCFG=\"authmode\",0,0").size());
+  TEST_ASSERT_EQUAL(0, modem.enviadosCon("AT+CCERTDOWN=").size());
+
+  // Reinicio del módulo: se configura de nuevo
+  http.getTLS().invalidar();
+  TEST_ASSERT_TRUE(http.enviarReportes(reportes));
+  TEST_ASSERT_EQUAL(2, modem.enviadosCon("AT+CSSLCFG=\"authmode\"").size());
+  TEST_ASSERT_EQUAL(2, http.getTLS().configuraciones());
+
+  TEST_ASSERT_TRUE(http.getTLS().msPorSesion() >= 900);
+  TEST_ASSERT_EQUAL(http.ultimoConsumo().subida + http.ultimoConsumo().bajada, http.getTLS().bytesEstimadosPorSesion());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_certificado_listado);
+  RUN_TEST(test_certificado_se_sube_una_vez);
+  RUN_TEST(test_carga_rechazada_no_abre_sesion_sin_verificar);
+  RUN_TEST(test_vigencia_con_el_reloj_del_modem);
+  RUN_TEST(test_contexto_por_encendido_y_medicion);
+  return UNITY_END();
+}
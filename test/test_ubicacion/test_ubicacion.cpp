@@ -0,0 +1,161 @@
+// Traza del "Localizar": polilínea codificada, recorte para un SMS y ventana de tiempo
+#include <unity.h>
+#include <Arduino.h>
+#include <string>
+#include <vector>
+#include "GeoUtils.h"
+#include "RelojGNSS.h"
+#include "ServicioUbicacion.h"
+#include "ReproductorModem.h"
+
+#define VISOR "https://" API_ENDPOINT UBICACION_VISOR_PATH "?p="
+
+static const char ALFABETO[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+static ReproductorModem modem;
+static CanalAT canal(modem);
+static RelojGNSS reloj;
+
+struct Vertice {
+  int32_t lat;
+  int32_t lon;
+};
+
+// Decodificador del visor: mismo formato de Google con el alfabeto base64url
+static std::vector<Vertice> decodificar(const std::string& texto) {
+  std::vector<Vertice> vertices;
+  int32_t acumulado[2] = { 0, 0 };
+  size_t i = 0;
+  int eje = 0;
+  while (i < texto.size()) {
+    uint32_t v = 0;
+    int desplazamiento = 0;
+    int grupo;
+    do {
+      grupo = (int)(strchr(ALFABETO, texto[i++]) - ALFABETO);
+      v |= (uint32_t)(grupo & 0x1F) << desplazamiento;
+      desplazamiento += 5;
+    } while (grupo & 0x20);
+    acumulado[eje] += (v & 1) ? ~(int32_t)(v >> 1) : (int32_t)(v >> 1);
+    if (++eje == 2) {
+      Vertice p = { acumulado[0], acumulado[1] };
+      vertices.push_back(p);
+      eje = 0;
+    }
+  }
+  return vertices;
+}
+
+static std::vector<Vertice> verticesDe(const String& respuesta) {
+  std::string texto = respuesta.c_str();
+  TEST_ASSERT_EQUAL(0, (int)texto.find(VISOR));
+  size_t fin = texto.find(' ');
+  return decodificar(texto.substr(strlen(VISOR), fin - strlen(VISOR)));
+}
+
+void setUp() {
+  fijarReloj(0);
+}
+
+void tearDown() {}
+
+void test_codifica_el_ejemplo_de_google_con_alfabeto_base64url() {
+  // Ejemplo de la documentación de Google: "_p~iF~ps|U_ulLnnqC_mqNvxq`@"
+  const double puntos[3][2] = { { 38.5, -120.2 }, { 40.7, -120.95 }, { 43.252, -126.453 } };
+  const char* google = "_p~iF~ps|U_ulLnnqC_mqNvxq`@";
+  std::string esperado;
+  for (const char* c = google; *c; c++) {
+    esperado += ALFABETO[*c - 63];
+  }
+
+  char texto[64];
+  size_t largo = 0;
+  int32_t anterior[2] = { 0, 0 };
+  for (int i = 0; i < 3; i++) {
+    for (int eje = 0; eje < 2; eje++) {
+      int32_t valor = aUnidadesPolilinea(puntos[i][eje]);
+      TEST_ASSERT_EQUAL(largoPolilinea(valor - anterior[eje]),
+                        codificarPolilinea(valor - anterior[eje], texto + largo));
+      largo += largoPolilinea(valor - anterior[eje]);
+      anterior[eje] = valor;
+    }
+  }
+  texto[largo] = '\0';
+  TEST_ASSERT_EQUAL_STRING(esperado.c_str(), texto);
+}
+
+void test_respuesta_lleva_la_traza_y_termina_en_el_fix_actual() {
+  GPSModule gps(canal, reloj);
+  ColaSMS cola(canal);
+  ServicioUbicacion ubicacion(gps, cola);
+
+  // Sin moverse: un solo vértice, la respuesta sigue siendo el enlace a Google Maps
+  ubicacion.registrarFix(18.926113, -99.230733);
+  fijarReloj(30000);
+  ubicacion.registrarFix(18.926150, -99.230700);
+  String respuesta = ubicacion.responder("+5217771234567");
+  TEST_ASSERT_EQUAL_STRING("https://maps.google.com/?q=18.926150,-99.230700 (hace 0 s)", respuesta.c_str());
+
+  // Hacia el norte, ~220 m cada 30 s
+  for (int i = 1; i <= 5; i++) {
+    fijarReloj(30000 + i * 30000UL);
+    ubicacion.registrarFix(18.926150 + i * 0.002, -99.230700 - i * 0.0005);
+  }
+  fijarReloj(184000);
+  respuesta = ubicacion.responder("+5217771234567");
+  TEST_ASSERT_TRUE(respuesta.length() <= SMS_LONGITUD_MAXIMA);
+  TEST_ASSERT_TRUE(respuesta.endsWith(" (hace 4 s)"));
+
+  std::vector<Vertice> vertices = verticesDe(respuesta);
+  TEST_ASSERT_EQUAL(6, (int)vertices.size());
+  TEST_ASSERT_EQUAL_INT32(1892611, vertices[0].lat);  // El primero, donde estuvo detenido
+  TEST_ASSERT_EQUAL_INT32(1893615, vertices[5].lat);  // El último, el fix actual
+  TEST_ASSERT_EQUAL_INT32(-9923320, vertices[5].lon);
+}
+
+void test_traza_larga_se_recorta_desde_el_vertice_mas_antiguo() {
+  GPSModule gps(canal, reloj);
+  ColaSMS cola(canal);
+  ServicioUbicacion ubicacion(gps, cola);
+
+  // Más vértices de los que caben: zigzag rápido, cada diferencia ocupa varios caracteres
+  for (int i = 0; i < 28; i++) {
+    fijarReloj(i * 30000UL);
+    ubicacion.registrarFix(18.9 + i * 0.01, -99.2 + (i % 2) * 0.01);
+  }
+  String respuesta = ubicacion.responder("+5217771234567");
+  TEST_ASSERT_TRUE(respuesta.length() <= SMS_LONGITUD_MAXIMA);
+  TEST_ASSERT_TRUE(respuesta.length() > SMS_LONGITUD_MAXIMA - 10);
+
+  std::vector<Vertice> vertices = verticesDe(respuesta);
+  TEST_ASSERT_TRUE(vertices.size() > 2 && vertices.size() < 28);
+  TEST_ASSERT_EQUAL_INT32(aUnidadesPolilinea(18.9 + 27 * 0.01), vertices.back().lat);
+  TEST_ASSERT_EQUAL_INT32(aUnidadesPolilinea(-99.19), vertices.back().lon);
+  TEST_ASSERT_EQUAL_INT32(aUnidadesPolilinea(18.9 + (28 - vertices.size()) * 0.01), vertices[0].lat);
+}
+
+void test_vertices_fuera_de_la_ventana_no_se_envian() {
+  GPSModule gps(canal, reloj);
+  ColaSMS cola(canal);
+  ServicioUbicacion ubicacion(gps, cola);
+
+  ubicacion.registrarFix(18.90, -99.20);
+  fijarReloj(60000);
+  ubicacion.registrarFix(18.91, -99.20);
+  TEST_ASSERT_EQUAL(2, (int)verticesDe(ubicacion.responder("+5217771234567")).size());
+
+  // Mucho después, estacionado en el último punto: del recorrido solo queda el presente
+  fijarReloj(60000 + UBICACION_TRAZA_MS + 1000);
+  ubicacion.registrarFix(18.91, -99.20);
+  TEST_ASSERT_EQUAL_STRING("https://maps.google.com/?q=18.910000,-99.200000 (hace 0 s)",
+                           ubicacion.responder("+5217771234567").c_str());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_codifica_el_ejemplo_de_google_con_alfabeto_base64url);
+  RUN_TEST(test_respuesta_lleva_la_traza_y_termina_en_el_fix_actual);
+  RUN_TEST(test_traza_larga_se_recorta_desde_el_vertice_mas_antiguo);
+  RUN_TEST(test_vertices_fuera_de_la_ventana_no_se_envian);
+  return UNITY_END();
+}
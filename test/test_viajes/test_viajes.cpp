@@ -0,0 +1,245 @@
+// Viajes y odómetro en el dispositivo: inicio y fin, filtro del ruido estacionado,
+// tiempo ocioso, resumen diario, persistencia en NVS y eventos en la URL
+#include <unity.h>
+#include <Arduino.h>
+#include <Preferences.h>
+#include <string>
+#include "CanalAT.h"
+#include "GSMModule.h"
+#include "HTTPClient.h"
+#include "ColaReportes.h"
+#include "ControlSalidas.h"
+#include "RegistroViajes.h"
+#include "ReproductorModem.h"
+
+#define T0 1714558222UL
+#define LAT0 18.9261130
+#define LON0 (-99.2307330)
+
+// Metros al este de LON0 sobre el paralelo de LAT0
+static double alEste(double metros) {
+  return LON0 + metros / (111319.49 * cos(LAT0 * M_PI / 180.0));
+}
+
+// Un fix cada 10 s desde 'desde' durante 'segundos', 'kmh' hacia el este
+static uint32_t conducir(RegistroViajes& viajes, uint32_t desde, double& metros, uint32_t segundos, float kmh,
+                         int ignicion) {
+  uint32_t utc = desde;
+  for (uint32_t t = 10; t <= segundos; t += 10) {
+    metros += kmh / 3.6 * 10;
+    utc = desde + t;
+    viajes.registrarFix(LAT0, alEste(metros), kmh, utc, ignicion);
+  }
+  return utc;
+}
+
+void setUp() {
+  Preferences::borrarTodo();
+  fijarReloj(0);
+}
+
+void tearDown() {}
+
+void test_viaje_inicio_y_fin() {
+  RegistroViajes viajes;
+  viajes.begin();
+  double metros = 0;
+  uint32_t utc = conducir(viajes, T0, metros, 60, 0.0f, -1);  // Estacionado
+  TEST_ASSERT_FALSE(viajes.enViaje());
+
+  // 10 minutos a 36 km/h: 6 km
+  utc = conducir(viajes, utc, metros, 600, 36.0f, -1);
+  TEST_ASSERT_TRUE(viajes.enViaje());
+  uint32_t llegada = utc;
+  utc = conducir(viajes, utc, metros, VIAJES_PARADA_S - 10, 0.0f, -1);
+  TEST_ASSERT_TRUE(viajes.enViaje());  // Una parada corta no cierra el viaje
+  utc = conducir(viajes, utc, metros, 20, 0.0f, -1);
+  TEST_ASSERT_FALSE(viajes.enViaje());
+
+  TEST_ASSERT_EQUAL(2, viajes.eventosPendientes());
+  const EventoViaje& inicio = viajes.evento(0);
+  TEST_ASSERT_EQUAL(EVENTO_INICIO, inicio.tipo);
+  TEST_ASSERT_EQUAL(1, inicio.numero);
+  TEST_ASSERT_EQUAL(T0 + 70, inicio.utc);
+  TEST_ASSERT_EQUAL(lround(LON0 * 1e6), inicio.lon);  // Salida: donde estaba estacionado
+
+  // El fin es el primer fix de la parada, no el momento en que se cumplió la espera
+  const EventoViaje& fin = viajes.evento(1);
+  TEST_ASSERT_EQUAL(EVENTO_FIN, fin.tipo);
+  TEST_ASSERT_EQUAL(llegada + 10, fin.utc);
+  TEST_ASSERT_EQUAL(fin.utc - inicio.utc, fin.segundos);
+  TEST_ASSERT_EQUAL(lround(alEste(6000) * 1e6), fin.lon);
+  TEST_ASSERT_FLOAT_WITHIN(10, 6000, fin.metros);
+  TEST_ASSERT_EQUAL(360, fin.vmax);
+  TEST_ASSERT_EQUAL(0, fin.ocioso);  // Sin cable de ignición la parada no es ociosa
+  TEST_ASSERT_EQUAL(fin.metros, fin.odometro);
+
+  char texto[VIAJES_LARGO_EVENTO];
+  RegistroViajes::formatearEvento(inicio, texto, sizeof(texto));
+  TEST_ASSERT_EQUAL_STRING("i,1,1714558292,18926113,-99230733", texto);
+  RegistroViajes::formatearEvento(fin, texto, sizeof(texto));
+  TEST_ASSERT_TRUE(std::string(texto).find("f,1,1714558892,") == 0);
+}
+
+void test_ruido_estacionado_no_suma() {
+  RegistroViajes viajes;
+  viajes.begin();
+  uint32_t utc = T0;
+  // Una hora estacionado con ±8 m de ruido y velocidad residual del GNSS
+  for (int i = 0; i < 360; i++) {
+    double ruido = ((i + 1) % 3 - 1) * 8.0;
+    viajes.registrarFix(LAT0, alEste(ruido), 0.4f, utc += 10, -1);
+  }
+  // Multitrayecto: 60 m de salto con velocidad cero no es un arranque
+  viajes.registrarFix(LAT0, alEste(60), 0.0f, utc += 10, -1);
+  viajes.registrarFix(LAT0, LON0, 0.0f, utc += 10, -1);
+  TEST_ASSERT_FALSE(viajes.enViaje());
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.0, viajes.odometro());
+  TEST_ASSERT_EQUAL(0, viajes.eventosPendientes());
+
+  // En viaje, un salto de 5 km en 10 s se descarta y no suma
+  double metros = 0;
+  utc = conducir(viajes, utc, metros, 100, 36.0f, -1);
+  TEST_ASSERT_TRUE(viajes.enViaje());
+  double antes = viajes.odometro();
+  viajes.registrarFix(LAT0, alEste(metros + 5000), 36.0f, utc += 10, -1);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, antes, viajes.odometro());
+  metros += 100;
+  viajes.registrarFix(LAT0, alEste(metros), 36.0f, utc += 10, -1);
+  TEST_ASSERT_FLOAT_WITHIN(5, 1100, viajes.odometro());
+
+  // Sin hora o fuera de orden no se cuenta
+  viajes.registrarFix(LAT0, alEste(metros + 100), 36.0f, 0, -1);
+  viajes.registrarFix(LAT0, alEste(metros + 100), 36.0f, utc - 5, -1);
+  TEST_ASSERT_FLOAT_WITHIN(5, 1100, viajes.odometro());
+}
+
+void test_ocioso_con_ignicion_y_resumen() {
+  RegistroViajes viajes;
+  viajes.begin();
+  double metros = 0;
+  // Motor encendido: el viaje empieza con la ignición, aún detenido
+  viajes.registrarFix(LAT0, LON0, 0.0f, T0, 1);
+  TEST_ASSERT_TRUE(viajes.enViaje());
+  uint32_t utc = conducir(viajes, T0, metros, 120, 0.0f, 1);    // 2 min calentando
+  utc = conducir(viajes, utc, metros, 100, 36.0f, 1);           // 1 km
+  utc = conducir(viajes, utc, metros, 200, 0.0f, 1);            // Esperando con el motor encendido
+  utc = conducir(viajes, utc, metros, 60, 0.0f, 0);             // Apagado
+  TEST_ASSERT_TRUE(viajes.enViaje());
+  utc = conducir(viajes, utc, metros, 60, 0.0f, 0);
+  TEST_ASSERT_FALSE(viajes.enViaje());
+
+  TEST_ASSERT_EQUAL(2, viajes.eventosPendientes());
+  const EventoViaje& fin = viajes.evento(1);
+  TEST_ASSERT_EQUAL(T0, viajes.evento(0).utc);
+  TEST_ASSERT_EQUAL(120 + 200 - 10, fin.ocioso);  // La espera empieza en el primer fix detenido
+  TEST_ASSERT_EQUAL(230, fin.segundos);
+  TEST_ASSERT_FLOAT_WITHIN(5, 1000, fin.metros);
+
+  // Con la ignición encendida una parada larga no termina el viaje
+  utc = conducir(viajes, utc, metros, 10, 0.0f, 1);
+  utc = conducir(viajes, utc, metros, 2 * VIAJES_PARADA_S, 0.0f, 1);
+  TEST_ASSERT_TRUE(viajes.enViaje());
+  utc = conducir(viajes, utc, metros, VIAJES_PARADA_S + 10, 0.0f, 0);
+  TEST_ASSERT_FALSE(viajes.enViaje());
+  viajes.confirmarEventos(viajes.eventosPendientes());
+
+  // Un día después del primer fix, resumen del periodo
+  viajes.registrarFix(LAT0, alEste(metros), 0.0f, T0 + VIAJES_RESUMEN_S - 10, 0);
+  TEST_ASSERT_EQUAL(0, viajes.eventosPendientes());
+  viajes.registrarFix(LAT0, alEste(metros), 0.0f, T0 + VIAJES_RESUMEN_S, 0);
+  TEST_ASSERT_EQUAL(1, viajes.eventosPendientes());
+  const EventoViaje& resumen = viajes.evento(0);
+  TEST_ASSERT_EQUAL(EVENTO_RESUMEN, resumen.tipo);
+  TEST_ASSERT_EQUAL(2, resumen.numero);
+  TEST_ASSERT_FLOAT_WITHIN(5, 1000, resumen.metros);
+  TEST_ASSERT_EQUAL(360, resumen.vmax);
+  TEST_ASSERT_TRUE(resumen.ocioso > fin.ocioso);
+}
+
+void test_persistencia_con_escrituras_acotadas() {
+  double metros = 0;
+  uint32_t utc;
+  {
+    RegistroViajes viajes;
+    viajes.begin();
+    viajes.registrarFix(LAT0, LON0, 0.0f, T0, -1);
+    // 5 km a 60 km/h
+    utc = conducir(viajes, T0, metros, 300, 60.0f, -1);
+    TEST_ASSERT_TRUE(viajes.enViaje());
+    int enMarcha = viajes.escrituras();
+    TEST_ASSERT_TRUE(enMarcha <= 5);
+    // Ocho horas estacionado: solo escribe al cerrar el viaje
+    utc = conducir(viajes, utc, metros, 8 * 3600, 0.0f, -1);
+    TEST_ASSERT_FALSE(viajes.enViaje());
+    TEST_ASSERT_EQUAL(enMarcha + 2, viajes.escrituras());
+  }
+  {
+    // Reinicio: odómetro y eventos sin confirmar sobreviven
+    RegistroViajes viajes;
+    viajes.begin();
+    TEST_ASSERT_FALSE(viajes.enViaje());
+    TEST_ASSERT_FLOAT_WITHIN(10, 5000, viajes.odometro());
+    TEST_ASSERT_EQUAL(1, viajes.getEstado().numero);
+    TEST_ASSERT_EQUAL(2, viajes.eventosPendientes());
+    viajes.confirmarEventos(2);
+
+    // Un viaje en curso al reiniciarse sigue abierto con lo guardado
+    utc = conducir(viajes, utc, metros, 200, 72.0f, -1);
+    TEST_ASSERT_TRUE(viajes.enViaje());
+  }
+  {
+    RegistroViajes viajes;
+    viajes.begin();
+    TEST_ASSERT_TRUE(viajes.enViaje());
+    TEST_ASSERT_EQUAL(1, viajes.eventosPendientes());  // El inicio del segundo
+    TEST_ASSERT_EQUAL(2, viajes.getEstado().numero);
+    TEST_ASSERT_TRUE(viajes.odometro() >= 5000 + 2000 - 10);
+  }
+}
+
+void test_eventos_viajan_con_el_reporte() {
+  std::vector<RegistroUART> g;
+  g.push_back({ '>', 0, "AT+CGACT?\r\n" });
+  g.push_back({ '<', 10, "\r\n+CGACT: 1,1\r\n\r\nOK\r\n" });
+  g.push_back({ '>', 0, "AT+HTTPACTION=0\r\n" });
+  g.push_back({ '<', 10, "\r\nOK\r\n" });
+  g.push_back({ '<', 900, "\r\n+HTTPACTION: 0,200,0\r\n" });
+  ReproductorModem modem(g);
+  CanalAT canal(modem);
+  GSMModule gsm(canal, PWR_PIN, RXD1_PIN, TXD1_PIN, BAUD_RATE);
+  ControlSalidas salidas(PIN_ACTIVE, PIN_INACTIVE);
+  HTTPClient http(gsm, salidas);
+  ColaReportes reportes;
+  RegistroViajes viajes;
+  salidas.begin();
+  reportes.begin();
+  viajes.begin();
+  http.setViajes(&viajes);
+
+  double metros = 0;
+  viajes.registrarFix(LAT0, LON0, 0.0f, T0, -1);
+  uint32_t utc = conducir(viajes, T0, metros, 600, 36.0f, -1);
+  utc = conducir(viajes, utc, metros, VIAJES_PARADA_S + 10, 0.0f, -1);
+  TEST_ASSERT_EQUAL(2, viajes.eventosPendientes());
+
+  reportes.agregar(LAT0, alEste(metros), 0.0f, utc);
+  TEST_ASSERT_TRUE(http.enviarReportes(reportes));
+  TEST_ASSERT_EQUAL(2, http.eventosEnviados());
+  std::string comando = modem.enviadosCon("AT+HTTPPARA=\"URL\"")[0];
+  TEST_ASSERT_TRUE(comando.find("&viaje=i,1,1714558232,18926113,-99230733_f,1,") != std::string::npos);
+
+  // Como enviarLote(): confirmados solo tras el 200
+  viajes.confirmarEventos(http.eventosEnviados());
+  TEST_ASSERT_EQUAL(0, viajes.eventosPendientes());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_viaje_inicio_y_fin);
+  RUN_TEST(test_ruido_estacionado_no_suma);
+  RUN_TEST(test_ocioso_con_ignicion_y_resumen);
+  RUN_TEST(test_persistencia_con_escrituras_acotadas);
+  RUN_TEST(test_eventos_viajan_con_el_reporte);
+  return UNITY_END();
+}